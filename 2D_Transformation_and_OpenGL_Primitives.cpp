@@ -13,11 +13,23 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+#include "primitiveBatch.h"
+#include "polylineRenderer.h"
+#include "pathTessellator.h"
 
 using namespace std;
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow *window);
+void benchPrimitiveBatch(GLFWwindow *window, unsigned int shaderProgram, int shapeCount);
+void benchPolylines(GLFWwindow *window, unsigned int shaderProgram, int segmentCount);
+void benchPaths(GLFWwindow *window, int pathCount);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
@@ -42,7 +54,7 @@ const char *fragmentShaderSource = "#version 330 core\n"
     "   FragColor = vec4(1.0f, 0.5f, 0.2f, 1.0f);\n"
     "}\n\0";
 
-int main()
+int main(int argc, char **argv)
 {
     // glfw: initialize and configure
     // ------------------------------
@@ -172,6 +184,28 @@ int main()
     // uncomment this call to draw in wireframe polygons.
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
+    // benchmark mode: ./triangle --bench-batch [shapes per frame]
+    if (argc > 1 && string(argv[1]) == "--bench-batch")
+    {
+        benchPrimitiveBatch(window, shaderProgram, argc > 2 ? atoi(argv[2]) : 100000);
+        glfwTerminate();
+        return 0;
+    }
+    // benchmark mode: ./triangle --bench-lines [segments per frame]
+    if (argc > 1 && string(argv[1]) == "--bench-lines")
+    {
+        benchPolylines(window, shaderProgram, argc > 2 ? atoi(argv[2]) : 1000000);
+        glfwTerminate();
+        return 0;
+    }
+    // benchmark mode: ./triangle --bench-paths [paths]
+    if (argc > 1 && string(argv[1]) == "--bench-paths")
+    {
+        benchPaths(window, argc > 2 ? atoi(argv[2]) : 5000);
+        glfwTerminate();
+        return 0;
+    }
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
@@ -284,6 +318,402 @@ void processInput(GLFWwindow *window)
     }
 }
 
+// Draws shapeCount small shapes per frame, each with its own transform, cycling through
+// a triangle (GL_TRIANGLES), a quad (GL_TRIANGLE_STRIP), a hexagon (GL_TRIANGLE_FAN) and
+// a pentagon outline (GL_LINE_LOOP). First as above: one static VBO with the four shapes,
+// a transform uniform and a glDrawArrays per shape; then pushed into a PrimitiveBatch and
+// drawn with one flush. Reports CPU time to submit a frame and frame time with glFinish.
+void benchPrimitiveBatch(GLFWwindow *window, unsigned int shaderProgram, int shapeCount)
+{
+    const int WARMUP_FRAMES = 10;
+    const int FRAMES = 100;
+    const GLenum modes[] = { GL_TRIANGLES, GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN, GL_LINE_LOOP };
+    
+    // the four shapes one after another, 3 floats per vertex like vertices[] above
+    vector<float> shapeVertices;
+    int first[4], count[4];
+    first[0] = 0;
+    float triangle[] = { -0.5f, -0.5f, 0.0f,   0.5f, -0.5f, 0.0f,   0.0f, 0.5f, 0.0f };
+    shapeVertices.insert(shapeVertices.end(), triangle, triangle + 9);
+    count[0] = 3;
+    first[1] = 3;
+    float quad[] = { -0.5f, -0.5f, 0.0f,   0.5f, -0.5f, 0.0f,   -0.5f, 0.5f, 0.0f,   0.5f, 0.5f, 0.0f };
+    shapeVertices.insert(shapeVertices.end(), quad, quad + 12);
+    count[1] = 4;
+    first[2] = 7;
+    shapeVertices.push_back(0.0f); shapeVertices.push_back(0.0f); shapeVertices.push_back(0.0f);
+    for (int i = 0; i <= 6; i++)
+    {
+        float angle = glm::radians(60.0f * i);
+        shapeVertices.push_back(0.5f * cosf(angle)); shapeVertices.push_back(0.5f * sinf(angle)); shapeVertices.push_back(0.0f);
+    }
+    count[2] = 8;
+    first[3] = 15;
+    for (int i = 0; i < 5; i++)
+    {
+        float angle = glm::radians(90.0f + 72.0f * i);
+        shapeVertices.push_back(0.5f * cosf(angle)); shapeVertices.push_back(0.5f * sinf(angle)); shapeVertices.push_back(0.0f);
+    }
+    count[3] = 5;
+    
+    unsigned int VBO, VAO;
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, shapeVertices.size() * sizeof(float), shapeVertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    
+    // shapes on a grid over the window, each turned by its own angle
+    int side = (int)ceilf(sqrtf((float)shapeCount));
+    float cell = 2.0f / side;
+    vector<glm::mat4> models(shapeCount);
+    for (int i = 0; i < shapeCount; i++)
+    {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f + (i % side + 0.5f) * cell, -1.0f + (i / side + 0.5f) * cell, 0.0f));
+        model = glm::rotate(model, glm::radians((float)(i * 7 % 360)), glm::vec3(0.0f, 0.0f, 1.0f));
+        models[i] = glm::scale(model, glm::vec3(cell * 0.8f, cell * 0.8f, 1.0f));
+    }
+    glm::vec4 colors[] = { glm::vec4(1.0f, 0.5f, 0.2f, 1.0f), glm::vec4(0.2f, 0.7f, 1.0f, 1.0f), glm::vec4(0.4f, 1.0f, 0.3f, 1.0f), glm::vec4(1.0f, 1.0f, 1.0f, 1.0f) };
+    
+    PrimitiveBatch batch;
+    glfwSwapInterval(0);
+    const char *runs[] = { "glDrawArrays per shape", "PrimitiveBatch" };
+    double cpuMs[2], frameMs[2];
+    int drawCalls[2];
+    for (int run = 0; run < 2; run++)
+    {
+        double cpuTotal = 0.0, frameTotal = 0.0;
+        for (int frame = 0; frame < WARMUP_FRAMES + FRAMES; frame++)
+        {
+            chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            if (run == 0)
+            {
+                glUseProgram(shaderProgram);
+                unsigned int transformLoc = glGetUniformLocation(shaderProgram, "transform");
+                glBindVertexArray(VAO);
+                for (int i = 0; i < shapeCount; i++)
+                {
+                    glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(models[i]));
+                    glDrawArrays(modes[i % 4], first[i % 4], count[i % 4]);
+                }
+                drawCalls[run] = shapeCount;
+            }
+            else
+            {
+                for (int i = 0; i < shapeCount; i++)
+                {
+                    batch.setTransform(models[i]);
+                    batch.add(modes[i % 4], &shapeVertices[first[i % 4] * 3], count[i % 4], colors[i % 4]);
+                }
+                batch.flush();
+                drawCalls[run] = batch.getDrawCallCount();
+            }
+            chrono::high_resolution_clock::time_point submitted = chrono::high_resolution_clock::now();
+            glFinish();
+            chrono::high_resolution_clock::time_point finished = chrono::high_resolution_clock::now();
+            if (frame >= WARMUP_FRAMES)
+            {
+                cpuTotal += chrono::duration<double, milli>(submitted - start).count();
+                frameTotal += chrono::duration<double, milli>(finished - start).count();
+            }
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+        cpuMs[run] = cpuTotal / FRAMES;
+        frameMs[run] = frameTotal / FRAMES;
+    }
+    
+    cout << "primitive batch: " << shapeCount << " shapes per frame, stream buffer "
+         << (batch.isPersistent() ? "persistently mapped" : "orphaned") << endl;
+    cout << left << setw(28) << "path" << right << setw(12) << "draw calls" << setw(12) << "cpu ms" << setw(12) << "frame ms" << endl;
+    for (int run = 0; run < 2; run++)
+        cout << left << setw(28) << runs[run] << right << setw(12) << drawCalls[run] << fixed << setprecision(3)
+             << setw(12) << cpuMs[run] << setw(12) << frameMs[run] << endl;
+    
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+}
+
+// Draws segmentCount segments per frame as plot traces of 1000 segments each, stacked
+// over the window. First as the demo draws lines: the traces in one static VBO and a
+// GL_LINE_STRIP glDrawArrays per trace, one pixel wide and one color; then streamed into
+// a PolylineRenderer every frame, 1 to 4 pixels wide with a color per point, with miter
+// and with bevel joins. Reports CPU time to submit a frame and frame time with glFinish.
+void benchPolylines(GLFWwindow *window, unsigned int shaderProgram, int segmentCount)
+{
+    const int WARMUP_FRAMES = 10;
+    const int FRAMES = 100;
+    const int TRACE_POINTS = 1001;
+    int traceCount = glm::max(segmentCount / (TRACE_POINTS - 1), 1);
+    
+    vector<glm::vec2> points(traceCount * TRACE_POINTS);
+    vector<float> widths(points.size());
+    vector<glm::vec4> colors(points.size());
+    vector<float> stripVertices(points.size() * 3);
+    for (int t = 0; t < traceCount; t++)
+    {
+        float baseline = -1.0f + (t + 0.5f) * 2.0f / traceCount;
+        for (int i = 0; i < TRACE_POINTS; i++)
+        {
+            int k = t * TRACE_POINTS + i;
+            float x = -1.0f + 2.0f * i / (TRACE_POINTS - 1);
+            float wave = sinf(x * (8.0f + t % 13) + t * 0.37f);
+            points[k] = glm::vec2(x, baseline + wave * 0.6f / traceCount + 0.02f * sinf(x * 97.0f + t));
+            widths[k] = 2.5f + 1.5f * wave;
+            colors[k] = glm::vec4(0.5f + 0.5f * wave, 0.4f, 0.5f - 0.5f * wave, 1.0f);
+            stripVertices[k * 3] = points[k].x;
+            stripVertices[k * 3 + 1] = points[k].y;
+            stripVertices[k * 3 + 2] = 0.0f;
+        }
+    }
+    
+    unsigned int VBO, VAO;
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, stripVertices.size() * sizeof(float), stripVertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    glm::mat4 identity = glm::mat4(1.0f);
+    PolylineRenderer lines;
+    glfwSwapInterval(0);
+    const char *runs[] = { "GL_LINE_STRIP per trace", "PolylineRenderer miter", "PolylineRenderer bevel" };
+    double cpuMs[3], frameMs[3];
+    int drawCalls[3];
+    for (int run = 0; run < 3; run++)
+    {
+        lines.setJoin(run == 2 ? JOIN_BEVEL : JOIN_MITER);
+        double cpuTotal = 0.0, frameTotal = 0.0;
+        for (int frame = 0; frame < WARMUP_FRAMES + FRAMES; frame++)
+        {
+            chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            if (run == 0)
+            {
+                glUseProgram(shaderProgram);
+                glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "transform"), 1, GL_FALSE, glm::value_ptr(identity));
+                glBindVertexArray(VAO);
+                for (int t = 0; t < traceCount; t++)
+                    glDrawArrays(GL_LINE_STRIP, t * TRACE_POINTS, TRACE_POINTS);
+                drawCalls[run] = traceCount;
+            }
+            else
+            {
+                for (int t = 0; t < traceCount; t++)
+                {
+                    int k = t * TRACE_POINTS;
+                    lines.add(&points[k], &widths[k], &colors[k], TRACE_POINTS);
+                }
+                lines.flush(identity, width, height);
+                drawCalls[run] = 1;
+            }
+            chrono::high_resolution_clock::time_point submitted = chrono::high_resolution_clock::now();
+            glFinish();
+            chrono::high_resolution_clock::time_point finished = chrono::high_resolution_clock::now();
+            if (frame >= WARMUP_FRAMES)
+            {
+                cpuTotal += chrono::duration<double, milli>(submitted - start).count();
+                frameTotal += chrono::duration<double, milli>(finished - start).count();
+            }
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+        cpuMs[run] = cpuTotal / FRAMES;
+        frameMs[run] = frameTotal / FRAMES;
+    }
+    
+    cout << "polylines: " << traceCount << " traces, " << traceCount * (TRACE_POINTS - 1) << " segments per frame, stream buffer "
+         << (lines.isPersistent() ? "persistently mapped" : "orphaned") << endl;
+    cout << left << setw(28) << "path" << right << setw(12) << "draw calls" << setw(12) << "cpu ms" << setw(12) << "frame ms" << endl;
+    for (int run = 0; run < 3; run++)
+        cout << left << setw(28) << runs[run] << right << setw(12) << drawCalls[run] << fixed << setprecision(3)
+             << setw(12) << cpuMs[run] << setw(12) << frameMs[run] << endl;
+    
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+}
+
+// A set of paths like the shapes of an SVG drawing, within [-1, 1]: circles and rounded
+// rectangles of cubics, blobs of quadratics, pentagrams that cross themselves and rings
+// whose hole runs the same way as the outside, so the two fill rules differ
+vector<Path> makeBenchPaths(int pathCount)
+{
+    vector<Path> paths(pathCount);
+    const float k = 0.5522847f;  // cubic control distance of a quarter circle
+    for (int i = 0; i < pathCount; i++)
+    {
+        Path &path = paths[i];
+        switch (i % 5)
+        {
+        case 0:
+            path.moveTo(glm::vec2(1.0f, 0.0f));
+            path.cubicTo(glm::vec2(1.0f, k), glm::vec2(k, 1.0f), glm::vec2(0.0f, 1.0f));
+            path.cubicTo(glm::vec2(-k, 1.0f), glm::vec2(-1.0f, k), glm::vec2(-1.0f, 0.0f));
+            path.cubicTo(glm::vec2(-1.0f, -k), glm::vec2(-k, -1.0f), glm::vec2(0.0f, -1.0f));
+            path.cubicTo(glm::vec2(k, -1.0f), glm::vec2(1.0f, -k), glm::vec2(1.0f, 0.0f));
+            path.close();
+            break;
+        case 1:
+        {
+            float r = 0.3f;
+            path.moveTo(glm::vec2(-1.0f + r, -0.6f));
+            path.lineTo(glm::vec2(1.0f - r, -0.6f));
+            path.cubicTo(glm::vec2(1.0f - r + r * k, -0.6f), glm::vec2(1.0f, -0.6f + r - r * k), glm::vec2(1.0f, -0.6f + r));
+            path.lineTo(glm::vec2(1.0f, 0.6f - r));
+            path.cubicTo(glm::vec2(1.0f, 0.6f - r + r * k), glm::vec2(1.0f - r + r * k, 0.6f), glm::vec2(1.0f - r, 0.6f));
+            path.lineTo(glm::vec2(-1.0f + r, 0.6f));
+            path.cubicTo(glm::vec2(-1.0f + r - r * k, 0.6f), glm::vec2(-1.0f, 0.6f - r + r * k), glm::vec2(-1.0f, 0.6f - r));
+            path.lineTo(glm::vec2(-1.0f, -0.6f + r));
+            path.cubicTo(glm::vec2(-1.0f, -0.6f + r - r * k), glm::vec2(-1.0f + r - r * k, -0.6f), glm::vec2(-1.0f + r, -0.6f));
+            path.close();
+            break;
+        }
+        case 2:
+        {
+            const int LOBES = 12;
+            for (int j = 0; j < LOBES; j++)
+            {
+                float angle = glm::radians(360.0f * j / LOBES);
+                float middle = glm::radians(360.0f * (j + 0.5f) / LOBES);
+                float radius = 0.6f + 0.3f * sinf((float)(i * 3 + j * 5));
+                glm::vec2 p = radius * glm::vec2(cosf(angle), sinf(angle));
+                if (j == 0)
+                    path.moveTo(p);
+                float next = glm::radians(360.0f * (j + 1) / LOBES);
+                float nextRadius = 0.6f + 0.3f * sinf((float)(i * 3 + (j + 1) % LOBES * 5));
+                path.quadTo(1.3f * glm::vec2(cosf(middle), sinf(middle)), nextRadius * glm::vec2(cosf(next), sinf(next)));
+            }
+            path.close();
+            break;
+        }
+        case 3:
+            for (int j = 0; j < 5; j++)
+            {
+                float angle = glm::radians(90.0f + 144.0f * j);
+                glm::vec2 p(cosf(angle), sinf(angle));
+                if (j == 0)
+                    path.moveTo(p);
+                else
+                    path.lineTo(p);
+            }
+            path.close();
+            break;
+        case 4:
+            for (int ring = 0; ring < 2; ring++)
+            {
+                float r = ring == 0 ? 1.0f : 0.55f;
+                path.moveTo(glm::vec2(r, 0.0f));
+                path.cubicTo(glm::vec2(r, r * k), glm::vec2(r * k, r), glm::vec2(0.0f, r));
+                path.cubicTo(glm::vec2(-r * k, r), glm::vec2(-r, r * k), glm::vec2(-r, 0.0f));
+                path.cubicTo(glm::vec2(-r, -r * k), glm::vec2(-r * k, -r), glm::vec2(0.0f, -r));
+                path.cubicTo(glm::vec2(r * k, -r), glm::vec2(r, -r * k), glm::vec2(r, 0.0f));
+                path.close();
+            }
+            break;
+        }
+    }
+    return paths;
+}
+
+// Tessellates pathCount paths (makeBenchPaths) and reports throughput for both fill
+// rules, then draws them on a grid turning every frame through a PrimitiveBatch: once
+// tessellating every path every frame, once from the fills cached in the paths, which
+// the turning alone does not invalidate. Reports CPU time to submit a frame and frame
+// time with glFinish.
+void benchPaths(GLFWwindow *window, int pathCount)
+{
+    const int TESSELLATE_REPEATS = 10;
+    const int WARMUP_FRAMES = 10;
+    const int FRAMES = 100;
+    vector<Path> paths = makeBenchPaths(pathCount);
+    
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    int side = (int)ceilf(sqrtf((float)pathCount));
+    float cell = 2.0f / side;
+    float tolerance = pathTolerance(glm::scale(glm::mat4(1.0f), glm::vec3(cell * 0.45f, cell * 0.45f, 1.0f)), height);
+    
+    FillTessellator tessellator;
+    PathFill fill;
+    const char *rules[] = { "nonzero", "even-odd" };
+    cout << "paths: " << pathCount << " paths, tolerance " << tolerance << " path units" << endl;
+    cout << left << setw(28) << "tessellation" << right << setw(14) << "paths/s" << setw(14) << "edges/s" << setw(14) << "triangles" << endl;
+    for (int rule = 0; rule < 2; rule++)
+    {
+        long long edges = 0, triangles = 0;
+        chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+        for (int repeat = 0; repeat < TESSELLATE_REPEATS; repeat++)
+            for (int i = 0; i < pathCount; i++)
+            {
+                tessellator.tessellate(paths[i], (FillRule)rule, tolerance, fill);
+                edges += fill.edgeCount;
+                triangles += fill.indices.size() / 3;
+            }
+        double seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+        cout << left << setw(28) << rules[rule] << right << fixed << setprecision(0) << setw(14) << pathCount * TESSELLATE_REPEATS / seconds
+             << setw(14) << edges / seconds << setw(14) << triangles / TESSELLATE_REPEATS << endl;
+    }
+    
+    glm::vec4 colors[] = { glm::vec4(1.0f, 0.5f, 0.2f, 1.0f), glm::vec4(0.2f, 0.7f, 1.0f, 1.0f), glm::vec4(0.4f, 1.0f, 0.3f, 1.0f),
+                           glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), glm::vec4(0.9f, 0.3f, 0.6f, 1.0f) };
+    PrimitiveBatch batch;
+    glfwSwapInterval(0);
+    const char *runs[] = { "tessellate every frame", "cached fills" };
+    double cpuMs[2], frameMs[2];
+    for (int run = 0; run < 2; run++)
+    {
+        double cpuTotal = 0.0, frameTotal = 0.0;
+        for (int frame = 0; frame < WARMUP_FRAMES + FRAMES; frame++)
+        {
+            chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            for (int i = 0; i < pathCount; i++)
+            {
+                glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f + (i % side + 0.5f) * cell, -1.0f + (i / side + 0.5f) * cell, 0.0f));
+                model = glm::rotate(model, glm::radians((float)(frame * 2 + i * 7 % 360)), glm::vec3(0.0f, 0.0f, 1.0f));
+                model = glm::scale(model, glm::vec3(cell * 0.45f, cell * 0.45f, 1.0f));
+                FillRule rule = i % 10 < 5 ? FILL_NONZERO : FILL_EVEN_ODD;
+                const PathFill *pathFill = &fill;
+                if (run == 0)
+                    tessellator.tessellate(paths[i], rule, tolerance, fill);
+                else
+                    pathFill = &paths[i].getFill(tessellator, rule, tolerance);
+                batch.setTransform(model);
+                batch.addTriangles(pathFill->vertices.data(), (int)pathFill->vertices.size(), pathFill->indices.data(), (int)pathFill->indices.size(), colors[i % 5]);
+            }
+            batch.flush();
+            chrono::high_resolution_clock::time_point submitted = chrono::high_resolution_clock::now();
+            glFinish();
+            chrono::high_resolution_clock::time_point finished = chrono::high_resolution_clock::now();
+            if (frame >= WARMUP_FRAMES)
+            {
+                cpuTotal += chrono::duration<double, milli>(submitted - start).count();
+                frameTotal += chrono::duration<double, milli>(finished - start).count();
+            }
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+        cpuMs[run] = cpuTotal / FRAMES;
+        frameMs[run] = frameTotal / FRAMES;
+    }
+    
+    cout << left << setw(28) << "drawing" << right << setw(14) << "cpu ms" << setw(14) << "frame ms" << endl;
+    for (int run = 0; run < 2; run++)
+        cout << left << setw(28) << runs[run] << right << fixed << setprecision(3) << setw(14) << cpuMs[run] << setw(14) << frameMs[run] << endl;
+}
+
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 // ---------------------------------------------------------------------------------------------
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
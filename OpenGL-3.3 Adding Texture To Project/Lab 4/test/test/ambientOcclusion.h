@@ -0,0 +1,302 @@
+//
+//  ambientOcclusion.h
+//  test
+//
+
+#ifndef ambientOcclusion_h
+#define ambientOcclusion_h
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "shader.h"
+#include "profiler.h"
+#include "renderTargetPool.h"
+
+using namespace std;
+
+// the lighting shaders read the occlusion from this unit, below the point shadow maps
+const int SSAO_TEXTURE_UNIT = 8;
+// hemisphere samples per pixel, KERNEL_SIZE in fragmentShaderForSSAO.fs
+const int SSAO_KERNEL_SIZE = 16;
+// side of the tile of kernel rotations, which the blur averages out
+const int SSAO_NOISE_SIZE = 4;
+
+// Screen-space ambient occlusion, multiplied into the ambient term of the lighting shaders.
+// Everything but the last pass runs at half resolution: the depth buffer is turned into
+// half size view space distance, a rotated hemisphere kernel of SSAO_KERNEL_SIZE samples
+// is tested against it (with the G-buffer normals when there is one, else normals rebuilt
+// from the depth), and a depth-aware 4x4 blur removes the rotation pattern. A joint
+// bilateral upsample against the full resolution depth brings it back to screen size
+// without smearing it across silhouettes. Each pass is a profiler scope "ssao <name>".
+//
+// The deferred path passes its G-buffer depth and normals to run(). The forward path
+// has no depth to sample before it shades, so its depth pre-pass goes into a depth
+// texture here (beginDepthPass()/endDepthPass()) and is copied into the scene target.
+class AmbientOcclusion{
+public:
+    bool enabled = true;
+    float radius = 0.5f;            // view space reach of the kernel
+    float bias = 0.025f;            // keeps a surface from occluding itself
+    float depthTolerance = 0.05f;   // relative depth difference the blur and upsample still treat as one surface
+
+    AmbientOcclusion(const string &shaderDirectory, Profiler &profiler) :
+        depthShader((shaderDirectory + "vertexShaderForFullscreen.vs").c_str(), (shaderDirectory + "fragmentShaderForSSAODepth.fs").c_str()),
+        occlusionShader((shaderDirectory + "vertexShaderForFullscreen.vs").c_str(), (shaderDirectory + "fragmentShaderForSSAO.fs").c_str()),
+        blurShader((shaderDirectory + "vertexShaderForFullscreen.vs").c_str(), (shaderDirectory + "fragmentShaderForSSAOBlur.fs").c_str()),
+        upsampleShader((shaderDirectory + "vertexShaderForFullscreen.vs").c_str(), (shaderDirectory + "fragmentShaderForSSAOUpsample.fs").c_str()),
+        profiler(profiler)
+    {
+        // fixed seed, so the pattern is the same every run
+        mt19937 random(1);
+        uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+        // hemisphere around +z, samples scaled towards the center where occlusion matters most
+        occlusionShader.use();
+        for(int i = 0; i < SSAO_KERNEL_SIZE; i++)
+        {
+            glm::vec3 sample = glm::normalize(glm::vec3(unit(random) * 2.0f - 1.0f, unit(random) * 2.0f - 1.0f, unit(random)));
+            float scale = (float)i / SSAO_KERNEL_SIZE;
+            sample *= unit(random) * glm::mix(0.1f, 1.0f, scale * scale);
+            occlusionShader.setVec3("samples[" + to_string(i) + "]", sample);
+        }
+        occlusionShader.setInt("linearDepth", 0);
+        occlusionShader.setInt("normalMap", 1);
+        occlusionShader.setInt("noise", 2);
+
+        // random rotations around z
+        vector<float> noise;
+        for(int i = 0; i < SSAO_NOISE_SIZE * SSAO_NOISE_SIZE; i++)
+        {
+            noise.push_back(unit(random) * 2.0f - 1.0f);
+            noise.push_back(unit(random) * 2.0f - 1.0f);
+            noise.push_back(0.0f);
+        }
+        glGenTextures(1, &noiseTexture);
+        glBindTexture(GL_TEXTURE_2D, noiseTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, SSAO_NOISE_SIZE, SSAO_NOISE_SIZE, 0, GL_RGB, GL_FLOAT, noise.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        depthShader.use();
+        depthShader.setInt("depthMap", 0);
+        blurShader.use();
+        blurShader.setInt("occlusion", 0);
+        blurShader.setInt("linearDepth", 1);
+        upsampleShader.use();
+        upsampleShader.setInt("occlusion", 0);
+        upsampleShader.setInt("linearDepth", 1);
+        upsampleShader.setInt("depthMap", 2);
+
+        // the fullscreen triangle has no attributes, but core profile still needs a VAO bound
+        glGenVertexArrays(1, &emptyVAO);
+    }
+
+    ~AmbientOcclusion()
+    {
+        deleteDepthTarget();
+        glDeleteTextures(1, &noiseTexture);
+        glDeleteVertexArrays(1, &emptyVAO);
+    }
+
+    // forward path: binds a cleared depth-only target for the depth pre-pass, since the
+    // depth renderbuffer of the scene target cannot be sampled
+    void beginDepthPass(int width, int height)
+    {
+        if(width != depthWidth || height != depthHeight)
+        {
+            deleteDepthTarget();
+            createDepthTarget(width, height);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
+        glViewport(0, 0, width, height);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    // copies the pre-pass depth into targetFBO, where the color pass tests against it, and binds it
+    void endDepthPass(unsigned int targetFBO)
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, depthFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFBO);
+        glBlitFramebuffer(0, 0, depthWidth, depthHeight, 0, 0, depthWidth, depthHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+    }
+
+    unsigned int getDepthTexture() const
+    {
+        return depthTexture;
+    }
+
+    // occlusion of the frame from a width x height depth texture, with the world space
+    // normals of normalTexture or, for 0, normals rebuilt from the depth; binds targetFBO at that size afterwards
+    void run(unsigned int depthTexture, unsigned int normalTexture, const glm::mat4 &projection, const glm::mat4 &view, int width, int height, unsigned int targetFBO = 0)
+    {
+        // the last frame's result was read by its lighting, the pool can hand it out again
+        pool.release(result);
+        pool.endFrame();
+        this->width = width;
+        this->height = height;
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glBindVertexArray(emptyVAO);
+        glm::vec2 depthParameters(projection[2][2], projection[3][2]);
+
+        RenderTarget *linearDepth = beginPass("depth", GL_R32F, 2);
+        depthShader.use();
+        depthShader.setVec2("depthParameters", depthParameters);
+        bindTexture(0, depthTexture);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        endPass();
+
+        RenderTarget *occlusion = beginPass("occlusion", GL_R8, 2);
+        occlusionShader.use();
+        occlusionShader.setBool("useNormalMap", normalTexture != 0);
+        occlusionShader.setMat4("projection", projection);
+        occlusionShader.setMat4("view", view);
+        occlusionShader.setFloat("radius", radius);
+        occlusionShader.setFloat("bias", bias);
+        bindTexture(0, linearDepth->texture);
+        bindTexture(1, normalTexture);
+        bindTexture(2, noiseTexture);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        endPass();
+
+        RenderTarget *blurred = beginPass("blur", GL_R8, 2);
+        blurShader.use();
+        blurShader.setFloat("depthTolerance", depthTolerance);
+        bindTexture(0, occlusion->texture);
+        bindTexture(1, linearDepth->texture);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        endPass();
+        pool.release(occlusion);
+
+        result = beginPass("upsample", GL_R8, 1);
+        upsampleShader.use();
+        upsampleShader.setVec2("depthParameters", depthParameters);
+        upsampleShader.setFloat("depthTolerance", depthTolerance);
+        bindTexture(0, blurred->texture);
+        bindTexture(1, linearDepth->texture);
+        bindTexture(2, depthTexture);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        endPass();
+        pool.release(blurred);
+        pool.release(linearDepth);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindVertexArray(0);
+        glEnable(GL_DEPTH_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+        glViewport(0, 0, width, height);
+    }
+
+    // every shader that declares the occlusion uniforms needs this each frame; while
+    // disabled, or before the first run(), the ambient terms are left alone
+    void setUpOcclusion(Shader &shader)
+    {
+        shader.use();
+        shader.setBool("ssaoOn", enabled && result);
+        shader.setInt("ssaoMap", SSAO_TEXTURE_UNIT);
+        glActiveTexture(GL_TEXTURE0 + SSAO_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D, result ? result->texture : 0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void report(ostream &out = cout) const
+    {
+        const char *passes[] = { "depth", "occlusion", "blur", "upsample" };
+        out << "ambient occlusion: " << SSAO_KERNEL_SIZE << " samples at " << max(width / 2, 1) << "x" << max(height / 2, 1)
+            << ", radius " << radius << ", " << fixed << setprecision(1) << pool.getAllocatedBytes() / (1024.0 * 1024.0) << " MB" << endl;
+        double total = 0.0;
+        for(int i = 0; i < 4; i++)
+        {
+            double ms = profiler.getSmoothedGpuTime(string("ssao ") + passes[i]);
+            total += ms;
+            out << "  " << left << setw(26) << passes[i] << right << fixed << setprecision(3) << setw(10) << ms << " ms" << endl;
+        }
+        out << "  " << left << setw(26) << "total" << right << fixed << setprecision(3) << setw(10) << total << " ms" << endl;
+    }
+
+private:
+    Shader depthShader;
+    Shader occlusionShader;
+    Shader blurShader;
+    Shader upsampleShader;
+    Profiler &profiler;
+    RenderTargetPool pool;
+    RenderTarget *result = NULL;        // full resolution occlusion, read by this frame's lighting
+    unsigned int noiseTexture = 0;
+    unsigned int emptyVAO = 0;
+    unsigned int depthFBO = 0;
+    unsigned int depthTexture = 0;
+    int depthWidth = 0;
+    int depthHeight = 0;
+    int width = 0;
+    int height = 0;
+
+    AmbientOcclusion(const AmbientOcclusion&);
+    AmbientOcclusion& operator=(const AmbientOcclusion&);
+
+    // binds a pooled target of this format at 1/divisor of the screen size for a pass
+    RenderTarget* beginPass(const string &name, GLenum internalFormat, int divisor)
+    {
+        RenderTargetDesc desc = { max(width / divisor, 1), max(height / divisor, 1), internalFormat, false, 1 };
+        RenderTarget *output = pool.acquire(desc);
+        profiler.begin("ssao " + name);
+        glBindFramebuffer(GL_FRAMEBUFFER, output->FBO);
+        glViewport(0, 0, desc.width, desc.height);
+        return output;
+    }
+
+    void endPass()
+    {
+        profiler.end();
+    }
+
+    static void bindTexture(int unit, unsigned int texture)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+    }
+
+    // same format as the scene target's depth so it can be blitted there
+    void createDepthTarget(int width, int height)
+    {
+        depthWidth = width;
+        depthHeight = height;
+        glGenTextures(1, &depthTexture);
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glGenFramebuffers(1, &depthFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ambient occlusion depth framebuffer is not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void deleteDepthTarget()
+    {
+        if(!depthFBO)
+            return;
+        glDeleteFramebuffers(1, &depthFBO);
+        glDeleteTextures(1, &depthTexture);
+        depthFBO = 0;
+        depthTexture = 0;
+    }
+};
+
+#endif /* ambientOcclusion_h */
@@ -0,0 +1,1098 @@
+//
+//  benchmark.h
+//  test
+//
+
+#ifndef benchmark_h
+#define benchmark_h
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <thread>
+#include <string>
+#include <vector>
+#include "shader.h"
+#include "camera.h"
+#include "sphere.h"
+#include "cube.h"
+#include "meshFile.h"
+#include "meshImporter.h"
+#include "scene.h"
+#include "materialBuffer.h"
+#include "furniture.h"
+#include "meshPool.h"
+#include "gpuCulling.h"
+#include "transformBuffer.h"
+#include "profiler.h"
+#include "postProcess.h"
+#include "pathTracer.h"
+
+using namespace std;
+
+// Benchmark modes are selected from the command line in main(). Each one renders
+// a fixed number of frames with vsync off, drops the warm-up frames and prints
+// the averaged profiler scopes.
+const int BENCHMARK_WARMUP_FRAMES = 30;
+const int BENCHMARK_FRAMES = 300;
+
+// grid of high-tessellation spheres, measures vertex throughput of the lit shader
+void benchVertexThroughput(GLFWwindow *window, Shader &lightingShader, TransformBuffer &transforms, Profiler &profiler)
+{
+    const int GRID = 6;
+    Sphere sphere = Sphere(0.4f, 512, 256);
+    
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 100.0f);
+    glm::vec3 eye = glm::vec3(0.0f, 0.0f, 8.0f);
+    glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    
+    lightingShader.use();
+    lightingShader.setVec3("viewPos", eye);
+    glfwSwapInterval(0);
+    
+    for(int frame = 0; frame < BENCHMARK_WARMUP_FRAMES + BENCHMARK_FRAMES; frame++)
+    {
+        if(frame == BENCHMARK_WARMUP_FRAMES)
+            profiler.reset();
+        profiler.beginFrame();
+        
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        
+        profiler.begin("transforms");
+        transforms.begin(view, projection);
+        int first = transforms.getCount();
+        for(int i = 0; i < GRID; i++)
+            for(int j = 0; j < GRID; j++)
+                transforms.add(sphere.getModelMatrix(glm::translate(glm::mat4(1.0f), glm::vec3((i - GRID / 2) * 1.0f + 0.5f, (j - GRID / 2) * 1.0f + 0.5f, 0.0f))));
+        transforms.bind(lightingShader);
+        profiler.end();
+        
+        profiler.begin("spheres");
+        for(int i = 0; i < GRID * GRID; i++)
+            sphere.drawSphere(lightingShader, first + i);
+        profiler.end();
+        
+        profiler.endFrame();
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+    profiler.finish();
+    
+    double ms = profiler.getGpuTime("spheres");
+    double indices = (double)sphere.getIndexCount() * GRID * GRID;
+    double vertices = (double)sphere.getVertexCount() * GRID * GRID;
+    cout << "vertex throughput: " << GRID * GRID << " x Sphere(0.4, 512, 256), "
+         << sphere.getVertexCount() << " vertices / " << sphere.getIndexCount() << " indices each" << endl;
+    profiler.report();
+    if(ms > 0.0)
+    {
+        cout << "  " << indices / (ms * 1000.0) << " M indices/s, "
+             << vertices / (ms * 1000.0) << " M unique vertices/s" << endl;
+    }
+}
+
+// A 6x6 grid of Sphere(0.4, 256, 128) drawn with 24-byte float vertices and 32-bit
+// indices, then with 12-byte packed vertices and 16-bit indices (33k vertices per
+// level, so the short indices fit). Reports GPU time and the vertex and index bytes
+// the draws fetch per frame (each vertex counted once).
+void benchVertexFormat(GLFWwindow *window, Shader &lightingShader, TransformBuffer &transforms, Profiler &profiler)
+{
+    const int GRID = 6;
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 100.0f);
+    glm::vec3 eye = glm::vec3(0.0f, 0.0f, 8.0f);
+    glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    lightingShader.use();
+    lightingShader.setVec3("viewPos", eye);
+    glfwSwapInterval(0);
+    
+    const char *runs[] = { "float", "compact" };
+    for(int run = 0; run < 2; run++)
+    {
+        Sphere sphere = Sphere(0.4f, 256, 128, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.5f), 32.0f, false, UV_SPHERE, run == 1);
+        for(int frame = 0; frame < BENCHMARK_WARMUP_FRAMES + BENCHMARK_FRAMES; frame++)
+        {
+            if(frame == BENCHMARK_WARMUP_FRAMES)
+                profiler.reset();
+            profiler.beginFrame();
+            
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            
+            transforms.begin(view, projection);
+            int first = transforms.getCount();
+            for(int i = 0; i < GRID; i++)
+                for(int j = 0; j < GRID; j++)
+                    transforms.add(sphere.getModelMatrix(glm::translate(glm::mat4(1.0f), glm::vec3((i - GRID / 2) * 1.0f + 0.5f, (j - GRID / 2) * 1.0f + 0.5f, 0.0f))));
+            transforms.bind(lightingShader);
+            
+            profiler.begin(string("spheres ") + runs[run]);
+            for(int i = 0; i < GRID * GRID; i++)
+                sphere.drawSphere(lightingShader, first + i);
+            profiler.end();
+            
+            profiler.endFrame();
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+        profiler.finish();
+        
+        double ms = profiler.getGpuTime(string("spheres ") + runs[run]);
+        double vertexBytes = (double)sphere.getVertexCount() * sphere.getVerticesStride() * GRID * GRID;
+        double indexBytes = (double)sphere.getIndexCount() * getIndexTypeSize(sphere.getIndexType()) * GRID * GRID;
+        cout << "== " << runs[run] << ": " << sphere.getVerticesStride() << " bytes per vertex, "
+             << getIndexTypeSize(sphere.getIndexType()) << " bytes per index" << endl;
+        cout << fixed << setprecision(3)
+             << "  " << ms << " ms, " << vertexBytes / (1024.0 * 1024.0) << " MB vertices + " << indexBytes / (1024.0 * 1024.0) << " MB indices per frame";
+        if(ms > 0.0)
+            cout << ", " << (vertexBytes + indexBytes) / (ms * 1000000.0) << " GB/s";
+        cout << endl;
+    }
+    profiler.report();
+}
+
+// A 64x64 field of Sphere(0.4, 128, 64) stretching away from a camera that dollies
+// through it, drawn once at full detail and once with per-instance LOD selection.
+// Reports GPU time, triangles per frame and how often instances switched level.
+void benchSphereLod(GLFWwindow *window, Shader &lightingShader, TransformBuffer &transforms, Profiler &profiler)
+{
+    const int GRID = 64;
+    const float SPACING = 1.5f;
+    const float FOVY = 45.0f;
+    Sphere sphere = Sphere(0.4f, 128, 64);
+    
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    glm::mat4 projection = glm::perspective(glm::radians(FOVY), (float)width / (float)height, 0.1f, 200.0f);
+    glfwSwapInterval(0);
+    
+    vector<glm::mat4> models;
+    vector<glm::vec4> bounds;
+    for(int i = 0; i < GRID; i++)
+        for(int j = 0; j < GRID; j++)
+        {
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3((i - GRID / 2) * SPACING, 0.0f, -j * SPACING));
+            models.push_back(model);
+            bounds.push_back(sphere.getBoundingSphere(model));
+        }
+    vector<int> lodLevels(models.size(), -1);
+    
+    cout << "sphere LOD: " << GRID * GRID << " x Sphere(0.4, 128, 64), levels:";
+    for(int l = 0; l < sphere.getLodCount(); l++)
+        cout << " " << sphere.getLodSectorCount(l) << "x" << sphere.getLodStackCount(l);
+    cout << endl;
+    
+    const char *runs[] = { "full detail", "lod" };
+    for(int run = 0; run < 2; run++)
+    {
+        bool useLod = (run == 1);
+        double triangles = 0.0;
+        long switches = 0;
+        for(int frame = 0; frame < BENCHMARK_WARMUP_FRAMES + BENCHMARK_FRAMES; frame++)
+        {
+            if(frame == BENCHMARK_WARMUP_FRAMES)
+            {
+                profiler.reset();
+                triangles = 0.0;
+                switches = 0;
+            }
+            profiler.beginFrame();
+            
+            // dolly from in front of the field to a third of the way in
+            float t = (float)frame / (BENCHMARK_WARMUP_FRAMES + BENCHMARK_FRAMES);
+            glm::vec3 eye = glm::vec3(0.0f, 2.0f, 10.0f - t * GRID * SPACING / 3.0f);
+            glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(0.0f, -0.2f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+            lightingShader.use();
+            lightingShader.setVec3("viewPos", eye);
+            
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            
+            transforms.begin(view, projection);
+            int first = transforms.getCount();
+            for(size_t i = 0; i < models.size(); i++)
+                transforms.add(sphere.getModelMatrix(models[i]));
+            transforms.bind(lightingShader);
+            
+            profiler.begin("lod select");
+            if(useLod)
+            {
+                for(size_t i = 0; i < models.size(); i++)
+                {
+                    int lod = sphere.selectLod(Sphere::projectedRadius(bounds[i], eye, FOVY, height), lodLevels[i]);
+                    if(lodLevels[i] >= 0 && lod != lodLevels[i])
+                        switches++;
+                    lodLevels[i] = lod;
+                }
+            }
+            profiler.end();
+            
+            profiler.begin(string("spheres ") + runs[run]);
+            for(size_t i = 0; i < models.size(); i++)
+            {
+                int lod = useLod ? lodLevels[i] : 0;
+                sphere.drawSphere(lightingShader, first + (int)i, lod);
+                triangles += sphere.getIndexCount(lod) / 3;
+            }
+            profiler.end();
+            
+            profiler.endFrame();
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+        profiler.finish();
+        cout << "== " << runs[run] << ": " << fixed << setprecision(0) << triangles / BENCHMARK_FRAMES
+             << " triangles/frame, " << switches << " level switches" << endl;
+    }
+    profiler.report();
+}
+
+// A 48x48 field of beds (6 parts each) drawn three ways: material uniforms and a draw
+// per part, as bed() used to; one instanced draw per bed with materials from the
+// registry; and one instanced draw for the whole field. Reports CPU submission time
+// and GPU time per frame.
+void benchMaterials(GLFWwindow *window, Shader &lightingShader, TransformBuffer &transforms, Profiler &profiler)
+{
+    const int GRID = 48;
+    Furniture bedFurniture = Furniture::makeBed();
+    Cube cube;
+    MaterialRegistry materials;
+    
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 200.0f);
+    glm::vec3 eye = glm::vec3(0.0f, 40.0f, 60.0f);
+    glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    lightingShader.use();
+    lightingShader.setVec3("viewPos", eye);
+    glfwSwapInterval(0);
+    
+    const char *runs[] = { "uniforms per part", "instanced per bed", "instanced field" };
+    for(int run = 0; run < 3; run++)
+    {
+        for(int frame = 0; frame < BENCHMARK_WARMUP_FRAMES + BENCHMARK_FRAMES; frame++)
+        {
+            if(frame == BENCHMARK_WARMUP_FRAMES)
+                profiler.reset();
+            profiler.beginFrame();
+            
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            
+            transforms.begin(view, projection);
+            int first = transforms.getCount();
+            for(int i = 0; i < GRID; i++)
+                for(int j = 0; j < GRID; j++)
+                    bedFurniture.add(transforms, glm::translate(glm::mat4(1.0f), glm::vec3((i - GRID / 2) * 1.5f, 0.0f, (j - GRID / 2) * 2.5f)), run == 0 ? NULL : &materials);
+            transforms.bind(lightingShader);
+            materials.bind(lightingShader);
+            
+            profiler.begin(runs[run]);
+            int parts = bedFurniture.getPartCount();
+            if(run == 0)
+                for(int i = 0; i < GRID * GRID; i++)
+                    bedFurniture.drawPerPart(lightingShader, cube, first + i * parts);
+            else if(run == 1)
+                for(int i = 0; i < GRID * GRID; i++)
+                    bedFurniture.draw(lightingShader, cube, first + i * parts);
+            else
+                cube.drawCubeWithMaterialBuffer(lightingShader, first, GRID * GRID * parts);
+            profiler.end();
+            
+            profiler.endFrame();
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+        profiler.finish();
+    }
+    cout << "materials: " << GRID * GRID << " beds, " << GRID * GRID * bedFurniture.getPartCount() << " parts, "
+         << materials.getCount() << " registered materials" << endl;
+    profiler.report();
+}
+
+// CPU cost of submitting 10k to 100k small objects, cubes and spheres with a handful of
+// registry materials: one glDrawElements per object from its own mesh (the current path),
+// the pool drawn one glDrawElementsBaseVertex at a time, and the pool in one
+// glMultiDrawElementsIndirect where the context has it. Transforms are built outside
+// the timed scopes; building the draw list is inside them.
+void benchMultiDraw(GLFWwindow *window, Shader &lightingShader, Shader &multiDrawShader, TransformBuffer &transforms, Profiler &profiler)
+{
+    const int COUNTS[] = { 10000, 25000, 50000, 100000 };
+    const int FRAMES = 100;
+    Cube cube;
+    Sphere sphere(0.5f, 16, 8);
+    MeshPool pool;
+    int poolCube = pool.addCube();
+    int poolSphere = pool.addSphere(16, 8, UV_SPHERE);
+    MultiDrawList drawList(pool);
+    bool indirect = drawList.useIndirect;
+    MaterialRegistry materials;
+    int materialIndex[4];
+    materialIndex[0] = materials.add(glm::vec3(0.8f, 0.2f, 0.2f), glm::vec3(0.8f, 0.2f, 0.2f), glm::vec3(0.5f), 32.0f);
+    materialIndex[1] = materials.add(glm::vec3(0.2f, 0.8f, 0.2f), glm::vec3(0.2f, 0.8f, 0.2f), glm::vec3(0.5f), 32.0f);
+    materialIndex[2] = materials.add(glm::vec3(0.2f, 0.2f, 0.8f), glm::vec3(0.2f, 0.2f, 0.8f), glm::vec3(0.5f), 32.0f);
+    materialIndex[3] = materials.add(glm::vec3(0.8f, 0.8f, 0.2f), glm::vec3(0.8f, 0.8f, 0.2f), glm::vec3(0.5f), 32.0f);
+    
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 1000.0f);
+    glfwSwapInterval(0);
+    
+    const char *runs[] = { "per draw", "pool, one at a time", "multi-draw indirect" };
+    double cpuMs[4][3] = {}, gpuMs[4][3] = {};
+    for(int c = 0; c < 4; c++)
+    {
+        int count = COUNTS[c];
+        int side = (int)ceilf(sqrtf((float)count));
+        glm::vec3 eye = glm::vec3(0.0f, side * 1.2f, side * 0.9f);
+        glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        lightingShader.use();
+        lightingShader.setVec3("viewPos", eye);
+        multiDrawShader.use();
+        multiDrawShader.setVec3("viewPos", eye);
+        for(int run = 0; run < 3; run++)
+        {
+            if(run == 2 && !indirect)
+                continue;
+            drawList.useIndirect = run == 2;
+            string scope = to_string(count) + " draws, " + runs[run];
+            for(int frame = 0; frame < BENCHMARK_WARMUP_FRAMES + FRAMES; frame++)
+            {
+                if(frame == BENCHMARK_WARMUP_FRAMES)
+                    profiler.reset();
+                profiler.beginFrame();
+                
+                glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                
+                // every other object is a sphere
+                transforms.begin(view, projection);
+                int first = transforms.getCount();
+                for(int i = 0; i < count; i++)
+                {
+                    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3((i % side - side / 2) * 1.5f, 0.0f, (i / side - side / 2) * 1.5f));
+                    transforms.add(i % 2 ? sphere.getModelMatrix(model) : model, materialIndex[i % 4]);
+                }
+                Shader &shader = run == 0 ? lightingShader : multiDrawShader;
+                transforms.bind(shader);
+                materials.bind(shader);
+                
+                profiler.begin(scope);
+                if(run == 0)
+                {
+                    for(int i = 0; i < count; i++)
+                    {
+                        if(i % 2)
+                        {
+                            shader.use();
+                            shader.setInt("objectIndex", first + i);
+                            sphere.drawSphereGeometry();
+                        }
+                        else
+                            cube.drawCubeWithMaterialBuffer(shader, first + i);
+                    }
+                }
+                else
+                {
+                    drawList.clear();
+                    for(int i = 0; i < count; i++)
+                        drawList.add(i % 2 ? poolSphere : poolCube, first + i);
+                    drawList.draw(shader);
+                }
+                profiler.end();
+                
+                profiler.endFrame();
+                glfwSwapBuffers(window);
+                glfwPollEvents();
+            }
+            profiler.finish();
+            // the next run's reset() drops these averages
+            cpuMs[c][run] = profiler.getCpuTime(scope);
+            gpuMs[c][run] = profiler.getGpuTime(scope);
+        }
+    }
+    cout << "multi-draw: cubes and Sphere(0.5, 16, 8) in turn, " << materials.getCount() << " materials, "
+         << "multi-draw indirect " << (indirect ? "supported" : "not supported") << endl;
+    cout << left << setw(44) << "draws" << right << setw(12) << "cpu ms" << setw(14) << "cpu ns/draw" << setw(12) << "gpu ms" << endl;
+    for(int c = 0; c < 4; c++)
+        for(int run = 0; run < 3; run++)
+        {
+            if(run == 2 && !indirect)
+                continue;
+            cout << left << setw(44) << to_string(COUNTS[c]) + " draws, " + runs[run] << right << fixed << setprecision(3)
+                 << setw(12) << cpuMs[c][run] << setw(14) << setprecision(1) << cpuMs[c][run] * 1000000.0 / COUNTS[c]
+                 << setw(12) << setprecision(3) << gpuMs[c][run] << endl;
+        }
+}
+
+// A 384 x 384 and a 512 x 512 field of cubes (147k and 262k instances) seen by a camera
+// turning in its middle, so the visible set changes every frame. Each field is culled
+// on the CPU, with transform feedback and, on GL 4.3, with a compute shader, and drawn
+// in one instanced draw. The instances' transforms and bounds are uploaded once.
+// Reports CPU and GPU time of cull + draw and the average number of survivors.
+void benchGpuCulling(GLFWwindow *window, Shader &culledInstanceShader, const string &shaderDirectory, Profiler &profiler)
+{
+    const int SIDES[] = { 384, 512 };
+    const int FRAMES = 200;
+    const float SPACING = 2.0f;
+    MeshPool pool;
+    int cubeMesh = pool.addCube();
+    GpuCuller culler(pool, cubeMesh, shaderDirectory);
+    MaterialRegistry materials;
+    int materialIndex[3];
+    materialIndex[0] = materials.add(glm::vec3(0.8f, 0.2f, 0.2f), glm::vec3(0.8f, 0.2f, 0.2f), glm::vec3(0.5f), 32.0f);
+    materialIndex[1] = materials.add(glm::vec3(0.2f, 0.8f, 0.2f), glm::vec3(0.2f, 0.8f, 0.2f), glm::vec3(0.5f), 32.0f);
+    materialIndex[2] = materials.add(glm::vec3(0.2f, 0.2f, 0.8f), glm::vec3(0.2f, 0.2f, 0.8f), glm::vec3(0.5f), 32.0f);
+    
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 300.0f);
+    glm::vec3 eye = glm::vec3(0.0f, 6.0f, 0.0f);
+    culledInstanceShader.use();
+    culledInstanceShader.setVec3("viewPos", eye);
+    glfwSwapInterval(0);
+    
+    bool compute = isComputeCullingSupported();
+    const char *runs[] = { "CPU", "transform feedback", "compute" };
+    double cpuMs[2][3] = {}, gpuMs[2][3] = {}, visible[2][3] = {};
+    for(int f = 0; f < 2; f++)
+    {
+        int side = SIDES[f];
+        int count = side * side;
+        // static transforms: the stored MVP is unused, the shader takes the view-projection
+        TransformBuffer instanceTransforms(count);
+        instanceTransforms.begin(glm::mat4(1.0f), glm::mat4(1.0f));
+        vector<glm::vec4> bounds(count);
+        vector<int> objectIndices(count);
+        Cube cube;
+        for(int i = 0; i < count; i++)
+        {
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3((i % side - side / 2) * SPACING, 0.0f, (i / side - side / 2) * SPACING));
+            objectIndices[i] = instanceTransforms.add(model, materialIndex[i % 3]);
+            bounds[i] = cube.getBoundingSphere(model);
+        }
+        culler.setInstances(bounds, objectIndices);
+        
+        for(int run = 0; run < 3; run++)
+        {
+            if(run == 2 && !compute)
+                continue;
+            culler.mode = run == 0 ? CULL_CPU : (run == 1 ? CULL_TRANSFORM_FEEDBACK : CULL_COMPUTE);
+            string scope = to_string(count) + " instances, " + runs[run];
+            long long survivors = 0;
+            for(int frame = 0; frame < BENCHMARK_WARMUP_FRAMES + FRAMES; frame++)
+            {
+                if(frame == BENCHMARK_WARMUP_FRAMES)
+                {
+                    profiler.reset();
+                    survivors = 0;
+                }
+                profiler.beginFrame();
+                
+                glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                
+                // one turn over the measured frames
+                float yaw = glm::radians(360.0f) * frame / FRAMES;
+                glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(sinf(yaw), -0.15f, cosf(yaw)), glm::vec3(0.0f, 1.0f, 0.0f));
+                glm::mat4 viewProjection = projection * view;
+                instanceTransforms.bind(culledInstanceShader);
+                materials.bind(culledInstanceShader);
+                culledInstanceShader.setMat4("viewProjection", viewProjection);
+                
+                profiler.begin(scope);
+                culler.cull(viewProjection);
+                culler.draw(culledInstanceShader);
+                profiler.end();
+                if(culler.getVisibleCount() >= 0)
+                    survivors += culler.getVisibleCount();
+                
+                profiler.endFrame();
+                glfwSwapBuffers(window);
+                glfwPollEvents();
+            }
+            profiler.finish();
+            cpuMs[f][run] = profiler.getCpuTime(scope);
+            gpuMs[f][run] = profiler.getGpuTime(scope);
+            visible[f][run] = run == 2 ? -1.0 : (double)survivors / FRAMES;
+        }
+    }
+    cout << "gpu culling: cube fields, " << (compute ? "compute shaders supported" : "no compute shaders") << endl;
+    cout << left << setw(40) << "cull + draw" << right << setw(12) << "cpu ms" << setw(12) << "gpu ms" << setw(12) << "visible" << endl;
+    for(int f = 0; f < 2; f++)
+        for(int run = 0; run < 3; run++)
+        {
+            if(run == 2 && !compute)
+                continue;
+            cout << left << setw(40) << to_string(SIDES[f] * SIDES[f]) + " instances, " + runs[run] << right << fixed << setprecision(3)
+                 << setw(12) << cpuMs[f][run] << setw(12) << gpuMs[f][run];
+            if(visible[f][run] >= 0.0)
+                cout << setw(12) << setprecision(0) << visible[f][run];
+            cout << endl;
+        }
+}
+
+// Bloom alone on an HDR target at 1080p and 4K, a dark frame with a few rectangles
+// brighter than the threshold, drawn with glClear so the scene costs nothing. Both the
+// mip chain and the full resolution Gaussian run at the chain's bloomLevels and every
+// pass is reported, downsample and upsample levels included, with the bloom total.
+void benchBloom(GLFWwindow *window, PostProcessChain &post, Profiler &profiler)
+{
+    const int SIZES[2][2] = { { 1920, 1080 }, { 3840, 2160 } };
+    const int FRAMES = 100;
+    const BloomMode modes[] = { BLOOM_MIP_CHAIN, BLOOM_GAUSSIAN };
+    glfwSwapInterval(0);
+    for(int s = 0; s < 2; s++)
+    {
+        int width = SIZES[s][0], height = SIZES[s][1];
+        RenderTargetDesc outputDesc = { width, height, GL_RGBA8, false, 1 };
+        RenderTarget *output = post.getPool().acquire(outputDesc);
+        for(int m = 0; m < 2; m++)
+        {
+            post.bloomMode = modes[m];
+            for(int frame = 0; frame < BENCHMARK_WARMUP_FRAMES + FRAMES; frame++)
+            {
+                if(frame == BENCHMARK_WARMUP_FRAMES)
+                    profiler.reset();
+                profiler.beginFrame();
+                
+                glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+                post.beginScene(width, height);
+                glEnable(GL_SCISSOR_TEST);
+                glClearColor(8.0f, 6.0f, 4.0f, 1.0f);
+                for(int r = 0; r < 6; r++)
+                {
+                    glScissor(width * (r + 1) / 8, height * (r % 3 + 1) / 4, width / 40, height / 40);
+                    glClear(GL_COLOR_BUFFER_BIT);
+                }
+                glDisable(GL_SCISSOR_TEST);
+                post.run(output->FBO);
+                
+                profiler.endFrame();
+                glfwSwapBuffers(window);
+                glfwPollEvents();
+            }
+            profiler.finish();
+            
+            cout << "bloom " << getBloomModeName(modes[m]) << ", " << post.bloomLevels << " levels, " << width << "x" << height << endl;
+            cout << left << setw(28) << "pass" << right << setw(12) << "gpu ms" << endl;
+            double bloomTotal = 0.0;
+            const vector<string> &passes = post.getPassNames();
+            for(size_t i = 0; i < passes.size(); i++)
+            {
+                double ms = profiler.getGpuTime("post " + passes[i]);
+                if(passes[i].compare(0, 5, "bloom") == 0)
+                    bloomTotal += ms;
+                cout << left << setw(28) << passes[i] << right << fixed << setprecision(3) << setw(12) << ms << endl;
+            }
+            cout << left << setw(28) << "bloom total" << right << fixed << setprecision(3) << setw(12) << bloomTotal << endl << endl;
+        }
+        post.getPool().release(output);
+    }
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+}
+
+// Builds 1000 spheres of distinct tessellations (32..81 x 16..35, LOD chain included)
+// twice: generated straight into mapped GL buffers, and with keepCpuData. Every one
+// misses the mesh cache, so this measures generation. Reports construction time and
+// the memory the spheres keep on the CPU and in GL buffers.
+void benchSphereGeneration()
+{
+    const int COUNT = 1000;
+    const char *runs[] = { "mapped, no CPU copy", "keepCpuData" };
+    for(int run = 0; run < 2; run++)
+    {
+        vector<Sphere*> spheres;
+        spheres.reserve(COUNT);
+        glFinish();
+        chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+        for(int i = 0; i < COUNT; i++)
+            spheres.push_back(new Sphere(1.0f, 32 + i % 50, 16 + i / 50, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.5f), 32.0f, run == 1));
+        glFinish();
+        double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+        
+        size_t cpuBytes = 0, gpuBytes = 0, legacyBytes = 0;
+        for(int i = 0; i < COUNT; i++)
+        {
+            cpuBytes += spheres[i]->getCpuMemory();
+            gpuBytes += spheres[i]->getGpuMemory();
+            for(int l = 0; l < spheres[i]->getLodCount(); l++)
+                legacyBytes += 2 * spheres[i]->getVertexCount(l) * 6 * sizeof(float) + spheres[i]->getIndexCount(l) * sizeof(unsigned int);
+        }
+        cout << "== " << runs[run] << ": " << COUNT << " x Sphere(1, 32..81, 16..35)" << endl;
+        cout << fixed << setprecision(3)
+             << "  construction " << ms << " ms (" << ms * 1000.0 / COUNT << " us per sphere)" << endl
+             << "  resident on CPU " << cpuBytes / (1024.0 * 1024.0) << " MB, in GL buffers " << gpuBytes / (1024.0 * 1024.0) << " MB" << endl;
+        if(run == 0)
+        {
+            // the previous generator kept coordinates + normals + interleaved vertices + indices
+            cout << "  previous layout kept at least " << legacyBytes / (1024.0 * 1024.0)
+                 << " MB on the CPU (before vector growth slack)" << endl;
+        }
+        for(int i = 0; i < COUNT; i++)
+            delete spheres[i];
+    }
+}
+
+// A scene of 10k spheres with random radii and materials over 4 tessellations, and
+// 10k cubes over 3 texture coordinate ranges. Reports construction time, the time
+// the cache misses took, the GL memory the shared meshes hold and what one mesh per
+// object would have cost on top.
+void benchMeshCache()
+{
+    const int COUNT = 10000;
+    const int tessellations[4][2] = { { 16, 8 }, { 36, 18 }, { 64, 32 }, { 128, 64 } };
+    const float textureRanges[3][4] = { { 0.0f, 0.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 2.0f, 2.0f }, { 0.0f, 0.0f, 4.0f, 1.0f } };
+    srand(1);
+    
+    vector<Sphere*> spheres;
+    vector<Cube*> cubes;
+    spheres.reserve(COUNT);
+    cubes.reserve(COUNT);
+    double missMs[4] = { 0.0, 0.0, 0.0, 0.0 };
+    double cubeMissMs = 0.0;
+    glFinish();
+    chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+    for(int i = 0; i < COUNT; i++)
+    {
+        int t = rand() % 4;
+        float radius = 0.1f + 0.9f * rand() / RAND_MAX;
+        glm::vec3 color = glm::vec3((float)rand() / RAND_MAX, (float)rand() / RAND_MAX, (float)rand() / RAND_MAX);
+        int cached = Sphere::getMeshCacheSize();
+        chrono::high_resolution_clock::time_point t0 = chrono::high_resolution_clock::now();
+        spheres.push_back(new Sphere(radius, tessellations[t][0], tessellations[t][1], color * 0.5f, color, glm::vec3(0.5f), 32.0f));
+        if(Sphere::getMeshCacheSize() != cached)
+            missMs[t] = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - t0).count();
+        
+        const float *range = textureRanges[rand() % 3];
+        cached = Cube::getMeshCacheSize();
+        t0 = chrono::high_resolution_clock::now();
+        cubes.push_back(new Cube(0, 0, 32.0f, range[0], range[1], range[2], range[3]));
+        if(Cube::getMeshCacheSize() != cached)
+            cubeMissMs += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - t0).count();
+    }
+    glFinish();
+    double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    
+    // without the cache every object pays the generation cost of its mesh
+    double uncachedMs = 0.0;
+    for(int i = 0; i < COUNT; i++)
+        for(int t = 0; t < 4; t++)
+            if(spheres[i]->getLodSectorCount(0) == tessellations[t][0] && spheres[i]->getLodStackCount(0) == tessellations[t][1])
+                uncachedMs += missMs[t];
+    uncachedMs += cubeMissMs / Cube::getMeshCacheSize() * COUNT;
+    
+    cout << "mesh cache: " << COUNT << " spheres over 4 tessellations, " << COUNT << " cubes over 3 texture ranges" << endl;
+    cout << fixed << setprecision(3)
+         << "  construction " << ms << " ms (" << ms * 1000.0 / (2 * COUNT) << " us per object), one mesh per object would take about " << uncachedMs << " ms" << endl
+         << "  sphere meshes " << Sphere::getMeshCacheSize() << ", " << Sphere::getMeshCacheMemory() / (1024.0 * 1024.0) << " MB in GL buffers, "
+         << Sphere::getMeshCacheMemorySaved() / (1024.0 * 1024.0) << " MB saved" << endl
+         << "  cube meshes " << Cube::getMeshCacheSize() << ", " << Cube::getMeshCacheMemory() / 1024.0 << " KB in GL buffers, "
+         << Cube::getMeshCacheMemorySaved() / (1024.0 * 1024.0) << " MB saved" << endl;
+    
+    for(int i = 0; i < COUNT; i++)
+    {
+        delete spheres[i];
+        delete cubes[i];
+    }
+}
+
+// ACMR and vertex shader invocations of level 0 of each sphere type, as generated
+// and after the vertex cache and fetch passes, at two tessellations.
+void benchVertexCache()
+{
+    const SphereType types[3] = { UV_SPHERE, ICOSPHERE, CUBE_SPHERE };
+    const char *typeNames[3] = { "uv sphere", "icosphere", "cube sphere" };
+    const int sizes[2][2] = { { 36, 18 }, { 128, 64 } };
+    cout << left << setw(14) << "mesh" << right << setw(10) << "edges" << setw(10) << "vertices" << setw(10) << "triangles"
+         << setw(12) << "acmr raw" << setw(12) << "acmr opt" << setw(12) << "vs raw" << setw(12) << "vs opt" << endl;
+    for(int size = 0; size < 2; size++)
+        for(int type = 0; type < 3; type++)
+        {
+            Sphere sphere = Sphere(1.0f, sizes[size][0], sizes[size][1], glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.5f), 32.0f, true, types[type]);
+            const SphereMesh::LodLevel &level = sphere.getLod(0);
+            vector<float> vertices(level.vertexCount * 6);
+            vector<unsigned int> indices(level.indexCount);
+            Sphere::generateLevel(types[type], level, vertices.data(), indices.data());
+            VertexCacheStats raw = analyzeVertexCache(indices.data(), indices.size(), level.vertexCount);
+            VertexCacheStats optimized = analyzeVertexCache(sphere.getIndices() + level.firstIndex, level.indexCount, level.vertexCount);
+            cout << left << setw(14) << typeNames[type] << right << setw(10) << level.sectorCount << setw(10) << level.vertexCount
+                 << setw(10) << level.indexCount / 3 << fixed << setprecision(3) << setw(12) << raw.acmr << setw(12) << optimized.acmr
+                 << setw(12) << raw.invocations << setw(12) << optimized.invocations << endl;
+        }
+}
+
+// Writes a Sphere(1, 2048, 1024) with its LOD chain to path as a mesh file, then
+// loads it back LOADS times. Compares generating the mesh with loading it; after
+// the first load the file comes from the page cache, so that is the mapped upload
+// path alone.
+void benchMeshFile(const string &path)
+{
+    const int LOADS = 10;
+    glFinish();
+    chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+    Sphere *sphere = new Sphere(1.0f, 2048, 1024, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.5f), 32.0f, true);
+    glFinish();
+    double generateMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    
+    start = chrono::high_resolution_clock::now();
+    bool written = sphere->writeMeshFile(path);
+    double writeMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    delete sphere;
+    if(!written)
+        return;
+    
+    double loadMs = 0.0, firstLoadMs = 0.0;
+    size_t bytes = 0;
+    for(int i = 0; i < LOADS; i++)
+    {
+        glFinish();
+        start = chrono::high_resolution_clock::now();
+        MeshAsset asset(path);
+        glFinish();
+        double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+        if(!asset.isLoaded())
+            return;
+        bytes = asset.getGpuMemory();
+        if(i == 0)
+            firstLoadMs = ms;
+        else
+            loadMs += ms;
+    }
+    loadMs /= LOADS - 1;
+    cout << "mesh file: Sphere(1, 2048, 1024), " << bytes / (1024.0 * 1024.0) << " MB" << endl;
+    cout << fixed << setprecision(3)
+         << "  generate " << generateMs << " ms, write " << writeMs << " ms" << endl
+         << "  first load " << firstLoadMs << " ms (" << bytes / (firstLoadMs * 1000.0) << " MB/s), cached load "
+         << loadMs << " ms (" << bytes / (loadMs * 1000.0) << " MB/s)" << endl;
+}
+
+// Writes a UV sphere of sectors x stacks quads as OBJ, with texture coordinates and normals
+bool writeSyntheticObj(const string &path, int sectors, int stacks)
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if(!file)
+    {
+        cout << "mesh " << path << " could not be opened for writing" << endl;
+        return false;
+    }
+    for(int i = 0; i <= stacks; i++)
+    {
+        float stackAngle = glm::radians(180.0f * i / stacks);
+        for(int j = 0; j <= sectors; j++)
+        {
+            float sectorAngle = glm::radians(360.0f * j / sectors);
+            float x = sinf(stackAngle) * cosf(sectorAngle), y = cosf(stackAngle), z = sinf(stackAngle) * sinf(sectorAngle);
+            fprintf(file, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n", x, y, z, (float)j / sectors, 1.0f - (float)i / stacks, x, y, z);
+        }
+    }
+    // one based, counter-clockwise seen from outside
+    for(int i = 0; i < stacks; i++)
+        for(int j = 0; j < sectors; j++)
+        {
+            int a = i * (sectors + 1) + j + 1, b = a + sectors + 1;
+            fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, a + 1, a + 1, a + 1, b + 1, b + 1, b + 1, b, b, b);
+        }
+    return fclose(file) == 0;
+}
+
+// Imports an OBJ or PLY file with 1 thread up to one per core and prints the parse rate
+// of each run; a missing path gets a synthetic ~270 MB OBJ first. The last import is
+// uploaded, and written as a mesh file to compare with loading that instead.
+void benchImport(const string &path)
+{
+    FILE *existing = fopen(path.c_str(), "rb");
+    if(existing)
+        fclose(existing);
+    else
+    {
+        cout << "writing a synthetic OBJ to " << path << endl;
+        if(!writeSyntheticObj(path, 1800, 900))
+            return;
+    }
+
+    int cores = getImportThreadCount(0);
+    vector<int> threadCounts;
+    for(int threads = 1; threads < cores && threads <= 8; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(cores);
+
+    ImportedMesh mesh;
+    for(size_t i = 0; i < threadCounts.size(); i++)
+    {
+        ImportStats stats;
+        if(!importMesh(path, mesh, threadCounts[i], &stats))
+            return;
+        double megabytes = stats.bytes / (1024.0 * 1024.0);
+        if(i == 0)
+            cout << "import: " << path << ", " << fixed << setprecision(1) << megabytes << " MB, "
+                 << mesh.getVertexCount() << " vertices, " << mesh.indices.size() / 3 << " triangles" << endl;
+        cout << fixed << setprecision(1) << "  " << setw(2) << stats.threads << " threads: parse " << stats.parseMs << " ms ("
+             << megabytes / (stats.parseMs / 1000.0) << " MB/s), dedupe " << stats.dedupeMs << " ms, optimize "
+             << stats.optimizeMs << " ms, total " << megabytes / ((stats.mapMs + stats.parseMs + stats.dedupeMs + stats.optimizeMs) / 1000.0) << " MB/s" << endl;
+    }
+
+    glFinish();
+    chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+    MeshAsset *asset = createMeshAsset(mesh);
+    glFinish();
+    double uploadMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    size_t gpuBytes = asset->getGpuMemory();
+    delete asset;
+
+    string meshPath = path + ".mesh";
+    if(!writeMeshFile(meshPath, mesh))
+        return;
+    glFinish();
+    start = chrono::high_resolution_clock::now();
+    MeshAsset loaded(meshPath);
+    glFinish();
+    double loadMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    cout << fixed << setprecision(1) << "  upload " << gpuBytes / (1024.0 * 1024.0) << " MB compact: " << uploadMs
+         << " ms, as mesh file " << meshPath << ": " << loadMs << " ms" << endl;
+}
+
+// Scene of nodeCount cubes and spheres in groups of 64, each group under its own
+// parent node, with the lights of the default scene
+SceneData makeSyntheticScene(int nodeCount)
+{
+    SceneData scene;
+    SceneTexture diffuse, specular;
+    diffuse.name = "container";
+    diffuse.path = "container2.png";
+    specular.name = "container_specular";
+    specular.path = "container2_specular.png";
+    scene.textures.push_back(diffuse);
+    scene.textures.push_back(specular);
+    SceneMaterial textured;
+    textured.name = "container";
+    textured.diffuseMap = 0;
+    textured.specularMap = 1;
+    scene.materials.push_back(textured);
+    for(int i = 0; i < 7; i++)
+    {
+        SceneMaterial color;
+        color.name = "color" + to_string(i);
+        color.ambient = color.diffuse = glm::vec3((i & 1) ? 0.8f : 0.2f, (i & 2) ? 0.8f : 0.2f, (i & 4) ? 0.8f : 0.2f);
+        scene.materials.push_back(color);
+    }
+    SceneMesh cube, sphere;
+    cube.name = "cube";
+    sphere.name = "sphere";
+    sphere.type = SCENE_MESH_SPHERE;
+    scene.meshes.push_back(cube);
+    scene.meshes.push_back(sphere);
+    for(int i = 0; i < MAX_SCENE_POINT_LIGHTS; i++)
+        scene.pointLights.push_back(PointLight((i & 2) ? -1.5f : 1.5f, (i & 1) ? -1.5f : 1.5f, 0.0f, 0.05f, 0.05f, 0.05f, 0.8f, 0.8f, 0.8f, 1.0f, 1.0f, 1.0f, 1.0f, 0.09f, 0.032f, i + 1));
+
+    int group = -1;
+    for(int i = 0; i < nodeCount; i++)
+    {
+        SceneNode node;
+        if(i % 65 == 0)
+        {
+            node.name = "group" + to_string(i / 65);
+            node.local = glm::translate(glm::mat4(1.0f), glm::vec3((i / 65 % 32) * 10.0f, 0.0f, -(i / 65 / 32) * 10.0f));
+            scene.nodes.push_back(node);
+            group = i;
+            continue;
+        }
+        int child = i - group - 1;
+        node.name = "node" + to_string(i);
+        node.parent = group;
+        node.mesh = i % 2;
+        node.material = i % 8;
+        node.local = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3((child % 8) * 1.2f, 0.0f, (child / 8) * -1.2f)), glm::radians(i * 10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        scene.nodes.push_back(node);
+    }
+    return scene;
+}
+
+// Writes a synthetic scene of nodeCount nodes as path (JSON) and path + ".scene", then
+// times loading each form whole, and streaming the compiled one in SCENE_STREAM_BATCH
+// node batches (open is the stall before the first frame, a batch is the per frame cost).
+void benchSceneLoad(int nodeCount, const string &path)
+{
+    SceneData scene = makeSyntheticScene(nodeCount);
+    string compiledPath = path + ".scene";
+    chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+    if(!writeSceneJson(path, scene))
+        return;
+    double writeJsonMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    start = chrono::high_resolution_clock::now();
+    if(!writeSceneFile(compiledPath, scene))
+        return;
+    double writeSceneMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+    SceneData loaded;
+    start = chrono::high_resolution_clock::now();
+    if(!loadSceneData(path, loaded))
+        return;
+    double jsonMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    start = chrono::high_resolution_clock::now();
+    if(!loadSceneData(compiledPath, loaded))
+        return;
+    double compiledMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+    SceneStream stream;
+    start = chrono::high_resolution_clock::now();
+    if(!stream.open(compiledPath, loaded))
+        return;
+    double openMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    double batchMs = 0.0, maxBatchMs = 0.0;
+    int batches = 0;
+    while(!stream.isDone())
+    {
+        start = chrono::high_resolution_clock::now();
+        stream.streamNodes(loaded, SCENE_STREAM_BATCH);
+        double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+        batchMs += ms;
+        maxBatchMs = fmax(maxBatchMs, ms);
+        batches++;
+    }
+
+    MappedFile json(path), compiled(compiledPath);
+    cout << "scene: " << scene.nodes.size() << " nodes, JSON " << json.getSize() / 1024 << " KB, compiled " << compiled.getSize() / 1024 << " KB" << endl;
+    cout << fixed << setprecision(3)
+         << "  write JSON " << writeJsonMs << " ms, compiled " << writeSceneMs << " ms" << endl
+         << "  load JSON " << jsonMs << " ms, compiled " << compiledMs << " ms (" << jsonMs / compiledMs << "x)" << endl
+         << "  stream: open " << openMs << " ms, " << batches << " batches of " << SCENE_STREAM_BATCH << " nodes, "
+         << (batches ? batchMs / batches : 0.0) << " ms per batch, " << maxBatchMs << " ms max" << endl;
+}
+
+// Path traces the scene from its camera with 1, 2, 4 ... threads up to every core, samples
+// passes each, and prints the rays per second of each next to one thread's
+void benchPathTracer(const string &scenePath, int samples)
+{
+    SceneData scene;
+    if(!loadSceneData(scenePath, scene))
+        return;
+    PathTracer tracer;
+    if(!tracer.load(scene))
+    {
+        cout << "path tracer: " << scenePath << " has nothing to trace" << endl;
+        return;
+    }
+    Camera camera(scene.cameraPosition);
+    tracer.resize(640, 480);
+    tracer.setCamera(camera.Position, camera.Front, camera.Up, camera.Zoom);
+
+    int cores = getImportThreadCount(0);
+    vector<int> threadCounts;
+    for(int threads = 1; threads < cores; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(cores);
+
+    double singleRate = 0.0;
+    for(size_t i = 0; i < threadCounts.size(); i++)
+    {
+        tracer.reset();
+        uint64_t rays = 0;
+        chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+        for(int s = 0; s < samples; s++)
+            rays += tracer.renderPass(threadCounts[i]);
+        double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+        double rate = rays / (ms * 1000.0);
+        if(i == 0)
+        {
+            singleRate = rate;
+            tracer.report();
+        }
+        cout << fixed << setprecision(1) << "  " << setw(2) << threadCounts[i] << " threads: " << setw(8) << ms << " ms, "
+             << setprecision(2) << setw(6) << rate << " Mrays/s, " << rate / singleRate << "x, "
+             << setprecision(0) << 100.0 * rate / (singleRate * threadCounts[i]) << "% per thread" << endl;
+    }
+}
+
+// Replays the same camera orbit around the scene once per render mode, printing
+// the profiler scopes of each run so the modes can be compared frame for frame,
+// and at the end the frame time of every mode next to the first one's.
+class BenchmarkReplay{
+public:
+    float orbitRadius = 5.2f;
+    float orbitHeight = 1.1f;
+    
+    void start(const vector<string> &modes)
+    {
+        this->modes = modes;
+        mode = 0;
+        frame = 0;
+        frameTimes.clear();
+        gpuFrameTimes.clear();
+    }
+    
+    bool isActive() const
+    {
+        return mode < (int)modes.size();
+    }
+    
+    const string& getMode() const
+    {
+        return modes[mode];
+    }
+    
+    // call once at the start of every frame, before the profiler's beginFrame()
+    void update(Camera &camera, Profiler &profiler)
+    {
+        if(frame == BENCHMARK_WARMUP_FRAMES)
+        {
+            profiler.reset();
+            startTime = glfwGetTime();
+        }
+        if(frame == BENCHMARK_WARMUP_FRAMES + BENCHMARK_FRAMES)
+        {
+            // wall clock per frame, swap and everything the profiler scopes leave out included
+            frameTimes.push_back((glfwGetTime() - startTime) * 1000.0 / BENCHMARK_FRAMES);
+            profiler.finish();
+            gpuFrameTimes.push_back(profiler.getGpuTime("frame"));
+            cout << "== " << modes[mode] << " (" << BENCHMARK_FRAMES << " frames)" << endl;
+            profiler.report();
+            profiler.reset();
+            mode++;
+            frame = 0;
+            if(!isActive())
+            {
+                reportFrameTimes();
+                return;
+            }
+        }
+        
+        // one full orbit per run, always looking at the origin
+        float t = (float)frame / (BENCHMARK_WARMUP_FRAMES + BENCHMARK_FRAMES);
+        float angle = t * 2.0f * PI;
+        camera.Position = glm::vec3(orbitRadius * sinf(angle), orbitHeight, orbitRadius * cosf(angle));
+        camera.Yaw = glm::degrees(atan2f(-camera.Position.z, -camera.Position.x));
+        camera.Pitch = glm::degrees(atan2f(-orbitHeight, orbitRadius));
+        camera.ProcessMouseMovement(0.0f, 0.0f);
+        frame++;
+    }
+    
+private:
+    vector<string> modes;
+    int mode = 0;
+    int frame = 0;
+    double startTime = 0.0;
+    vector<double> frameTimes;      // ms per mode
+    vector<double> gpuFrameTimes;
+
+    void reportFrameTimes() const
+    {
+        cout << "== frame time" << endl;
+        cout << left << setw(40) << "mode" << right << setw(12) << "frame ms" << setw(12) << "gpu ms" << setw(10) << "fps" << setw(12) << "vs first" << endl;
+        for(size_t i = 0; i < frameTimes.size(); i++)
+            cout << left << setw(40) << modes[i] << right << fixed << setprecision(3) << setw(12) << frameTimes[i] << setw(12) << gpuFrameTimes[i]
+                 << setprecision(1) << setw(10) << 1000.0 / frameTimes[i] << setprecision(2) << setw(11) << frameTimes[i] / frameTimes[0] << "x" << endl;
+    }
+};
+
+#endif /* benchmark_h */
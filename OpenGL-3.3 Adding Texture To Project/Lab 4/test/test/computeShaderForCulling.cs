@@ -0,0 +1,39 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+// matches CullInstance in gpuCulling.h
+struct CullInstance{
+    vec4 bounds;
+    int objectIndex;
+};
+
+layout (std430, binding = 0) readonly buffer Instances{
+    CullInstance instances[];
+};
+layout (std430, binding = 1) writeonly buffer VisibleObjects{
+    int visibleObjects[];
+};
+// the DrawElementsIndirectCommand of the instanced draw, instanceCount counts the survivors
+layout (std430, binding = 2) buffer DrawCommand{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+// frustum planes in world space, xyz points inside (see frustum.h)
+uniform vec4 frustumPlanes[6];
+uniform uint instanceTotal;
+
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+    if(i >= instanceTotal)
+        return;
+    vec4 bounds = instances[i].bounds;
+    for(int p = 0; p < 6; p++)
+        if(dot(frustumPlanes[p].xyz, bounds.xyz) + frustumPlanes[p].w < -bounds.w)
+            return;
+    visibleObjects[atomicAdd(instanceCount, 1u)] = instances[i].objectIndex;
+}
@@ -14,9 +14,24 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "shader.h"
+#include "meshOptimizer.h"
+#include "vertexFormat.h"
 
 using namespace std;
 
+// Cube geometry shared, refcounted, by every Cube with the same texture coordinate
+// range; only the material differs between them. Vertices are packed to 16 bytes
+// (snorm16 position, 2_10_10_10 normal, half texture coordinates), indices to 16 bits.
+struct CubeMesh{
+    float TXmin, TYmin, TXmax, TYmax;
+    int refCount = 0;
+    unsigned int cubeVAO;           // position only
+    unsigned int lightCubeVAO;      // position, normal
+    unsigned int lightTexCubeVAO;   // position, normal, texture coordinates
+    unsigned int cubeVBO;
+    unsigned int cubeEBO;
+};
+
 class Cube{
 public:
     
@@ -39,7 +54,7 @@ public:
     // constructors
     Cube()
     {
-        setUpCubeVertexDataAndConfigureVertexAttribute();
+        mesh = acquireMesh(TXmin, TYmin, TXmax, TYmax);
     }
     
     Cube(glm::vec3 amb, glm::vec3 diff, glm::vec3 spec, float shiny)
@@ -49,7 +64,7 @@ public:
         this->specular = spec;
         this->shininess = shiny;
         
-        setUpCubeVertexDataAndConfigureVertexAttribute();
+        mesh = acquireMesh(TXmin, TYmin, TXmax, TYmax);
     }
     
     Cube(unsigned int dMap, unsigned int sMap, float shiny, float textureXmin, float textureYmin, float textureXmax, float textureYmax)
@@ -62,20 +77,42 @@ public:
         this->TXmax = textureXmax;
         this->TYmax = textureYmax;
         
-        setUpCubeVertexDataAndConfigureVertexAttribute();
+        mesh = acquireMesh(TXmin, TYmin, TXmax, TYmax);
+    }
+    
+    Cube(const Cube &other)
+    {
+        *this = other;
+    }
+    
+    Cube& operator=(const Cube &other)
+    {
+        if(this == &other)
+            return *this;
+        if(mesh)
+            releaseMesh(mesh);
+        ambient = other.ambient;
+        diffuse = other.diffuse;
+        specular = other.specular;
+        TXmin = other.TXmin;
+        TXmax = other.TXmax;
+        TYmin = other.TYmin;
+        TYmax = other.TYmax;
+        diffuseMap = other.diffuseMap;
+        specularMap = other.specularMap;
+        shininess = other.shininess;
+        mesh = other.mesh;
+        mesh->refCount++;
+        return *this;
     }
     
     // destructor
     ~Cube()
     {
-        glDeleteVertexArrays(1, &cubeVAO);
-        glDeleteVertexArrays(1, &lightCubeVAO);
-        glDeleteVertexArrays(1, &lightTexCubeVAO);
-        glDeleteBuffers(1, &cubeVBO);
-        glDeleteBuffers(1, &cubeEBO);
+        releaseMesh(mesh);
     }
     
-    void drawCubeWithTexture(Shader &lightingShaderWithTexture, glm::mat4 model=glm::mat4(1.0f))
+    void drawCubeWithTexture(Shader &lightingShaderWithTexture, int objectIndex)
     {
         lightingShaderWithTexture.use();
         
@@ -91,13 +128,13 @@ public:
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, this->specularMap);
         
-        lightingShaderWithTexture.setMat4("model", model);
+        lightingShaderWithTexture.setInt("objectIndex", objectIndex);
 
-        glBindVertexArray(lightTexCubeVAO);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+        glBindVertexArray(mesh->lightTexCubeVAO);
+        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, 0);
     }
     
-    void drawCubeWithMaterialisticProperty(Shader &lightingShader, glm::mat4 model=glm::mat4(1.0f))
+    void drawCubeWithMaterialisticProperty(Shader &lightingShader, int objectIndex)
     {
         lightingShader.use();
         
@@ -106,21 +143,50 @@ public:
         lightingShader.setVec3("material.specular", this->specular);
         lightingShader.setFloat("material.shininess", this->shininess);
         
-        lightingShader.setMat4("model", model);
+        lightingShader.setInt("objectIndex", objectIndex);
+        
+        glBindVertexArray(mesh->lightCubeVAO);
+        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, 0);
+    }
+    
+    // material from the registry by the objects' material indices (see materialBuffer.h);
+    // instanceCount objects with consecutive transforms from objectIndex on in one draw
+    void drawCubeWithMaterialBuffer(Shader &lightingShader, int objectIndex, int instanceCount = 1)
+    {
+        lightingShader.use();
+        lightingShader.setInt("objectIndex", objectIndex);
         
-        glBindVertexArray(lightCubeVAO);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+        glBindVertexArray(mesh->lightCubeVAO);
+        glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, 0, instanceCount);
     }
     
-    void drawCube(Shader &shader, glm::mat4 model=glm::mat4(1.0f), float r=1.0f, float g=1.0f, float b=1.0f)
+    void drawCube(Shader &shader, int objectIndex, float r=1.0f, float g=1.0f, float b=1.0f)
     {
         shader.use();
         
         shader.setVec3("color", glm::vec3(r, g, b));
-        shader.setMat4("model", model);
+        shader.setInt("objectIndex", objectIndex);
         
-        glBindVertexArray(cubeVAO);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+        glBindVertexArray(mesh->cubeVAO);
+        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, 0);
+    }
+    
+    // world bounding sphere of the unit cube under model: xyz = center, w = radius
+    glm::vec4 getBoundingSphere(const glm::mat4 &model) const
+    {
+        glm::vec3 center = glm::vec3(model * glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+        float scale = fmaxf(glm::length(glm::vec3(model[0])), fmaxf(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        return glm::vec4(center, 0.8660254f * scale);
+    }
+    
+    // position-only draw for the depth pre-pass and shadow maps
+    void drawCubeDepthOnly(Shader &depthShader, int objectIndex)
+    {
+        depthShader.use();
+        depthShader.setInt("objectIndex", objectIndex);
+        
+        glBindVertexArray(mesh->cubeVAO);
+        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, 0);
     }
     
     void setMaterialisticProperty(glm::vec3 amb, glm::vec3 diff, glm::vec3 spec, float shiny)
@@ -138,19 +204,11 @@ public:
         this->shininess = shiny;
     }
     
-private:
-    unsigned int cubeVAO;
-    unsigned int lightCubeVAO;
-    unsigned int lightTexCubeVAO;
-    unsigned int cubeVBO;
-    unsigned int cubeEBO;
-    
-    void setUpCubeVertexDataAndConfigureVertexAttribute()
+    // the unit cube as 24 vertices of 8 floats (position, normal, texture coordinates) and
+    // 36 indices, optimized for the vertex cache and fetch order
+    static void getVertexData(float TXmin, float TYmin, float TXmax, float TYmax, float vertices[24 * 8], unsigned int indices[36])
     {
-        // set up vertex data (and buffer(s)) and configure vertex attributes
-        // ------------------------------------------------------------------
-        
-       float cube_vertices[] = {
+        float cube_vertices[] = {
             // positions      // normals         // texture
             0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, TXmax, TYmin,
             1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, TXmin, TYmin,
@@ -201,54 +259,131 @@ private:
             20, 21, 22,
             22, 23, 20
         };
+        optimizeVertexCache(cube_indices, 36, 24);
+        optimizeVertexFetch(cube_vertices, cube_indices, 36, 24, 8);
+        memcpy(vertices, cube_vertices, sizeof(cube_vertices));
+        memcpy(indices, cube_indices, sizeof(cube_indices));
+    }
+    
+    // mesh cache statistics, over every live Cube
+    static int getMeshCacheSize()
+    {
+        return (int)meshCache().size();
+    }
+    
+    // GL buffer bytes held by the cache, and the bytes one mesh per cube would add on top
+    static size_t getMeshCacheMemory()
+    {
+        return meshCache().size() * MESH_BYTES;
+    }
+    
+    static size_t getMeshCacheMemorySaved()
+    {
+        size_t bytes = 0;
+        for(size_t i = 0; i < meshCache().size(); i++)
+            bytes += (size_t)(meshCache()[i]->refCount - 1) * MESH_BYTES;
+        return bytes;
+    }
+    
+private:
+    static const size_t MESH_BYTES = 24 * 16 + 36 * sizeof(unsigned short);
+    
+    CubeMesh *mesh = nullptr;       // shared, refcounted
+    
+    // every live mesh, one per texture coordinate range
+    static vector<CubeMesh*>& meshCache()
+    {
+        static vector<CubeMesh*> cache;
+        return cache;
+    }
+    
+    static CubeMesh* acquireMesh(float TXmin, float TYmin, float TXmax, float TYmax)
+    {
+        vector<CubeMesh*> &cache = meshCache();
+        for(size_t i = 0; i < cache.size(); i++)
+            if(cache[i]->TXmin == TXmin && cache[i]->TYmin == TYmin && cache[i]->TXmax == TXmax && cache[i]->TYmax == TYmax)
+            {
+                cache[i]->refCount++;
+                return cache[i];
+            }
+        CubeMesh *mesh = new CubeMesh();
+        mesh->TXmin = TXmin;
+        mesh->TYmin = TYmin;
+        mesh->TXmax = TXmax;
+        mesh->TYmax = TYmax;
+        mesh->refCount = 1;
+        setUpCubeVertexDataAndConfigureVertexAttribute(*mesh);
+        cache.push_back(mesh);
+        return mesh;
+    }
+    
+    static void releaseMesh(CubeMesh *mesh)
+    {
+        if(--mesh->refCount > 0)
+            return;
+        vector<CubeMesh*> &cache = meshCache();
+        for(size_t i = 0; i < cache.size(); i++)
+            if(cache[i] == mesh)
+            {
+                cache[i] = cache.back();
+                cache.pop_back();
+                break;
+            }
+        glDeleteVertexArrays(1, &mesh->cubeVAO);
+        glDeleteVertexArrays(1, &mesh->lightCubeVAO);
+        glDeleteVertexArrays(1, &mesh->lightTexCubeVAO);
+        glDeleteBuffers(1, &mesh->cubeVBO);
+        glDeleteBuffers(1, &mesh->cubeEBO);
+        delete mesh;
+    }
+    
+    static void setUpCubeVertexDataAndConfigureVertexAttribute(CubeMesh &mesh)
+    {
+        // set up vertex data (and buffer(s)) and configure vertex attributes
+        // ------------------------------------------------------------------
+        float cube_vertices[24 * 8];
+        unsigned int cube_indices[36];
+        getVertexData(mesh.TXmin, mesh.TYmin, mesh.TXmax, mesh.TYmax, cube_vertices, cube_indices);
+        
+        VertexFormat format = VertexFormat::positionNormalTexture(true);
+        unsigned char packedVertices[24 * 16];
+        unsigned short packedIndices[36];
+        format.pack(cube_vertices, 8, 24, packedVertices);
+        packIndices(cube_indices, 36, GL_UNSIGNED_SHORT, packedIndices);
         
-        glGenVertexArrays(1, &cubeVAO);
-        glGenVertexArrays(1, &lightCubeVAO);
-        glGenVertexArrays(1, &lightTexCubeVAO);
-        glGenBuffers(1, &cubeVBO);
-        glGenBuffers(1, &cubeEBO);
+        glGenVertexArrays(1, &mesh.cubeVAO);
+        glGenVertexArrays(1, &mesh.lightCubeVAO);
+        glGenVertexArrays(1, &mesh.lightTexCubeVAO);
+        glGenBuffers(1, &mesh.cubeVBO);
+        glGenBuffers(1, &mesh.cubeEBO);
 
         
-        glBindVertexArray(lightTexCubeVAO);
+        glBindVertexArray(mesh.lightTexCubeVAO);
 
-        glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(cube_vertices), cube_vertices, GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.cubeVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(packedVertices), packedVertices, GL_STATIC_DRAW);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeEBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.cubeEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(packedIndices), packedIndices, GL_STATIC_DRAW);
 
-        // position attribute
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
+        // position, vertex normal and texture coordinate attributes
+        format.setUpAttributes();
         
-        // vertex normal attribute
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)12);
-        glEnableVertexAttribArray(1);
         
-        // texture coordinate attribute
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)24);
-        glEnableVertexAttribArray(2);
-        
-        
-        glBindVertexArray(lightCubeVAO);
+        glBindVertexArray(mesh.lightCubeVAO);
 
-        glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeEBO);
-        
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.cubeVBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.cubeEBO);
         
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)12);
-        glEnableVertexAttribArray(1);
+        format.setUpAttributes((1 << 0) | (1 << 1));
         
         
-        glBindVertexArray(cubeVAO);
+        glBindVertexArray(mesh.cubeVAO);
 
-        glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeEBO);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.cubeVBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.cubeEBO);
         
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
+        format.setUpAttributes(1 << 0);
     }
     
 };
@@ -0,0 +1,311 @@
+//
+//  deferredRenderer.h
+//  test
+//
+
+#ifndef deferredRenderer_h
+#define deferredRenderer_h
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "shader.h"
+#include "sphere.h"
+#include "pointLight.h"
+#include "spotLight.h"
+#include "directionLight.h"
+#include "transformBuffer.h"
+#include "shadowMap.h"
+#include "ambientOcclusion.h"
+
+using namespace std;
+
+const int LIGHT_CONE_SEGMENTS = 24;
+
+// Deferred shading path. The geometry pass writes into a G-buffer:
+//   0: RGBA16F  world position, shininess in w
+//   1: RGBA16F  world normal, w = 1 where something was drawn
+//   2: RGBA8    diffuse color
+//   3: RGBA8    specular color
+//   4: RGBA8    ambient color
+// and a DEPTH24_STENCIL8 depth texture, which ambient occlusion reads along with the normals.
+// The lighting pass then draws the directional light as one fullscreen triangle
+// and every point/spot light as a volume (sphere/cone sized from its attenuation
+// radius), so each light only shades the pixels it can reach.
+class DeferredRenderer{
+public:
+    DeferredRenderer(int width, int height, const string &shaderDirectory) :
+        dirLightShader((shaderDirectory + "vertexShaderForFullscreen.vs").c_str(), (shaderDirectory + "fragmentShaderForDeferredDirLight.fs").c_str()),
+        pointLightShader((shaderDirectory + "vertexShader.vs").c_str(), (shaderDirectory + "fragmentShaderForDeferredPointLight.fs").c_str()),
+        spotLightShader((shaderDirectory + "vertexShader.vs").c_str(), (shaderDirectory + "fragmentShaderForDeferredSpotLight.fs").c_str()),
+        lightSphere(1.0f, 16, 8)
+    {
+        Shader* lightingShaders[] = { &dirLightShader, &pointLightShader, &spotLightShader };
+        for(int i = 0; i < 3; i++)
+        {
+            lightingShaders[i]->use();
+            lightingShaders[i]->setInt("gPosition", 0);
+            lightingShaders[i]->setInt("gNormal", 1);
+            lightingShaders[i]->setInt("gDiffuse", 2);
+            lightingShaders[i]->setInt("gSpecular", 3);
+            lightingShaders[i]->setInt("gAmbient", 4);
+        }
+
+        // the fullscreen triangle has no attributes, but core profile still needs a VAO bound
+        glGenVertexArrays(1, &emptyVAO);
+        setUpLightCone();
+        createGBuffer(width, height);
+    }
+
+    ~DeferredRenderer()
+    {
+        deleteGBuffer();
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteVertexArrays(1, &coneVAO);
+        glDeleteBuffers(1, &coneVBO);
+        glDeleteBuffers(1, &coneEBO);
+    }
+
+    void resize(int width, int height)
+    {
+        if(width == this->width && height == this->height)
+            return;
+        deleteGBuffer();
+        createGBuffer(width, height);
+    }
+
+    void beginGeometryPass()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, gBufferFBO);
+        glViewport(0, 0, width, height);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glDisable(GL_BLEND);
+    }
+
+    void endGeometryPass()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // Shades the G-buffer into targetFBO and copies the scene depth there, so forward
+    // drawn objects (lamps) can be depth tested against the deferred scene afterwards.
+    // view is the camera view matrix, used to pick the shadow cascade of each pixel.
+    void lightingPass(TransformBuffer &transforms, glm::vec3 viewPos, DirectionLight &dirLight, PointLight* pointLights[], int pointLightCount, SpotLight &spotLight, ShadowRenderer &shadows, AmbientOcclusion &occlusion, const glm::mat4 &view, unsigned int targetFBO = 0)
+    {
+        // light volume transforms
+        int firstPointLight = transforms.getCount();
+        for(int i = 0; i < pointLightCount; i++)
+        {
+            // the sphere mesh is inscribed in its radius, grow it a little so the volume covers it
+            float radius = pointLights[i]->getAttenuationRadius() * 1.1f;
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), pointLights[i]->position);
+            model = glm::scale(model, glm::vec3(radius));
+            transforms.add(model);
+        }
+
+        float coneLength = spotLight.getAttenuationRadius();
+        bool spotLightLit = coneLength > LIGHT_MIN_RADIUS;
+        float coneRadius = coneLength * tanf(glm::radians(spotLight.outerCuttOff)) / cosf(PI / LIGHT_CONE_SEGMENTS);
+        glm::vec3 direction = glm::normalize(spotLight.direction);
+        glm::vec3 up = fabsf(direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        // inverse view matrix of the light: moves the cone apex to the light and points -z along its direction
+        glm::mat4 coneModel = glm::inverse(glm::lookAt(spotLight.position, spotLight.position + direction, up));
+        coneModel = glm::scale(coneModel, glm::vec3(coneRadius, coneRadius, coneLength));
+        int spotLightIndex = transforms.add(coneModel);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, gBufferFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFBO);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+        glViewport(0, 0, width, height);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        for(int i = 0; i < 5; i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + i);
+            glBindTexture(GL_TEXTURE_2D, gBufferTextures[i]);
+        }
+        glActiveTexture(GL_TEXTURE0);
+
+        // directional light and its ambient term cover every pixel
+        glDisable(GL_DEPTH_TEST);
+        dirLight.setUpDirectionLight(dirLightShader);
+        dirLightShader.setVec3("viewPos", viewPos);
+        shadows.setUpShadows(dirLightShader, view);
+        occlusion.setUpOcclusion(dirLightShader);
+        glBindVertexArray(emptyVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        // light volumes: back faces that are behind the scene surface mark the pixels inside the volume
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_GEQUAL);
+        glDepthMask(GL_FALSE);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+
+        transforms.bind(pointLightShader);
+        pointLightShader.setVec2("screenSize", (float)width, (float)height);
+        pointLightShader.setVec3("viewPos", viewPos);
+        occlusion.setUpOcclusion(pointLightShader);
+        for(int i = 0; i < pointLightCount; i++)
+            pointLights[i]->setUpPointLight(pointLightShader);
+        for(int i = 0; i < pointLightCount; i++)
+        {
+            // lights too dim to reach past LIGHT_MIN_RADIUS light nothing
+            if(pointLights[i]->getAttenuationRadius() <= LIGHT_MIN_RADIUS)
+                continue;
+            int light = glm::clamp(pointLights[i]->lightNumber, 1, 4) - 1;
+            shadows.pointShadows.setUpLightShadow(pointLightShader, light, shadows.enabled);
+            pointLightShader.setInt("lightIndex", light);
+            pointLightShader.setInt("objectIndex", firstPointLight + i);
+            lightSphere.drawSphereGeometry();
+        }
+
+        transforms.bind(spotLightShader);
+        spotLightShader.setVec2("screenSize", (float)width, (float)height);
+        spotLightShader.setVec3("viewPos", viewPos);
+        spotLight.setUpSpotLight(spotLightShader);
+        shadows.setUpShadows(spotLightShader, view);
+        occlusion.setUpOcclusion(spotLightShader);
+        spotLightShader.setInt("objectIndex", spotLightIndex);
+        if(spotLightLit)
+        {
+            glBindVertexArray(coneVAO);
+            glDrawElements(GL_TRIANGLES, LIGHT_CONE_SEGMENTS * 6, GL_UNSIGNED_INT, 0);
+            glBindVertexArray(0);
+        }
+
+        glDisable(GL_CULL_FACE);
+        glCullFace(GL_BACK);
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+        glDisable(GL_BLEND);
+    }
+
+    unsigned int getGBufferFBO() const
+    {
+        return gBufferFBO;
+    }
+
+    unsigned int getDepthTexture() const
+    {
+        return depthTexture;
+    }
+
+    unsigned int getNormalTexture() const
+    {
+        return gBufferTextures[1];
+    }
+
+private:
+    Shader dirLightShader;
+    Shader pointLightShader;
+    Shader spotLightShader;
+    Sphere lightSphere;
+
+    unsigned int gBufferFBO = 0;
+    unsigned int gBufferTextures[5];
+    unsigned int depthTexture = 0;
+    unsigned int emptyVAO;
+    unsigned int coneVAO, coneVBO, coneEBO;
+    int width = 0;
+    int height = 0;
+
+    void createGBuffer(int width, int height)
+    {
+        this->width = width;
+        this->height = height;
+
+        glGenFramebuffers(1, &gBufferFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, gBufferFBO);
+
+        GLenum internalFormats[5] = { GL_RGBA16F, GL_RGBA16F, GL_RGBA8, GL_RGBA8, GL_RGBA8 };
+        GLenum types[5] = { GL_FLOAT, GL_FLOAT, GL_UNSIGNED_BYTE, GL_UNSIGNED_BYTE, GL_UNSIGNED_BYTE };
+        glGenTextures(5, gBufferTextures);
+        for(int i = 0; i < 5; i++)
+        {
+            glBindTexture(GL_TEXTURE_2D, gBufferTextures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[i], width, height, 0, GL_RGBA, types[i], NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, gBufferTextures[i], 0);
+        }
+        unsigned int attachments[5] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3, GL_COLOR_ATTACHMENT4 };
+        glDrawBuffers(5, attachments);
+
+        // same format as the default framebuffer's depth so it can be blitted there, but a
+        // texture so ambient occlusion can sample it
+        glGenTextures(1, &depthTexture);
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "G-buffer framebuffer is not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    void deleteGBuffer()
+    {
+        glDeleteTextures(5, gBufferTextures);
+        glDeleteTextures(1, &depthTexture);
+        glDeleteFramebuffers(1, &gBufferFBO);
+    }
+
+    // unit cone: apex at the origin, base circle of radius 1 at z = -1
+    void setUpLightCone()
+    {
+        vector<float> coneVertices;
+        vector<unsigned int> coneIndices;
+
+        coneVertices.push_back(0.0f); coneVertices.push_back(0.0f); coneVertices.push_back(0.0f);      // apex
+        coneVertices.push_back(0.0f); coneVertices.push_back(0.0f); coneVertices.push_back(-1.0f);     // base center
+        for(int i = 0; i < LIGHT_CONE_SEGMENTS; i++)
+        {
+            float angle = 2 * PI * i / LIGHT_CONE_SEGMENTS;
+            coneVertices.push_back(cosf(angle));
+            coneVertices.push_back(sinf(angle));
+            coneVertices.push_back(-1.0f);
+        }
+        for(int i = 0; i < LIGHT_CONE_SEGMENTS; i++)
+        {
+            unsigned int current = 2 + i;
+            unsigned int next = 2 + (i + 1) % LIGHT_CONE_SEGMENTS;
+            // side, counter-clockwise seen from outside
+            coneIndices.push_back(0);
+            coneIndices.push_back(current);
+            coneIndices.push_back(next);
+            // base cap
+            coneIndices.push_back(1);
+            coneIndices.push_back(next);
+            coneIndices.push_back(current);
+        }
+
+        glGenVertexArrays(1, &coneVAO);
+        glGenBuffers(1, &coneVBO);
+        glGenBuffers(1, &coneEBO);
+        glBindVertexArray(coneVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, coneVBO);
+        glBufferData(GL_ARRAY_BUFFER, coneVertices.size() * sizeof(float), coneVertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, coneEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, coneIndices.size() * sizeof(unsigned int), coneIndices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
+    }
+};
+
+#endif /* deferredRenderer_h */
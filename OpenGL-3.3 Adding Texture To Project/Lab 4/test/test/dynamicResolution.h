@@ -0,0 +1,100 @@
+//
+//  dynamicResolution.h
+//  test
+//
+
+#ifndef dynamicResolution_h
+#define dynamicResolution_h
+
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+#include "profiler.h"
+
+using namespace std;
+
+// the scale moves in steps of this, so each render target size is kept for many frames
+const float RESOLUTION_SCALE_STEP = 1.0f / 16.0f;
+// frames with room to spare before the scale goes up a step
+const int RESOLUTION_RAISE_FRAMES = 30;
+
+// Picks the scene's render resolution from the GPU frame time, so the frame rate holds
+// and the resolution gives instead. Over budget it drops straight to the scale that
+// would fit, since the frame costs roughly the pixel count, scale squared; it climbs
+// back one step at a time, and only after RESOLUTION_RAISE_FRAMES frames that would
+// still fit one step up. Timer queries arrive PROFILER_FRAME_LATENCY frames late, so
+// after every change the frames still in flight at the old size are ignored.
+class DynamicResolution{
+public:
+    bool enabled = false;
+    float budgetMs = 1000.0f / 60.0f;   // GPU time per frame
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+
+    // once per frame, with the newest resolved GPU time of the whole frame
+    void update(double gpuMs)
+    {
+        if(!enabled)
+        {
+            setScale(maxScale);
+            return;
+        }
+        if(skipFrames > 0)
+        {
+            skipFrames--;
+            return;
+        }
+        if(gpuMs <= 0.0)
+            return;
+        smoothedMs = samples++ == 0 ? gpuMs : 0.8 * smoothedMs + 0.2 * gpuMs;
+
+        float fit = scale * sqrtf(budgetMs / (float)smoothedMs);
+        if(smoothedMs > budgetMs)
+            setScale(min(scale - RESOLUTION_SCALE_STEP, floorf(fit / RESOLUTION_SCALE_STEP) * RESOLUTION_SCALE_STEP));
+        // a tenth of the budget is kept free, so one step up does not go straight back down
+        else if(fit * sqrtf(0.9f) >= scale + RESOLUTION_SCALE_STEP)
+        {
+            if(++framesUnderBudget >= RESOLUTION_RAISE_FRAMES)
+                setScale(scale + RESOLUTION_SCALE_STEP);
+        }
+        else
+            framesUnderBudget = 0;
+    }
+
+    float getScale() const
+    {
+        return scale;
+    }
+
+    // the render size for an output of this size
+    void getRenderSize(int outputWidth, int outputHeight, int &width, int &height) const
+    {
+        width = max((int)(outputWidth * scale + 0.5f), 1);
+        height = max((int)(outputHeight * scale + 0.5f), 1);
+    }
+
+    void report(ostream &out = cout) const
+    {
+        out << "dynamic resolution " << (enabled ? "on" : "off") << ": scale " << scale << ", GPU frame " << smoothedMs << " ms of " << budgetMs << " ms" << endl;
+    }
+
+private:
+    float scale = 1.0f;
+    double smoothedMs = 0.0;
+    int samples = 0;
+    int skipFrames = 0;
+    int framesUnderBudget = 0;
+
+    void setScale(float newScale)
+    {
+        newScale = max(minScale, min(newScale, maxScale));
+        if(newScale == scale)
+            return;
+        scale = newScale;
+        skipFrames = PROFILER_FRAME_LATENCY;
+        samples = 0;
+        framesUnderBudget = 0;
+    }
+};
+
+#endif /* dynamicResolution_h */
@@ -0,0 +1,70 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D source;
+uniform vec2 sourceTexelSize;
+// first level only: keep what is brighter than threshold, with a soft knee, and weight
+// the taps by brightness so a single very bright pixel cannot flicker through the chain
+uniform bool prefilter;
+uniform float threshold;
+uniform float knee;
+
+vec3 sampleAt(float x, float y)
+{
+    return texture(source, TexCoords + vec2(x, y) * sourceTexelSize).rgb;
+}
+
+// Karis average: a group of taps weighted by 1 / (1 + luma)
+vec3 karisAverage(vec3 a, vec3 b, vec3 c, vec3 d)
+{
+    vec4 sum = vec4(0.0);
+    vec3 taps[4] = vec3[](a, b, c, d);
+    for(int i = 0; i < 4; i++)
+    {
+        float w = 1.0 / (1.0 + dot(taps[i], vec3(0.2126, 0.7152, 0.0722)));
+        sum += vec4(taps[i] * w, w);
+    }
+    return sum.rgb / sum.w;
+}
+
+vec3 applyThreshold(vec3 color)
+{
+    float brightness = max(color.r, max(color.g, color.b));
+    float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 1e-5);
+    return color * max(soft, brightness - threshold) / max(brightness, 1e-5);
+}
+
+// the 13-tap downsample of Jimenez's Call of Duty bloom: four overlapping 2x2 boxes and
+// one centered box, each read with bilinear taps between texels
+void main()
+{
+    vec3 a = sampleAt(-2.0,  2.0);
+    vec3 b = sampleAt( 0.0,  2.0);
+    vec3 c = sampleAt( 2.0,  2.0);
+    vec3 d = sampleAt(-2.0,  0.0);
+    vec3 e = sampleAt( 0.0,  0.0);
+    vec3 f = sampleAt( 2.0,  0.0);
+    vec3 g = sampleAt(-2.0, -2.0);
+    vec3 h = sampleAt( 0.0, -2.0);
+    vec3 i = sampleAt( 2.0, -2.0);
+    vec3 j = sampleAt(-1.0,  1.0);
+    vec3 k = sampleAt( 1.0,  1.0);
+    vec3 l = sampleAt(-1.0, -1.0);
+    vec3 m = sampleAt( 1.0, -1.0);
+
+    vec3 color;
+    if(prefilter)
+    {
+        color = karisAverage(j, k, l, m) * 0.5
+              + (karisAverage(a, b, d, e) + karisAverage(b, c, e, f) + karisAverage(d, e, g, h) + karisAverage(e, f, h, i)) * 0.125;
+        color = applyThreshold(color);
+    }
+    else
+    {
+        color = e * 0.125 + (a + c + g + i) * 0.03125 + (b + d + f + h) * 0.0625 + (j + k + l + m) * 0.125;
+    }
+    FragColor = vec4(color, 1.0);
+}
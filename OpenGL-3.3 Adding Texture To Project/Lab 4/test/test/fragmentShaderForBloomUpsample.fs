@@ -0,0 +1,20 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D source;
+uniform vec2 sourceTexelSize;
+uniform float filterRadius;     // in source texels
+
+// 3x3 tent filter of the next smaller level, added onto this level by blending
+void main()
+{
+    vec2 r = sourceTexelSize * filterRadius;
+    vec3 color = texture(source, TexCoords).rgb * 4.0;
+    color += (texture(source, TexCoords + vec2(-r.x, 0.0)).rgb + texture(source, TexCoords + vec2(r.x, 0.0)).rgb
+            + texture(source, TexCoords + vec2(0.0, -r.y)).rgb + texture(source, TexCoords + vec2(0.0, r.y)).rgb) * 2.0;
+    color += texture(source, TexCoords + vec2(-r.x, -r.y)).rgb + texture(source, TexCoords + vec2(r.x, -r.y)).rgb
+           + texture(source, TexCoords + vec2(-r.x, r.y)).rgb + texture(source, TexCoords + vec2(r.x, r.y)).rgb;
+    FragColor = vec4(color / 16.0, 1.0);
+}
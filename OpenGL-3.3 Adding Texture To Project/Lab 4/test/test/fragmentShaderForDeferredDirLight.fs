@@ -0,0 +1,109 @@
+#version 330 core
+out vec4 FragColor;
+
+struct DirLight {
+    vec3 direction;
+    
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+in vec2 TexCoords;
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gDiffuse;
+uniform sampler2D gSpecular;
+uniform sampler2D gAmbient;
+
+uniform vec3 viewPos;
+uniform DirLight dirLight;
+
+// cascaded shadows (see shadowMap.h)
+#define MAX_CASCADES 4
+uniform bool shadowsOn;
+uniform mat4 view;
+uniform int cascadeCount;
+uniform float cascadeSplits[MAX_CASCADES];     // view space far distance of each cascade
+uniform mat4 dirLightSpaceMatrices[MAX_CASCADES];
+uniform sampler2DArrayShadow dirShadowMap;
+
+// ambient occlusion (see ambientOcclusion.h)
+uniform bool ssaoOn;
+uniform sampler2D ssaoMap;
+
+float CalcDirShadow(vec3 fragPos, vec3 N);
+float CalcAmbientOcclusion();
+
+void main()
+{
+    vec4 normal = texture(gNormal, TexCoords);
+    // nothing was drawn here in the geometry pass
+    if(normal.w == 0.0)
+        discard;
+    
+    vec4 position = texture(gPosition, TexCoords);
+    vec3 N = normalize(normal.xyz);
+    vec3 V = normalize(viewPos - position.xyz);
+    vec3 K_D = texture(gDiffuse, TexCoords).rgb;
+    vec3 K_S = texture(gSpecular, TexCoords).rgb;
+    vec3 K_A = texture(gAmbient, TexCoords).rgb;
+    float shininess = position.w;
+    
+    vec3 L = normalize(-dirLight.direction);
+    vec3 R = reflect(-L, N);
+    
+    vec3 ambient = K_A * dirLight.ambient * CalcAmbientOcclusion();
+    vec3 diffuse = K_D * max(dot(N, L), 0.0) * dirLight.diffuse;
+    vec3 specular = K_S * pow(max(dot(V, R), 0.0), shininess) * dirLight.specular;
+    
+    // shadows only block direct light
+    float shadow = CalcDirShadow(position.xyz, N);
+    diffuse *= shadow;
+    specular *= shadow;
+    
+    FragColor = vec4(ambient + diffuse + specular, 1.0);
+}
+
+// fraction of the directional light reaching fragPos, 3x3 PCF in the cascade covering it
+float CalcDirShadow(vec3 fragPos, vec3 N)
+{
+    if(!shadowsOn)
+        return 1.0;
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    int cascade = cascadeCount;
+    for(int i = 0; i < cascadeCount; i++)
+    {
+        if(depth < cascadeSplits[i])
+        {
+            cascade = i;
+            break;
+        }
+    }
+    // beyond the shadow distance
+    if(cascade == cascadeCount)
+        return 1.0;
+    
+    // normal offset grows with the cascade, whose texels grow too
+    vec4 lightSpace = dirLightSpaceMatrices[cascade] * vec4(fragPos + N * 0.01 * float(cascade + 1), 1.0);
+    vec3 p = lightSpace.xyz / lightSpace.w * 0.5 + 0.5;
+    if(p.z > 1.0)
+        return 1.0;
+    
+    vec2 texelSize = 1.0 / vec2(textureSize(dirShadowMap, 0).xy);
+    float lit = 0.0;
+    for(int x = -1; x <= 1; x++)
+        for(int y = -1; y <= 1; y++)
+            lit += texture(dirShadowMap, vec4(p.xy + vec2(x, y) * texelSize, float(cascade), p.z));
+    return lit / 9.0;
+}
+
+
+// fraction of the ambient light reaching this pixel, from the screen-space occlusion
+float CalcAmbientOcclusion()
+{
+    if(!ssaoOn)
+        return 1.0;
+    return texelFetch(ssaoMap, ivec2(gl_FragCoord.xy), 0).r;
+}
@@ -0,0 +1,103 @@
+#version 330 core
+out vec4 FragColor;
+
+struct PointLight {
+    vec3 position;
+    
+    float k_c;  // attenuation factors
+    float k_l;  // attenuation factors
+    float k_q;  // attenuation factors
+    
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+#define NR_POINT_LIGHTS 4
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gDiffuse;
+uniform sampler2D gSpecular;
+uniform sampler2D gAmbient;
+
+uniform vec2 screenSize;
+uniform vec3 viewPos;
+uniform PointLight pointLights[NR_POINT_LIGHTS];
+uniform int lightIndex;     // the light whose volume is being drawn
+
+// shadow of that light (see pointShadowMap.h)
+uniform bool shadowsOn;
+uniform samplerCubeShadow pointShadowMap;
+uniform float pointShadowFarPlane;
+
+// ambient occlusion (see ambientOcclusion.h)
+uniform bool ssaoOn;
+uniform sampler2D ssaoMap;
+
+float CalcPointShadow(samplerCubeShadow shadowMap, vec3 lightPos, float farPlane, vec3 fragPos, vec3 N);
+float CalcAmbientOcclusion();
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / screenSize;
+    vec4 normal = texture(gNormal, uv);
+    if(normal.w == 0.0)
+        discard;
+    
+    PointLight light = pointLights[lightIndex];
+    vec4 position = texture(gPosition, uv);
+    vec3 fragPos = position.xyz;
+    vec3 N = normalize(normal.xyz);
+    vec3 V = normalize(viewPos - fragPos);
+    vec3 K_D = texture(gDiffuse, uv).rgb;
+    vec3 K_S = texture(gSpecular, uv).rgb;
+    vec3 K_A = texture(gAmbient, uv).rgb;
+    float shininess = position.w;
+    
+    vec3 L = normalize(light.position - fragPos);
+    vec3 R = reflect(-L, N);
+    
+    // attenuation
+    float d = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.k_c + light.k_l * d + light.k_q * (d * d));
+    
+    vec3 ambient = K_A * light.ambient * CalcAmbientOcclusion();
+    vec3 diffuse = K_D * max(dot(N, L), 0.0) * light.diffuse;
+    vec3 specular = K_S * pow(max(dot(V, R), 0.0), shininess) * light.specular;
+    
+    float shadow = CalcPointShadow(pointShadowMap, light.position, pointShadowFarPlane, fragPos, N);
+    diffuse *= shadow;
+    specular *= shadow;
+    
+    FragColor = vec4((ambient + diffuse + specular) * attenuation, 1.0);
+}
+
+// fraction of a point light reaching fragPos; farPlane 0 means the light has no shadow map
+float CalcPointShadow(samplerCubeShadow shadowMap, vec3 lightPos, float farPlane, vec3 fragPos, vec3 N)
+{
+    if(!shadowsOn || farPlane <= 0.0)
+        return 1.0;
+    vec3 toFrag = fragPos + N * 0.02 - lightPos;
+    float d = length(toFrag);
+    if(d >= farPlane)
+        return 1.0;
+    
+    // 8 taps around the direction, offsets grow with distance so the kernel keeps its angular size
+    float ref = d / farPlane - 0.002;
+    float offset = d * 0.005;
+    float lit = 0.0;
+    for(int x = -1; x <= 1; x += 2)
+        for(int y = -1; y <= 1; y += 2)
+            for(int z = -1; z <= 1; z += 2)
+                lit += texture(shadowMap, vec4(toFrag + vec3(x, y, z) * offset, ref));
+    return lit / 8.0;
+}
+
+// fraction of the ambient light reaching this pixel, from the screen-space occlusion
+float CalcAmbientOcclusion()
+{
+    if(!ssaoOn)
+        return 1.0;
+    return texelFetch(ssaoMap, ivec2(gl_FragCoord.xy), 0).r;
+}
@@ -0,0 +1,106 @@
+#version 330 core
+out vec4 FragColor;
+
+struct SpotLight {
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+  
+    float k_c;  // attenuation factors
+    float k_l;  // attenuation factors
+    float k_q;  // attenuation factors
+  
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gDiffuse;
+uniform sampler2D gSpecular;
+uniform sampler2D gAmbient;
+
+uniform vec2 screenSize;
+uniform vec3 viewPos;
+uniform SpotLight spotLight;
+
+// spot light shadow (see shadowMap.h)
+uniform bool shadowsOn;
+uniform mat4 spotLightSpaceMatrix;
+uniform sampler2DShadow spotShadowMap;
+
+// ambient occlusion (see ambientOcclusion.h)
+uniform bool ssaoOn;
+uniform sampler2D ssaoMap;
+
+float CalcSpotShadow(vec3 fragPos, vec3 N);
+float CalcAmbientOcclusion();
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / screenSize;
+    vec4 normal = texture(gNormal, uv);
+    if(normal.w == 0.0)
+        discard;
+    
+    vec4 position = texture(gPosition, uv);
+    vec3 fragPos = position.xyz;
+    vec3 N = normalize(normal.xyz);
+    vec3 V = normalize(viewPos - fragPos);
+    vec3 K_D = texture(gDiffuse, uv).rgb;
+    vec3 K_S = texture(gSpecular, uv).rgb;
+    vec3 K_A = texture(gAmbient, uv).rgb;
+    float shininess = position.w;
+    
+    vec3 L = normalize(spotLight.position - fragPos);
+    vec3 R = reflect(-L, N);
+    
+    // attenuation
+    float d = length(spotLight.position - fragPos);
+    float attenuation = 1.0 / (spotLight.k_c + spotLight.k_l * d + spotLight.k_q * (d * d));
+    
+    // spotlight intensity
+    float theta = dot(L, normalize(-spotLight.direction));
+    float epsilon = spotLight.cutOff - spotLight.outerCutOff;
+    float intensity = clamp((theta - spotLight.outerCutOff) / epsilon, 0.0, 1.0);
+    
+    vec3 ambient = K_A * spotLight.ambient * CalcAmbientOcclusion();
+    vec3 diffuse = K_D * max(dot(N, L), 0.0) * spotLight.diffuse;
+    vec3 specular = K_S * pow(max(dot(V, R), 0.0), shininess) * spotLight.specular;
+    
+    float shadow = CalcSpotShadow(fragPos, N);
+    diffuse *= shadow;
+    specular *= shadow;
+    
+    FragColor = vec4((ambient + diffuse + specular) * attenuation * intensity, 1.0);
+}
+
+// fraction of the spot light reaching fragPos, 3x3 PCF
+float CalcSpotShadow(vec3 fragPos, vec3 N)
+{
+    if(!shadowsOn)
+        return 1.0;
+    vec4 lightSpace = spotLightSpaceMatrix * vec4(fragPos + N * 0.01, 1.0);
+    if(lightSpace.w <= 0.0)
+        return 1.0;
+    vec3 p = lightSpace.xyz / lightSpace.w * 0.5 + 0.5;
+    if(p.z > 1.0)
+        return 1.0;
+    
+    vec2 texelSize = 1.0 / vec2(textureSize(spotShadowMap, 0));
+    float lit = 0.0;
+    for(int x = -1; x <= 1; x++)
+        for(int y = -1; y <= 1; y++)
+            lit += texture(spotShadowMap, vec3(p.xy + vec2(x, y) * texelSize, p.z));
+    return lit / 9.0;
+}
+
+// fraction of the ambient light reaching this pixel, from the screen-space occlusion
+float CalcAmbientOcclusion()
+{
+    if(!ssaoOn)
+        return 1.0;
+    return texelFetch(ssaoMap, ivec2(gl_FragCoord.xy), 0).r;
+}
@@ -0,0 +1,129 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D source;       // tone mapped, luma in alpha
+uniform vec2 texelSize;
+
+// after Lottes' FXAA 3.11 quality preset
+#define EDGE_THRESHOLD_MIN 0.0312   // darker than this is left alone
+#define EDGE_THRESHOLD_MAX 0.125    // local contrast needed, relative to the brightest neighbour
+#define SUBPIXEL_QUALITY 0.75
+#define ITERATIONS 12
+
+// step along the edge per search iteration, in texels
+const float QUALITY[ITERATIONS] = float[](1.0, 1.0, 1.0, 1.0, 1.0, 1.5, 2.0, 2.0, 2.0, 2.0, 4.0, 8.0);
+
+float lumaAt(vec2 uv)
+{
+    return texture(source, uv).a;
+}
+
+// Finds the direction of the edge through this pixel from the luma of its 3x3
+// neighbourhood, walks along it both ways to its ends, and blends with the neighbour
+// across the edge by how far the pixel is from the nearer end, which turns stairs
+// into a slope. Single pixels unlike everything around them get a subpixel blend.
+void main()
+{
+    vec4 center = texture(source, TexCoords);
+    float lumaCenter = center.a;
+    float lumaDown = textureOffset(source, TexCoords, ivec2(0, -1)).a;
+    float lumaUp = textureOffset(source, TexCoords, ivec2(0, 1)).a;
+    float lumaLeft = textureOffset(source, TexCoords, ivec2(-1, 0)).a;
+    float lumaRight = textureOffset(source, TexCoords, ivec2(1, 0)).a;
+    
+    float lumaMin = min(lumaCenter, min(min(lumaDown, lumaUp), min(lumaLeft, lumaRight)));
+    float lumaMax = max(lumaCenter, max(max(lumaDown, lumaUp), max(lumaLeft, lumaRight)));
+    float range = lumaMax - lumaMin;
+    // no edge here, or too dark for one to show
+    if(range < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD_MAX))
+    {
+        FragColor = vec4(center.rgb, 1.0);
+        return;
+    }
+    
+    float lumaDownLeft = textureOffset(source, TexCoords, ivec2(-1, -1)).a;
+    float lumaUpRight = textureOffset(source, TexCoords, ivec2(1, 1)).a;
+    float lumaUpLeft = textureOffset(source, TexCoords, ivec2(-1, 1)).a;
+    float lumaDownRight = textureOffset(source, TexCoords, ivec2(1, -1)).a;
+    float lumaDownUp = lumaDown + lumaUp;
+    float lumaLeftRight = lumaLeft + lumaRight;
+    float lumaLeftCorners = lumaDownLeft + lumaUpLeft;
+    float lumaDownCorners = lumaDownLeft + lumaDownRight;
+    float lumaRightCorners = lumaDownRight + lumaUpRight;
+    float lumaUpCorners = lumaUpRight + lumaUpLeft;
+    
+    // second differences across each axis, the center row counted twice
+    float edgeHorizontal = abs(-2.0 * lumaLeft + lumaLeftCorners) + abs(-2.0 * lumaCenter + lumaDownUp) * 2.0 + abs(-2.0 * lumaRight + lumaRightCorners);
+    float edgeVertical = abs(-2.0 * lumaUp + lumaUpCorners) + abs(-2.0 * lumaCenter + lumaLeftRight) * 2.0 + abs(-2.0 * lumaDown + lumaDownCorners);
+    bool isHorizontal = edgeHorizontal >= edgeVertical;
+    
+    // which side of the pixel the edge is on: the steeper gradient
+    float luma1 = isHorizontal ? lumaDown : lumaLeft;
+    float luma2 = isHorizontal ? lumaUp : lumaRight;
+    float gradient1 = luma1 - lumaCenter;
+    float gradient2 = luma2 - lumaCenter;
+    bool is1Steepest = abs(gradient1) >= abs(gradient2);
+    float gradientScaled = 0.25 * max(abs(gradient1), abs(gradient2));
+    float stepLength = isHorizontal ? texelSize.y : texelSize.x;
+    float lumaLocalAverage;
+    if(is1Steepest)
+    {
+        stepLength = -stepLength;
+        lumaLocalAverage = 0.5 * (luma1 + lumaCenter);
+    }
+    else
+        lumaLocalAverage = 0.5 * (luma2 + lumaCenter);
+    
+    // walk along the edge, half a texel towards it, until the luma leaves the edge's average
+    vec2 edgeUv = TexCoords;
+    if(isHorizontal)
+        edgeUv.y += stepLength * 0.5;
+    else
+        edgeUv.x += stepLength * 0.5;
+    vec2 offset = isHorizontal ? vec2(texelSize.x, 0.0) : vec2(0.0, texelSize.y);
+    vec2 uv1 = edgeUv - offset;
+    vec2 uv2 = edgeUv + offset;
+    float lumaEnd1 = 0.0;
+    float lumaEnd2 = 0.0;
+    bool reached1 = false;
+    bool reached2 = false;
+    for(int i = 0; i < ITERATIONS; i++)
+    {
+        if(!reached1)
+            lumaEnd1 = lumaAt(uv1) - lumaLocalAverage;
+        if(!reached2)
+            lumaEnd2 = lumaAt(uv2) - lumaLocalAverage;
+        reached1 = abs(lumaEnd1) >= gradientScaled;
+        reached2 = abs(lumaEnd2) >= gradientScaled;
+        if(reached1 && reached2)
+            break;
+        if(!reached1)
+            uv1 -= offset * QUALITY[i];
+        if(!reached2)
+            uv2 += offset * QUALITY[i];
+    }
+    
+    float distance1 = isHorizontal ? (TexCoords.x - uv1.x) : (TexCoords.y - uv1.y);
+    float distance2 = isHorizontal ? (uv2.x - TexCoords.x) : (uv2.y - TexCoords.y);
+    bool isDirection1 = distance1 < distance2;
+    float pixelOffset = 0.5 - min(distance1, distance2) / (distance1 + distance2);
+    // only blend if the nearer end goes the same way as the center, else this pixel is past the step
+    bool isLumaCenterSmaller = lumaCenter < lumaLocalAverage;
+    bool correctVariation = ((isDirection1 ? lumaEnd1 : lumaEnd2) < 0.0) != isLumaCenterSmaller;
+    float finalOffset = correctVariation ? pixelOffset : 0.0;
+    
+    // subpixel aliasing: how much the pixel differs from its whole neighbourhood
+    float lumaAverage = (1.0 / 12.0) * (2.0 * (lumaDownUp + lumaLeftRight) + lumaLeftCorners + lumaRightCorners);
+    float subPixel = clamp(abs(lumaAverage - lumaCenter) / range, 0.0, 1.0);
+    subPixel = (-2.0 * subPixel + 3.0) * subPixel * subPixel;
+    finalOffset = max(finalOffset, subPixel * subPixel * SUBPIXEL_QUALITY);
+    
+    vec2 finalUv = TexCoords;
+    if(isHorizontal)
+        finalUv.y += finalOffset * stepLength;
+    else
+        finalUv.x += finalOffset * stepLength;
+    FragColor = vec4(texture(source, finalUv).rgb, 1.0);
+}
@@ -0,0 +1,36 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D source;
+uniform vec2 direction;         // one texel along x or y
+// first pass only: keep what is brighter than threshold, with a soft knee
+uniform bool prefilter;
+uniform float threshold;
+uniform float knee;
+
+const float weights[5] = float[](0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216);
+
+vec3 applyThreshold(vec3 color)
+{
+    float brightness = max(color.r, max(color.g, color.b));
+    float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 1e-5);
+    return color * max(soft, brightness - threshold) / max(brightness, 1e-5);
+}
+
+vec3 sampleAt(vec2 offset)
+{
+    vec3 color = texture(source, TexCoords + offset).rgb;
+    return prefilter ? applyThreshold(color) : color;
+}
+
+// one direction of a 9-tap separable Gaussian, the full resolution reference for the bloom mip chain
+void main()
+{
+    vec3 color = sampleAt(vec2(0.0)) * weights[0];
+    for(int i = 1; i < 5; i++)
+        color += (sampleAt(direction * float(i)) + sampleAt(-direction * float(i))) * weights[i];
+    FragColor = vec4(color, 1.0);
+}
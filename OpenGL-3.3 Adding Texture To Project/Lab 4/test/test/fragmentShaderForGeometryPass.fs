@@ -0,0 +1,50 @@
+#version 330 core
+layout (location = 0) out vec4 gPosition;
+layout (location = 1) out vec4 gNormal;
+layout (location = 2) out vec4 gDiffuse;
+layout (location = 3) out vec4 gSpecular;
+layout (location = 4) out vec4 gAmbient;
+
+struct Material {
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float shininess;
+};
+
+in vec3 FragPos;
+in vec3 Normal;
+
+uniform Material material;
+
+// material registry (see materialBuffer.h), used when the object has a material index
+#define MAX_MATERIALS 256
+struct MaterialData {
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;  // w = shininess
+};
+layout (std140) uniform Materials {
+    MaterialData materials[MAX_MATERIALS];
+};
+flat in int MaterialIndex;
+
+// the object's material: from the registry, or the material uniform for index -1
+Material getMaterial()
+{
+    if(MaterialIndex < 0)
+        return material;
+    MaterialData data = materials[MaterialIndex];
+    return Material(data.ambient.xyz, data.diffuse.xyz, data.specular.xyz, data.specular.w);
+}
+
+void main()
+{
+    Material objectMaterial = getMaterial();
+    // world space position, shininess packed into w
+    gPosition = vec4(FragPos, objectMaterial.shininess);
+    gNormal = vec4(normalize(Normal), 1.0);
+    gDiffuse = vec4(objectMaterial.diffuse, 1.0);
+    gSpecular = vec4(objectMaterial.specular, 1.0);
+    gAmbient = vec4(objectMaterial.ambient, 1.0);
+}
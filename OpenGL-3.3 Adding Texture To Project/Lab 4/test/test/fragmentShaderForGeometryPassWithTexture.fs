@@ -0,0 +1,29 @@
+#version 330 core
+layout (location = 0) out vec4 gPosition;
+layout (location = 1) out vec4 gNormal;
+layout (location = 2) out vec4 gDiffuse;
+layout (location = 3) out vec4 gSpecular;
+layout (location = 4) out vec4 gAmbient;
+
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+    float shininess;
+};
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform Material material;
+
+void main()
+{
+    // world space position, shininess packed into w
+    gPosition = vec4(FragPos, material.shininess);
+    gNormal = vec4(normalize(Normal), 1.0);
+    gDiffuse = vec4(vec3(texture(material.diffuse, TexCoords)), 1.0);
+    gSpecular = vec4(vec3(texture(material.specular, TexCoords)), 1.0);
+    // the textured forward shader lights ambient with the diffuse map too
+    gAmbient = gDiffuse;
+}
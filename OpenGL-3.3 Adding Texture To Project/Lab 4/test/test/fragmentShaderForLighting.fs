@@ -54,32 +54,83 @@ uniform PointLight pointLights[NR_POINT_LIGHTS];
 uniform SpotLight spotLight;
 uniform Material material;
 
+// material registry (see materialBuffer.h), used when the object has a material index
+#define MAX_MATERIALS 256
+struct MaterialData {
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;  // w = shininess
+};
+layout (std140) uniform Materials {
+    MaterialData materials[MAX_MATERIALS];
+};
+flat in int MaterialIndex;
+
+// the object's material: from the registry, or the material uniform for index -1
+Material getMaterial()
+{
+    if(MaterialIndex < 0)
+        return material;
+    MaterialData data = materials[MaterialIndex];
+    return Material(data.ambient.xyz, data.diffuse.xyz, data.specular.xyz, data.specular.w);
+}
+
+// shadows (see shadowMap.h)
+#define MAX_CASCADES 4
+uniform bool shadowsOn;
+uniform mat4 view;
+uniform int cascadeCount;
+uniform float cascadeSplits[MAX_CASCADES];     // view space far distance of each cascade
+uniform mat4 dirLightSpaceMatrices[MAX_CASCADES];
+uniform sampler2DArrayShadow dirShadowMap;
+uniform mat4 spotLightSpaceMatrix;
+uniform sampler2DShadow spotShadowMap;
+uniform samplerCubeShadow pointShadowMaps[NR_POINT_LIGHTS];
+uniform float pointShadowFarPlanes[NR_POINT_LIGHTS];
+
+// ambient occlusion (see ambientOcclusion.h)
+uniform bool ssaoOn;
+uniform sampler2D ssaoMap;
+
 // function prototypes
-vec3 CalcDirLight(Material material, DirLight light, vec3 N, vec3 V);
-vec3 CalcPointLight(Material material, PointLight light, vec3 N, vec3 fragPos, vec3 V);
-vec3 CalcSpotLight(Material material, SpotLight light, vec3 N, vec3 fragPos, vec3 V);
+vec3 CalcDirLight(Material material, DirLight light, vec3 N, vec3 V, float shadow, float occlusion);
+vec3 CalcPointLight(Material material, PointLight light, vec3 N, vec3 fragPos, vec3 V, float shadow, float occlusion);
+vec3 CalcSpotLight(Material material, SpotLight light, vec3 N, vec3 fragPos, vec3 V, float shadow, float occlusion);
+float CalcDirShadow(vec3 fragPos, vec3 N);
+float CalcSpotShadow(vec3 fragPos, vec3 N);
+float CalcPointShadow(samplerCubeShadow shadowMap, vec3 lightPos, float farPlane, vec3 fragPos, vec3 N);
+float CalcAmbientOcclusion();
 
 void main()
 {
     // properties
     vec3 N = normalize(Normal);
     vec3 V = normalize(viewPos - FragPos);
+    Material objectMaterial = getMaterial();
+    
+    // ambient occlusion only darkens the ambient terms
+    float occlusion = CalcAmbientOcclusion();
     
     // directional lighting
-    vec3 result = CalcDirLight(material, dirLight, N, V);
+    vec3 result = CalcDirLight(objectMaterial, dirLight, N, V, CalcDirShadow(FragPos, N), occlusion);
     
-    // point lights
+    // point lights; sampler arrays only take constant indices in GLSL 3.30
+    float pointShadows[NR_POINT_LIGHTS];
+    pointShadows[0] = CalcPointShadow(pointShadowMaps[0], pointLights[0].position, pointShadowFarPlanes[0], FragPos, N);
+    pointShadows[1] = CalcPointShadow(pointShadowMaps[1], pointLights[1].position, pointShadowFarPlanes[1], FragPos, N);
+    pointShadows[2] = CalcPointShadow(pointShadowMaps[2], pointLights[2].position, pointShadowFarPlanes[2], FragPos, N);
+    pointShadows[3] = CalcPointShadow(pointShadowMaps[3], pointLights[3].position, pointShadowFarPlanes[3], FragPos, N);
     for(int i = 0; i < NR_POINT_LIGHTS; i++)
-        result += CalcPointLight(material, pointLights[i], N, FragPos, V);
+        result += CalcPointLight(objectMaterial, pointLights[i], N, FragPos, V, pointShadows[i], occlusion);
     
     // spot light
-    result += CalcSpotLight(material, spotLight, N, FragPos, V);
+    result += CalcSpotLight(objectMaterial, spotLight, N, FragPos, V, CalcSpotShadow(FragPos, N), occlusion);
     
     FragColor = vec4(result, 1.0);
 }
 
 // calculates the color when using a directional light.
-vec3 CalcDirLight(Material material, DirLight light, vec3 N, vec3 V)
+vec3 CalcDirLight(Material material, DirLight light, vec3 N, vec3 V, float shadow, float occlusion)
 {
     vec3 L = normalize(-light.direction);
     vec3 R = reflect(-L, N);
@@ -92,11 +143,16 @@ vec3 CalcDirLight(Material material, DirLight light, vec3 N, vec3 V)
     vec3 diffuse = K_D * max(dot(N, L), 0.0) * light.diffuse;
     vec3 specular = K_S * pow(max(dot(V, R), 0.0), material.shininess) * light.specular;
     
+    // shadows only block direct light, occlusion only the ambient light
+    ambient *= occlusion;
+    diffuse *= shadow;
+    specular *= shadow;
+    
     return (ambient + diffuse + specular);
 }
 
 // calculates the color when using a point light.
-vec3 CalcPointLight(Material material, PointLight light, vec3 N, vec3 fragPos, vec3 V)
+vec3 CalcPointLight(Material material, PointLight light, vec3 N, vec3 fragPos, vec3 V, float shadow, float occlusion)
 {
     vec3 L = normalize(light.position - fragPos);
     vec3 R = reflect(-L, N);
@@ -113,15 +169,15 @@ vec3 CalcPointLight(Material material, PointLight light, vec3 N, vec3 fragPos, v
     vec3 diffuse = K_D * max(dot(N, L), 0.0) * light.diffuse;
     vec3 specular = K_S * pow(max(dot(V, R), 0.0), material.shininess) * light.specular;
     
-    ambient *= attenuation;
-    diffuse *= attenuation;
-    specular *= attenuation;
+    ambient *= attenuation * occlusion;
+    diffuse *= attenuation * shadow;
+    specular *= attenuation * shadow;
     
     return (ambient + diffuse + specular);
 }
 
 // calculates the color when using a spot light.
-vec3 CalcSpotLight(Material material, SpotLight light, vec3 N, vec3 fragPos, vec3 V)
+vec3 CalcSpotLight(Material material, SpotLight light, vec3 N, vec3 fragPos, vec3 V, float shadow, float occlusion)
 {
     vec3 L = normalize(light.position - fragPos);
     vec3 R = reflect(-L, N);
@@ -144,9 +200,91 @@ vec3 CalcSpotLight(Material material, SpotLight light, vec3 N, vec3 fragPos, vec
     vec3 diffuse = K_D * max(dot(N, L), 0.0) * light.diffuse;
     vec3 specular = K_S * pow(max(dot(V, R), 0.0), material.shininess) * light.specular;
     
-    ambient *= attenuation * intensity;
-    diffuse *= attenuation * intensity;
-    specular *= attenuation * intensity;
+    ambient *= attenuation * intensity * occlusion;
+    diffuse *= attenuation * intensity * shadow;
+    specular *= attenuation * intensity * shadow;
     
     return (ambient + diffuse + specular);
 }
+
+// fraction of the directional light reaching fragPos, 3x3 PCF in the cascade covering it
+float CalcDirShadow(vec3 fragPos, vec3 N)
+{
+    if(!shadowsOn)
+        return 1.0;
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    int cascade = cascadeCount;
+    for(int i = 0; i < cascadeCount; i++)
+    {
+        if(depth < cascadeSplits[i])
+        {
+            cascade = i;
+            break;
+        }
+    }
+    // beyond the shadow distance
+    if(cascade == cascadeCount)
+        return 1.0;
+    
+    // normal offset grows with the cascade, whose texels grow too
+    vec4 lightSpace = dirLightSpaceMatrices[cascade] * vec4(fragPos + N * 0.01 * float(cascade + 1), 1.0);
+    vec3 p = lightSpace.xyz / lightSpace.w * 0.5 + 0.5;
+    if(p.z > 1.0)
+        return 1.0;
+    
+    vec2 texelSize = 1.0 / vec2(textureSize(dirShadowMap, 0).xy);
+    float lit = 0.0;
+    for(int x = -1; x <= 1; x++)
+        for(int y = -1; y <= 1; y++)
+            lit += texture(dirShadowMap, vec4(p.xy + vec2(x, y) * texelSize, float(cascade), p.z));
+    return lit / 9.0;
+}
+
+// fraction of the spot light reaching fragPos, 3x3 PCF
+float CalcSpotShadow(vec3 fragPos, vec3 N)
+{
+    if(!shadowsOn)
+        return 1.0;
+    vec4 lightSpace = spotLightSpaceMatrix * vec4(fragPos + N * 0.01, 1.0);
+    if(lightSpace.w <= 0.0)
+        return 1.0;
+    vec3 p = lightSpace.xyz / lightSpace.w * 0.5 + 0.5;
+    if(p.z > 1.0)
+        return 1.0;
+    
+    vec2 texelSize = 1.0 / vec2(textureSize(spotShadowMap, 0));
+    float lit = 0.0;
+    for(int x = -1; x <= 1; x++)
+        for(int y = -1; y <= 1; y++)
+            lit += texture(spotShadowMap, vec3(p.xy + vec2(x, y) * texelSize, p.z));
+    return lit / 9.0;
+}
+
+// fraction of a point light reaching fragPos; farPlane 0 means the light has no shadow map
+float CalcPointShadow(samplerCubeShadow shadowMap, vec3 lightPos, float farPlane, vec3 fragPos, vec3 N)
+{
+    if(!shadowsOn || farPlane <= 0.0)
+        return 1.0;
+    vec3 toFrag = fragPos + N * 0.02 - lightPos;
+    float d = length(toFrag);
+    if(d >= farPlane)
+        return 1.0;
+    
+    // 8 taps around the direction, offsets grow with distance so the kernel keeps its angular size
+    float ref = d / farPlane - 0.002;
+    float offset = d * 0.005;
+    float lit = 0.0;
+    for(int x = -1; x <= 1; x += 2)
+        for(int y = -1; y <= 1; y += 2)
+            for(int z = -1; z <= 1; z += 2)
+                lit += texture(shadowMap, vec4(toFrag + vec3(x, y, z) * offset, ref));
+    return lit / 8.0;
+}
+
+// fraction of the ambient light reaching this pixel, from the screen-space occlusion
+float CalcAmbientOcclusion()
+{
+    if(!ssaoOn)
+        return 1.0;
+    return texelFetch(ssaoMap, ivec2(gl_FragCoord.xy), 0).r;
+}
@@ -0,0 +1,75 @@
+#version 330 core
+out vec4 FragColor;
+
+#define KERNEL_SIZE 16
+
+uniform sampler2D linearDepth;      // half resolution view space distance, 0 where nothing was drawn
+uniform sampler2D normalMap;        // world space G-buffer normals at full resolution
+uniform sampler2D noise;            // 4x4 tile of random vectors that rotate the kernel
+uniform bool useNormalMap;          // otherwise the normal is rebuilt from the depth
+uniform mat4 projection;
+uniform mat4 view;
+uniform vec3 samples[KERNEL_SIZE];  // hemisphere around +z, denser near the center
+uniform float radius;
+uniform float bias;
+
+ivec2 depthSize;
+
+// view space position of a half resolution texel
+vec3 viewPosition(ivec2 texel, float depth)
+{
+    vec2 ndc = (vec2(texel) + 0.5) / vec2(depthSize) * 2.0 - 1.0;
+    return vec3(ndc * depth / vec2(projection[0][0], projection[1][1]), -depth);
+}
+
+vec3 viewPosition(ivec2 texel)
+{
+    texel = clamp(texel, ivec2(0), depthSize - 1);
+    return viewPosition(texel, texelFetch(linearDepth, texel, 0).r);
+}
+
+// from the neighbour on the side closer in depth along each axis, so a silhouette does not bend it
+vec3 reconstructNormal(ivec2 texel, vec3 P)
+{
+    vec3 right = viewPosition(texel + ivec2(1, 0)) - P;
+    vec3 left = P - viewPosition(texel - ivec2(1, 0));
+    vec3 up = viewPosition(texel + ivec2(0, 1)) - P;
+    vec3 down = P - viewPosition(texel - ivec2(0, 1));
+    vec3 dx = abs(right.z) < abs(left.z) ? right : left;
+    vec3 dy = abs(up.z) < abs(down.z) ? up : down;
+    return normalize(cross(dx, dy));
+}
+
+void main()
+{
+    depthSize = textureSize(linearDepth, 0);
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(linearDepth, texel, 0).r;
+    if(depth <= 0.0)
+    {
+        FragColor = vec4(1.0);
+        return;
+    }
+    
+    vec3 P = viewPosition(texel, depth);
+    vec3 N = useNormalMap ? normalize(mat3(view) * texelFetch(normalMap, texel * 2, 0).xyz) : reconstructNormal(texel, P);
+    
+    // the random vector, made orthogonal to N, turns the kernel around the normal
+    vec3 randomVec = texelFetch(noise, texel & 3, 0).xyz;
+    vec3 T = normalize(randomVec - N * dot(randomVec, N));
+    mat3 TBN = mat3(T, cross(N, T), N);
+    
+    float occlusion = 0.0;
+    for(int i = 0; i < KERNEL_SIZE; i++)
+    {
+        vec3 S = P + TBN * samples[i] * radius;
+        vec4 clip = projection * vec4(S, 1.0);
+        ivec2 sampleTexel = clamp(ivec2((clip.xy / clip.w * 0.5 + 0.5) * vec2(depthSize)), ivec2(0), depthSize - 1);
+        float sceneDepth = texelFetch(linearDepth, sampleTexel, 0).r;
+        // the surface seen there is in front of the sample; far in front it is another object and fades out
+        float rangeCheck = smoothstep(0.0, 1.0, radius / abs(depth - sceneDepth));
+        if(sceneDepth > 0.0 && sceneDepth <= -S.z - bias)
+            occlusion += rangeCheck;
+    }
+    FragColor = vec4(1.0 - occlusion / float(KERNEL_SIZE));
+}
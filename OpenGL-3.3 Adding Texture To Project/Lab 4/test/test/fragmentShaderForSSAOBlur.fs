@@ -0,0 +1,33 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D occlusion;        // half resolution, noisy
+uniform sampler2D linearDepth;      // half resolution view space distance, 0 where nothing was drawn
+uniform float depthTolerance;       // relative depth difference still counted as the same surface
+
+// average over one 4x4 noise tile, which cancels the kernel rotations, leaving out
+// texels on other surfaces so occlusion does not bleed across silhouettes
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    ivec2 size = textureSize(occlusion, 0);
+    float depth = texelFetch(linearDepth, texel, 0).r;
+    if(depth <= 0.0)
+    {
+        FragColor = vec4(1.0);
+        return;
+    }
+    
+    float sum = 0.0;
+    float weight = 0.0;
+    for(int x = -2; x < 2; x++)
+        for(int y = -2; y < 2; y++)
+        {
+            ivec2 t = clamp(texel + ivec2(x, y), ivec2(0), size - 1);
+            float w = max(0.0, 1.0 - abs(texelFetch(linearDepth, t, 0).r - depth) / (depthTolerance * depth));
+            sum += texelFetch(occlusion, t, 0).r * w;
+            weight += w;
+        }
+    // the center always has weight 1
+    FragColor = vec4(sum / weight);
+}
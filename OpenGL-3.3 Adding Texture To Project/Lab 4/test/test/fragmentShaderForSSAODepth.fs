@@ -0,0 +1,18 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D depthMap;         // full resolution depth buffer
+uniform vec2 depthParameters;       // projection[2][2], projection[3][2]
+
+// half resolution view space distance, 0 where nothing was drawn; one full resolution
+// texel per 2x2 block, so the depth is that of a real surface and not an average across an edge
+void main()
+{
+    float depth = texelFetch(depthMap, ivec2(gl_FragCoord.xy) * 2, 0).r;
+    if(depth == 1.0)
+    {
+        FragColor = vec4(0.0);
+        return;
+    }
+    FragColor = vec4(depthParameters.y / (depth * 2.0 - 1.0 + depthParameters.x));
+}
@@ -0,0 +1,49 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D occlusion;        // half resolution, blurred
+uniform sampler2D linearDepth;      // half resolution view space distance, 0 where nothing was drawn
+uniform sampler2D depthMap;         // full resolution depth buffer
+uniform vec2 depthParameters;       // projection[2][2], projection[3][2]
+uniform float depthTolerance;
+
+// joint bilateral upsample: the four half resolution texels around the pixel, bilinear
+// weights times how close each one's depth is to the pixel's own
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(depthMap, texel, 0).r;
+    if(depth == 1.0)
+    {
+        FragColor = vec4(1.0);
+        return;
+    }
+    float linear = depthParameters.y / (depth * 2.0 - 1.0 + depthParameters.x);
+    
+    ivec2 size = textureSize(occlusion, 0);
+    vec2 position = (vec2(texel) + 0.5) * 0.5 - 0.5;
+    ivec2 base = ivec2(floor(position));
+    vec2 f = position - vec2(base);
+    float sum = 0.0;
+    float weight = 0.0;
+    float nearest = 1.0;
+    float nearestDelta = 1e30;
+    for(int i = 0; i < 4; i++)
+    {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 t = clamp(base + offset, ivec2(0), size - 1);
+        float value = texelFetch(occlusion, t, 0).r;
+        float delta = abs(texelFetch(linearDepth, t, 0).r - linear);
+        float bilinear = mix(1.0 - f.x, f.x, float(offset.x)) * mix(1.0 - f.y, f.y, float(offset.y));
+        float w = bilinear * max(0.0, 1.0 - delta / (depthTolerance * linear));
+        sum += value * w;
+        weight += w;
+        if(delta < nearestDelta)
+        {
+            nearestDelta = delta;
+            nearest = value;
+        }
+    }
+    // no neighbour on this surface, e.g. a thin edge: the one closest in depth
+    FragColor = vec4(weight > 1e-4 ? sum / weight : nearest);
+}
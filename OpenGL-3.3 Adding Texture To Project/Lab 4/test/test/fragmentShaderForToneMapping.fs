@@ -0,0 +1,35 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D hdrBuffer;
+uniform sampler2D bloomBuffer;
+uniform bool bloomOn;
+uniform float bloomStrength;
+uniform float exposure;
+uniform int toneMapper;     // ToneMapper in postProcess.h: 0 clamp, 1 Reinhard, 2 ACES
+uniform bool lumaInAlpha;   // for the FXAA pass that follows
+
+// Narkowicz's fit of the ACES filmic curve
+vec3 ACESFilm(vec3 x)
+{
+    return clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 0.0, 1.0);
+}
+
+void main()
+{
+    vec3 hdr = texture(hdrBuffer, TexCoords).rgb;
+    if(bloomOn)
+        hdr += texture(bloomBuffer, TexCoords).rgb * bloomStrength;
+    hdr *= exposure;
+    vec3 color;
+    if(toneMapper == 1)
+        color = hdr / (hdr + vec3(1.0));
+    else if(toneMapper == 2)
+        color = ACESFilm(hdr);
+    else
+        color = clamp(hdr, 0.0, 1.0);
+    // the scene's colors are authored for the display, so no gamma is applied, as before
+    FragColor = vec4(color, lumaInAlpha ? dot(color, vec3(0.299, 0.587, 0.114)) : 1.0);
+}
@@ -0,0 +1,39 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D source;       // the frame at the scaled resolution, linear filtered
+
+// Catmull-Rom bicubic in 9 bilinear taps instead of 16 point ones: the middle two
+// weights of each axis are merged into one tap between their texels. Its negative lobes
+// keep edges sharper than a bilinear upscale does.
+void main()
+{
+    vec2 size = vec2(textureSize(source, 0));
+    vec2 samplePos = TexCoords * size;
+    vec2 texPos1 = floor(samplePos - 0.5) + 0.5;
+    vec2 f = samplePos - texPos1;
+    
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+    vec2 w12 = w1 + w2;
+    
+    vec2 texPos0 = (texPos1 - 1.0) / size;
+    vec2 texPos3 = (texPos1 + 2.0) / size;
+    vec2 texPos12 = (texPos1 + w2 / w12) / size;
+    
+    vec3 result = texture(source, vec2(texPos0.x, texPos0.y)).rgb * w0.x * w0.y;
+    result += texture(source, vec2(texPos12.x, texPos0.y)).rgb * w12.x * w0.y;
+    result += texture(source, vec2(texPos3.x, texPos0.y)).rgb * w3.x * w0.y;
+    result += texture(source, vec2(texPos0.x, texPos12.y)).rgb * w0.x * w12.y;
+    result += texture(source, vec2(texPos12.x, texPos12.y)).rgb * w12.x * w12.y;
+    result += texture(source, vec2(texPos3.x, texPos12.y)).rgb * w3.x * w12.y;
+    result += texture(source, vec2(texPos0.x, texPos3.y)).rgb * w0.x * w3.y;
+    result += texture(source, vec2(texPos12.x, texPos3.y)).rgb * w12.x * w3.y;
+    result += texture(source, vec2(texPos3.x, texPos3.y)).rgb * w3.x * w3.y;
+    // the lobes can overshoot below black
+    FragColor = vec4(max(result, 0.0), 1.0);
+}
@@ -0,0 +1,52 @@
+//
+//  frustum.h
+//  test
+//
+
+#ifndef frustum_h
+#define frustum_h
+
+#include <glm/glm.hpp>
+
+// Six clip planes pulled out of a view-projection matrix (Gribb/Hartmann),
+// normalized so plane distances are in world units.
+class Frustum{
+public:
+    glm::vec4 planes[6];    // left, right, bottom, top, near, far; xyz points inside
+    
+    Frustum() {}
+    
+    Frustum(const glm::mat4 &viewProjection)
+    {
+        set(viewProjection);
+    }
+    
+    void set(const glm::mat4 &m)
+    {
+        glm::vec4 row0 = glm::vec4(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1 = glm::vec4(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2 = glm::vec4(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3 = glm::vec4(m[0][3], m[1][3], m[2][3], m[3][3]);
+        
+        planes[0] = row3 + row0;
+        planes[1] = row3 - row0;
+        planes[2] = row3 + row1;
+        planes[3] = row3 - row1;
+        planes[4] = row3 + row2;
+        planes[5] = row3 - row2;
+        for(int i = 0; i < 6; i++)
+            planes[i] = planes[i] / glm::length(glm::vec3(planes[i]));
+    }
+    
+    // bounds: xyz = world center, w = radius
+    bool intersectsSphere(const glm::vec4 &bounds) const
+    {
+        glm::vec3 center = glm::vec3(bounds);
+        for(int i = 0; i < 6; i++)
+            if(glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -bounds.w)
+                return false;
+        return true;
+    }
+};
+
+#endif /* frustum_h */
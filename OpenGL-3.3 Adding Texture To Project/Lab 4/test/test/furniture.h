@@ -0,0 +1,114 @@
+//
+//  furniture.h
+//  test
+//
+
+#ifndef furniture_h
+#define furniture_h
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "shader.h"
+#include "cube.h"
+#include "transformBuffer.h"
+#include "materialBuffer.h"
+
+using namespace std;
+
+// one box of a piece of furniture, in the piece's own space
+struct FurniturePart{
+    glm::vec3 offset;           // bottom center of the box
+    glm::vec3 size;
+    glm::vec3 color;            // ambient and diffuse
+};
+
+// A piece of furniture built from unit cubes. add() puts the parts' transforms next to
+// each other in the transform buffer, each carrying its material index, so the whole
+// piece is one instanced draw of the cube however many materials it has.
+class Furniture{
+public:
+    Furniture(const vector<FurniturePart> &parts)
+    {
+        this->parts = parts;
+        // unit cube [0,1] -> box of the part's size standing on its bottom center
+        for(size_t i = 0; i < parts.size(); i++)
+            localMatrices.push_back(glm::translate(glm::mat4(1.0f), parts[i].offset) * glm::scale(glm::mat4(1.0f), parts[i].size)
+                                    * glm::translate(glm::mat4(1.0f), glm::vec3(-0.5f, 0.0f, -0.5f)));
+    }
+
+    int getPartCount() const
+    {
+        return (int)parts.size();
+    }
+
+    // adds the parts under model, returns the object index of the first one; without a
+    // registry the parts keep material index -1 for drawPerPart()
+    int add(TransformBuffer &transforms, const glm::mat4 &model, MaterialRegistry *materials)
+    {
+        if(materials && materials != registeredWith)
+        {
+            materialIndices.clear();
+            for(size_t i = 0; i < parts.size(); i++)
+                materialIndices.push_back(materials->add(parts[i].color, parts[i].color, glm::vec3(0.5f), 32.0f));
+            registeredWith = materials;
+        }
+        int first = transforms.getCount();
+        for(size_t i = 0; i < parts.size(); i++)
+            transforms.add(model * localMatrices[i], materials ? materialIndices[i] : -1);
+        return first;
+    }
+
+    // every part in one draw, materials from the registry
+    void draw(Shader &lightingShader, Cube &cube, int objectIndex) const
+    {
+        cube.drawCubeWithMaterialBuffer(lightingShader, objectIndex, (int)parts.size());
+    }
+
+    // a draw and four material uniforms per part
+    void drawPerPart(Shader &lightingShader, Cube &cube, int objectIndex) const
+    {
+        for(size_t i = 0; i < parts.size(); i++)
+        {
+            cube.setMaterialisticProperty(parts[i].color, parts[i].color, glm::vec3(0.5f), 32.0f);
+            cube.drawCubeWithMaterialisticProperty(lightingShader, objectIndex + (int)i);
+        }
+    }
+
+    static Furniture makeBed()
+    {
+        float baseHeight = 0.3;
+        float width = 1;
+        float length = 2;
+        float pillowWidth = 0.3;
+        float pillowLength = 0.15;
+        float blanketWidth = 0.8;
+        float blanketLength = 0.7;
+        float headHeight = 0.6;
+        glm::vec3 wood = glm::vec3(0.545, 0.271, 0.075);
+        glm::vec3 pillow = glm::vec3(1.0, 0.647, 0.0);
+
+        vector<FurniturePart> parts;
+        //base
+        parts.push_back({ glm::vec3(0, 0, 0), glm::vec3(width, baseHeight, length), wood });
+        //foam
+        parts.push_back({ glm::vec3(0, baseHeight, 0), glm::vec3(width, 0.06, length), glm::vec3(0.804, 0.361, 0.361) });
+        //pillow 1
+        parts.push_back({ glm::vec3((width/2)-(0.1+pillowWidth/2), baseHeight+1*0.06, (length/2)-(0.025+pillowWidth/2)), glm::vec3(pillowWidth, 0.04, pillowLength), pillow });
+        //pillow 2
+        parts.push_back({ glm::vec3((-width/2)+(0.1+pillowWidth/2), baseHeight+1*0.06, (length/2)-(0.025+pillowWidth/2)), glm::vec3(pillowWidth, 0.04, pillowLength), pillow });
+        //blanket
+        parts.push_back({ glm::vec3(0, baseHeight+1*0.06, -(length/2-0.025)+blanketLength/2), glm::vec3(blanketWidth, 0.015, blanketLength), glm::vec3(0.541, 0.169, 0.886) });
+        //head
+        parts.push_back({ glm::vec3(0, 0, (length/2-0.02/2)+0.02), glm::vec3(width, headHeight, 0.02), wood });
+        return Furniture(parts);
+    }
+
+private:
+    vector<FurniturePart> parts;
+    vector<glm::mat4> localMatrices;
+    vector<int> materialIndices;
+    const MaterialRegistry *registeredWith = NULL;
+};
+
+#endif /* furniture_h */
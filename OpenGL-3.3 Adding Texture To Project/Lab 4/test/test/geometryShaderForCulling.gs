@@ -0,0 +1,18 @@
+#version 330 core
+layout (points) in;
+layout (points, max_vertices = 1) out;
+
+flat in int Visible[];
+flat in int ObjectIndex[];
+
+// captured by transform feedback, one int per surviving instance
+flat out int VisibleObjectIndex;
+
+void main()
+{
+    if(Visible[0] == 0)
+        return;
+    VisibleObjectIndex = ObjectIndex[0];
+    EmitVertex();
+    EndPrimitive();
+}
@@ -0,0 +1,36 @@
+#version 330 core
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 18) out;
+
+uniform mat4 shadowMatrices[6];
+uniform int faceMask;       // bit i set: cube face i is re-rendered this frame
+
+out vec4 FragPos;
+
+void main()
+{
+    for(int face = 0; face < 6; face++)
+    {
+        if((faceMask & (1 << face)) == 0)
+            continue;
+        
+        vec4 clip[3];
+        for(int i = 0; i < 3; i++)
+            clip[i] = shadowMatrices[face] * gl_in[i].gl_Position;
+        // skip triangles entirely outside one side of this face's frustum
+        if((clip[0].x > clip[0].w && clip[1].x > clip[1].w && clip[2].x > clip[2].w) ||
+           (clip[0].x < -clip[0].w && clip[1].x < -clip[1].w && clip[2].x < -clip[2].w) ||
+           (clip[0].y > clip[0].w && clip[1].y > clip[1].w && clip[2].y > clip[2].w) ||
+           (clip[0].y < -clip[0].w && clip[1].y < -clip[1].w && clip[2].y < -clip[2].w))
+            continue;
+        
+        gl_Layer = face;
+        for(int i = 0; i < 3; i++)
+        {
+            FragPos = gl_in[i].gl_Position;
+            gl_Position = clip[i];
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+}
@@ -0,0 +1,246 @@
+//
+//  gpuCulling.h
+//  test
+//
+
+#ifndef gpuCulling_h
+#define gpuCulling_h
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <glm/glm.hpp>
+#include "shader.h"
+#include "frustum.h"
+#include "meshPool.h"
+
+using namespace std;
+
+// how the instances of a GpuCuller are culled
+enum CullMode{
+    CULL_CPU,                   // frustum test on the CPU, survivors uploaded every frame
+    CULL_TRANSFORM_FEEDBACK,    // vertex + geometry shader, survivors captured by transform feedback (GL 3.3)
+    CULL_COMPUTE                // compute shader, survivors counted into an indirect draw command (GL 4.3)
+};
+
+// one instance in the instance buffer; 32 bytes, the std430 layout of the compute shader's struct
+struct CullInstance{
+    glm::vec4 bounds;           // world bounding sphere: xyz = center, w = radius
+    int objectIndex;            // what the instanced draw reads for this instance
+    int padding[3];
+};
+
+const int CULL_WORK_GROUP_SIZE = 64;
+
+// compute shaders, storage buffers and indirect draws are all core in 4.3
+bool isComputeCullingSupported()
+{
+#if defined(GL_VERSION_4_3)
+    return GLAD_GL_VERSION_4_3 != 0;
+#else
+    return false;
+#endif
+}
+
+// Many instances of one pool mesh, culled against the view frustum on the GPU. The
+// instance bounds are uploaded once by setInstances(); every frame cull() compacts the
+// object indices of the instances inside the frustum into one buffer, and draw() issues
+// a single instanced draw over it (vertexShaderForCulledInstances.vs reads the index per
+// instance). With CULL_COMPUTE the survivor count goes straight into the indirect draw
+// command and never reaches the CPU. Transform feedback has no such path before 4.2,
+// so CULL_TRANSFORM_FEEDBACK reads the count back from a query, which waits for the
+// cull pass but nothing else. CULL_CPU is the reference the other two are measured against.
+class GpuCuller{
+public:
+    CullMode mode;
+
+    GpuCuller(MeshPool &pool, int mesh, const string &shaderDirectory) : pool(pool), mesh(mesh)
+    {
+        mode = isComputeCullingSupported() ? CULL_COMPUTE : CULL_TRANSFORM_FEEDBACK;
+        vector<const char*> varyings(1, "VisibleObjectIndex");
+        feedbackShader = new Shader((shaderDirectory + "vertexShaderForCulling.vs").c_str(), (shaderDirectory + "geometryShaderForCulling.gs").c_str(), varyings);
+        if(isComputeCullingSupported())
+            computeShader = new Shader((shaderDirectory + "computeShaderForCulling.cs").c_str());
+
+        glGenBuffers(1, &instanceBuffer);
+        glGenBuffers(1, &visibleBuffer);
+        glGenBuffers(1, &commandBuffer);
+        glGenQueries(1, &primitivesQuery);
+
+        // the instances as points for the transform feedback pass
+        glGenVertexArrays(1, &instanceVAO);
+        glBindVertexArray(instanceVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(CullInstance), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribIPointer(1, 1, GL_INT, sizeof(CullInstance), (void*)offsetof(CullInstance, objectIndex));
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    ~GpuCuller()
+    {
+        delete feedbackShader;
+        delete computeShader;
+        glDeleteVertexArrays(1, &instanceVAO);
+        glDeleteBuffers(1, &instanceBuffer);
+        glDeleteBuffers(1, &visibleBuffer);
+        glDeleteBuffers(1, &commandBuffer);
+        glDeleteQueries(1, &primitivesQuery);
+    }
+
+    // instance i has world bounding sphere bounds[i] and draws object objectIndices[i]
+    void setInstances(const vector<glm::vec4> &bounds, const vector<int> &objectIndices)
+    {
+        instances.resize(bounds.size());
+        for(size_t i = 0; i < bounds.size(); i++)
+        {
+            instances[i].bounds = bounds[i];
+            instances[i].objectIndex = objectIndices[i];
+            instances[i].padding[0] = instances[i].padding[1] = instances[i].padding[2] = 0;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(CullInstance), instances.data(), GL_STATIC_DRAW);
+        // room for every instance to survive
+        glBindBuffer(GL_ARRAY_BUFFER, visibleBuffer);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(int), NULL, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        visibleCount = 0;
+    }
+
+    int getInstanceCount() const
+    {
+        return (int)instances.size();
+    }
+
+    // survivors of the last cull(); -1 with CULL_COMPUTE, whose count stays on the GPU
+    int getVisibleCount() const
+    {
+        return mode == CULL_COMPUTE ? -1 : visibleCount;
+    }
+
+    // compacts the object indices of the instances inside the frustum of viewProjection
+    void cull(const glm::mat4 &viewProjection)
+    {
+        if(instances.empty())
+            return;
+        Frustum frustum(viewProjection);
+        if(mode == CULL_CPU)
+        {
+            visibleObjects.clear();
+            for(size_t i = 0; i < instances.size(); i++)
+                if(frustum.intersectsSphere(instances[i].bounds))
+                    visibleObjects.push_back(instances[i].objectIndex);
+            visibleCount = (int)visibleObjects.size();
+            glBindBuffer(GL_ARRAY_BUFFER, visibleBuffer);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, visibleObjects.size() * sizeof(int), visibleObjects.data());
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        else if(mode == CULL_TRANSFORM_FEEDBACK)
+            cullWithTransformFeedback(frustum);
+        else
+            cullWithCompute(frustum);
+    }
+
+    // one instanced draw of the mesh over the survivors of the last cull()
+    void draw(Shader &shader)
+    {
+        if(instances.empty())
+            return;
+        const PoolMesh &m = pool.getMesh(mesh);
+        shader.use();
+        pool.bind();
+        glBindBuffer(GL_ARRAY_BUFFER, visibleBuffer);
+        glVertexAttribIPointer(DRAW_OBJECT_LOCATION, 1, GL_INT, 0, (void*)0);
+        glVertexAttribDivisor(DRAW_OBJECT_LOCATION, 1);
+        glEnableVertexAttribArray(DRAW_OBJECT_LOCATION);
+#if defined(GL_VERSION_4_3)
+        if(mode == CULL_COMPUTE)
+        {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            glBindVertexArray(0);
+            return;
+        }
+#endif
+        if(visibleCount > 0)
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, m.indexCount, GL_UNSIGNED_INT, (void*)(size_t)(m.firstIndex * sizeof(unsigned int)), visibleCount, m.baseVertex);
+        glBindVertexArray(0);
+    }
+
+private:
+    MeshPool &pool;
+    int mesh;
+    Shader *feedbackShader = NULL;
+    Shader *computeShader = NULL;
+    vector<CullInstance> instances;     // CPU copy, read by CULL_CPU only
+    vector<int> visibleObjects;
+    int visibleCount = 0;
+    unsigned int instanceVAO = 0;
+    unsigned int instanceBuffer = 0;
+    unsigned int visibleBuffer = 0;     // object index per survivor
+    unsigned int commandBuffer = 0;     // DrawElementsIndirectCommand, CULL_COMPUTE only
+    unsigned int primitivesQuery = 0;
+
+    GpuCuller(const GpuCuller&);
+    GpuCuller& operator=(const GpuCuller&);
+
+    void setFrustumPlanes(Shader &shader, const Frustum &frustum)
+    {
+        glUniform4fv(glGetUniformLocation(shader.ID, "frustumPlanes"), 6, &frustum.planes[0][0]);
+    }
+
+    void cullWithTransformFeedback(const Frustum &frustum)
+    {
+        feedbackShader->use();
+        setFrustumPlanes(*feedbackShader, frustum);
+        glEnable(GL_RASTERIZER_DISCARD);
+        glBindVertexArray(instanceVAO);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, visibleBuffer);
+        glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, primitivesQuery);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, (GLsizei)instances.size());
+        glEndTransformFeedback();
+        glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glBindVertexArray(0);
+        glDisable(GL_RASTERIZER_DISCARD);
+
+        GLuint count = 0;
+        glGetQueryObjectuiv(primitivesQuery, GL_QUERY_RESULT, &count);
+        visibleCount = (int)count;
+    }
+
+    void cullWithCompute(const Frustum &frustum)
+    {
+#if defined(GL_VERSION_4_3)
+        // a fresh command for the mesh with no instances, the shader counts them up
+        const PoolMesh &m = pool.getMesh(mesh);
+        DrawElementsIndirectCommand command;
+        command.count = m.indexCount;
+        command.instanceCount = 0;
+        command.firstIndex = m.firstIndex;
+        command.baseVertex = m.baseVertex;
+        command.baseInstance = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(command), &command, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        computeShader->use();
+        setFrustumPlanes(*computeShader, frustum);
+        glUniform1ui(glGetUniformLocation(computeShader->ID, "instanceTotal"), (GLuint)instances.size());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visibleBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, commandBuffer);
+        glDispatchCompute((GLuint)((instances.size() + CULL_WORK_GROUP_SIZE - 1) / CULL_WORK_GROUP_SIZE), 1, 1);
+        // the draw reads the survivors as vertex attributes and the count as its command
+        glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+#endif
+    }
+};
+
+#endif /* gpuCulling_h */
@@ -0,0 +1,361 @@
+//
+//  json.h
+//  test
+//
+
+#ifndef json_h
+#define json_h
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <glm/glm.hpp>
+
+using namespace std;
+
+// A parsed JSON document. Objects keep their keys in file order; lookups of keys
+// or elements that are not there return a null value, so optional fields read as
+// value["key"].getNumber(default) without checks.
+class JsonValue{
+public:
+    enum Type{ JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+    JsonValue() {}
+
+    Type getType() const
+    {
+        return type;
+    }
+
+    bool isNull() const { return type == JSON_NULL; }
+    bool isNumber() const { return type == JSON_NUMBER; }
+    bool isString() const { return type == JSON_STRING; }
+    bool isArray() const { return type == JSON_ARRAY; }
+    bool isObject() const { return type == JSON_OBJECT; }
+
+    bool getBool(bool fallback = false) const
+    {
+        return type == JSON_BOOL ? boolean : fallback;
+    }
+
+    double getNumber(double fallback = 0.0) const
+    {
+        return type == JSON_NUMBER ? number : fallback;
+    }
+
+    const string& getString() const
+    {
+        return text;
+    }
+
+    string getString(const string &fallback) const
+    {
+        return type == JSON_STRING ? text : fallback;
+    }
+
+    // [x, y, z]
+    glm::vec3 getVec3(const glm::vec3 &fallback) const
+    {
+        if(type != JSON_ARRAY || elements.size() != 3)
+            return fallback;
+        return glm::vec3(elements[0].getNumber(), elements[1].getNumber(), elements[2].getNumber());
+    }
+
+    // elements of an array, members of an object
+    size_t size() const
+    {
+        return type == JSON_OBJECT ? members.size() : elements.size();
+    }
+
+    const JsonValue& operator[](size_t i) const
+    {
+        return i < elements.size() ? elements[i] : getNull();
+    }
+
+    const JsonValue& operator[](const string &key) const
+    {
+        for(size_t i = 0; i < members.size(); i++)
+            if(members[i].first == key)
+                return members[i].second;
+        return getNull();
+    }
+
+    bool has(const string &key) const
+    {
+        return !(*this)[key].isNull();
+    }
+
+    const string& getKey(size_t i) const
+    {
+        return members[i].first;
+    }
+
+    // parses text into root; prints the line of the first error
+    static bool parse(const string &text, JsonValue &root, const string &name = "json")
+    {
+        Parser parser = { text.c_str(), text.c_str() + text.size(), text.c_str(), "" };
+        parser.skipSpace();
+        bool parsed = parser.parseValue(root, 0);
+        parser.skipSpace();
+        if(parsed && parser.p != parser.end)
+        {
+            parsed = false;
+            parser.error = "unexpected text after the document";
+        }
+        if(!parsed)
+        {
+            int line = 1;
+            for(const char *c = parser.start; c < parser.p; c++)
+                line += *c == '\n';
+            cout << name << ":" << line << ": " << parser.error << endl;
+        }
+        return parsed;
+    }
+
+private:
+    Type type = JSON_NULL;
+    bool boolean = false;
+    double number = 0.0;
+    string text;
+    vector<JsonValue> elements;
+    vector<pair<string, JsonValue> > members;
+
+    static const JsonValue& getNull()
+    {
+        static JsonValue null;
+        return null;
+    }
+
+    struct Parser{
+        const char *p;
+        const char *end;
+        const char *start;
+        const char *error;
+
+        void skipSpace()
+        {
+            while(p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+                p++;
+        }
+
+        bool fail(const char *message)
+        {
+            error = message;
+            return false;
+        }
+
+        bool literal(const char *word)
+        {
+            size_t length = strlen(word);
+            if((size_t)(end - p) < length || strncmp(p, word, length) != 0)
+                return false;
+            p += length;
+            return true;
+        }
+
+        bool parseValue(JsonValue &value, int depth)
+        {
+            if(depth > 256)
+                return fail("nested too deeply");
+            if(p >= end)
+                return fail("unexpected end of the document");
+            if(*p == '{')
+                return parseObject(value, depth);
+            if(*p == '[')
+                return parseArray(value, depth);
+            if(*p == '"')
+            {
+                value.type = JSON_STRING;
+                return parseString(value.text);
+            }
+            if(literal("true"))
+            {
+                value.type = JSON_BOOL;
+                value.boolean = true;
+                return true;
+            }
+            if(literal("false"))
+            {
+                value.type = JSON_BOOL;
+                return true;
+            }
+            if(literal("null"))
+                return true;
+            if(*p == '-' || (*p >= '0' && *p <= '9'))
+            {
+                // strtod stops at the first character that is not part of the number
+                char *numberEnd;
+                value.type = JSON_NUMBER;
+                value.number = strtod(p, &numberEnd);
+                p = numberEnd;
+                return true;
+            }
+            return fail("expected a value");
+        }
+
+        bool parseString(string &out)
+        {
+            for(p++; p < end && *p != '"'; p++)
+            {
+                if(*p != '\\')
+                {
+                    out += *p;
+                    continue;
+                }
+                if(++p >= end)
+                    break;
+                switch(*p)
+                {
+                    case 'n': out += '\n'; break;
+                    case 't': out += '\t'; break;
+                    case 'r': out += '\r'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'u':
+                    {
+                        // paths and names are ASCII, other code points are kept as UTF-8
+                        if(end - p < 5)
+                            return fail("bad \\u escape");
+                        unsigned int c = (unsigned int)strtoul(string(p + 1, p + 5).c_str(), NULL, 16);
+                        if(c < 0x80)
+                            out += (char)c;
+                        else if(c < 0x800)
+                        {
+                            out += (char)(0xC0 | (c >> 6));
+                            out += (char)(0x80 | (c & 0x3F));
+                        }
+                        else
+                        {
+                            out += (char)(0xE0 | (c >> 12));
+                            out += (char)(0x80 | ((c >> 6) & 0x3F));
+                            out += (char)(0x80 | (c & 0x3F));
+                        }
+                        p += 4;
+                        break;
+                    }
+                    default: out += *p; break;
+                }
+            }
+            if(p >= end)
+                return fail("unterminated string");
+            p++;
+            return true;
+        }
+
+        bool parseArray(JsonValue &value, int depth)
+        {
+            value.type = JSON_ARRAY;
+            p++;
+            skipSpace();
+            if(p < end && *p == ']')
+            {
+                p++;
+                return true;
+            }
+            while(true)
+            {
+                value.elements.push_back(JsonValue());
+                skipSpace();
+                if(!parseValue(value.elements.back(), depth + 1))
+                    return false;
+                skipSpace();
+                if(p < end && *p == ',')
+                {
+                    p++;
+                    continue;
+                }
+                if(p < end && *p == ']')
+                {
+                    p++;
+                    return true;
+                }
+                return fail("expected ',' or ']'");
+            }
+        }
+
+        bool parseObject(JsonValue &value, int depth)
+        {
+            value.type = JSON_OBJECT;
+            p++;
+            skipSpace();
+            if(p < end && *p == '}')
+            {
+                p++;
+                return true;
+            }
+            while(true)
+            {
+                skipSpace();
+                if(p >= end || *p != '"')
+                    return fail("expected a key");
+                value.members.push_back(make_pair(string(), JsonValue()));
+                if(!parseString(value.members.back().first))
+                    return false;
+                skipSpace();
+                if(p >= end || *p != ':')
+                    return fail("expected ':'");
+                p++;
+                skipSpace();
+                if(!parseValue(value.members.back().second, depth + 1))
+                    return false;
+                skipSpace();
+                if(p < end && *p == ',')
+                {
+                    p++;
+                    continue;
+                }
+                if(p < end && *p == '}')
+                {
+                    p++;
+                    return true;
+                }
+                return fail("expected ',' or '}'");
+            }
+        }
+    };
+};
+
+// quoted and escaped for a JSON document
+string toJsonString(const string &text)
+{
+    string out = "\"";
+    for(size_t i = 0; i < text.size(); i++)
+    {
+        char c = text[i];
+        if(c == '"' || c == '\\')
+            out += '\\';
+        if(c == '\n')
+            out += "\\n";
+        else if((unsigned char)c < 0x20)
+        {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\u%04x", (unsigned char)c);
+            out += escape;
+        }
+        else
+            out += c;
+    }
+    return out + "\"";
+}
+
+// with enough digits to read back the same float
+string toJsonNumber(float value)
+{
+    char number[32];
+    snprintf(number, sizeof(number), "%.9g", value);
+    return number;
+}
+
+// [x, y, z] with enough digits to read back the same floats
+string toJsonArray(const float *values, int count)
+{
+    string out = "[";
+    for(int i = 0; i < count; i++)
+        out += (i ? ", " : "") + toJsonNumber(values[i]);
+    return out + "]";
+}
+
+#endif /* json_h */
@@ -0,0 +1,33 @@
+//
+//  lightAttenuation.h
+//  test
+//
+
+#ifndef lightAttenuation_h
+#define lightAttenuation_h
+
+#include <cmath>
+#include <glm/glm.hpp>
+
+// lights that fade out closer than this get no light volume and no shadow pass; it is
+// not below the near planes of the spot and point shadow projections
+const float LIGHT_MIN_RADIUS = 0.1f;
+
+// distance at which a light with attenuation 1 / (k_c + k_l * d + k_q * d^2) drops below
+// 5/256 of its brightest diffuse or specular channel, 0 for a light that is dimmer than
+// that everywhere (e.g. switched off)
+float getAttenuationRadius(float k_c, float k_l, float k_q, const glm::vec3 &diffuse, const glm::vec3 &specular)
+{
+    float lightMax = fmaxf(fmaxf(diffuse.x, diffuse.y), diffuse.z);
+    lightMax = fmaxf(lightMax, fmaxf(fmaxf(specular.x, specular.y), specular.z));
+    if(!(lightMax > 0.0f))
+        return 0.0f;
+    if(k_q <= 0.0f)
+        return (k_l > 0.0f) ? fmaxf((256.0f / 5.0f * lightMax - k_c) / k_l, 0.0f) : 100.0f;
+    float discriminant = k_l * k_l - 4.0f * k_q * (k_c - (256.0f / 5.0f) * lightMax);
+    if(discriminant < 0.0f)
+        return 0.0f;
+    return fmaxf((-k_l + sqrtf(discriminant)) / (2.0f * k_q), 0.0f);
+}
+
+#endif /* lightAttenuation_h */
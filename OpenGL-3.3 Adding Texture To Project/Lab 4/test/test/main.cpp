@@ -20,7 +20,20 @@
 #include "directionLight.h"
 #include "cube.h"
 #include "sphere.h"
-#include "stb_image.h"
+#include "scene.h"
+#include "materialBuffer.h"
+#include "meshPool.h"
+#include "furniture.h"
+#include "transformBuffer.h"
+#include "shadowMap.h"
+#include "deferredRenderer.h"
+#include "renderQueue.h"
+#include "postProcess.h"
+#include "ambientOcclusion.h"
+#include "dynamicResolution.h"
+#include "pathTracer.h"
+#include "profiler.h"
+#include "benchmark.h"
 
 #include <iostream>
 
@@ -31,8 +44,8 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow* window);
-unsigned int loadTexture(char const * path, GLenum textureWrappingModeS, GLenum textureWrappingModeT, GLenum textureFilteringModeMin, GLenum textureFilteringModeMax);
-void bed(Shader &lightingShader, glm::mat4 alTogether, Cube &cube);
+void bed(Shader &lightingShader, glm::mat4 alTogether, Cube &cube, TransformBuffer &transforms, MaterialRegistry &materials);
+void applyRenderMode(const string &mode);
 
 
 // settings
@@ -64,78 +77,8 @@ float lookAtX = 0.0, lookAtY = 0.0, lookAtZ = 0.0;
 glm:: vec3 V = glm::vec3(0.0f, 1.0f, 0.0f);
 BasicCamera basic_camera(eyeX, eyeY, eyeZ, lookAtX, lookAtY, lookAtZ, V);
 
-// lights
-DirectionLight dirlight(
-
-    -0.2f, -1.0f, -0.3f,     // position
-    0.05f, 0.05f, 0.05f,     // ambient
-    0.4f, 0.4f, 0.4f,        // diffuse
-    0.5f, 0.5f, 0.5f         // specular
-);
-// positions of the point lights
-glm::vec3 pointLightPositions[] = {
-    glm::vec3( 1.50f,  1.50f,  0.0f),
-    glm::vec3( 1.5f,  -1.5f,  0.0f),
-    glm::vec3(-1.5f,  1.5f,  0.0f),
-    glm::vec3( -1.5f,  -1.5f,  0.0f)
-};
-PointLight pointlight1(
-
-    pointLightPositions[0].x, pointLightPositions[0].y, pointLightPositions[0].z,  // position
-    0.05f, 0.05f, 0.05f,     // ambient
-    0.8f, 0.8f, 0.8f,     // diffuse
-    1.0f, 1.0f, 1.0f,        // specular
-    1.0f,   //k_c
-    0.09f,  //k_l
-    0.032f, //k_q
-    1       // light number
-);
-PointLight pointlight2(
-
-    pointLightPositions[1].x, pointLightPositions[1].y, pointLightPositions[1].z,  // position
-    0.05f, 0.05f, 0.05f,     // ambient
-    0.8f, 0.8f, 0.8f,     // diffuse
-    1.0f, 1.0f, 1.0f,        // specular
-    1.0f,   //k_c
-    0.09f,  //k_l
-    0.032f, //k_q
-    2       // light number
-);
-PointLight pointlight3(
-
-    pointLightPositions[2].x, pointLightPositions[2].y, pointLightPositions[2].z,  // position
-    0.05f, 0.05f, 0.05f,     // ambient
-    0.8f, 0.8f, 0.8f,     // diffuse
-    1.0f, 1.0f, 1.0f,        // specular
-    1.0f,   //k_c
-    0.09f,  //k_l
-    0.032f, //k_q
-    3       // light number
-);
-PointLight pointlight4(
-
-    pointLightPositions[3].x, pointLightPositions[3].y, pointLightPositions[3].z,  // position
-    0.05f, 0.05f, 0.05f,     // ambient
-    0.8f, 0.8f, 0.8f,     // diffuse
-    1.0f, 1.0f, 1.0f,        // specular
-    1.0f,   //k_c
-    0.09f,  //k_l
-    0.032f, //k_q
-    4       // light number
-);
-SpotLight spotlight(
-        
-                    0.0f, 1.1f, 5.2f,  // position
-                    0.0f, 0.0f, -1.0f, // direction
-                    0.0f, 0.0f, 0.0f,  // ambient
-                    1.0f, 1.0f, 1.0f,  // diffuse
-                    1.0f, 1.0f, 1.0f,  // specular
-                    1.0f,   //k_c
-                    0.09f,  //k_l
-                    0.032f, //k_q
-                    12.5f,  //cutoff
-                    15.0f   //outer cutoff
-);
+// lights, meshes, materials and node placements, from --scene <path> (scene.json by default)
+Scene scene;
 
 // light settings
 bool dirLightOn = true;
@@ -145,13 +88,109 @@ bool ambientToggle = true;
 bool diffuseToggle = true;
 bool specularToggle = true;
 
+// render path, toggled with 7
+bool deferredShading = false;
+// depth-only pre-pass before the forward color pass, toggled with 8
+bool depthPrepass = false;
+// untextured cubes and spheres in one glMultiDrawElementsIndirect where the context has it, toggled with backslash
+bool multiDrawIndirect = true;
+// HDR scene target tone mapped into the window, toggled with ;  ' cycles the tone mapper,
+// [ and ] change the exposure, / prints the GPU time of every post-processing and ambient occlusion pass
+bool postProcessing = true;
+int toneMapper = TONE_MAP_ACES;
+float exposure = 1.0f;
+bool reportPasses = false;
+// bloom around the lamps, , cycles off / mip chain / gaussian and . the levels; in HDR the
+// lamps are drawn lampIntensity times brighter, so they cross the bloom threshold
+int bloomMode = BLOOM_MIP_CHAIN;
+int bloomLevels = 5;
+float lampIntensity = 6.0f;
+// anti-aliasing, Tab cycles off / FXAA / 2x / 4x / 8x MSAA; both live in the post-processing chain,
+// and the deferred path stays single sampled since its G-buffer is
+int antiAliasing = AA_OFF;
+// scene resolution between 50% and 100% of the window, whatever holds the GPU frame time under
+// the budget, toggled with F1; it renders into the post-processing chain's target
+bool dynamicResolution = false;
+float frameBudgetMs = 1000.0f / 60.0f;
+// F2 path traces the current view into pathTrace.ppm, a reference for the lighting
+bool pathTraceView = false;
+// screen-space ambient occlusion on the ambient terms, toggled with `; in the forward path it forces the depth pre-pass
+bool ambientOcclusion = true;
+// directional and spot light shadows, toggled with 9; 0 cycles the cascade count, -/= halve/double the resolution
+bool shadowsOn = true;
+int cascadeCount = 4;
+int shadowResolution = 2048;
+
+// actual framebuffer size, larger than the window on retina displays
+int framebufferWidth = SCR_WIDTH;
+int framebufferHeight = SCR_HEIGHT;
+
 
 // timing
 float deltaTime = 0.0f;    // time between current frame and last frame
 float lastFrame = 0.0f;
 
-int main()
+int main(int argc, char **argv)
 {
+    // ./test [--scene <path.json|path.scene>] [mode ...]
+    string scenePath = "scene.json";
+    vector<string> args(argv + 1, argv + argc);
+    if (args.size() >= 2 && args[0] == "--scene")
+    {
+        scenePath = args[1];
+        args.erase(args.begin(), args.begin() + 2);
+    }
+    string benchmark = args.empty() ? string() : args[0];
+    
+    // scene modes that need no window: ./test --compile-scene <in.json> <out.scene>
+    //                                   ./test --bench-scene <node count> <path.json>
+    //                                   ./test --path-trace <out.ppm> [samples] [bounces]
+    //                                   ./test --bench-path-trace [samples]
+    if (benchmark == "--compile-scene" && args.size() > 2)
+    {
+        SceneData data;
+        return (loadSceneData(args[1], data) && writeSceneFile(args[2], data)) ? 0 : -1;
+    }
+    if (benchmark == "--bench-scene" && args.size() > 2)
+    {
+        benchSceneLoad(atoi(args[1].c_str()), args[2]);
+        return 0;
+    }
+    if (benchmark == "--path-trace" && args.size() > 1)
+    {
+        SceneData data;
+        PathTracer tracer;
+        if (!loadSceneData(scenePath, data) || !tracer.load(data))
+            return -1;
+        int samples = args.size() > 2 ? std::max(atoi(args[2].c_str()), 1) : 64;
+        if (args.size() > 3)
+            tracer.maxBounces = std::max(atoi(args[3].c_str()), 0);
+        camera.Position = data.cameraPosition;
+        tracer.resize(SCR_WIDTH, SCR_HEIGHT);
+        tracer.setCamera(camera.Position, camera.Front, camera.Up, camera.Zoom);
+        uint64_t rays = 0;
+        chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+        for (int s = 1; s <= samples; s++)
+        {
+            rays += tracer.renderPass();
+            // the image so far at every power of two, so a long render can be looked at early
+            if ((s & (s - 1)) == 0 || s == samples)
+            {
+                double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+                cout << s << " samples, " << ms / 1000.0 << " s, " << rays / (ms * 1000.0) << " Mrays/s" << endl;
+                if (!tracer.writeImage(args[1]))
+                    return -1;
+            }
+        }
+        tracer.report();
+        return 0;
+    }
+    if (benchmark == "--bench-path-trace")
+    {
+        benchPathTracer(scenePath, args.size() > 1 ? std::max(atoi(args[1].c_str()), 1) : 8);
+        return 0;
+    }
+    
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -177,6 +216,7 @@ int main()
     glfwSetKeyCallback(window, key_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
 
     // tell GLFW to capture our mouse
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
@@ -192,50 +232,152 @@ int main()
     // configure global opengl state
     // -----------------------------
     glEnable(GL_DEPTH_TEST);
+    
+    if (!scene.load(scenePath))
+    {
+        glfwTerminate();
+        return -1;
+    }
+    camera.Position = scene.data.cameraPosition;
+    string shaderDirectory = scene.getShaderDirectory();
 
     // build and compile our shader zprogram
     // ------------------------------------
-    Shader lightingShader("/Users/macbookpro/Desktop/test/test/vertexShaderForLighting.vs", "/Users/macbookpro/Desktop/test/test/fragmentShaderForLighting.fs");
-    //Shader lightingShader("/Users/macbookpro/Desktop/test/test/vertexShaderForGouraudShading.vs", "/Users/macbookpro/Desktop/test/test/fragmentShaderForGouraudShading.fs");
-    Shader lightingShaderWithTexture("/Users/macbookpro/Desktop/test/test/vertexShaderForPhongShadingWithTexture.vs", "/Users/macbookpro/Desktop/test/test/fragmentShaderForPhongShadingWithTexture.fs");
-    Shader ourShader("/Users/macbookpro/Desktop/test/test/vertexShader.vs", "/Users/macbookpro/Desktop/test/test/fragmentShader.fs");
-    
-    string diffuseMapPath = "/Users/macbookpro/Desktop/test/test/container2.png";
-    string specularMapPath = "/Users/macbookpro/Desktop/test/test/container2_specular.png";
-    
-    string diffuseMapPath_emoji = "/Users/macbookpro/Desktop/test/test/emoji.png";
-    string specularMapPath_white_background = "/Users/macbookpro/Desktop/test/test/whiteBackground.png";
-    
-    unsigned int diffMap = loadTexture(diffuseMapPath.c_str(), GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
-    unsigned int specMap = loadTexture(specularMapPath.c_str(), GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
-    Cube cube = Cube(diffMap, specMap, 32.0f, 0.0f, 0.0f, 1.0f, 1.0f);
-    
-    unsigned int diffMap1 = loadTexture(diffuseMapPath.c_str(), GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
-    unsigned int specMap1 = loadTexture(specularMapPath.c_str(), GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
-    Cube cube1 = Cube(diffMap1, specMap1, 32.0f, 0.0f, 0.0f, 2.0f, 2.0f);
-    
-    // GL_MIRRORED_REPEAT
-    unsigned int diffMap2 = loadTexture(diffuseMapPath.c_str(), GL_MIRRORED_REPEAT, GL_MIRRORED_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
-    unsigned int specMap2 = loadTexture(specularMapPath.c_str(), GL_MIRRORED_REPEAT, GL_MIRRORED_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
-    Cube cube2 = Cube(diffMap2, specMap2, 32.0f, 0.0f, 0.0f, 2.0f, 2.0f);
+    Shader lightingShader((shaderDirectory + "vertexShaderForLighting.vs").c_str(), (shaderDirectory + "fragmentShaderForLighting.fs").c_str());
+    //Shader lightingShader((shaderDirectory + "vertexShaderForGouraudShading.vs").c_str(), (shaderDirectory + "fragmentShaderForGouraudShading.fs").c_str());
+    Shader lightingShaderWithTexture((shaderDirectory + "vertexShaderForPhongShadingWithTexture.vs").c_str(), (shaderDirectory + "fragmentShaderForPhongShadingWithTexture.fs").c_str());
+    Shader ourShader((shaderDirectory + "vertexShader.vs").c_str(), (shaderDirectory + "fragmentShader.fs").c_str());
+    // geometry pass of the deferred path, writes the G-buffer instead of lighting
+    Shader geometryPassShader((shaderDirectory + "vertexShaderForLighting.vs").c_str(), (shaderDirectory + "fragmentShaderForGeometryPass.fs").c_str());
+    // position-only program for the depth pre-pass
+    Shader depthShader((shaderDirectory + "vertexShader.vs").c_str(), (shaderDirectory + "fragmentShaderForDepth.fs").c_str());
+    // position-only programs that render shadow casters from a light; the point light one
+    // writes all six cube faces in one pass through a geometry shader
+    Shader pointShadowShader((shaderDirectory + "vertexShaderForPointShadow.vs").c_str(), (shaderDirectory + "fragmentShaderForPointShadow.fs").c_str(), (shaderDirectory + "geometryShaderForPointShadow.gs").c_str());
+    Shader shadowDepthShader((shaderDirectory + "vertexShaderForShadowDepth.vs").c_str(), (shaderDirectory + "fragmentShaderForDepth.fs").c_str());
+    Shader geometryPassShaderWithTexture((shaderDirectory + "vertexShaderForPhongShadingWithTexture.vs").c_str(), (shaderDirectory + "fragmentShaderForGeometryPassWithTexture.fs").c_str());
+    // lighting and geometry pass programs for pooled meshes, object index per draw instead of a uniform
+    Shader multiDrawLightingShader((shaderDirectory + "vertexShaderForMultiDraw.vs").c_str(), (shaderDirectory + "fragmentShaderForLighting.fs").c_str());
+    Shader multiDrawGeometryPassShader((shaderDirectory + "vertexShaderForMultiDraw.vs").c_str(), (shaderDirectory + "fragmentShaderForGeometryPass.fs").c_str());
     
-    // GL_CLAMP_TO_EDGE
-    unsigned int diffMap3 = loadTexture(diffuseMapPath.c_str(), GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
-    unsigned int specMap3 = loadTexture(specularMapPath.c_str(), GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
-    Cube cube3 = Cube(diffMap3, specMap3, 32.0f, 0.0f, 0.0f, 2.0f, 2.0f);
+    // lamps are drawn at the point lights with a plain cube
+    Cube lamp;
     
-    // GL_NEAREST
-    unsigned int diffMap4 = loadTexture(diffuseMapPath_emoji.c_str(), GL_REPEAT, GL_REPEAT, GL_NEAREST, GL_NEAREST);
-    unsigned int specMap4 = loadTexture(specularMapPath_white_background.c_str(), GL_REPEAT, GL_REPEAT, GL_NEAREST, GL_NEAREST);
-    Cube cube4 = Cube(diffMap4, specMap4, 32.0f, 0.0f, 0.0f, 1.0f, 1.0f);
     
-    // GL_LINEAR
-    unsigned int diffMap5 = loadTexture(diffuseMapPath_emoji.c_str(), GL_REPEAT, GL_REPEAT, GL_LINEAR, GL_LINEAR);
-    unsigned int specMap5 = loadTexture(specularMapPath_white_background.c_str(), GL_REPEAT, GL_REPEAT, GL_LINEAR, GL_LINEAR);
-    Cube cube5 = Cube(diffMap5, specMap5, 32.0f, 0.0f, 0.0f, 1.0f, 1.0f);
+    //Sphere sphere = Sphere();
     
+    // per-object transforms of the frame, uploaded once and indexed by the vertex shaders
+    TransformBuffer transforms;
+    // untextured materials, drawn by index from one uniform buffer
+    MaterialRegistry materials;
+    scene.registerMaterials(materials);
+    // the scene's cubes and spheres in one mesh pool, so a pass can draw them with one call
+    MeshPool meshPool;
+    scene.registerMeshes(meshPool);
+    MultiDrawList multiDraw(meshPool);
+    if (!multiDraw.useIndirect)
+        cout << "multi-draw indirect not supported, drawing one object at a time" << endl;
+    Profiler profiler;
+    RenderQueue opaqueQueue;
+    DeferredRenderer deferred(framebufferWidth, framebufferHeight, shaderDirectory);
+    PostProcessChain post(shaderDirectory, profiler);
+    AmbientOcclusion ssao(shaderDirectory, profiler);
+    DynamicResolution resolution;
+    ShadowRenderer shadows(shadowResolution, cascadeCount);
     
-    //Sphere sphere = Sphere();
+    // benchmark modes: ./test --bench-vertex
+    //                  ./test --bench-sphere-lod
+    //                  ./test --bench-vertex-format
+    //                  ./test --bench-materials
+    //                  ./test --bench-multi-draw
+    //                  ./test --bench-gpu-culling
+    //                  ./test --bench-bloom
+    //                  ./test --bench-sphere-generation
+    //                  ./test --bench-mesh-cache
+    //                  ./test --bench-vertex-cache
+    //                  ./test --bench-mesh-file <path>
+    //                  ./test --bench-import <path.obj|path.ply>
+    //                  ./test --bench-replay forward deferred prepass+shadows ...
+    BenchmarkReplay replay;
+    if (args.size() > 1 && benchmark == "--bench-replay")
+    {
+        replay.start(vector<string>(args.begin() + 1, args.end()));
+        glfwSwapInterval(0);
+    }
+    if (benchmark == "--bench-sphere-generation")
+    {
+        benchSphereGeneration();
+        glfwTerminate();
+        return 0;
+    }
+    if (benchmark == "--bench-mesh-file" && args.size() > 1)
+    {
+        benchMeshFile(args[1]);
+        glfwTerminate();
+        return 0;
+    }
+    if (benchmark == "--bench-import" && args.size() > 1)
+    {
+        benchImport(args[1]);
+        glfwTerminate();
+        return 0;
+    }
+    if (benchmark == "--bench-vertex-cache")
+    {
+        benchVertexCache();
+        glfwTerminate();
+        return 0;
+    }
+    if (benchmark == "--bench-mesh-cache")
+    {
+        benchMeshCache();
+        glfwTerminate();
+        return 0;
+    }
+    if (benchmark == "--bench-multi-draw")
+    {
+        scene.setUpLights(lightingShader);
+        scene.setUpLights(multiDrawLightingShader);
+        shadows.enabled = false;
+        shadows.setUpShadows(lightingShader, glm::mat4(1.0f));
+        shadows.setUpShadows(multiDrawLightingShader, glm::mat4(1.0f));
+        benchMultiDraw(window, lightingShader, multiDrawLightingShader, transforms, profiler);
+        glfwTerminate();
+        return 0;
+    }
+    if (benchmark == "--bench-gpu-culling")
+    {
+        // instances culled on the GPU, drawn with transforms uploaded once
+        Shader culledInstanceShader((shaderDirectory + "vertexShaderForCulledInstances.vs").c_str(), (shaderDirectory + "fragmentShaderForLighting.fs").c_str());
+        scene.setUpLights(culledInstanceShader);
+        shadows.enabled = false;
+        shadows.setUpShadows(culledInstanceShader, glm::mat4(1.0f));
+        benchGpuCulling(window, culledInstanceShader, shaderDirectory, profiler);
+        glfwTerminate();
+        return 0;
+    }
+    if (benchmark == "--bench-bloom")
+    {
+        benchBloom(window, post, profiler);
+        glfwTerminate();
+        return 0;
+    }
+    if (benchmark == "--bench-vertex" || benchmark == "--bench-sphere-lod" || benchmark == "--bench-vertex-format" || benchmark == "--bench-materials")
+    {
+        scene.setUpLights(lightingShader);
+        shadows.enabled = false;
+        shadows.setUpShadows(lightingShader, glm::mat4(1.0f));
+        if (benchmark == "--bench-vertex")
+            benchVertexThroughput(window, lightingShader, transforms, profiler);
+        else if (benchmark == "--bench-vertex-format")
+            benchVertexFormat(window, lightingShader, transforms, profiler);
+        else if (benchmark == "--bench-materials")
+            benchMaterials(window, lightingShader, transforms, profiler);
+        else
+            benchSphereLod(window, lightingShader, transforms, profiler);
+        glfwTerminate();
+        return 0;
+    }
 
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
@@ -253,6 +395,28 @@ int main()
         // input
         // -----
         processInput(window);
+        
+        // a compiled scene streams in a batch of nodes per frame until it is complete
+        scene.update();
+        
+        // a benchmark replay drives the camera and the render mode instead of the user
+        if (replay.isActive())
+        {
+            replay.update(camera, profiler);
+            if (!replay.isActive())
+                break;
+            applyRenderMode(replay.getMode());
+        }
+        
+        profiler.beginFrame();
+        profiler.begin("frame");
+        
+        // the scene's size follows the GPU time of the frames resolved so far
+        resolution.enabled = dynamicResolution && postProcessing;
+        resolution.budgetMs = frameBudgetMs;
+        resolution.update(profiler.getLastGpuTime("frame"));
+        int renderWidth, renderHeight;
+        resolution.getRenderSize(framebufferWidth, framebufferHeight, renderWidth, renderHeight);
 
         // render
         // ------
@@ -263,20 +427,13 @@ int main()
         lightingShader.use();
         lightingShader.setVec3("viewPos", camera.Position);
         
-        // directional light
-        dirlight.setUpDirectionLight(lightingShader);
-        // point light 1
-        pointlight1.setUpPointLight(lightingShader);
-        // point light 2
-        pointlight2.setUpPointLight(lightingShader);
-        // point light 3
-        pointlight3.setUpPointLight(lightingShader);
-        // point light 4
-        pointlight4.setUpPointLight(lightingShader);
-        // spotLight
-        spotlight.position = camera.Position;
-        spotlight.direction = camera.Front;
-        spotlight.setUpSpotLight(lightingShader);
+        // directional, point and spot lights of the scene
+        if (scene.data.spotLightFollowsCamera)
+        {
+            scene.data.spotLight.position = camera.Position;
+            scene.data.spotLight.direction = camera.Front;
+        }
+        scene.setUpLights(lightingShader);
         
         // activate shader
         lightingShader.use();
@@ -284,12 +441,13 @@ int main()
         // pass projection matrix to shader (note that in this case it could change every frame)
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
         //glm::mat4 projection = glm::ortho(-2.0f, +2.0f, -1.5f, +1.5f, 0.1f, 100.0f);
-        lightingShader.setMat4("projection", projection);
 
         // camera/view transformation
         glm::mat4 view = camera.GetViewMatrix();
         //glm::mat4 view = basic_camera.createViewMatrix();
-        lightingShader.setMat4("view", view);
+        
+        // all per-object transforms of this frame are collected first and uploaded once
+        transforms.begin(view, projection);
 
         // Modelling Transformation
         glm::mat4 identityMatrix = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
@@ -300,75 +458,276 @@ int main()
         rotateZMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Z), glm::vec3(0.0f, 0.0f, 1.0f));
         scaleMatrix = glm::scale(identityMatrix, glm::vec3(scale_X, scale_Y, scale_Z));
         model = translateMatrix * rotateXMatrix * rotateYMatrix * rotateZMatrix * scaleMatrix;
-        lightingShader.setMat4("model", model);
         
-        //bed(lightingShader, model, cube);
+        // scene nodes, queued by program and then front to back
+        // they are also the point light shadow casters, tracked by node so unmoved ones keep their cached shadows
+        opaqueQueue.clear();
+        shadows.pointShadows.beginCasters();
+        for (int i = 0; i < scene.getNodeCount(); i++)
+        {
+            if (!scene.isDrawable(i))
+                continue;
+            glm::mat4 nodeMatrix = model * scene.worldMatrices[i];
+            glm::vec4 nodeBounds = scene.getBoundingSphere(i, nodeMatrix);
+            // one sphere level per node and frame, drawn by every pass below
+            scene.selectLod(i, nodeBounds, camera.Position, camera.Zoom, renderHeight);
+            int nodeIndex = transforms.add(scene.getDrawMatrix(i, nodeMatrix), scene.getMaterialIndex(i));
+            opaqueQueue.add(scene.getProgram(i), RenderQueue::viewDepth(view, glm::mat4(1.0f), glm::vec3(nodeBounds)), nodeIndex, i, nodeBounds);
+            shadows.pointShadows.addCaster(i, nodeMatrix, nodeBounds);
+        }
+        shadows.pointShadows.endCasters();
+        opaqueQueue.sort();
+        const vector<RenderItem> &opaque = opaqueQueue.getItems();
         
-        /*glm::mat4 modelForSphere = glm::mat4(1.0f);
-        modelForSphere = glm::translate(model, glm::vec3(1.7f, 1.2f, 0.5f));
-        sphere.drawSphere(lightingShader, modelForSphere);*/
+        // lamp cubes, one per point light
+        int pointLightCount = (int)scene.data.pointLights.size();
+        PointLight* pointLights[MAX_SCENE_POINT_LIGHTS];
+        int lampIndex[MAX_SCENE_POINT_LIGHTS];
+        for (int i = 0; i < pointLightCount; i++)
+        {
+            pointLights[i] = &scene.data.pointLights[i];
+            glm::mat4 lampModel = glm::mat4(1.0f);
+            lampModel = glm::translate(lampModel, pointLights[i]->position);
+            lampModel = glm::scale(lampModel, glm::vec3(0.2f)); // Make it a smaller cube
+            lampIndex[i] = transforms.add(lampModel);
+        }
         
-        //container with texture
-        lightingShaderWithTexture.use();
-        lightingShaderWithTexture.setVec3("viewPos", camera.Position);
+        //bed(lightingShader, model, lamp, transforms, materials);
         
-        // directional light
-        dirlight.setUpDirectionLight(lightingShaderWithTexture);
-        // point light 1
-        pointlight1.setUpPointLight(lightingShaderWithTexture);
-        // point light 2
-        pointlight2.setUpPointLight(lightingShaderWithTexture);
-        // point light 3
-        pointlight3.setUpPointLight(lightingShaderWithTexture);
-        // point light 4
-        pointlight4.setUpPointLight(lightingShaderWithTexture);
-        // spotLight
-        spotlight.setUpSpotLight(lightingShaderWithTexture);
+        // shadow maps: every cascade and the spot light only draw the casters that can reach them
+        shadows.enabled = shadowsOn;
+        if (shadowsOn)
+        {
+            shadows.setResolution(shadowResolution);
+            shadows.setCascadeCount(cascadeCount);
+            shadows.updateCascades(view, glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, scene.data.dirLight.direction);
+            shadows.updateSpotLight(scene.data.spotLight);
+            transforms.bind(shadowDepthShader);
+            for (int c = 0; c < shadows.getCascadeCount(); c++)
+            {
+                profiler.begin("shadow cascade " + to_string(c));
+                shadows.beginCascade(c, shadowDepthShader);
+                for (size_t i = 0; i < opaque.size(); i++)
+                    if (shadows.isCasterInCascade(c, opaque[i].bounds))
+                        scene.drawNodeDepthOnly(opaque[i].drawable, shadowDepthShader, opaque[i].objectIndex);
+                profiler.end();
+            }
+            if (shadows.hasSpotShadow())
+            {
+                profiler.begin("shadow spot light");
+                shadows.beginSpotLight(shadowDepthShader);
+                for (size_t i = 0; i < opaque.size(); i++)
+                    if (shadows.isCasterInSpotLight(opaque[i].bounds))
+                        scene.drawNodeDepthOnly(opaque[i].drawable, shadowDepthShader, opaque[i].objectIndex);
+                profiler.end();
+            }
+            
+            // point lights: cached cube maps, only the faces a moved caster touches are drawn again
+            transforms.bind(pointShadowShader);
+            for (int l = 0; l < pointLightCount; l++)
+            {
+                int faces = shadows.pointShadows.getDirtyFaces(l, *pointLights[l]);
+                if (faces == 0)
+                    continue;
+                profiler.begin("shadow point light " + to_string(l));
+                shadows.pointShadows.beginLight(l, faces, pointShadowShader);
+                for (size_t i = 0; i < opaque.size(); i++)
+                    if (shadows.pointShadows.isCasterInFaces(l, faces, opaque[i].bounds))
+                        scene.drawNodeDepthOnly(opaque[i].drawable, pointShadowShader, opaque[i].objectIndex);
+                profiler.end();
+            }
+            shadows.end(framebufferWidth, framebufferHeight);
+        }
+        else
+        {
+            // casters are not tracked while shadows are off
+            shadows.pointShadows.invalidate();
+        }
+        shadows.setUpShadows(lightingShader, view);
         
-        lightingShaderWithTexture.setMat4("projection", projection);
-        lightingShaderWithTexture.setMat4("view", view);
+        /*int sphereIndex = transforms.add(sphere.getModelMatrix(glm::translate(model, glm::vec3(1.7f, 1.2f, 0.5f))));
+        transforms.bind(lightingShader);
+        sphere.drawSphere(lightingShader, sphereIndex);*/
         
-        glm::mat4 modelMatrixForContainer = glm::mat4(1.0f);
-        modelMatrixForContainer = glm::translate(model, glm::vec3(-1.5f, 1.2f, 0.5f));
-        cube.drawCubeWithTexture(lightingShaderWithTexture,modelMatrixForContainer);
+        lightingShaderWithTexture.use();
+        lightingShaderWithTexture.setVec3("viewPos", camera.Position);
         
-        glm::mat4 modelMatrixForContainer1 = glm::mat4(1.0f);
-        modelMatrixForContainer1 = glm::translate(model, glm::vec3(-0.3f, 1.2f, 0.5f));
-        cube1.drawCubeWithTexture(lightingShaderWithTexture,modelMatrixForContainer1);
+        scene.setUpLights(lightingShaderWithTexture);
+        shadows.setUpShadows(lightingShaderWithTexture, view);
         
-        // GL_MIRRORED_REPEAT
-        glm::mat4 modelMatrixForContainer2 = glm::mat4(1.0f);
-        modelMatrixForContainer2 = glm::translate(model, glm::vec3(-1.5f, 0.0f, 0.5f));
-        cube2.drawCubeWithTexture(lightingShaderWithTexture,modelMatrixForContainer2);
+        multiDrawLightingShader.use();
+        multiDrawLightingShader.setVec3("viewPos", camera.Position);
+        scene.setUpLights(multiDrawLightingShader);
+        shadows.setUpShadows(multiDrawLightingShader, view);
         
-        // GL_CLAMP_TO_EDGE
-        glm::mat4 modelMatrixForContainer3 = glm::mat4(1.0f);
-        modelMatrixForContainer3 = glm::translate(model, glm::vec3(-0.3f, 0.0f, 0.5f));
-        cube3.drawCubeWithTexture(lightingShaderWithTexture,modelMatrixForContainer3);
+        // pooled nodes skip their own draw and go out together after the rest of the pass;
+        // on contexts without multi-draw indirect every node keeps its own draw
+        multiDraw.useIndirect = multiDrawIndirect && isMultiDrawIndirectSupported();
         
-        // GL_NEAREST
-        glm::mat4 modelMatrixForContainer4 = glm::mat4(1.0f);
-        modelMatrixForContainer4 = glm::translate(model, glm::vec3(-1.5f, -1.2f, 0.5f));
-        cube4.drawCubeWithTexture(lightingShaderWithTexture,modelMatrixForContainer4);
+        // the scene and the lamps go into an HDR target, tone mapped into the window at the end
+        if (postProcessing)
+            post.beginScene(renderWidth, renderHeight, deferredShading ? 1 : getAntiAliasingSamples((AntiAliasing)antiAliasing));
         
-        // GL_LINEAR
-        glm::mat4 modelMatrixForContainer5 = glm::mat4(1.0f);
-        modelMatrixForContainer5 = glm::translate(model, glm::vec3(-0.3f, -1.2f, 0.5f));
-        cube5.drawCubeWithTexture(lightingShaderWithTexture,modelMatrixForContainer5);
+        if (deferredShading)
+        {
+            // geometry pass: same draws as the forward path, into the G-buffer
+            profiler.begin("geometry pass");
+            deferred.resize(renderWidth, renderHeight);
+            deferred.beginGeometryPass();
+            // the queue keeps the draws of each program together
+            transforms.bind(geometryPassShaderWithTexture);
+            transforms.bind(geometryPassShader);
+            materials.bind(geometryPassShader);
+            multiDraw.clear();
+            for (size_t i = 0; i < opaque.size(); i++)
+            {
+                int poolMesh = scene.getPoolMesh(opaque[i].drawable);
+                if (multiDraw.useIndirect && poolMesh >= 0)
+                {
+                    multiDraw.add(poolMesh, opaque[i].objectIndex);
+                    continue;
+                }
+                Shader &shader = scene.getProgram(opaque[i].drawable) == SCENE_PROGRAM_TEXTURED ? geometryPassShaderWithTexture : geometryPassShader;
+                scene.drawNode(opaque[i].drawable, shader, opaque[i].objectIndex);
+            }
+            transforms.bind(multiDrawGeometryPassShader);
+            materials.bind(multiDrawGeometryPassShader);
+            multiDraw.draw(multiDrawGeometryPassShader);
+            //bed(geometryPassShader, model, lamp, transforms, materials);
+            deferred.endGeometryPass();
+            profiler.end();
+            
+            // occlusion from the G-buffer depth and normals, read by the lighting pass below
+            ssao.enabled = ambientOcclusion;
+            if (ambientOcclusion)
+                ssao.run(deferred.getDepthTexture(), deferred.getNormalTexture(), projection, view, renderWidth, renderHeight, post.getSceneFBO());
+            
+            // lighting pass: fullscreen directional light, then one volume per point/spot light
+            profiler.begin("lighting pass");
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+            deferred.lightingPass(transforms, camera.Position, scene.data.dirLight, pointLights, pointLightCount, scene.data.spotLight, shadows, ssao, view, post.getSceneFBO());
+            profiler.end();
+        }
+        else
+        {
+            auto drawDepthPrepass = [&]()
+            {
+                transforms.bind(depthShader);
+                glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                for (size_t i = 0; i < opaque.size(); i++)
+                    scene.drawNodeDepthOnly(opaque[i].drawable, depthShader, opaque[i].objectIndex);
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            };
+            
+            // ambient occlusion needs the depth before the color pass, so it brings its own pre-pass,
+            // which is copied into the scene target unless that is multisampled
+            ssao.enabled = ambientOcclusion;
+            bool sharedPrepass = ambientOcclusion && post.getSceneSamples() == 1;
+            bool prepass = depthPrepass || sharedPrepass;
+            if (ambientOcclusion)
+            {
+                profiler.begin("depth prepass");
+                ssao.beginDepthPass(renderWidth, renderHeight);
+                drawDepthPrepass();
+                if (sharedPrepass)
+                    ssao.endDepthPass(post.getSceneFBO());
+                profiler.end();
+                ssao.run(ssao.getDepthTexture(), 0, projection, view, renderWidth, renderHeight, post.getSceneFBO());
+            }
+            if (depthPrepass && !sharedPrepass)
+            {
+                // lay down the nearest depth first, so the lighting below runs once per pixel
+                profiler.begin(ambientOcclusion ? "msaa depth prepass" : "depth prepass");
+                drawDepthPrepass();
+                profiler.end();
+            }
+            if (prepass)
+            {
+                glDepthFunc(GL_EQUAL);
+                glDepthMask(GL_FALSE);
+            }
+            ssao.setUpOcclusion(lightingShader);
+            ssao.setUpOcclusion(lightingShaderWithTexture);
+            ssao.setUpOcclusion(multiDrawLightingShader);
+            
+            profiler.begin("forward pass");
+            transforms.bind(lightingShaderWithTexture);
+            transforms.bind(lightingShader);
+            materials.bind(lightingShader);
+            multiDraw.clear();
+            for (size_t i = 0; i < opaque.size(); i++)
+            {
+                int poolMesh = scene.getPoolMesh(opaque[i].drawable);
+                if (multiDraw.useIndirect && poolMesh >= 0)
+                {
+                    multiDraw.add(poolMesh, opaque[i].objectIndex);
+                    continue;
+                }
+                Shader &shader = scene.getProgram(opaque[i].drawable) == SCENE_PROGRAM_TEXTURED ? lightingShaderWithTexture : lightingShader;
+                scene.drawNode(opaque[i].drawable, shader, opaque[i].objectIndex);
+            }
+            transforms.bind(multiDrawLightingShader);
+            materials.bind(multiDrawLightingShader);
+            multiDraw.draw(multiDrawLightingShader);
+            profiler.end();
+            
+            if (prepass)
+            {
+                glDepthFunc(GL_LESS);
+                glDepthMask(GL_TRUE);
+            }
+        }
         
         // also draw the lamp object(s)
-        ourShader.use();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
+        transforms.bind(ourShader);
             
         // we now draw as many light bulbs as we have point lights.
-        for (unsigned int i = 0; i < 4; i++)
+        profiler.begin("lamps");
+        float lampBrightness = postProcessing ? 0.8f * lampIntensity : 0.8f;
+        for (int i = 0; i < pointLightCount; i++)
         {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, pointLightPositions[i]);
-            model = glm::scale(model, glm::vec3(0.2f)); // Make it a smaller cube
-            cube.drawCube(ourShader, model, 0.8f, 0.8f, 0.8f);
+            lamp.drawCube(ourShader, lampIndex[i], lampBrightness, lampBrightness, lampBrightness);
         }
+        profiler.end();
+        
+        if (postProcessing)
+        {
+            post.exposure = exposure;
+            post.toneMapper = (ToneMapper)toneMapper;
+            post.bloomMode = (BloomMode)bloomMode;
+            post.bloomLevels = bloomLevels;
+            post.fxaa = antiAliasing == AA_FXAA;
+            post.run(0, framebufferWidth, framebufferHeight);
+        }
+        if (reportPasses)
+        {
+            if (postProcessing)
+                post.report();
+            if (ambientOcclusion)
+                ssao.report();
+            if (dynamicResolution)
+                resolution.report();
+            reportPasses = false;
+        }
+        if (pathTraceView)
+        {
+            // the scene as loaded so far, from this camera; the window waits until it is done
+            PathTracer tracer;
+            if (tracer.load(scene.data))
+            {
+                tracer.resize(framebufferWidth, framebufferHeight);
+                tracer.setCamera(camera.Position, camera.Front, camera.Up, camera.Zoom);
+                for (int s = 0; s < 16; s++)
+                    tracer.renderPass();
+                if (tracer.writeImage("pathTrace.ppm"))
+                    cout << "path traced the view into pathTrace.ppm" << endl;
+                tracer.report();
+            }
+            pathTraceView = false;
+        }
+        
+        profiler.end();
+        profiler.endFrame();
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -386,88 +745,16 @@ int main()
     return 0;
 }
 
-void bed(Shader &lightingShader, glm::mat4 alTogether, Cube &cube)
+void bed(Shader &lightingShader, glm::mat4 alTogether, Cube &cube, TransformBuffer &transforms, MaterialRegistry &materials)
 {
-    float baseHeight = 0.3;
-    float width = 1;
-    float length = 2;
-    float pillowWidth = 0.3;
-    float pillowLength = 0.15;
-    float blanketWidth = 0.8;
-    float blanketLength = 0.7;
-    float headHeight = 0.6;
-    
-    //base
-    glm::mat4 model = glm::mat4(1.0f);
-    glm::mat4 translate = glm::mat4(1.0f);
-    glm::mat4 translate2 = glm::mat4(1.0f);
-    glm::mat4 scale = glm::mat4(1.0f);
-    scale = glm::scale(model, glm::vec3(width,baseHeight,length));
-    translate = glm::translate(model, glm::vec3(-0.5,0,-0.5));
-    model = alTogether * scale * translate;
-    cube.setMaterialisticProperty(glm::vec3(0.545,0.271,0.075),glm::vec3(0.545,0.271,0.075),glm::vec3(0.5,0.5,0.5),32.0);
-    cube.drawCubeWithMaterialisticProperty(lightingShader, model);
-    
-    //foam
-    model = glm::mat4(1.0f);
-    translate = glm::mat4(1.0f);
-    translate2 = glm::mat4(1.0f);
-    scale = glm::mat4(1.0f);
-    translate2 = glm::translate(model, glm::vec3(0,baseHeight,0));
-    scale = glm::scale(model, glm::vec3(width,0.06,length));
-    translate = glm::translate(model, glm::vec3(-0.5,0,-0.5));
-    model = alTogether * translate2 * scale * translate;
-    cube.setMaterialisticProperty(glm::vec3(0.804,0.361,0.361),glm::vec3(0.804,0.361,0.361),glm::vec3(0.5,0.5,0.5),32.0);
-    cube.drawCubeWithMaterialisticProperty(lightingShader, model);
-    
-    //pillow 1
-    model = glm::mat4(1.0f);
-    translate = glm::mat4(1.0f);
-    translate2 = glm::mat4(1.0f);
-    scale = glm::mat4(1.0f);
-    translate2 = glm::translate(model, glm::vec3((width/2)-(0.1+pillowWidth/2),baseHeight+1*0.06,(length/2)-(0.025+pillowWidth/2)));
-    scale = glm::scale(model, glm::vec3(pillowWidth,0.04,pillowLength));
-    translate = glm::translate(model, glm::vec3(-0.5,0,-0.5));
-    model = alTogether * translate2 * scale * translate;
-    cube.setMaterialisticProperty(glm::vec3(1.0,0.647,0.0),glm::vec3(1.0,0.647,0.0),glm::vec3(0.5,0.5,0.5),32.0);
-    cube.drawCubeWithMaterialisticProperty(lightingShader, model);
-    
-    //pillow 2
-    model = glm::mat4(1.0f);
-    translate = glm::mat4(1.0f);
-    translate2 = glm::mat4(1.0f);
-    scale = glm::mat4(1.0f);
-    translate2 = glm::translate(model, glm::vec3((-width/2)+(0.1+pillowWidth/2),baseHeight+1*0.06,(length/2)-(0.025+pillowWidth/2)));
-    scale = glm::scale(model, glm::vec3(pillowWidth,0.04,pillowLength));
-    translate = glm::translate(model, glm::vec3(-0.5,0,-0.5));
-    model = alTogether * translate2 * scale * translate;
-    cube.setMaterialisticProperty(glm::vec3(1.0,0.647,0.0),glm::vec3(1.0,0.647,0.0),glm::vec3(0.5,0.5,0.5),32.0);
-    cube.drawCubeWithMaterialisticProperty(lightingShader, model);
-    
-    //blanket
-    model = glm::mat4(1.0f);
-    translate = glm::mat4(1.0f);
-    translate2 = glm::mat4(1.0f);
-    scale = glm::mat4(1.0f);
-    translate2 = glm::translate(model, glm::vec3(0,baseHeight+1*0.06,-(length/2-0.025)+blanketLength/2));
-    scale = glm::scale(model, glm::vec3(blanketWidth,0.015,blanketLength));
-    translate = glm::translate(model, glm::vec3(-0.5,0,-0.5));
-    model = alTogether * translate2 * scale * translate;
-    cube.setMaterialisticProperty(glm::vec3(0.541,0.169,0.886),glm::vec3(0.541,0.169,0.886),glm::vec3(0.5,0.5,0.5),32.0);
-    cube.drawCubeWithMaterialisticProperty(lightingShader, model);
-    
-    //head
-    model = glm::mat4(1.0f);
-    translate = glm::mat4(1.0f);
-    translate2 = glm::mat4(1.0f);
-    scale = glm::mat4(1.0f);
-    translate2 = glm::translate(model, glm::vec3(0,0,(length/2-0.02/2)+0.02));
-    scale = glm::scale(model, glm::vec3(width,headHeight,0.02));
-    translate = glm::translate(model, glm::vec3(-0.5,0,-0.5));
-    model = alTogether * translate2 * scale * translate;
-    cube.setMaterialisticProperty(glm::vec3(0.545,0.271,0.075),glm::vec3(0.545,0.271,0.075),glm::vec3(0.5,0.5,0.5),32.0);
-    cube.drawCubeWithMaterialisticProperty(lightingShader, model);
+    static Furniture bedFurniture = Furniture::makeBed();
     
+    // base, foam, pillows, blanket and head go into the transform buffer side by side,
+    // each with its material index, and are drawn in one instanced call
+    int first = bedFurniture.add(transforms, alTogether, &materials);
+    transforms.bind(lightingShader);
+    materials.bind(lightingShader);
+    bedFurniture.draw(lightingShader, cube, first);
 }
 
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
@@ -566,16 +853,105 @@ void processInput(GLFWwindow* window)
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
+    if (key == GLFW_KEY_7 && action == GLFW_PRESS)
+    {
+        deferredShading = !deferredShading;
+        cout << (deferredShading ? "deferred shading" : "forward shading") << endl;
+    }
+    if (key == GLFW_KEY_8 && action == GLFW_PRESS)
+    {
+        depthPrepass = !depthPrepass;
+        cout << "depth pre-pass " << (depthPrepass ? "on" : "off") << endl;
+    }
+    if (key == GLFW_KEY_BACKSLASH && action == GLFW_PRESS)
+    {
+        multiDrawIndirect = !multiDrawIndirect;
+        cout << "multi-draw indirect " << (multiDrawIndirect ? "on" : "off") << endl;
+    }
+    if (key == GLFW_KEY_SEMICOLON && action == GLFW_PRESS)
+    {
+        postProcessing = !postProcessing;
+        cout << "post-processing " << (postProcessing ? "on" : "off") << endl;
+    }
+    if (key == GLFW_KEY_APOSTROPHE && action == GLFW_PRESS)
+    {
+        toneMapper = (toneMapper + 1) % TONE_MAP_COUNT;
+        cout << "tone mapping: " << getToneMapperName((ToneMapper)toneMapper) << endl;
+    }
+    if (key == GLFW_KEY_LEFT_BRACKET && action == GLFW_PRESS && exposure > 0.0625f)
+    {
+        exposure *= 0.8f;
+        cout << "exposure: " << exposure << endl;
+    }
+    if (key == GLFW_KEY_RIGHT_BRACKET && action == GLFW_PRESS && exposure < 16.0f)
+    {
+        exposure *= 1.25f;
+        cout << "exposure: " << exposure << endl;
+    }
+    if (key == GLFW_KEY_COMMA && action == GLFW_PRESS)
+    {
+        bloomMode = (bloomMode + 1) % BLOOM_MODE_COUNT;
+        cout << "bloom: " << getBloomModeName((BloomMode)bloomMode) << endl;
+    }
+    if (key == GLFW_KEY_PERIOD && action == GLFW_PRESS)
+    {
+        bloomLevels = bloomLevels % MAX_BLOOM_LEVELS + 1;
+        cout << "bloom levels: " << bloomLevels << endl;
+    }
+    if (key == GLFW_KEY_SLASH && action == GLFW_PRESS)
+        reportPasses = true;
+    if (key == GLFW_KEY_F2 && action == GLFW_PRESS)
+        pathTraceView = true;
+    if (key == GLFW_KEY_F1 && action == GLFW_PRESS)
+    {
+        dynamicResolution = !dynamicResolution;
+        cout << "dynamic resolution " << (dynamicResolution ? "on" : "off") << (dynamicResolution && !postProcessing ? " (needs post-processing)" : "") << endl;
+    }
+    if (key == GLFW_KEY_TAB && action == GLFW_PRESS)
+    {
+        antiAliasing = (antiAliasing + 1) % AA_MODE_COUNT;
+        cout << "anti-aliasing: " << getAntiAliasingName((AntiAliasing)antiAliasing);
+        if (!postProcessing)
+            cout << " (needs post-processing)";
+        else if (deferredShading && antiAliasing >= AA_MSAA_2X)
+            cout << " (not in the deferred path)";
+        cout << endl;
+    }
+    if (key == GLFW_KEY_GRAVE_ACCENT && action == GLFW_PRESS)
+    {
+        ambientOcclusion = !ambientOcclusion;
+        cout << "ambient occlusion " << (ambientOcclusion ? "on" : "off") << endl;
+    }
+    if (key == GLFW_KEY_9 && action == GLFW_PRESS)
+    {
+        shadowsOn = !shadowsOn;
+        cout << "shadows " << (shadowsOn ? "on" : "off") << endl;
+    }
+    if (key == GLFW_KEY_0 && action == GLFW_PRESS)
+    {
+        cascadeCount = cascadeCount % MAX_CASCADES + 1;
+        cout << "shadow cascades: " << cascadeCount << endl;
+    }
+    if (key == GLFW_KEY_MINUS && action == GLFW_PRESS && shadowResolution > 256)
+    {
+        shadowResolution /= 2;
+        cout << "shadow map resolution: " << shadowResolution << endl;
+    }
+    if (key == GLFW_KEY_EQUAL && action == GLFW_PRESS && shadowResolution < 4096)
+    {
+        shadowResolution *= 2;
+        cout << "shadow map resolution: " << shadowResolution << endl;
+    }
     if (key == GLFW_KEY_1 && action == GLFW_PRESS)
     {
         if(dirLightOn)
         {
-            dirlight.turnOff();
+            scene.data.dirLight.turnOff();
             dirLightOn = !dirLightOn;
         }
         else
         {
-            dirlight.turnOn();
+            scene.data.dirLight.turnOn();
             dirLightOn = !dirLightOn;
         }
     }
@@ -583,18 +959,14 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     {
         if(pointLightOn)
         {
-            pointlight1.turnOff();
-            pointlight2.turnOff();
-            pointlight3.turnOff();
-            pointlight4.turnOff();
+            for (size_t i = 0; i < scene.data.pointLights.size(); i++)
+                scene.data.pointLights[i].turnOff();
             pointLightOn = !pointLightOn;
         }
         else
         {
-            pointlight1.turnOn();
-            pointlight2.turnOn();
-            pointlight3.turnOn();
-            pointlight4.turnOn();
+            for (size_t i = 0; i < scene.data.pointLights.size(); i++)
+                scene.data.pointLights[i].turnOn();
             pointLightOn = !pointLightOn;
         }
     }
@@ -602,12 +974,12 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     {
         if(spotLightOn)
         {
-            spotlight.turnOff();
+            scene.data.spotLight.turnOff();
             spotLightOn = !spotLightOn;
         }
         else
         {
-            spotlight.turnOn();
+            scene.data.spotLight.turnOn();
             spotLightOn = !spotLightOn;
         }
     }
@@ -617,13 +989,13 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
         {
             if(ambientToggle)
             {
-                dirlight.turnAmbientOff();
+                scene.data.dirLight.turnAmbientOff();
                 ambientToggle = !ambientToggle;
             }
             else
             {
 
-                dirlight.turnAmbientOn();
+                scene.data.dirLight.turnAmbientOn();
                 ambientToggle = !ambientToggle;
             }
         }
@@ -631,18 +1003,14 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
         {
             if(ambientToggle)
             {
-                pointlight1.turnAmbientOff();
-                pointlight2.turnAmbientOff();
-                pointlight3.turnAmbientOff();
-                pointlight4.turnAmbientOff();
+                for (size_t i = 0; i < scene.data.pointLights.size(); i++)
+                    scene.data.pointLights[i].turnAmbientOff();
                 ambientToggle = !ambientToggle;
             }
             else
             {
-                pointlight1.turnAmbientOn();
-                pointlight2.turnAmbientOn();
-                pointlight3.turnAmbientOn();
-                pointlight4.turnAmbientOn();
+                for (size_t i = 0; i < scene.data.pointLights.size(); i++)
+                    scene.data.pointLights[i].turnAmbientOn();
                 ambientToggle = !ambientToggle;
             }
         }
@@ -650,12 +1018,12 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
         {
             if(ambientToggle)
             {
-                spotlight.turnAmbientOff();
+                scene.data.spotLight.turnAmbientOff();
                 ambientToggle = !ambientToggle;
             }
             else
             {
-                spotlight.turnAmbientOn();
+                scene.data.spotLight.turnAmbientOn();
                 ambientToggle = !ambientToggle;
             }
         }
@@ -667,13 +1035,13 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
         {
             if(diffuseToggle)
             {
-                dirlight.turnDiffuseOff();
+                scene.data.dirLight.turnDiffuseOff();
                 diffuseToggle = !diffuseToggle;
             }
             else
             {
 
-                dirlight.turnDiffuseOn();
+                scene.data.dirLight.turnDiffuseOn();
                 diffuseToggle = !diffuseToggle;
             }
         }
@@ -681,18 +1049,14 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
         {
             if(diffuseToggle)
             {
-                pointlight1.turnDiffuseOff();
-                pointlight2.turnDiffuseOff();
-                pointlight3.turnDiffuseOff();
-                pointlight4.turnDiffuseOff();
+                for (size_t i = 0; i < scene.data.pointLights.size(); i++)
+                    scene.data.pointLights[i].turnDiffuseOff();
                 diffuseToggle = !diffuseToggle;
             }
             else
             {
-                pointlight1.turnDiffuseOn();
-                pointlight2.turnDiffuseOn();
-                pointlight3.turnDiffuseOn();
-                pointlight4.turnDiffuseOn();
+                for (size_t i = 0; i < scene.data.pointLights.size(); i++)
+                    scene.data.pointLights[i].turnDiffuseOn();
                 diffuseToggle = !diffuseToggle;
             }
         }
@@ -700,12 +1064,12 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
         {
             if(diffuseToggle)
             {
-                spotlight.turnDiffuseOff();
+                scene.data.spotLight.turnDiffuseOff();
                 diffuseToggle = !diffuseToggle;
             }
             else
             {
-                spotlight.turnDiffuseOn();
+                scene.data.spotLight.turnDiffuseOn();
                 diffuseToggle = !diffuseToggle;
             }
         }
@@ -717,13 +1081,13 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
         {
             if(specularToggle)
             {
-                dirlight.turnSpecularOff();
+                scene.data.dirLight.turnSpecularOff();
                 specularToggle = !specularToggle;
             }
             else
             {
 
-                dirlight.turnSpecularOn();
+                scene.data.dirLight.turnSpecularOn();
                 specularToggle = !specularToggle;
             }
         }
@@ -731,18 +1095,14 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
         {
             if(specularToggle)
             {
-                pointlight1.turnSpecularOff();
-                pointlight2.turnSpecularOff();
-                pointlight3.turnSpecularOff();
-                pointlight4.turnSpecularOff();
+                for (size_t i = 0; i < scene.data.pointLights.size(); i++)
+                    scene.data.pointLights[i].turnSpecularOff();
                 specularToggle = !specularToggle;
             }
             else
             {
-                pointlight1.turnSpecularOn();
-                pointlight2.turnSpecularOn();
-                pointlight3.turnSpecularOn();
-                pointlight4.turnSpecularOn();
+                for (size_t i = 0; i < scene.data.pointLights.size(); i++)
+                    scene.data.pointLights[i].turnSpecularOn();
                 specularToggle = !specularToggle;
             }
         }
@@ -750,12 +1110,12 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
         {
             if(specularToggle)
             {
-                spotlight.turnSpecularOff();
+                scene.data.spotLight.turnSpecularOff();
                 specularToggle = !specularToggle;
             }
             else
             {
-                spotlight.turnSpecularOn();
+                scene.data.spotLight.turnSpecularOn();
                 specularToggle = !specularToggle;
             }
         }
@@ -769,6 +1129,79 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     // make sure the viewport matches the new window dimensions; note that width and
     // height will be significantly larger than specified on retina displays.
     glViewport(0, 0, width, height);
+    framebufferWidth = width;
+    framebufferHeight = height;
+}
+
+// render modes that a benchmark replay can switch between, options joined with '+',
+// e.g. "deferred", "prepass+shadows", "forward+multidraw+ssao", "deferred+post+bloom+exposure=1.5",
+// "forward+post+msaa4", "deferred+post+fxaa", "forward+shadows+post+dynres+budget=8"
+// or "forward+shadows+cascades=2+shadowres=1024"
+void applyRenderMode(const string &mode)
+{
+    deferredShading = false;
+    depthPrepass = false;
+    shadowsOn = false;
+    multiDrawIndirect = false;
+    postProcessing = false;
+    bloomMode = BLOOM_OFF;
+    ambientOcclusion = false;
+    antiAliasing = AA_OFF;
+    dynamicResolution = false;
+    size_t start = 0;
+    while (start <= mode.size())
+    {
+        size_t end = mode.find('+', start);
+        if (end == string::npos)
+            end = mode.size();
+        string option = mode.substr(start, end - start);
+        start = end + 1;
+        
+        if (option == "forward")
+            continue;
+        else if (option == "prepass")
+            depthPrepass = true;
+        else if (option == "deferred")
+            deferredShading = true;
+        else if (option == "shadows")
+            shadowsOn = true;
+        else if (option == "multidraw")
+            multiDrawIndirect = true;
+        else if (option == "ssao")
+            ambientOcclusion = true;
+        else if (option == "fxaa")
+            antiAliasing = AA_FXAA;
+        else if (option == "msaa2")
+            antiAliasing = AA_MSAA_2X;
+        else if (option == "msaa4")
+            antiAliasing = AA_MSAA_4X;
+        else if (option == "msaa8")
+            antiAliasing = AA_MSAA_8X;
+        else if (option == "dynres")
+            dynamicResolution = true;
+        else if (option.compare(0, 7, "budget=") == 0)
+            frameBudgetMs = glm::clamp((float)atof(option.c_str() + 7), 1.0f, 100.0f);
+        else if (option == "post")
+            postProcessing = true;
+        else if (option == "reinhard")
+            toneMapper = TONE_MAP_REINHARD;
+        else if (option == "aces")
+            toneMapper = TONE_MAP_ACES;
+        else if (option == "bloom")
+            bloomMode = BLOOM_MIP_CHAIN;
+        else if (option == "gaussian")
+            bloomMode = BLOOM_GAUSSIAN;
+        else if (option.compare(0, 12, "bloomlevels=") == 0)
+            bloomLevels = glm::clamp(atoi(option.c_str() + 12), 1, MAX_BLOOM_LEVELS);
+        else if (option.compare(0, 9, "exposure=") == 0)
+            exposure = glm::clamp((float)atof(option.c_str() + 9), 0.0625f, 16.0f);
+        else if (option.compare(0, 9, "cascades=") == 0)
+            cascadeCount = glm::clamp(atoi(option.c_str() + 9), 1, MAX_CASCADES);
+        else if (option.compare(0, 10, "shadowres=") == 0)
+            shadowResolution = glm::clamp(atoi(option.c_str() + 10), 256, 4096);
+        else
+            cout << "unknown render option: " << option << endl;
+    }
 }
 
 
@@ -801,41 +1234,3 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
-
-unsigned int loadTexture(char const * path, GLenum textureWrappingModeS, GLenum textureWrappingModeT, GLenum textureFilteringModeMin, GLenum textureFilteringModeMax)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    stbi_set_flip_vertically_on_load(true);
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, textureWrappingModeS);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, textureWrappingModeT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, textureFilteringModeMin);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, textureFilteringModeMax);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
-}
@@ -0,0 +1,70 @@
+//
+//  mappedFile.h
+//  test
+//
+
+#ifndef mappedFile_h
+#define mappedFile_h
+
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+// A whole file mapped read-only, hinted for one front-to-back pass. Loaders read
+// straight from getData() instead of copying the file into memory first.
+class MappedFile{
+public:
+    MappedFile(const string &path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            return;
+        struct stat info;
+        if(fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            void *mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapping != MAP_FAILED)
+            {
+                data = (const unsigned char*)mapping;
+                size = (size_t)info.st_size;
+                madvise(mapping, size, MADV_SEQUENTIAL);
+                madvise(mapping, size, MADV_WILLNEED);
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if(data)
+            munmap((void*)data, size);
+    }
+
+    bool isOpen() const
+    {
+        return data != NULL;
+    }
+
+    const unsigned char* getData() const
+    {
+        return data;
+    }
+
+    size_t getSize() const
+    {
+        return size;
+    }
+
+private:
+    const unsigned char *data = NULL;
+    size_t size = 0;
+
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+#endif /* mappedFile_h */
@@ -0,0 +1,107 @@
+//
+//  materialBuffer.h
+//  test
+//
+
+#ifndef materialBuffer_h
+#define materialBuffer_h
+
+#include <glad/glad.h>
+#include <vector>
+#include <iostream>
+#include <glm/glm.hpp>
+#include "shader.h"
+
+using namespace std;
+
+// materials in the buffer, 48 bytes each keeps it under the 16 KB every GL 3.3 UBO allows
+const int MAX_MATERIALS = 256;
+// uniform buffer binding point of the "Materials" block
+const int MATERIAL_BUFFER_BINDING = 0;
+
+// std140 layout of one entry of the Materials block
+struct MaterialData{
+    glm::vec4 ambient;
+    glm::vec4 diffuse;
+    glm::vec4 specular;         // w = shininess
+};
+
+// Every untextured material of the frame in one uniform buffer, so draws pick a material
+// by index instead of setting material.* uniforms. The index travels with the object's
+// transform (TransformBuffer::add), which lets one instanced draw cover objects with
+// different materials. Materials are added once, deduplicated, and uploaded only when
+// new ones come in; the GL buffer is created on first use, so a registry can outlive
+// or predate the context.
+class MaterialRegistry{
+public:
+    ~MaterialRegistry()
+    {
+        if(materialUBO)
+            glDeleteBuffers(1, &materialUBO);
+    }
+
+    // index of a material with these properties, added if it is new; -1 once the buffer is full
+    int add(const glm::vec3 &ambient, const glm::vec3 &diffuse, const glm::vec3 &specular, float shininess)
+    {
+        MaterialData material;
+        material.ambient = glm::vec4(ambient, 0.0f);
+        material.diffuse = glm::vec4(diffuse, 0.0f);
+        material.specular = glm::vec4(specular, shininess);
+        for(size_t i = 0; i < materials.size(); i++)
+            if(materials[i].ambient == material.ambient && materials[i].diffuse == material.diffuse && materials[i].specular == material.specular)
+                return (int)i;
+        if((int)materials.size() == MAX_MATERIALS)
+        {
+            cout << "material registry is full, " << MAX_MATERIALS << " materials" << endl;
+            return -1;
+        }
+        materials.push_back(material);
+        return (int)materials.size() - 1;
+    }
+
+    int getCount() const
+    {
+        return (int)materials.size();
+    }
+
+    const MaterialData& get(int index) const
+    {
+        return materials[index];
+    }
+
+    // uploads the materials added since the last bind and points the shader's
+    // Materials block at the buffer
+    void bind(Shader &shader)
+    {
+        flush();
+        unsigned int block = glGetUniformBlockIndex(shader.ID, "Materials");
+        if(block != GL_INVALID_INDEX)
+            glUniformBlockBinding(shader.ID, block, MATERIAL_BUFFER_BINDING);
+        glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BUFFER_BINDING, materialUBO);
+    }
+
+private:
+    unsigned int materialUBO = 0;
+    int uploaded = 0;
+    vector<MaterialData> materials;
+
+    void flush()
+    {
+        if(!materialUBO)
+        {
+            // full size up front, so later materials are appended without reallocating
+            glGenBuffers(1, &materialUBO);
+            glBindBuffer(GL_UNIFORM_BUFFER, materialUBO);
+            glBufferData(GL_UNIFORM_BUFFER, MAX_MATERIALS * sizeof(MaterialData), NULL, GL_STATIC_DRAW);
+        }
+        else
+            glBindBuffer(GL_UNIFORM_BUFFER, materialUBO);
+        int count = (int)materials.size();
+        if(count > uploaded)
+            glBufferSubData(GL_UNIFORM_BUFFER, uploaded * sizeof(MaterialData), (count - uploaded) * sizeof(MaterialData), &materials[uploaded]);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        uploaded = count;
+    }
+};
+
+#endif /* materialBuffer_h */
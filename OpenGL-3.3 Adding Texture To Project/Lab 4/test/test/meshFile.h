@@ -0,0 +1,315 @@
+//
+//  meshFile.h
+//  test
+//
+
+#ifndef meshFile_h
+#define meshFile_h
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "shader.h"
+#include "vertexFormat.h"
+#include "mappedFile.h"
+
+using namespace std;
+
+// Binary mesh file, little-endian, version 1:
+//   MeshFileHeader
+//   MeshFileAttrib[attribCount]     vertex format, in VertexFormat::add() order
+//   MeshFileLod[lodCount]           level 0 is the finest
+//   vertex blob at vertexOffset     packed exactly as the GL buffer wants it
+//   index blob at indexOffset       indices of each level start at 0, drawn with its baseVertex
+// Blobs start on 16-byte boundaries so they can be uploaded straight from a mapping.
+// Positions stored as ATTRIB_SNORM16 are relative to the bounding sphere (center +
+// position * radius), MeshAsset::getModelMatrix() applies that.
+const char MESH_FILE_MAGIC[4] = { 'M', 'E', 'S', 'H' };
+const uint32_t MESH_FILE_VERSION = 1;
+const uint32_t MESH_FILE_ALIGNMENT = 16;
+
+struct MeshFileHeader{
+    char magic[4];
+    uint32_t version;
+    uint32_t attribCount;
+    uint32_t stride;            // bytes per vertex
+    uint32_t indexType;         // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    uint32_t lodCount;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t vertexOffset;      // bytes from the start of the file
+    uint64_t indexOffset;
+    float bounds[4];            // mesh space bounding sphere: center, radius
+};
+
+struct MeshFileAttrib{
+    uint32_t location;
+    uint32_t components;
+    uint32_t encoding;          // AttribEncoding
+    uint32_t sourceOffset;
+    uint32_t offset;            // bytes into a vertex
+};
+
+struct MeshFileLod{
+    uint32_t baseVertex;
+    uint32_t vertexCount;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float detail;               // edges around the bounding circumference, for LOD selection
+};
+
+// writes an already packed mesh; vertices are vertexCount * format.getStride() bytes
+bool writeMeshFile(const string &path, const VertexFormat &format, const void *vertices, size_t vertexCount,
+                   const void *indices, size_t indexCount, GLenum indexType, const glm::vec4 &bounds, const vector<MeshFileLod> &lods)
+{
+    // readers draw level 0, so there has to be one
+    if(lods.empty())
+    {
+        cout << "mesh file " << path << " needs at least one level" << endl;
+        return false;
+    }
+    const vector<VertexAttrib> &attribs = format.getAttribs();
+    MeshFileHeader header;
+    memcpy(header.magic, MESH_FILE_MAGIC, 4);
+    header.version = MESH_FILE_VERSION;
+    header.attribCount = (uint32_t)attribs.size();
+    header.stride = (uint32_t)format.getStride();
+    header.indexType = (uint32_t)indexType;
+    header.lodCount = (uint32_t)lods.size();
+    header.vertexCount = vertexCount;
+    header.indexCount = indexCount;
+    uint64_t tables = sizeof(MeshFileHeader) + attribs.size() * sizeof(MeshFileAttrib) + lods.size() * sizeof(MeshFileLod);
+    uint64_t vertexBytes = (uint64_t)vertexCount * format.getStride();
+    header.vertexOffset = (tables + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+    header.indexOffset = (header.vertexOffset + vertexBytes + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+    memcpy(header.bounds, &bounds[0], sizeof(header.bounds));
+
+    ofstream file(path.c_str(), ios::binary | ios::trunc);
+    if(!file)
+    {
+        cout << "mesh file " << path << " could not be opened for writing" << endl;
+        return false;
+    }
+    file.write((const char*)&header, sizeof(header));
+    for(size_t i = 0; i < attribs.size(); i++)
+    {
+        MeshFileAttrib a;
+        a.location = attribs[i].location;
+        a.components = attribs[i].components;
+        a.encoding = attribs[i].encoding;
+        a.sourceOffset = attribs[i].sourceOffset;
+        a.offset = attribs[i].offset;
+        file.write((const char*)&a, sizeof(a));
+    }
+    if(!lods.empty())
+        file.write((const char*)lods.data(), lods.size() * sizeof(MeshFileLod));
+    const char padding[MESH_FILE_ALIGNMENT] = { 0 };
+    file.write(padding, header.vertexOffset - tables);
+    file.write((const char*)vertices, vertexBytes);
+    file.write(padding, header.indexOffset - header.vertexOffset - vertexBytes);
+    file.write((const char*)indices, (uint64_t)indexCount * getIndexTypeSize(indexType));
+    if(!file)
+    {
+        cout << "mesh file " << path << " could not be written" << endl;
+        return false;
+    }
+    return true;
+}
+
+// A mesh loaded from a mesh file. The file is mapped and both blobs go to
+// glBufferData straight from the mapping: nothing is parsed beyond the header
+// and tables, and no copy is made on the CPU, so loading is bounded by I/O.
+// Meshes built at runtime (e.g. by the importer) are uploaded the same way from
+// memory, with the arguments writeMeshFile() takes.
+class MeshAsset{
+public:
+    MeshAsset(const string &path)
+    {
+        load(path);
+    }
+
+    MeshAsset(const VertexFormat &format, const void *vertices, size_t vertexCount, const void *indices, size_t indexCount,
+              GLenum indexType, const glm::vec4 &bounds, const vector<MeshFileLod> &lods)
+    {
+        this->format = format;
+        this->indexType = indexType;
+        this->bounds = bounds;
+        this->lods = lods;
+        // without levels the whole mesh is the only one
+        if(this->lods.empty())
+        {
+            MeshFileLod whole = { 0, (uint32_t)vertexCount, 0, (uint32_t)indexCount, 0.0f };
+            this->lods.push_back(whole);
+        }
+        createBuffers(vertices, (size_t)vertexCount * format.getStride(), indices, indexCount * getIndexTypeSize(indexType));
+        loaded = true;
+    }
+
+    ~MeshAsset()
+    {
+        if(!loaded)
+            return;
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+    }
+
+    bool isLoaded() const
+    {
+        return loaded;
+    }
+
+    int getLodCount() const
+    {
+        return (int)lods.size();
+    }
+
+    const MeshFileLod& getLod(int lod) const
+    {
+        return lods[lod];
+    }
+
+    const VertexFormat& getFormat() const
+    {
+        return format;
+    }
+
+    // bytes read from the file into GL buffers
+    size_t getGpuMemory() const
+    {
+        return gpuBytes;
+    }
+
+    // quantized positions are relative to the bounding sphere, this maps them back
+    glm::mat4 getModelMatrix(const glm::mat4 &model) const
+    {
+        const vector<VertexAttrib> &attribs = format.getAttribs();
+        for(size_t i = 0; i < attribs.size(); i++)
+            if(attribs[i].location == 0 && attribs[i].encoding == ATTRIB_SNORM16)
+                return glm::scale(glm::translate(model, glm::vec3(bounds)), glm::vec3(bounds.w));
+        return model;
+    }
+
+    // world bounding sphere under model (without getModelMatrix()): xyz = center, w = radius
+    glm::vec4 getBoundingSphere(const glm::mat4 &model) const
+    {
+        glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(bounds), 1.0f));
+        float scale = fmaxf(glm::length(glm::vec3(model[0])), fmaxf(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        return glm::vec4(center, bounds.w * scale);
+    }
+
+    void drawMesh(Shader &shader, int objectIndex, int lod = 0) const
+    {
+        shader.use();
+        shader.setInt("objectIndex", objectIndex);
+        drawMeshGeometry(lod);
+    }
+
+    void drawMeshGeometry(int lod = 0) const
+    {
+        if(!loaded)
+            return;
+        const MeshFileLod &level = lods[glm::clamp(lod, 0, (int)lods.size() - 1)];
+        glBindVertexArray(VAO);
+        glDrawElementsBaseVertex(GL_TRIANGLES, level.indexCount, indexType, (void*)(size_t)(level.firstIndex * getIndexTypeSize(indexType)), level.baseVertex);
+        glBindVertexArray(0);
+    }
+
+private:
+    bool loaded = false;
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    unsigned int EBO = 0;
+    VertexFormat format;
+    GLenum indexType = GL_UNSIGNED_INT;
+    vector<MeshFileLod> lods;
+    glm::vec4 bounds = glm::vec4(0.0f);
+    size_t gpuBytes = 0;
+
+    MeshAsset(const MeshAsset&);
+    MeshAsset& operator=(const MeshAsset&);
+
+    void load(const string &path)
+    {
+        MappedFile file(path);
+        if(!file.isOpen() || file.getSize() < sizeof(MeshFileHeader))
+        {
+            cout << "mesh file " << path << " could not be mapped" << endl;
+            return;
+        }
+        if(upload(file.getData(), (uint64_t)file.getSize()))
+            loaded = true;
+        else
+            cout << "mesh file " << path << " is not a valid version " << MESH_FILE_VERSION << " mesh file" << endl;
+    }
+
+    bool upload(const unsigned char *data, uint64_t size)
+    {
+        MeshFileHeader header;
+        memcpy(&header, data, sizeof(header));
+        if(memcmp(header.magic, MESH_FILE_MAGIC, 4) != 0 || header.version != MESH_FILE_VERSION)
+            return false;
+        if(header.indexType != GL_UNSIGNED_SHORT && header.indexType != GL_UNSIGNED_INT)
+            return false;
+        if(header.lodCount == 0)
+            return false;
+        // counts are checked against the file size before they are multiplied, so nothing wraps
+        if(header.stride == 0 || header.vertexCount > size / header.stride || header.indexCount > size / getIndexTypeSize(header.indexType))
+            return false;
+        uint64_t tables = sizeof(MeshFileHeader) + (uint64_t)header.attribCount * sizeof(MeshFileAttrib) + (uint64_t)header.lodCount * sizeof(MeshFileLod);
+        uint64_t vertexBytes = header.vertexCount * header.stride;
+        uint64_t indexBytes = header.indexCount * getIndexTypeSize(header.indexType);
+        if(tables > size || header.vertexOffset < tables || header.vertexOffset > size - vertexBytes || header.indexOffset > size - indexBytes)
+            return false;
+
+        // the format is rebuilt through add(), so the file's offsets have to agree with it
+        const unsigned char *table = data + sizeof(MeshFileHeader);
+        for(uint32_t i = 0; i < header.attribCount; i++, table += sizeof(MeshFileAttrib))
+        {
+            MeshFileAttrib a;
+            memcpy(&a, table, sizeof(a));
+            // 16 is the smallest GL_MAX_VERTEX_ATTRIBS, and the location mask of VertexFormat is one bit per location
+            if(a.location >= 16 || a.components < 1 || a.components > 4)
+                return false;
+            if(a.encoding > ATTRIB_SNORM_2_10_10_10 || (int)a.offset != format.getStride())
+                return false;
+            format.add(a.location, a.components, (AttribEncoding)a.encoding, a.sourceOffset);
+        }
+        if(format.getStride() != (int)header.stride)
+            return false;
+        lods.resize(header.lodCount);
+        memcpy(lods.data(), table, header.lodCount * sizeof(MeshFileLod));
+        for(size_t i = 0; i < lods.size(); i++)
+            if((uint64_t)lods[i].baseVertex + lods[i].vertexCount > header.vertexCount || (uint64_t)lods[i].firstIndex + lods[i].indexCount > header.indexCount)
+                return false;
+        indexType = header.indexType;
+        bounds = glm::vec4(header.bounds[0], header.bounds[1], header.bounds[2], header.bounds[3]);
+        createBuffers(data + header.vertexOffset, vertexBytes, data + header.indexOffset, indexBytes);
+        return true;
+    }
+
+    void createBuffers(const void *vertices, size_t vertexBytes, const void *indices, size_t indexBytes)
+    {
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertices, GL_STATIC_DRAW);
+        glGenBuffers(1, &EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indices, GL_STATIC_DRAW);
+        format.setUpAttributes();
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        gpuBytes = vertexBytes + indexBytes;
+    }
+};
+
+#endif /* meshFile_h */
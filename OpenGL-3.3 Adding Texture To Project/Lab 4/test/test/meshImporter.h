@@ -0,0 +1,1085 @@
+//
+//  meshImporter.h
+//  test
+//
+
+#ifndef meshImporter_h
+#define meshImporter_h
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+#include <cmath>
+#include <cctype>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "mappedFile.h"
+#include "meshOptimizer.h"
+#include "vertexFormat.h"
+#include "meshFile.h"
+
+using namespace std;
+
+// floats per imported vertex: position, normal, texture coordinates, the layout Cube uses
+const int IMPORTED_VERTEX_FLOATS = 8;
+
+struct ImportedMesh{
+    vector<float> vertices;         // IMPORTED_VERTEX_FLOATS per vertex
+    vector<unsigned int> indices;   // triangle list
+    glm::vec4 bounds;               // bounding sphere: center, radius
+
+    size_t getVertexCount() const
+    {
+        return vertices.size() / IMPORTED_VERTEX_FLOATS;
+    }
+};
+
+// where an import spent its time, in milliseconds
+struct ImportStats{
+    size_t bytes = 0;
+    int threads = 0;
+    double mapMs = 0.0;
+    double parseMs = 0.0;           // chunks parsed in parallel
+    double dedupeMs = 0.0;          // vertex dedupe, normals, bounds
+    double optimizeMs = 0.0;        // vertex cache and fetch order
+};
+
+// ---- number parsing, no locale or stream state: the parsers read straight from the mapping
+
+bool isLineSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char* skipLineSpace(const char *p, const char *end)
+{
+    while(p < end && isLineSpace(*p))
+        p++;
+    return p;
+}
+
+const char* skipLine(const char *p, const char *end)
+{
+    const char *eol = (const char*)memchr(p, '\n', end - p);
+    return eol ? eol + 1 : end;
+}
+
+// decimal float with optional sign, fraction and exponent; returns p unchanged if there is no number
+const char* parseFloat(const char *p, const char *end, float &value)
+{
+    static const double POWERS[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char *start = p;
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    // 19 digits fit in 64 bits, later ones only move the exponent
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    const char *digitsStart = p;
+    for(; p < end && (unsigned)(*p - '0') < 10; p++)
+    {
+        if(digits < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            if(mantissa)
+                digits++;
+        }
+        else
+            exponent++;
+    }
+    if(p < end && *p == '.')
+    {
+        for(p++; p < end && (unsigned)(*p - '0') < 10; p++)
+            if(digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                if(mantissa)
+                    digits++;
+                exponent--;
+            }
+    }
+    if(p == digitsStart || (p == digitsStart + 1 && *digitsStart == '.'))
+        return start;
+    if(p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char *q = p + 1;
+        bool negativeExponent = false;
+        if(q < end && (*q == '-' || *q == '+'))
+            negativeExponent = *q++ == '-';
+        if(q < end && (unsigned)(*q - '0') < 10)
+        {
+            int e = 0;
+            for(; q < end && (unsigned)(*q - '0') < 10; q++)
+                if(e < 10000)
+                    e = e * 10 + (*q - '0');
+            exponent += negativeExponent ? -e : e;
+            p = q;
+        }
+    }
+
+    double result = (double)mantissa;
+    if(exponent < -22 || exponent > 22)
+        result *= pow(10.0, exponent);
+    else if(exponent < 0)
+        result /= POWERS[-exponent];
+    else
+        result *= POWERS[exponent];
+    value = (float)(negative ? -result : result);
+    return p;
+}
+
+// decimal integer with optional sign; returns p unchanged if there is no number
+const char* parseInt(const char *p, const char *end, long long &value)
+{
+    const char *start = p;
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    const char *digitsStart = p;
+    long long result = 0;
+    for(; p < end && (unsigned)(*p - '0') < 10; p++)
+        result = result * 10 + (*p - '0');
+    if(p == digitsStart)
+        return start;
+    value = negative ? -result : result;
+    return p;
+}
+
+// ---- shared steps
+
+// splits [data, data + size) into count ranges that end on line breaks
+vector<size_t> splitLines(const char *data, size_t size, int count)
+{
+    vector<size_t> bounds(1, 0);
+    for(int i = 1; i < count; i++)
+    {
+        size_t at = size * i / count;
+        if(at <= bounds.back())
+            continue;
+        const char *eol = (const char*)memchr(data + at, '\n', size - at);
+        at = eol ? eol - data + 1 : size;
+        if(at > bounds.back() && at < size)
+            bounds.push_back(at);
+    }
+    bounds.push_back(size);
+    return bounds;
+}
+
+// runs task(i) for i in [0, count) on count threads, the calling thread takes task 0
+template <typename Task>
+void runParallel(int count, Task task)
+{
+    vector<thread> threads;
+    for(int i = 1; i < count; i++)
+        threads.push_back(thread(task, i));
+    task(0);
+    for(size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+}
+
+int getImportThreadCount(int threadCount)
+{
+    if(threadCount > 0)
+        return threadCount;
+    int hardware = (int)thread::hardware_concurrency();
+    return hardware > 0 ? hardware : 1;
+}
+
+// area weighted vertex normals, for files without them
+void computeVertexNormals(vector<float> &vertices, const vector<unsigned int> &indices)
+{
+    size_t vertexCount = vertices.size() / IMPORTED_VERTEX_FLOATS;
+    vector<glm::vec3> normals(vertexCount, glm::vec3(0.0f));
+    for(size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        glm::vec3 p0 = glm::make_vec3(&vertices[indices[i] * IMPORTED_VERTEX_FLOATS]);
+        // the cross product's length is twice the area, so larger faces weigh more
+        glm::vec3 n = glm::cross(glm::make_vec3(&vertices[indices[i + 1] * IMPORTED_VERTEX_FLOATS]) - p0, glm::make_vec3(&vertices[indices[i + 2] * IMPORTED_VERTEX_FLOATS]) - p0);
+        for(int k = 0; k < 3; k++)
+            normals[indices[i + k]] += n;
+    }
+    for(size_t v = 0; v < vertexCount; v++)
+    {
+        float length = glm::length(normals[v]);
+        glm::vec3 n = length > 0.0f ? normals[v] / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        vertices[v * IMPORTED_VERTEX_FLOATS + 3] = n.x;
+        vertices[v * IMPORTED_VERTEX_FLOATS + 4] = n.y;
+        vertices[v * IMPORTED_VERTEX_FLOATS + 5] = n.z;
+    }
+}
+
+// Open addressing table of vertex ids for the dedupe passes: linear probing in a power of
+// two table kept under half full. The caller hashes and compares ids, so the keys stay
+// in the caller's arrays and a lookup touches one 4-byte slot per probe.
+const unsigned int VERTEX_ID_EMPTY = ~0u;
+
+class VertexIdTable{
+public:
+    VertexIdTable(size_t expected)
+    {
+        size_t capacity = 16;
+        while(capacity < expected * 2)
+            capacity *= 2;
+        ids.assign(capacity, VERTEX_ID_EMPTY);
+    }
+
+    // the id already in the table equal to id, or id itself once it is inserted
+    template <typename Hash, typename Equal>
+    unsigned int insert(unsigned int id, Hash hash, Equal equal)
+    {
+        if((count + 1) * 2 > ids.size())
+            grow(hash);
+        size_t mask = ids.size() - 1;
+        for(size_t i = hash(id) & mask; ; i = (i + 1) & mask)
+        {
+            if(ids[i] == VERTEX_ID_EMPTY)
+            {
+                ids[i] = id;
+                count++;
+                return id;
+            }
+            if(equal(ids[i], id))
+                return ids[i];
+        }
+    }
+
+private:
+    vector<unsigned int> ids;
+    size_t count = 0;
+
+    template <typename Hash>
+    void grow(Hash hash)
+    {
+        vector<unsigned int> old(ids.size() * 2, VERTEX_ID_EMPTY);
+        old.swap(ids);
+        size_t mask = ids.size() - 1;
+        for(size_t i = 0; i < old.size(); i++)
+        {
+            if(old[i] == VERTEX_ID_EMPTY)
+                continue;
+            size_t slot = hash(old[i]) & mask;
+            while(ids[slot] != VERTEX_ID_EMPTY)
+                slot = (slot + 1) & mask;
+            ids[slot] = old[i];
+        }
+    }
+};
+
+size_t mixHash(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    return (size_t)hash;
+}
+
+// merges vertices whose floats are bit-for-bit equal and remaps the indices
+void dedupeVertices(vector<float> &vertices, vector<unsigned int> &indices)
+{
+    size_t vertexCount = vertices.size() / IMPORTED_VERTEX_FLOATS;
+    // the ids are of already kept vertices, which are compacted into the front in place
+    float *kept = vertices.data();
+    VertexIdTable unique(vertexCount);
+    vector<unsigned int> remap(vertexCount);
+    unsigned int keptCount = 0;
+    for(size_t v = 0; v < vertexCount; v++)
+    {
+        if(keptCount != v)
+            memcpy(kept + (size_t)keptCount * IMPORTED_VERTEX_FLOATS, kept + v * IMPORTED_VERTEX_FLOATS, IMPORTED_VERTEX_FLOATS * sizeof(float));
+        remap[v] = unique.insert(keptCount, [kept](unsigned int id) {
+            const uint32_t *words = (const uint32_t*)(kept + (size_t)id * IMPORTED_VERTEX_FLOATS);
+            uint64_t hash = 0;
+            for(int i = 0; i < IMPORTED_VERTEX_FLOATS; i++)
+                hash = (hash + words[i]) * 0x9E3779B97F4A7C15ull;
+            return mixHash(hash);
+        }, [kept](unsigned int a, unsigned int b) {
+            return memcmp(kept + (size_t)a * IMPORTED_VERTEX_FLOATS, kept + (size_t)b * IMPORTED_VERTEX_FLOATS, IMPORTED_VERTEX_FLOATS * sizeof(float)) == 0;
+        });
+        if(remap[v] == keptCount)
+            keptCount++;
+    }
+    vertices.resize((size_t)keptCount * IMPORTED_VERTEX_FLOATS);
+    for(size_t i = 0; i < indices.size(); i++)
+        indices[i] = remap[indices[i]];
+}
+
+// center of the bounding box, radius to the farthest vertex
+glm::vec4 computeBounds(const vector<float> &vertices)
+{
+    size_t vertexCount = vertices.size() / IMPORTED_VERTEX_FLOATS;
+    if(vertexCount == 0)
+        return glm::vec4(0.0f);
+    glm::vec3 low(vertices[0], vertices[1], vertices[2]), high = low;
+    for(size_t v = 1; v < vertexCount; v++)
+    {
+        glm::vec3 p(vertices[v * IMPORTED_VERTEX_FLOATS], vertices[v * IMPORTED_VERTEX_FLOATS + 1], vertices[v * IMPORTED_VERTEX_FLOATS + 2]);
+        low = glm::min(low, p);
+        high = glm::max(high, p);
+    }
+    glm::vec3 center = (low + high) * 0.5f;
+    float radius = 0.0f;
+    for(size_t v = 0; v < vertexCount; v++)
+    {
+        glm::vec3 p(vertices[v * IMPORTED_VERTEX_FLOATS], vertices[v * IMPORTED_VERTEX_FLOATS + 1], vertices[v * IMPORTED_VERTEX_FLOATS + 2]);
+        radius = fmaxf(radius, glm::length(p - center));
+    }
+    return glm::vec4(center, radius);
+}
+
+// ---- Wavefront OBJ
+
+// corner indices of a triangle; absolute ones are global and 0-based, relative ones
+// (negative in the file) are counted from the start of the chunk that read them
+struct ObjCorner{
+    int position, texcoord, normal;
+    unsigned char relative;     // bit 0 position, bit 1 texcoord, bit 2 normal
+};
+
+const int OBJ_ABSENT = INT_MIN;
+
+struct ObjChunk{
+    vector<float> positions;
+    vector<float> texcoords;
+    vector<float> normals;
+    vector<ObjCorner> corners;  // three per triangle
+    size_t positionBase = 0, texcoordBase = 0, normalBase = 0;
+    bool failed = false;
+};
+
+// one corner, "p", "p/t", "p//n" or "p/t/n"
+const char* parseObjCorner(const char *p, const char *end, const ObjChunk &chunk, ObjCorner &corner)
+{
+    long long value = 0;
+    const char *q = parseInt(p, end, value);
+    if(q == p || value == 0)
+        return NULL;
+    corner.relative = 0;
+    corner.texcoord = corner.normal = OBJ_ABSENT;
+    // negative indices count back from the last element read so far
+    size_t counts[3] = { chunk.positions.size() / 3, chunk.texcoords.size() / 2, chunk.normals.size() / 3 };
+    int *fields[3] = { &corner.position, &corner.texcoord, &corner.normal };
+    for(int field = 0; ; )
+    {
+        if(value > 0)
+            *fields[field] = (int)(value - 1);
+        else
+        {
+            *fields[field] = (int)((long long)counts[field] + value);
+            corner.relative |= 1 << field;
+        }
+        p = q;
+        // skip fields left empty, as in "p//n"
+        do
+        {
+            if(p >= end || *p != '/' || ++field > 2)
+                return p;
+            p++;
+        } while(p < end && *p == '/');
+        if(p >= end || *p == '/' || (q = parseInt(p, end, value)) == p || value == 0)
+            return NULL;
+    }
+}
+
+void parseObjChunk(const char *p, const char *end, ObjChunk &chunk)
+{
+    ObjCorner polygon[64];
+    while(p < end)
+    {
+        p = skipLineSpace(p, end);
+        if(p + 1 < end && p[0] == 'v' && isLineSpace(p[1]))
+        {
+            float v[3] = { 0.0f, 0.0f, 0.0f };
+            const char *q = p + 1;
+            for(int i = 0; i < 3; i++)
+            {
+                const char *start = skipLineSpace(q, end);
+                q = parseFloat(start, end, v[i]);
+                if(q == start)
+                    chunk.failed = true;
+            }
+            chunk.positions.insert(chunk.positions.end(), v, v + 3);
+            p = q;
+        }
+        else if(p + 2 < end && p[0] == 'v' && (p[1] == 't' || p[1] == 'n') && isLineSpace(p[2]))
+        {
+            int count = p[1] == 't' ? 2 : 3;
+            float v[3] = { 0.0f, 0.0f, 0.0f };
+            const char *q = p + 2;
+            for(int i = 0; i < count; i++)
+            {
+                const char *start = skipLineSpace(q, end);
+                q = parseFloat(start, end, v[i]);
+                // a missing v in "vt u" is 0
+                if(q == start && !(count == 2 && i == 1))
+                    chunk.failed = true;
+            }
+            vector<float> &target = count == 2 ? chunk.texcoords : chunk.normals;
+            target.insert(target.end(), v, v + count);
+            p = q;
+        }
+        else if(p + 1 < end && p[0] == 'f' && isLineSpace(p[1]))
+        {
+            // polygons are triangulated as fans around their first corner
+            int cornerCount = 0;
+            const char *q = skipLineSpace(p + 1, end);
+            while(q < end && *q != '\n' && *q != '#')
+            {
+                if(cornerCount == 64 || (q = parseObjCorner(q, end, chunk, polygon[cornerCount++])) == NULL)
+                {
+                    chunk.failed = true;
+                    q = p;
+                    break;
+                }
+                q = skipLineSpace(q, end);
+            }
+            for(int i = 1; i + 1 < cornerCount; i++)
+            {
+                chunk.corners.push_back(polygon[0]);
+                chunk.corners.push_back(polygon[i]);
+                chunk.corners.push_back(polygon[i + 1]);
+            }
+            p = q;
+        }
+        // comments, groups, materials and smoothing groups are skipped
+        p = skipLine(p, end);
+    }
+}
+
+bool importObj(const MappedFile &file, ImportedMesh &mesh, int threadCount, ImportStats &stats)
+{
+    chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+    const char *data = (const char*)file.getData();
+    vector<size_t> ranges = splitLines(data, file.getSize(), threadCount);
+    int chunkCount = (int)ranges.size() - 1;
+    vector<ObjChunk> chunks(chunkCount);
+    runParallel(chunkCount, [&](int i) {
+        parseObjChunk(data + ranges[i], data + ranges[i + 1], chunks[i]);
+    });
+    for(int i = 0; i < chunkCount; i++)
+    {
+        if(chunks[i].failed)
+            return false;
+        if(i > 0)
+        {
+            chunks[i].positionBase = chunks[i - 1].positionBase + chunks[i - 1].positions.size() / 3;
+            chunks[i].texcoordBase = chunks[i - 1].texcoordBase + chunks[i - 1].texcoords.size() / 2;
+            chunks[i].normalBase = chunks[i - 1].normalBase + chunks[i - 1].normals.size() / 3;
+        }
+    }
+    const ObjChunk &last = chunks.back();
+    size_t positionCount = last.positionBase + last.positions.size() / 3;
+    size_t texcoordCount = last.texcoordBase + last.texcoords.size() / 2;
+    size_t normalCount = last.normalBase + last.normals.size() / 3;
+
+    // relative indices become global now that every chunk's base is known
+    vector<char> valid(chunkCount, 1);
+    runParallel(chunkCount, [&](int i) {
+        ObjChunk &chunk = chunks[i];
+        for(size_t c = 0; c < chunk.corners.size(); c++)
+        {
+            ObjCorner &corner = chunk.corners[c];
+            if(corner.relative & 1)
+                corner.position += (int)chunk.positionBase;
+            if(corner.relative & 2)
+                corner.texcoord += (int)chunk.texcoordBase;
+            if(corner.relative & 4)
+                corner.normal += (int)chunk.normalBase;
+            if(corner.position < 0 || corner.position >= (long long)positionCount
+               || (corner.texcoord != OBJ_ABSENT && (corner.texcoord < 0 || corner.texcoord >= (long long)texcoordCount))
+               || (corner.normal != OBJ_ABSENT && (corner.normal < 0 || corner.normal >= (long long)normalCount)))
+                valid[i] = 0;
+        }
+    });
+    for(int i = 0; i < chunkCount; i++)
+        if(!valid[i])
+            return false;
+    stats.parseMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+    // one vertex per distinct position/texcoord/normal triplet
+    start = chrono::high_resolution_clock::now();
+    size_t cornerCount = 0;
+    for(int i = 0; i < chunkCount; i++)
+        cornerCount += chunks[i].corners.size();
+    vector<ObjCorner> keys;     // the triplet of each vertex
+    keys.reserve(positionCount + positionCount / 4);
+    VertexIdTable unique(positionCount + positionCount / 4);
+    mesh.vertices.clear();
+    mesh.indices.clear();
+    mesh.indices.reserve(cornerCount);
+    mesh.vertices.reserve(keys.capacity() * IMPORTED_VERTEX_FLOATS);
+    vector<unsigned int> vertexPositions;   // position index of each vertex missing its normal, ~0u otherwise
+    bool missingNormals = false;
+    for(int i = 0; i < chunkCount; i++)
+    {
+        for(size_t c = 0; c < chunks[i].corners.size(); c++)
+        {
+            const ObjCorner &corner = chunks[i].corners[c];
+            unsigned int next = (unsigned int)keys.size();
+            keys.push_back(corner);
+            const ObjCorner *triplets = keys.data();
+            unsigned int vertex = unique.insert(next, [triplets](unsigned int id) {
+                const ObjCorner &k = triplets[id];
+                return mixHash((((uint64_t)(unsigned)k.position * 0x9E3779B97F4A7C15ull) ^ (unsigned)k.texcoord) * 0xC4CEB9FE1A85EC53ull ^ (unsigned)k.normal);
+            }, [triplets](unsigned int a, unsigned int b) {
+                return triplets[a].position == triplets[b].position && triplets[a].texcoord == triplets[b].texcoord && triplets[a].normal == triplets[b].normal;
+            });
+            mesh.indices.push_back(vertex);
+            if(vertex != next)
+            {
+                keys.pop_back();
+                continue;
+            }
+
+            // the element arrays stay in their chunks, find the one holding each index
+            float data[IMPORTED_VERTEX_FLOATS] = { 0.0f };
+            int k = chunkCount - 1;
+            while(chunks[k].positionBase > (size_t)corner.position)
+                k--;
+            memcpy(data, &chunks[k].positions[(corner.position - chunks[k].positionBase) * 3], 3 * sizeof(float));
+            if(corner.normal != OBJ_ABSENT)
+            {
+                for(k = chunkCount - 1; chunks[k].normalBase > (size_t)corner.normal; k--);
+                memcpy(data + 3, &chunks[k].normals[(corner.normal - chunks[k].normalBase) * 3], 3 * sizeof(float));
+                vertexPositions.push_back(~0u);
+            }
+            else
+            {
+                vertexPositions.push_back((unsigned int)corner.position);
+                missingNormals = true;
+            }
+            if(corner.texcoord != OBJ_ABSENT)
+            {
+                for(k = chunkCount - 1; chunks[k].texcoordBase > (size_t)corner.texcoord; k--);
+                memcpy(data + 6, &chunks[k].texcoords[(corner.texcoord - chunks[k].texcoordBase) * 2], 2 * sizeof(float));
+            }
+            mesh.vertices.insert(mesh.vertices.end(), data, data + IMPORTED_VERTEX_FLOATS);
+        }
+    }
+    if(missingNormals)
+    {
+        // area weighted normals gathered per position, so vertices split by texture coordinates stay smooth
+        vector<glm::vec3> normals(positionCount, glm::vec3(0.0f));
+        for(size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            const unsigned int *tri = &mesh.indices[i];
+            glm::vec3 p0 = glm::make_vec3(&mesh.vertices[tri[0] * IMPORTED_VERTEX_FLOATS]);
+            glm::vec3 n = glm::cross(glm::make_vec3(&mesh.vertices[tri[1] * IMPORTED_VERTEX_FLOATS]) - p0, glm::make_vec3(&mesh.vertices[tri[2] * IMPORTED_VERTEX_FLOATS]) - p0);
+            for(int k = 0; k < 3; k++)
+                if(vertexPositions[tri[k]] != ~0u)
+                    normals[vertexPositions[tri[k]]] += n;
+        }
+        for(size_t v = 0; v < vertexPositions.size(); v++)
+        {
+            if(vertexPositions[v] == ~0u)
+                continue;
+            float length = glm::length(normals[vertexPositions[v]]);
+            glm::vec3 n = length > 0.0f ? normals[vertexPositions[v]] / length : glm::vec3(0.0f, 1.0f, 0.0f);
+            memcpy(&mesh.vertices[v * IMPORTED_VERTEX_FLOATS + 3], &n[0], 3 * sizeof(float));
+        }
+    }
+    stats.dedupeMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    return !mesh.indices.empty();
+}
+
+// ---- PLY, ASCII and binary
+
+enum PlyType{ PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64, PLY_INVALID };
+
+struct PlyProperty{
+    string name;
+    PlyType type;
+    PlyType countType;          // PLY_INVALID unless this is a list
+    int slot;                   // of an imported vertex, for vertex properties; -1 for none
+    bool faceIndices;           // the vertex index list of a face
+};
+
+struct PlyElement{
+    string name;
+    size_t count;
+    vector<PlyProperty> properties;
+};
+
+PlyType getPlyType(const string &name)
+{
+    const char *names[] = { "char", "uchar", "short", "ushort", "int", "uint", "float", "double" };
+    const char *sizedNames[] = { "int8", "uint8", "int16", "uint16", "int32", "uint32", "float32", "float64" };
+    for(int i = 0; i < 8; i++)
+        if(name == names[i] || name == sizedNames[i])
+            return (PlyType)i;
+    return PLY_INVALID;
+}
+
+int getPlyTypeSize(PlyType type)
+{
+    const int sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+    return sizes[type];
+}
+
+double readPlyValue(const unsigned char *p, PlyType type, bool bigEndian)
+{
+    unsigned char bytes[8];
+    int size = getPlyTypeSize(type);
+    for(int i = 0; i < size; i++)
+        bytes[i] = bigEndian ? p[size - 1 - i] : p[i];
+    switch(type)
+    {
+        case PLY_INT8: return (double)(signed char)bytes[0];
+        case PLY_UINT8: return (double)bytes[0];
+        case PLY_INT16: { int16_t v; memcpy(&v, bytes, 2); return v; }
+        case PLY_UINT16: { uint16_t v; memcpy(&v, bytes, 2); return v; }
+        case PLY_INT32: { int32_t v; memcpy(&v, bytes, 4); return v; }
+        case PLY_UINT32: { uint32_t v; memcpy(&v, bytes, 4); return v; }
+        case PLY_FLOAT32: { float v; memcpy(&v, bytes, 4); return v; }
+        default: { double v; memcpy(&v, bytes, 8); return v; }
+    }
+}
+
+// which slot of an imported vertex a vertex property fills, -1 for none
+int getPlyVertexSlot(const string &name)
+{
+    const char *slots[][3] = {
+        { "x", NULL, NULL }, { "y", NULL, NULL }, { "z", NULL, NULL },
+        { "nx", NULL, NULL }, { "ny", NULL, NULL }, { "nz", NULL, NULL },
+        { "u", "s", "texture_u" }, { "v", "t", "texture_v" }
+    };
+    for(int slot = 0; slot < IMPORTED_VERTEX_FLOATS; slot++)
+        for(int i = 0; i < 3 && slots[slot][i]; i++)
+            if(name == slots[slot][i])
+                return slot;
+    return -1;
+}
+
+struct PlyHeader{
+    enum { ASCII, BINARY_LITTLE_ENDIAN, BINARY_BIG_ENDIAN } format;
+    vector<PlyElement> elements;
+    size_t size;                // bytes up to and including "end_header"'s line
+};
+
+bool parsePlyHeader(const char *data, size_t size, PlyHeader &header)
+{
+    const char *p = data, *end = data + size;
+    bool formatRead = false;
+    if(size < 4 || memcmp(data, "ply", 3) != 0)
+        return false;
+    p = skipLine(p, end);
+    while(p < end)
+    {
+        const char *eol = skipLine(p, end);
+        vector<string> words;
+        for(const char *q = skipLineSpace(p, eol); q < eol && *q != '\n'; q = skipLineSpace(q, eol))
+        {
+            const char *wordEnd = q;
+            while(wordEnd < eol && !isLineSpace(*wordEnd) && *wordEnd != '\n')
+                wordEnd++;
+            words.push_back(string(q, wordEnd));
+            q = wordEnd;
+        }
+        p = eol;
+        if(words.empty() || words[0] == "comment" || words[0] == "obj_info")
+            continue;
+        if(words[0] == "end_header")
+        {
+            header.size = p - data;
+            return formatRead;
+        }
+        if(words[0] == "format" && words.size() >= 2)
+        {
+            if(words[1] == "ascii")
+                header.format = PlyHeader::ASCII;
+            else if(words[1] == "binary_little_endian")
+                header.format = PlyHeader::BINARY_LITTLE_ENDIAN;
+            else if(words[1] == "binary_big_endian")
+                header.format = PlyHeader::BINARY_BIG_ENDIAN;
+            else
+                return false;
+            formatRead = true;
+        }
+        else if(words[0] == "element" && words.size() == 3)
+        {
+            PlyElement element;
+            element.name = words[1];
+            element.count = strtoull(words[2].c_str(), NULL, 10);
+            header.elements.push_back(element);
+        }
+        else if(words[0] == "property" && !header.elements.empty())
+        {
+            PlyProperty property;
+            if(words.size() == 5 && words[1] == "list")
+            {
+                property.countType = getPlyType(words[2]);
+                property.type = getPlyType(words[3]);
+                property.name = words[4];
+                if(property.countType == PLY_INVALID || property.countType >= PLY_FLOAT32)
+                    return false;
+            }
+            else if(words.size() == 3)
+            {
+                property.countType = PLY_INVALID;
+                property.type = getPlyType(words[1]);
+                property.name = words[2];
+            }
+            else
+                return false;
+            if(property.type == PLY_INVALID)
+                return false;
+            const string &element = header.elements.back().name;
+            property.slot = element == "vertex" && property.countType == PLY_INVALID ? getPlyVertexSlot(property.name) : -1;
+            property.faceIndices = element == "face" && property.countType != PLY_INVALID && (property.name == "vertex_indices" || property.name == "vertex_index");
+            header.elements.back().properties.push_back(property);
+        }
+        else
+            return false;
+    }
+    return false;
+}
+
+// appends the fan triangulation of a polygon, false if an index is out of range
+bool addPlyPolygon(const long long *polygon, size_t count, size_t vertexCount, vector<unsigned int> &indices)
+{
+    for(size_t i = 0; i < count; i++)
+        if(polygon[i] < 0 || polygon[i] >= (long long)vertexCount)
+            return false;
+    for(size_t i = 1; i + 1 < count; i++)
+    {
+        indices.push_back((unsigned int)polygon[0]);
+        indices.push_back((unsigned int)polygon[i]);
+        indices.push_back((unsigned int)polygon[i + 1]);
+    }
+    return true;
+}
+
+// ASCII body: one element per line. Chunks count their lines first, so every
+// chunk knows the element of each of its lines and all of them parse in parallel.
+bool importPlyAscii(const char *body, size_t size, const PlyHeader &header, int threadCount, ImportedMesh &mesh, size_t vertexCount)
+{
+    vector<size_t> ranges = splitLines(body, size, threadCount);
+    int chunkCount = (int)ranges.size() - 1;
+    vector<size_t> firstLine(chunkCount + 1, 0);
+    runParallel(chunkCount, [&](int i) {
+        size_t lines = 0;
+        for(const char *p = body + ranges[i], *end = body + ranges[i + 1]; (p = (const char*)memchr(p, '\n', end - p)) != NULL; p++)
+            lines++;
+        firstLine[i + 1] = lines;
+    });
+    for(int i = 0; i < chunkCount; i++)
+        firstLine[i + 1] += firstLine[i];
+    vector<size_t> elementLine(header.elements.size() + 1, 0);
+    for(size_t e = 0; e < header.elements.size(); e++)
+        elementLine[e + 1] = elementLine[e] + header.elements[e].count;
+
+    vector<vector<unsigned int> > faceIndices(chunkCount);
+    vector<char> valid(chunkCount, 1);
+    runParallel(chunkCount, [&](int i) {
+        const char *p = body + ranges[i], *end = body + ranges[i + 1];
+        size_t element = 0;
+        vector<long long> polygon;
+        for(size_t line = firstLine[i]; p < end && line < elementLine.back(); line++)
+        {
+            while(line >= elementLine[element + 1])
+                element++;
+            const PlyElement &e = header.elements[element];
+            const char *eol = skipLine(p, end);
+            float *vertex = e.name == "vertex" ? &mesh.vertices[(line - elementLine[element]) * IMPORTED_VERTEX_FLOATS] : NULL;
+            for(size_t k = 0; k < e.properties.size() && valid[i]; k++)
+            {
+                const PlyProperty &property = e.properties[k];
+                size_t count = 1;
+                if(property.countType != PLY_INVALID)
+                {
+                    long long listCount = 0;
+                    const char *start = skipLineSpace(p, eol);
+                    if((p = parseInt(start, eol, listCount)) == start || listCount < 0)
+                        valid[i] = 0;
+                    count = (size_t)listCount;
+                }
+                polygon.clear();
+                for(size_t c = 0; c < count && valid[i]; c++)
+                {
+                    const char *start = skipLineSpace(p, eol);
+                    if(property.faceIndices)
+                    {
+                        long long index = 0;
+                        if((p = parseInt(start, eol, index)) != start)
+                            polygon.push_back(index);
+                    }
+                    else
+                    {
+                        float value = 0.0f;
+                        p = parseFloat(start, eol, value);
+                        if(vertex && property.slot >= 0)
+                            vertex[property.slot] = value;
+                    }
+                    if(p == start)
+                        valid[i] = 0;
+                }
+                if(property.faceIndices && valid[i] && !addPlyPolygon(polygon.data(), polygon.size(), vertexCount, faceIndices[i]))
+                    valid[i] = 0;
+            }
+            p = eol;
+        }
+    });
+    for(int i = 0; i < chunkCount; i++)
+    {
+        if(!valid[i])
+            return false;
+        mesh.indices.insert(mesh.indices.end(), faceIndices[i].begin(), faceIndices[i].end());
+    }
+    return firstLine.back() + 1 >= elementLine.back();
+}
+
+// Binary body: fixed size vertex records are decoded in parallel, byte swapped for
+// big-endian files. Lists make face records variable in size, so faces are read in one pass.
+bool importPlyBinary(const unsigned char *body, size_t size, const PlyHeader &header, int threadCount, ImportedMesh &mesh, size_t vertexCount)
+{
+    bool bigEndian = header.format == PlyHeader::BINARY_BIG_ENDIAN;
+    const unsigned char *p = body, *end = body + size;
+    vector<long long> polygon;
+    for(size_t e = 0; e < header.elements.size(); e++)
+    {
+        const PlyElement &element = header.elements[e];
+        size_t recordSize = 0;
+        bool fixedSize = true;
+        for(size_t k = 0; k < element.properties.size(); k++)
+        {
+            if(element.properties[k].countType != PLY_INVALID)
+                fixedSize = false;
+            recordSize += getPlyTypeSize(element.properties[k].type);
+        }
+        if(fixedSize)
+        {
+            // divided rather than multiplied, so a huge count cannot wrap; empty records take no bytes
+            if(recordSize > 0 && element.count > (size_t)(end - p) / recordSize)
+                return false;
+            if(element.name == "vertex")
+            {
+                const unsigned char *records = p;
+                int chunkCount = element.count < 4096 ? 1 : threadCount;
+                runParallel(chunkCount, [&](int i) {
+                    size_t first = element.count * i / chunkCount, last = element.count * (i + 1) / chunkCount;
+                    for(size_t v = first; v < last; v++)
+                    {
+                        const unsigned char *record = records + v * recordSize;
+                        float *vertex = &mesh.vertices[v * IMPORTED_VERTEX_FLOATS];
+                        for(size_t k = 0; k < element.properties.size(); k++)
+                        {
+                            const PlyProperty &property = element.properties[k];
+                            if(property.slot >= 0)
+                                vertex[property.slot] = (float)readPlyValue(record, property.type, bigEndian);
+                            record += getPlyTypeSize(property.type);
+                        }
+                    }
+                });
+            }
+            p += recordSize * element.count;
+            continue;
+        }
+        for(size_t r = 0; r < element.count; r++)
+        {
+            for(size_t k = 0; k < element.properties.size(); k++)
+            {
+                const PlyProperty &property = element.properties[k];
+                size_t count = 1;
+                if(property.countType != PLY_INVALID)
+                {
+                    if(p + getPlyTypeSize(property.countType) > end)
+                        return false;
+                    double listCount = readPlyValue(p, property.countType, bigEndian);
+                    if(listCount < 0.0)
+                        return false;
+                    count = (size_t)listCount;
+                    p += getPlyTypeSize(property.countType);
+                }
+                int valueSize = getPlyTypeSize(property.type);
+                if(count * valueSize > (size_t)(end - p))
+                    return false;
+                if(property.faceIndices)
+                {
+                    polygon.resize(count);
+                    for(size_t c = 0; c < count; c++)
+                        polygon[c] = (long long)readPlyValue(p + c * valueSize, property.type, bigEndian);
+                    if(!addPlyPolygon(polygon.data(), count, vertexCount, mesh.indices))
+                        return false;
+                }
+                p += count * valueSize;
+            }
+        }
+    }
+    return true;
+}
+
+bool importPly(const MappedFile &file, ImportedMesh &mesh, int threadCount, ImportStats &stats)
+{
+    chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+    PlyHeader header;
+    if(!parsePlyHeader((const char*)file.getData(), file.getSize(), header))
+        return false;
+    size_t vertexCount = 0;
+    size_t minimumRecordSize = 1;
+    bool hasNormals = false;
+    for(size_t e = 0; e < header.elements.size(); e++)
+    {
+        if(header.elements[e].name != "vertex")
+            continue;
+        vertexCount = header.elements[e].count;
+        // an ASCII vertex takes at least a byte per property, a binary one its whole record
+        minimumRecordSize = header.format == PlyHeader::ASCII ? max(header.elements[e].properties.size(), (size_t)1) : 0;
+        for(size_t k = 0; k < header.elements[e].properties.size(); k++)
+        {
+            const PlyProperty &property = header.elements[e].properties[k];
+            // a list in a vertex element would make vertex records variable in size
+            if(property.countType != PLY_INVALID)
+                return false;
+            if(property.slot == 3)
+                hasNormals = true;
+            if(header.format != PlyHeader::ASCII)
+                minimumRecordSize += getPlyTypeSize(property.type);
+        }
+    }
+    // the header's count is checked against the body before anything is allocated for it
+    if(vertexCount == 0 || vertexCount > UINT_MAX || minimumRecordSize == 0 || vertexCount > (file.getSize() - header.size) / minimumRecordSize)
+        return false;
+    mesh.vertices.assign(vertexCount * IMPORTED_VERTEX_FLOATS, 0.0f);
+    mesh.indices.clear();
+    bool parsed;
+    if(header.format == PlyHeader::ASCII)
+        parsed = importPlyAscii((const char*)file.getData() + header.size, file.getSize() - header.size, header, threadCount, mesh, vertexCount);
+    else
+        parsed = importPlyBinary(file.getData() + header.size, file.getSize() - header.size, header, threadCount, mesh, vertexCount);
+    if(!parsed)
+        return false;
+    stats.parseMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+    // PLY is indexed already, but exporters often split every face's corners; merging
+    // them before computing missing normals also makes those normals smooth
+    start = chrono::high_resolution_clock::now();
+    dedupeVertices(mesh.vertices, mesh.indices);
+    if(!hasNormals)
+        computeVertexNormals(mesh.vertices, mesh.indices);
+    stats.dedupeMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    return !mesh.indices.empty();
+}
+
+// ---- entry points
+
+// last four characters of path in lower case, ".obj" and ".ply" are what importMesh() reads
+string getMeshExtension(const string &path)
+{
+    string extension = path.size() > 4 ? path.substr(path.size() - 4) : string();
+    for(size_t i = 0; i < extension.size(); i++)
+        extension[i] = (char)tolower(extension[i]);
+    return extension;
+}
+
+// Imports a Wavefront OBJ or PLY (ASCII or binary) file into Cube's interleaved
+// position/normal/texture layout. The mapped file is split into one chunk per thread
+// (threadCount 0: one per core), parsed in parallel, then deduped into an indexed
+// mesh in the order the vertex cache and vertex fetch prefer.
+bool importMesh(const string &path, ImportedMesh &mesh, int threadCount = 0, ImportStats *stats = NULL)
+{
+    ImportStats local;
+    if(stats == NULL)
+        stats = &local;
+    *stats = ImportStats();
+    stats->threads = getImportThreadCount(threadCount);
+
+    chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+    MappedFile file(path);
+    if(!file.isOpen())
+    {
+        cout << "mesh " << path << " could not be opened" << endl;
+        return false;
+    }
+    stats->bytes = file.getSize();
+    stats->mapMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+    string extension = getMeshExtension(path);
+    bool imported;
+    if(extension == ".obj")
+        imported = importObj(file, mesh, stats->threads, *stats);
+    else if(extension == ".ply")
+        imported = importPly(file, mesh, stats->threads, *stats);
+    else
+    {
+        cout << "mesh " << path << " is neither .obj nor .ply" << endl;
+        return false;
+    }
+    if(!imported || mesh.getVertexCount() > UINT_MAX)
+    {
+        cout << "mesh " << path << " could not be parsed" << endl;
+        mesh.vertices.clear();
+        mesh.indices.clear();
+        return false;
+    }
+
+    start = chrono::high_resolution_clock::now();
+    mesh.bounds = computeBounds(mesh.vertices);
+    optimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.getVertexCount());
+    optimizeVertexFetch(mesh.vertices.data(), mesh.indices.data(), mesh.indices.size(), mesh.getVertexCount(), IMPORTED_VERTEX_FLOATS);
+    stats->optimizeMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    return true;
+}
+
+// one level of detail: its detail is that of a UV sphere with as many triangles
+vector<MeshFileLod> getImportedMeshLods(const ImportedMesh &mesh)
+{
+    MeshFileLod lod;
+    lod.baseVertex = 0;
+    lod.vertexCount = (uint32_t)mesh.getVertexCount();
+    lod.firstIndex = 0;
+    lod.indexCount = (uint32_t)mesh.indices.size();
+    lod.detail = sqrtf((float)(mesh.indices.size() / 3));
+    return vector<MeshFileLod>(1, lod);
+}
+
+// packs into positionNormalTexture(compact); compact positions are relative to the bounds
+void packImportedMesh(const ImportedMesh &mesh, bool compact, VertexFormat &format, vector<unsigned char> &vertices, vector<unsigned char> &indices, GLenum &indexType)
+{
+    format = VertexFormat::positionNormalTexture(compact);
+    indexType = compact ? getIndexTypeFor(mesh.getVertexCount()) : GL_UNSIGNED_INT;
+    const vector<float> *source = &mesh.vertices;
+    vector<float> relative;
+    if(compact)
+    {
+        relative = mesh.vertices;
+        float scale = mesh.bounds.w > 0.0f ? 1.0f / mesh.bounds.w : 1.0f;
+        for(size_t v = 0; v < relative.size(); v += IMPORTED_VERTEX_FLOATS)
+            for(int c = 0; c < 3; c++)
+                relative[v + c] = (relative[v + c] - mesh.bounds[c]) * scale;
+        source = &relative;
+    }
+    vertices.resize(mesh.getVertexCount() * format.getStride());
+    indices.resize(mesh.indices.size() * getIndexTypeSize(indexType));
+    format.pack(source->data(), IMPORTED_VERTEX_FLOATS, mesh.getVertexCount(), vertices.data());
+    packIndices(mesh.indices.data(), mesh.indices.size(), indexType, indices.data());
+}
+
+// GL buffers for an imported mesh, draw it with getModelMatrix() of the asset
+MeshAsset* createMeshAsset(const ImportedMesh &mesh, bool compact = true)
+{
+    VertexFormat format;
+    vector<unsigned char> vertices, indices;
+    GLenum indexType;
+    packImportedMesh(mesh, compact, format, vertices, indices, indexType);
+    return new MeshAsset(format, vertices.data(), mesh.getVertexCount(), indices.data(), mesh.indices.size(), indexType, mesh.bounds, getImportedMeshLods(mesh));
+}
+
+// converts an imported mesh to a mesh file, which then loads without parsing
+bool writeMeshFile(const string &path, const ImportedMesh &mesh, bool compact = true)
+{
+    VertexFormat format;
+    vector<unsigned char> vertices, indices;
+    GLenum indexType;
+    packImportedMesh(mesh, compact, format, vertices, indices, indexType);
+    return writeMeshFile(path, format, vertices.data(), mesh.getVertexCount(), indices.data(), mesh.indices.size(), indexType, mesh.bounds, getImportedMeshLods(mesh));
+}
+
+#endif /* meshImporter_h */
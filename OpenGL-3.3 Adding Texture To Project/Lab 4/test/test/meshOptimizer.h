@@ -0,0 +1,204 @@
+//
+//  meshOptimizer.h
+//  test
+//
+
+#ifndef meshOptimizer_h
+#define meshOptimizer_h
+
+#include <vector>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+// size of the post-transform vertex cache the optimizer models (LRU)
+const int VERTEX_CACHE_SIZE = 32;
+
+struct VertexCacheStats{
+    size_t invocations;     // vertex shader invocations
+    float acmr;             // average cache miss ratio: invocations per triangle, 0.5 at best
+    float atvr;             // average transformed vertex ratio: invocations per vertex, 1.0 at best
+};
+
+// replays an index buffer through a FIFO post-transform cache of cacheSize entries
+VertexCacheStats analyzeVertexCache(const unsigned int *indices, size_t indexCount, size_t vertexCount, int cacheSize = VERTEX_CACHE_SIZE)
+{
+    VertexCacheStats stats;
+    stats.invocations = 0;
+    // a vertex is cached while fewer than cacheSize misses happened since it was loaded
+    vector<size_t> loadedAt(vertexCount, 0);
+    size_t timestamp = cacheSize + 1;
+    for(size_t i = 0; i < indexCount; i++)
+    {
+        unsigned int v = indices[i];
+        if(timestamp - loadedAt[v] > (size_t)cacheSize)
+        {
+            loadedAt[v] = timestamp++;
+            stats.invocations++;
+        }
+    }
+    stats.acmr = indexCount ? (float)stats.invocations / (indexCount / 3) : 0.0f;
+    stats.atvr = vertexCount ? (float)stats.invocations / vertexCount : 0.0f;
+    return stats;
+}
+
+// Vertex score of Tom Forsyth's "Linear-Speed Vertex Cache Optimisation": vertices
+// high in the cache score more, and so do vertices with few triangles left, so
+// the optimizer finishes off islands instead of leaving lone triangles behind.
+float forsythVertexScore(int cachePosition, int remainingTriangles)
+{
+    if(remainingTriangles == 0)
+        return -1.0f;
+    float score = 0.0f;
+    if(cachePosition >= 0)
+    {
+        // the three vertices of the triangle just emitted get a fixed, lower score
+        if(cachePosition < 3)
+            score = 0.75f;
+        else
+            score = powf(1.0f - (cachePosition - 3) * (1.0f / (VERTEX_CACHE_SIZE - 3)), 1.5f);
+    }
+    score += 2.0f * powf((float)remainingTriangles, -0.5f);
+    return score;
+}
+
+// Reorders the triangles of an indexed triangle list for the post-transform vertex
+// cache. Each step emits the best scoring triangle touching a cached vertex; when
+// none is left it continues with the next unemitted triangle in input order, which
+// keeps the whole pass linear in the number of triangles.
+void optimizeVertexCache(unsigned int *indices, size_t indexCount, size_t vertexCount)
+{
+    size_t triangleCount = indexCount / 3;
+    if(triangleCount == 0)
+        return;
+
+    // triangles using each vertex, the live ones first in each vertex's range
+    vector<unsigned int> remaining(vertexCount, 0);
+    for(size_t i = 0; i < indexCount; i++)
+        remaining[indices[i]]++;
+    vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+    for(size_t v = 0; v < vertexCount; v++)
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+    vector<unsigned int> adjacency(indexCount);
+    vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for(size_t i = 0; i < indexCount; i++)
+        adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+    vector<int> cachePosition(vertexCount, -1);
+    vector<float> vertexScore(vertexCount);
+    for(size_t v = 0; v < vertexCount; v++)
+        vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+    vector<float> triangleScore(triangleCount);
+    vector<char> emitted(triangleCount, 0);
+    for(size_t t = 0; t < triangleCount; t++)
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+    vector<unsigned int> output(triangleCount * 3);
+    int cache[VERTEX_CACHE_SIZE + 3];
+    int cacheCount = 0;
+    size_t nextInput = 0;
+    int best = -1;
+    for(size_t out = 0; out < triangleCount; out++)
+    {
+        if(best < 0)
+        {
+            while(emitted[nextInput])
+                nextInput++;
+            best = (int)nextInput;
+        }
+
+        unsigned int tri[3] = { indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2] };
+        output[out * 3] = tri[0];
+        output[out * 3 + 1] = tri[1];
+        output[out * 3 + 2] = tri[2];
+        emitted[best] = 1;
+
+        // drop the triangle from its vertices' live lists
+        for(int k = 0; k < 3; k++)
+        {
+            unsigned int v = tri[k];
+            unsigned int *list = &adjacency[adjacencyOffset[v]];
+            for(unsigned int i = 0; i < remaining[v]; i++)
+                if(list[i] == (unsigned int)best)
+                {
+                    list[i] = list[remaining[v] - 1];
+                    list[remaining[v] - 1] = best;
+                    break;
+                }
+            remaining[v]--;
+        }
+
+        // the triangle's vertices move to the front of the cache
+        int newCache[VERTEX_CACHE_SIZE + 3];
+        int newCount = 0;
+        for(int k = 0; k < 3; k++)
+            if((k < 1 || tri[k] != tri[0]) && (k < 2 || tri[k] != tri[1]))    // degenerate triangles repeat a vertex
+                newCache[newCount++] = tri[k];
+        for(int i = 0; i < cacheCount; i++)
+            if(cache[i] != (int)tri[0] && cache[i] != (int)tri[1] && cache[i] != (int)tri[2])
+                newCache[newCount++] = cache[i];
+
+        // rescore every vertex whose cache position or valence changed, and the live triangles using it
+        cacheCount = newCount < VERTEX_CACHE_SIZE ? newCount : VERTEX_CACHE_SIZE;
+        for(int i = 0; i < newCount; i++)
+        {
+            int v = newCache[i];
+            cachePosition[v] = i < cacheCount ? i : -1;
+            if(i < cacheCount)
+                cache[i] = v;
+            float score = forsythVertexScore(cachePosition[v], remaining[v]);
+            float delta = score - vertexScore[v];
+            vertexScore[v] = score;
+            for(unsigned int j = 0; j < remaining[v]; j++)
+                triangleScore[adjacency[adjacencyOffset[v] + j]] += delta;
+        }
+
+        // next triangle: the best one touching the cache
+        best = -1;
+        float bestScore = -1.0f;
+        for(int i = 0; i < cacheCount; i++)
+        {
+            int v = cache[i];
+            for(unsigned int j = 0; j < remaining[v]; j++)
+            {
+                unsigned int t = adjacency[adjacencyOffset[v] + j];
+                if(triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = (int)t;
+                }
+            }
+        }
+    }
+    // regular grids can already be in a good order, keep the input if it replays better
+    if(analyzeVertexCache(output.data(), output.size(), vertexCount).invocations < analyzeVertexCache(indices, indexCount, vertexCount).invocations)
+        memcpy(indices, output.data(), output.size() * sizeof(unsigned int));
+}
+
+// Renumbers the vertices in the order the index buffer first uses them, so vertex
+// fetches walk the buffer forward. Vertices no index refers to keep their data
+// after the referenced ones, so the vertex count does not change.
+void optimizeVertexFetch(float *vertices, unsigned int *indices, size_t indexCount, size_t vertexCount, int floatsPerVertex)
+{
+    const unsigned int UNUSED = ~0u;
+    vector<unsigned int> remap(vertexCount, UNUSED);
+    unsigned int next = 0;
+    for(size_t i = 0; i < indexCount; i++)
+    {
+        unsigned int &target = remap[indices[i]];
+        if(target == UNUSED)
+            target = next++;
+        indices[i] = target;
+    }
+    for(size_t v = 0; v < vertexCount; v++)
+        if(remap[v] == UNUSED)
+            remap[v] = next++;
+
+    vector<float> reordered(vertexCount * floatsPerVertex);
+    for(size_t v = 0; v < vertexCount; v++)
+        memcpy(&reordered[remap[v] * floatsPerVertex], &vertices[v * floatsPerVertex], floatsPerVertex * sizeof(float));
+    memcpy(vertices, reordered.data(), reordered.size() * sizeof(float));
+}
+
+#endif /* meshOptimizer_h */
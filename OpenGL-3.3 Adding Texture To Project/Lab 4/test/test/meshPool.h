@@ -0,0 +1,279 @@
+//
+//  meshPool.h
+//  test
+//
+
+#ifndef meshPool_h
+#define meshPool_h
+
+#include <glad/glad.h>
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include "shader.h"
+#include "vertexFormat.h"
+#include "cube.h"
+#include "sphere.h"
+
+using namespace std;
+
+// glad headers generated for GL 3.3 alone have no multi-draw indirect entry point
+#if defined(GL_VERSION_4_3) || defined(GL_ARB_multi_draw_indirect)
+#define HAS_MULTI_DRAW_INDIRECT
+#endif
+
+// vertex attribute location of the per-draw object index (vertexShaderForMultiDraw.vs)
+const int DRAW_OBJECT_LOCATION = 3;
+
+// one mesh's range in the pool's buffers
+struct PoolMesh{
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    int baseVertex;
+};
+
+// the layout glMultiDrawElementsIndirect reads, one per draw
+struct DrawElementsIndirectCommand{
+    unsigned int count;
+    unsigned int instanceCount;
+    unsigned int firstIndex;
+    int baseVertex;
+    unsigned int baseInstance;
+};
+
+// true when the context can take a whole draw list in one glMultiDrawElementsIndirect;
+// baseInstance, which carries the draw index, needs GL 4.2 next to the extension
+bool isMultiDrawIndirectSupported()
+{
+#if defined(GL_VERSION_4_3)
+    if(GLAD_GL_VERSION_4_3)
+        return true;
+#endif
+#if defined(GL_ARB_multi_draw_indirect) && defined(GL_VERSION_4_2)
+    if(GLAD_GL_ARB_multi_draw_indirect && GLAD_GL_VERSION_4_2)
+        return true;
+#endif
+    return false;
+}
+
+// Untextured meshes in one vertex and one index buffer behind one VAO, so any number of
+// draws of them can go out as a single multi-draw. Vertices are packed like the Cube and
+// Sphere buffers (snorm16 position, 2_10_10_10 normal), so a pooled draw writes exactly
+// the depth of the same object drawn from its own mesh, as the GL_EQUAL pass after the
+// depth pre-pass needs. Meshes are added on the CPU and uploaded on the next bind().
+class MeshPool{
+public:
+    MeshPool()
+    {
+        format = VertexFormat::positionNormal(true);
+    }
+
+    ~MeshPool()
+    {
+        if(VAO)
+        {
+            glDeleteVertexArrays(1, &VAO);
+            glDeleteBuffers(1, &VBO);
+            glDeleteBuffers(1, &EBO);
+        }
+    }
+
+    // vertexCount vertices of sourceStride floats, position then normal, and 32-bit indices
+    // starting at 0 for the mesh's first vertex; returns the mesh id
+    int addMesh(const float *vertices, int sourceStride, size_t vertexCount, const unsigned int *indices, size_t indexCount)
+    {
+        PoolMesh mesh;
+        mesh.firstIndex = (unsigned int)indexData.size();
+        mesh.indexCount = (unsigned int)indexCount;
+        mesh.baseVertex = (int)this->vertexCount;
+        vertexData.resize((this->vertexCount + vertexCount) * format.getStride());
+        format.pack(vertices, sourceStride, vertexCount, &vertexData[this->vertexCount * format.getStride()]);
+        indexData.insert(indexData.end(), indices, indices + indexCount);
+        this->vertexCount += vertexCount;
+        meshes.push_back(mesh);
+        dirty = true;
+        return (int)meshes.size() - 1;
+    }
+
+    // the unit cube of cube.h; texture coordinates are left out, so every range shares one mesh
+    int addCube()
+    {
+        if(cubeMesh >= 0)
+            return cubeMesh;
+        float vertices[24 * 8];
+        unsigned int indices[36];
+        Cube::getVertexData(0.0f, 0.0f, 1.0f, 1.0f, vertices, indices);
+        cubeMesh = addMesh(vertices, 8, 24, indices, 36);
+        return cubeMesh;
+    }
+
+    // level lod of a unit sphere of sphere.h with this tessellation
+    int addSphere(int sectors, int stacks, SphereType type, int lod = 0)
+    {
+        // a throwaway sphere that keeps its CPU copy to read the level from
+        Sphere sphere(1.0f, sectors, stacks, glm::vec3(1.0f), glm::vec3(1.0f), glm::vec3(0.5f), 32.0f, true, type);
+        lod = glm::min(lod, sphere.getLodCount() - 1);
+        return addMesh(sphere.getVertices() + sphere.getBaseVertex(lod) * 6, 6, sphere.getVertexCount(lod),
+                       sphere.getIndices() + sphere.getFirstIndex(lod), sphere.getIndexCount(lod));
+    }
+
+    // every level of that sphere, as consecutive mesh ids; returns the id of level 0
+    int addSphereLevels(int sectors, int stacks, SphereType type)
+    {
+        Sphere sphere(1.0f, sectors, stacks, glm::vec3(1.0f), glm::vec3(1.0f), glm::vec3(0.5f), 32.0f, true, type);
+        int first = getMeshCount();
+        for(int lod = 0; lod < sphere.getLodCount(); lod++)
+            addMesh(sphere.getVertices() + sphere.getBaseVertex(lod) * 6, 6, sphere.getVertexCount(lod),
+                    sphere.getIndices() + sphere.getFirstIndex(lod), sphere.getIndexCount(lod));
+        return first;
+    }
+
+    int getMeshCount() const
+    {
+        return (int)meshes.size();
+    }
+
+    const PoolMesh& getMesh(int mesh) const
+    {
+        return meshes[mesh];
+    }
+
+    // binds the pool's VAO, uploading the meshes added since the last bind
+    void bind()
+    {
+        if(!VAO)
+        {
+            glGenVertexArrays(1, &VAO);
+            glGenBuffers(1, &VBO);
+            glGenBuffers(1, &EBO);
+            glBindVertexArray(VAO);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            format.setUpAttributes();
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        }
+        else
+            glBindVertexArray(VAO);
+        if(dirty)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glBufferData(GL_ARRAY_BUFFER, vertexData.size(), vertexData.data(), GL_STATIC_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size() * sizeof(unsigned int), indexData.data(), GL_STATIC_DRAW);
+            dirty = false;
+        }
+    }
+
+private:
+    VertexFormat format;
+    vector<unsigned char> vertexData;   // packed to format
+    vector<unsigned int> indexData;
+    size_t vertexCount = 0;
+    vector<PoolMesh> meshes;
+    int cubeMesh = -1;
+    bool dirty = false;
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    unsigned int EBO = 0;
+
+    MeshPool(const MeshPool&);
+    MeshPool& operator=(const MeshPool&);
+};
+
+// The draws of one pass that use pool meshes, collected with add() and sent with draw().
+// With multi-draw indirect the commands go into a GL_DRAW_INDIRECT_BUFFER and out in one
+// glMultiDrawElementsIndirect. Each command's baseInstance is its draw index, which
+// makes the instanced DRAW_OBJECT_LOCATION attribute read that draw's object index: the
+// per-draw data is indexed by draw id without needing gl_DrawID (GL 4.6 or
+// ARB_shader_draw_parameters). Without it the same list is drawn one
+// glDrawElementsBaseVertex at a time, the object index set as a constant attribute.
+class MultiDrawList{
+public:
+    bool useIndirect;               // defaults to what the context supports
+
+    MultiDrawList(MeshPool &pool) : pool(pool)
+    {
+        useIndirect = isMultiDrawIndirectSupported();
+    }
+
+    ~MultiDrawList()
+    {
+        if(objectVBO)
+            glDeleteBuffers(1, &objectVBO);
+        if(commandBuffer)
+            glDeleteBuffers(1, &commandBuffer);
+    }
+
+    void clear()
+    {
+        commands.clear();
+        objectIndices.clear();
+    }
+
+    // one draw of a pool mesh with the transform and material of objectIndex
+    void add(int mesh, int objectIndex)
+    {
+        const PoolMesh &m = pool.getMesh(mesh);
+        DrawElementsIndirectCommand command;
+        command.count = m.indexCount;
+        command.instanceCount = 1;
+        command.firstIndex = m.firstIndex;
+        command.baseVertex = m.baseVertex;
+        command.baseInstance = (unsigned int)commands.size();
+        commands.push_back(command);
+        objectIndices.push_back(objectIndex);
+    }
+
+    int getDrawCount() const
+    {
+        return (int)commands.size();
+    }
+
+    void draw(Shader &shader)
+    {
+        if(commands.empty())
+            return;
+        shader.use();
+        pool.bind();
+#ifdef HAS_MULTI_DRAW_INDIRECT
+        if(useIndirect)
+        {
+            if(!objectVBO)
+            {
+                glGenBuffers(1, &objectVBO);
+                glGenBuffers(1, &commandBuffer);
+            }
+            // per-draw object indices, one instanced element per draw
+            glBindBuffer(GL_ARRAY_BUFFER, objectVBO);
+            glBufferData(GL_ARRAY_BUFFER, objectIndices.size() * sizeof(int), objectIndices.data(), GL_STREAM_DRAW);
+            glVertexAttribIPointer(DRAW_OBJECT_LOCATION, 1, GL_INT, 0, (void*)0);
+            glVertexAttribDivisor(DRAW_OBJECT_LOCATION, 1);
+            glEnableVertexAttribArray(DRAW_OBJECT_LOCATION);
+
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STREAM_DRAW);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0, (GLsizei)commands.size(), 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            glBindVertexArray(0);
+            return;
+        }
+#endif
+        glDisableVertexAttribArray(DRAW_OBJECT_LOCATION);
+        for(size_t i = 0; i < commands.size(); i++)
+        {
+            glVertexAttribI1i(DRAW_OBJECT_LOCATION, objectIndices[i]);
+            glDrawElementsBaseVertex(GL_TRIANGLES, commands[i].count, GL_UNSIGNED_INT, (void*)(size_t)(commands[i].firstIndex * sizeof(unsigned int)), commands[i].baseVertex);
+        }
+        glBindVertexArray(0);
+    }
+
+private:
+    MeshPool &pool;
+    vector<DrawElementsIndirectCommand> commands;
+    vector<int> objectIndices;      // per draw, read through baseInstance
+    unsigned int objectVBO = 0;
+    unsigned int commandBuffer = 0;
+
+    MultiDrawList(const MultiDrawList&);
+    MultiDrawList& operator=(const MultiDrawList&);
+};
+
+#endif /* meshPool_h */
@@ -0,0 +1,1134 @@
+//
+//  pathTracer.h
+//  test
+//
+
+#ifndef pathTracer_h
+#define pathTracer_h
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "scene.h"
+#include "stb_image.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PATH_TRACER_SSE
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define PATH_TRACER_NEON
+#endif
+
+using namespace std;
+
+// square tiles of pixels, the unit of work the threads take from each other
+const int PATH_TRACER_TILE_SIZE = 16;
+// spheres are traced at least this finely tessellated, finer than the rasterizer draws them
+const int PATH_TRACER_SPHERE_SECTORS = 96;
+const int PATH_TRACER_SPHERE_STACKS = 48;
+// BVH leaves hold up to BVH_LEAF_TRIANGLES triangles, more only where no split pays off;
+// splits are picked from BVH_BIN_COUNT SAH bins per axis
+const int BVH_LEAF_TRIANGLES = 4;
+const int BVH_MAX_LEAF_TRIANGLES = 16;
+const int BVH_BIN_COUNT = 16;
+// nodes this deep are leaves whatever they hold; traversal pushes at most one node per
+// level, so its stacks need more than BVH_MAX_DEPTH entries
+const int BVH_MAX_DEPTH = 48;
+const int BVH_STACK_SIZE = 64;
+// primary rays of a 2x2 pixel quad are traced together, one SIMD lane each
+const int RAY_PACKET_SIZE = 4;
+const float RAY_EPSILON = 1e-4f;
+const float RAY_FAR = 1e30f;
+
+// triangle as the intersection test wants it, in world space
+struct TraceTriangle{
+    glm::vec3 v0;
+    glm::vec3 edge1;
+    glm::vec3 edge2;
+};
+
+// what shading needs of a triangle, kept apart so traversal only touches positions
+struct TraceTriangleShading{
+    glm::vec3 normals[3];
+    glm::vec2 texCoords[3];
+    int material;                   // into the scene's materials, -1 for the default one
+    bool textured;
+};
+
+// 32 bytes; the first child of an inner node follows it, so only the second is stored
+struct BvhNode{
+    glm::vec3 boundsMin;
+    int offset;                     // leaf: first triangle, inner node: second child
+    glm::vec3 boundsMax;
+    int count;                      // triangles of a leaf, 0 for an inner node
+};
+
+struct TraceHit{
+    float t = RAY_FAR;
+    int triangle = -1;
+    float u = 0.0f;                 // barycentrics of vertex 1 and 2
+    float v = 0.0f;
+};
+
+// primary rays of a pixel quad with the closest hit of each, one array per component so
+// the box and triangle tests load every lane into one SSE or NEON register
+struct RayPacket{
+    float originX[RAY_PACKET_SIZE];
+    float originY[RAY_PACKET_SIZE];
+    float originZ[RAY_PACKET_SIZE];
+    float directionX[RAY_PACKET_SIZE];
+    float directionY[RAY_PACKET_SIZE];
+    float directionZ[RAY_PACKET_SIZE];
+    float inverseX[RAY_PACKET_SIZE];
+    float inverseY[RAY_PACKET_SIZE];
+    float inverseZ[RAY_PACKET_SIZE];
+    float hitT[RAY_PACKET_SIZE];
+    float hitU[RAY_PACKET_SIZE];
+    float hitV[RAY_PACKET_SIZE];
+    int hitTriangle[RAY_PACKET_SIZE];
+
+    void setRay(int lane, const glm::vec3 &origin, const glm::vec3 &direction)
+    {
+        originX[lane] = origin.x;
+        originY[lane] = origin.y;
+        originZ[lane] = origin.z;
+        directionX[lane] = direction.x;
+        directionY[lane] = direction.y;
+        directionZ[lane] = direction.z;
+        inverseX[lane] = 1.0f / direction.x;
+        inverseY[lane] = 1.0f / direction.y;
+        inverseZ[lane] = 1.0f / direction.z;
+        setHit(lane, TraceHit());
+    }
+
+    glm::vec3 getOrigin(int lane) const
+    {
+        return glm::vec3(originX[lane], originY[lane], originZ[lane]);
+    }
+
+    glm::vec3 getDirection(int lane) const
+    {
+        return glm::vec3(directionX[lane], directionY[lane], directionZ[lane]);
+    }
+
+    TraceHit getHit(int lane) const
+    {
+        TraceHit hit;
+        hit.t = hitT[lane];
+        hit.triangle = hitTriangle[lane];
+        hit.u = hitU[lane];
+        hit.v = hitV[lane];
+        return hit;
+    }
+
+    void setHit(int lane, const TraceHit &hit)
+    {
+        hitT[lane] = hit.t;
+        hitTriangle[lane] = hit.triangle;
+        hitU[lane] = hit.u;
+        hitV[lane] = hit.v;
+    }
+
+    // lanes set in mask hit triangle at t with barycentrics u, v
+    void takeHits(int mask, int triangle, const float *t, const float *u, const float *v)
+    {
+        for(int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+        {
+            if(!(mask & (1 << lane)))
+                continue;
+            hitT[lane] = t[lane];
+            hitTriangle[lane] = triangle;
+            hitU[lane] = u[lane];
+            hitV[lane] = v[lane];
+        }
+    }
+};
+
+// A scene texture on the CPU as floats, sampled as GL samples it at magnification:
+// the texture's wrap modes and nearest or bilinear filtering, without mipmaps
+struct TraceTexture{
+    int width = 0;
+    int height = 0;
+    vector<glm::vec3> texels;
+    GLenum wrapS = GL_REPEAT;
+    GLenum wrapT = GL_REPEAT;
+    bool nearest = false;
+
+    bool load(const string &path, const SceneTexture &texture)
+    {
+        // flipped like loadTexture(), so texture coordinates match
+        stbi_set_flip_vertically_on_load(true);
+        int components;
+        unsigned char *data = stbi_load(path.c_str(), &width, &height, &components, 3);
+        if(!data)
+        {
+            cout << "Texture failed to load at path: " << path << endl;
+            width = height = 0;
+            return false;
+        }
+        texels.resize((size_t)width * height);
+        for(size_t i = 0; i < texels.size(); i++)
+            texels[i] = glm::vec3(data[i * 3], data[i * 3 + 1], data[i * 3 + 2]) / 255.0f;
+        stbi_image_free(data);
+        wrapS = texture.wrapS;
+        wrapT = texture.wrapT;
+        nearest = texture.magFilter == GL_NEAREST;
+        return true;
+    }
+
+    glm::vec3 sample(const glm::vec2 &uv) const
+    {
+        // an incomplete GL texture samples black
+        if(texels.empty())
+            return glm::vec3(0.0f);
+        float x = uv.x * width - 0.5f;
+        float y = uv.y * height - 0.5f;
+        if(nearest)
+            return fetch((int)floorf(x + 0.5f), (int)floorf(y + 0.5f));
+        int x0 = (int)floorf(x);
+        int y0 = (int)floorf(y);
+        float fx = x - x0;
+        float fy = y - y0;
+        glm::vec3 bottom = glm::mix(fetch(x0, y0), fetch(x0 + 1, y0), fx);
+        glm::vec3 top = glm::mix(fetch(x0, y0 + 1), fetch(x0 + 1, y0 + 1), fx);
+        return glm::mix(bottom, top, fy);
+    }
+
+private:
+    glm::vec3 fetch(int x, int y) const
+    {
+        return texels[(size_t)wrap(y, height, wrapT) * width + wrap(x, width, wrapS)];
+    }
+
+    static int wrap(int i, int size, GLenum mode)
+    {
+        if(mode == GL_REPEAT)
+            return ((i % size) + size) % size;
+        if(mode == GL_MIRRORED_REPEAT)
+        {
+            int m = ((i % (2 * size)) + 2 * size) % (2 * size);
+            return m < size ? m : 2 * size - 1 - m;
+        }
+        return i < 0 ? 0 : (i >= size ? size - 1 : i);
+    }
+};
+
+// PCG hash random numbers, seeded from the pixel and the sample index, so an image does
+// not depend on which thread rendered which tile
+struct TraceRandom{
+    uint32_t state = 0;
+
+    void seed(uint32_t pixel, uint32_t sample)
+    {
+        state = hash(pixel ^ hash(sample));
+    }
+
+    // uniform in [0, 1)
+    float next()
+    {
+        state = hash(state);
+        return (state >> 8) * (1.0f / 16777216.0f);
+    }
+
+    static uint32_t hash(uint32_t value)
+    {
+        uint32_t state = value * 747796405u + 2891336453u;
+        uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        return (word >> 22u) ^ word;
+    }
+};
+
+// Reference renderer on the CPU: the scene's cubes, spheres and mesh files as one
+// triangle BVH, lit by the scene's own light objects with the lighting shaders' Phong
+// terms and attenuation, with shadow rays instead of shadow maps. With maxBounces 0 the
+// lights' ambient terms are added as the rasterizer does; otherwise diffuse bounces trace
+// the indirect light the ambient terms stand in for. Every renderPass() adds one sample per
+// pixel to the accumulated image, on any number of threads: the image is cut into tiles,
+// each thread renders its share and then takes what is left of the others'.
+class PathTracer{
+public:
+    int maxBounces = 3;
+    glm::vec3 background = glm::vec3(0.1f);     // the rasterizer's clear color
+
+    // triangles, textures and BVH from the scene data, no GL context needed
+    bool load(const SceneData &scene)
+    {
+        chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+        triangles.clear();
+        shading.clear();
+        materials = scene.materials;
+        textures.assign(scene.textures.size(), TraceTexture());
+        dirLight = scene.dirLight;
+        pointLights = scene.pointLights;
+        spotLight = scene.spotLight;
+        spotLightFollowsCamera = scene.spotLightFollowsCamera;
+
+        vector<glm::mat4> worldMatrices(scene.nodes.size());
+        for(size_t i = 0; i < scene.nodes.size(); i++)
+        {
+            const SceneNode &node = scene.nodes[i];
+            worldMatrices[i] = node.parent < 0 ? node.local : worldMatrices[node.parent] * node.local;
+            if(node.mesh < 0)
+                continue;
+            const SceneMesh &mesh = scene.meshes[node.mesh];
+            // spheres have no texture coordinates, as in Scene::getProgram()
+            bool textured = node.material >= 0 && scene.materials[node.material].diffuseMap >= 0 && mesh.type != SCENE_MESH_SPHERE;
+            if(textured)
+            {
+                loadTexture(scene, scene.materials[node.material].diffuseMap);
+                loadTexture(scene, scene.materials[node.material].specularMap);
+            }
+            if(mesh.type == SCENE_MESH_CUBE)
+            {
+                float vertices[24 * 8];
+                unsigned int indices[36];
+                Cube::getVertexData(mesh.textureRange.x, mesh.textureRange.y, mesh.textureRange.z, mesh.textureRange.w, vertices, indices);
+                addTriangles(vertices, 8, indices, 36, worldMatrices[i], node.material, textured);
+            }
+            else if(mesh.type == SCENE_MESH_SPHERE)
+            {
+                // every sphere type as a fine UV sphere, the closest to the exact one
+                SphereMesh::LodLevel level;
+                level.sectorCount = max(mesh.sectors, PATH_TRACER_SPHERE_SECTORS);
+                level.stackCount = max(mesh.stacks, PATH_TRACER_SPHERE_STACKS);
+                level.detail = 0;
+                level.baseVertex = 0;
+                level.vertexCount = (level.stackCount + 1) * (level.sectorCount + 1);
+                level.firstIndex = 0;
+                level.indexCount = level.sectorCount * (level.stackCount - 1) * 6;
+                vector<float> vertices(level.vertexCount * 6);
+                vector<unsigned int> indices(level.indexCount);
+                Sphere::generateLevel(UV_SPHERE, level, vertices.data(), indices.data());
+                addTriangles(vertices.data(), 6, indices.data(), indices.size(), worldMatrices[i], node.material, false);
+            }
+            else
+            {
+                // .mesh files are packed for the GPU, the tracer reads their sources
+                string path = scene.resolvePath(mesh.path);
+                string extension = getMeshExtension(path);
+                ImportedMesh imported;
+                if(extension != ".obj" && extension != ".ply")
+                    cout << "path tracer: skipping " << path << ", only .obj and .ply meshes are traced" << endl;
+                else if(importMesh(path, imported))
+                    addTriangles(imported.vertices.data(), IMPORTED_VERTEX_FLOATS, imported.indices.data(), imported.indices.size(), worldMatrices[i], node.material, textured);
+            }
+        }
+        buildBvh();
+        buildMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+        return !triangles.empty();
+    }
+
+    // the rasterizer's camera; clears the accumulated image
+    void setCamera(const glm::vec3 &position, const glm::vec3 &front, const glm::vec3 &up, float fovyDegrees)
+    {
+        cameraPosition = position;
+        cameraFront = glm::normalize(front);
+        cameraRight = glm::normalize(glm::cross(cameraFront, up));
+        cameraUp = glm::cross(cameraRight, cameraFront);
+        tanHalfFovy = tanf(glm::radians(fovyDegrees) * 0.5f);
+        if(spotLightFollowsCamera)
+        {
+            spotLight.position = position;
+            spotLight.direction = cameraFront;
+        }
+        reset();
+    }
+
+    // clears the accumulated image
+    void resize(int width, int height)
+    {
+        this->width = width;
+        this->height = height;
+        reset();
+    }
+
+    void reset()
+    {
+        accumulation.assign((size_t)width * height, glm::vec3(0.0f));
+        sampleCount = 0;
+    }
+
+    // adds one sample to every pixel on threadCount threads, every core for 0; returns the
+    // rays traced, primary, shadow and bounce rays alike
+    uint64_t renderPass(int threadCount = 0)
+    {
+        threadCount = getImportThreadCount(threadCount);
+        int tilesX = (width + PATH_TRACER_TILE_SIZE - 1) / PATH_TRACER_TILE_SIZE;
+        int tilesY = (height + PATH_TRACER_TILE_SIZE - 1) / PATH_TRACER_TILE_SIZE;
+        int tileCount = tilesX * tilesY;
+        vector<TileShare> shares(threadCount);
+        for(int i = 0; i < threadCount; i++)
+        {
+            shares[i].next = tileCount * i / threadCount;
+            shares[i].end = tileCount * (i + 1) / threadCount;
+        }
+        // shading tables for the lights, once per pass
+        spotCutOff = cosf(glm::radians(spotLight.cutOff));
+        spotOuterCutOff = cosf(glm::radians(spotLight.outerCuttOff));
+
+        atomic<uint64_t> rays(0);
+        int sample = sampleCount;
+        runParallel(threadCount, [&](int thread) {
+            uint64_t threadRays = 0;
+            for(int k = 0; k < threadCount; k++)
+            {
+                TileShare &share = shares[(thread + k) % threadCount];
+                for(int tile = share.next++; tile < share.end; tile = share.next++)
+                    renderTile(tile % tilesX, tile / tilesX, sample, threadRays);
+            }
+            rays += threadRays;
+        });
+        sampleCount++;
+        return rays;
+    }
+
+    int getSampleCount() const
+    {
+        return sampleCount;
+    }
+
+    size_t getTriangleCount() const
+    {
+        return triangles.size();
+    }
+
+    // the accumulated image as a binary PPM, clamped as the rasterizer's colors are
+    // without post-processing
+    bool writeImage(const string &path) const
+    {
+        ofstream out(path.c_str(), ios::binary);
+        if(!out)
+        {
+            cout << "image " << path << " could not be opened for writing" << endl;
+            return false;
+        }
+        out << "P6\n" << width << " " << height << "\n255\n";
+        vector<unsigned char> row((size_t)width * 3);
+        float scale = sampleCount > 0 ? 1.0f / sampleCount : 0.0f;
+        for(int y = 0; y < height; y++)
+        {
+            for(int x = 0; x < width; x++)
+            {
+                glm::vec3 color = glm::clamp(accumulation[(size_t)y * width + x] * scale, 0.0f, 1.0f);
+                for(int c = 0; c < 3; c++)
+                    row[x * 3 + c] = (unsigned char)(color[c] * 255.0f + 0.5f);
+            }
+            out.write((const char*)row.data(), row.size());
+        }
+        if(!out)
+        {
+            cout << "image " << path << " could not be written" << endl;
+            return false;
+        }
+        return true;
+    }
+
+    void report(ostream &out = cout) const
+    {
+        out << "path tracer: " << triangles.size() << " triangles, " << nodes.size() << " BVH nodes, built in " << fixed << setprecision(1) << buildMs
+            << " ms, " << width << "x" << height << ", " << sampleCount << " samples, " << maxBounces << " bounces" << endl;
+    }
+
+private:
+    // a thread's share of a pass's tiles; the others take from its front once theirs run out
+    struct alignas(64) TileShare{
+        atomic<int> next;
+        int end;
+    };
+
+    struct TraceSurface{
+        glm::vec3 position;
+        glm::vec3 normal;               // shading normal, on the side the ray came from
+        glm::vec3 geometricNormal;
+        glm::vec3 ambient;
+        glm::vec3 diffuse;
+        glm::vec3 specular;
+        float shininess;
+    };
+
+    // per triangle while the BVH is built
+    struct BvhBuild{
+        vector<int> order;
+        vector<glm::vec3> centroids;
+        vector<glm::vec3> boundsMin;
+        vector<glm::vec3> boundsMax;
+    };
+
+    struct BvhBin{
+        int count = 0;
+        glm::vec3 boundsMin = glm::vec3(RAY_FAR);
+        glm::vec3 boundsMax = glm::vec3(-RAY_FAR);
+    };
+
+    vector<TraceTriangle> triangles;
+    vector<TraceTriangleShading> shading;
+    vector<BvhNode> nodes;
+    vector<SceneMaterial> materials;
+    SceneMaterial defaultMaterial;
+    vector<TraceTexture> textures;      // empty until a node needs the texture
+    DirectionLight dirLight = DirectionLight(0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    vector<PointLight> pointLights;
+    SpotLight spotLight = SpotLight(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 12.5f, 15.0f);
+    bool spotLightFollowsCamera = false;
+    float spotCutOff = 1.0f;
+    float spotOuterCutOff = 1.0f;
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
+    glm::vec3 cameraRight = glm::vec3(1.0f, 0.0f, 0.0f);
+    glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
+    float tanHalfFovy = 1.0f;
+    int width = 0;
+    int height = 0;
+    vector<glm::vec3> accumulation;     // sums of every sample, top row first
+    int sampleCount = 0;
+    double buildMs = 0.0;
+
+    void loadTexture(const SceneData &scene, int texture)
+    {
+        if(textures[texture].width == 0)
+            textures[texture].load(scene.resolvePath(scene.textures[texture].path), scene.textures[texture]);
+    }
+
+    // indexed triangles of stride floats per vertex: position, normal, then texture coordinates if stride >= 8
+    void addTriangles(const float *vertices, int stride, const unsigned int *indices, size_t indexCount, const glm::mat4 &model, int material, bool textured)
+    {
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+        for(size_t i = 0; i + 2 < indexCount; i += 3)
+        {
+            glm::vec3 p[3];
+            TraceTriangleShading s;
+            for(int c = 0; c < 3; c++)
+            {
+                const float *v = vertices + (size_t)indices[i + c] * stride;
+                p[c] = glm::vec3(model * glm::vec4(v[0], v[1], v[2], 1.0f));
+                s.normals[c] = glm::normalize(normalMatrix * glm::vec3(v[3], v[4], v[5]));
+                s.texCoords[c] = stride >= 8 ? glm::vec2(v[6], v[7]) : glm::vec2(0.0f);
+            }
+            s.material = material;
+            s.textured = textured;
+            TraceTriangle triangle = { p[0], p[1] - p[0], p[2] - p[0] };
+            // degenerate triangles can never be hit
+            if(glm::dot(glm::cross(triangle.edge1, triangle.edge2), glm::cross(triangle.edge1, triangle.edge2)) == 0.0f)
+                continue;
+            triangles.push_back(triangle);
+            shading.push_back(s);
+        }
+    }
+
+    // ---- BVH
+
+    void buildBvh()
+    {
+        nodes.clear();
+        size_t count = triangles.size();
+        if(count == 0)
+            return;
+        BvhBuild build;
+        build.order.resize(count);
+        build.centroids.resize(count);
+        build.boundsMin.resize(count);
+        build.boundsMax.resize(count);
+        for(size_t i = 0; i < count; i++)
+        {
+            const TraceTriangle &t = triangles[i];
+            glm::vec3 p1 = t.v0 + t.edge1;
+            glm::vec3 p2 = t.v0 + t.edge2;
+            build.order[i] = (int)i;
+            build.boundsMin[i] = glm::min(t.v0, glm::min(p1, p2));
+            build.boundsMax[i] = glm::max(t.v0, glm::max(p1, p2));
+            build.centroids[i] = (build.boundsMin[i] + build.boundsMax[i]) * 0.5f;
+        }
+        nodes.reserve(count * 2);
+        buildNode(build, 0, (int)count, 0);
+
+        // triangles in leaf order, so every leaf's are contiguous
+        vector<TraceTriangle> sortedTriangles(count);
+        vector<TraceTriangleShading> sortedShading(count);
+        for(size_t i = 0; i < count; i++)
+        {
+            sortedTriangles[i] = triangles[build.order[i]];
+            sortedShading[i] = shading[build.order[i]];
+        }
+        triangles.swap(sortedTriangles);
+        shading.swap(sortedShading);
+    }
+
+    static float surfaceArea(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax)
+    {
+        glm::vec3 e = boundsMax - boundsMin;
+        return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+
+    // node over build.order[first, first + count), split where the surface area heuristic
+    // says tracing is cheapest; returns its index
+    int buildNode(BvhBuild &build, int first, int count, int depth)
+    {
+        int index = (int)nodes.size();
+        nodes.push_back(BvhNode());
+        glm::vec3 boundsMin(RAY_FAR), boundsMax(-RAY_FAR), centroidMin(RAY_FAR), centroidMax(-RAY_FAR);
+        for(int i = first; i < first + count; i++)
+        {
+            int t = build.order[i];
+            boundsMin = glm::min(boundsMin, build.boundsMin[t]);
+            boundsMax = glm::max(boundsMax, build.boundsMax[t]);
+            centroidMin = glm::min(centroidMin, build.centroids[t]);
+            centroidMax = glm::max(centroidMax, build.centroids[t]);
+        }
+        nodes[index].boundsMin = boundsMin;
+        nodes[index].boundsMax = boundsMax;
+        nodes[index].offset = first;
+        nodes[index].count = count;
+        if(count <= BVH_LEAF_TRIANGLES || depth >= BVH_MAX_DEPTH)
+            return index;
+
+        // costs in triangle tests: a leaf tests all of them, a split one box plus each side
+        // weighted by how likely a ray through this node enters it
+        float parentArea = surfaceArea(boundsMin, boundsMax);
+        float bestCost = (float)count;
+        int bestAxis = -1;
+        int bestBin = 0;
+        glm::vec3 extent = centroidMax - centroidMin;
+        for(int axis = 0; axis < 3; axis++)
+        {
+            if(extent[axis] <= 0.0f)
+                continue;
+            BvhBin bins[BVH_BIN_COUNT];
+            float scale = BVH_BIN_COUNT / extent[axis];
+            for(int i = first; i < first + count; i++)
+            {
+                int t = build.order[i];
+                int b = min((int)((build.centroids[t][axis] - centroidMin[axis]) * scale), BVH_BIN_COUNT - 1);
+                bins[b].count++;
+                bins[b].boundsMin = glm::min(bins[b].boundsMin, build.boundsMin[t]);
+                bins[b].boundsMax = glm::max(bins[b].boundsMax, build.boundsMax[t]);
+            }
+            // right sides swept from the end, left sides on the way back
+            float rightCost[BVH_BIN_COUNT];
+            BvhBin right;
+            for(int b = BVH_BIN_COUNT - 1; b > 0; b--)
+            {
+                right.count += bins[b].count;
+                right.boundsMin = glm::min(right.boundsMin, bins[b].boundsMin);
+                right.boundsMax = glm::max(right.boundsMax, bins[b].boundsMax);
+                rightCost[b - 1] = right.count > 0 ? right.count * surfaceArea(right.boundsMin, right.boundsMax) : 0.0f;
+            }
+            BvhBin left;
+            for(int b = 0; b < BVH_BIN_COUNT - 1; b++)
+            {
+                left.count += bins[b].count;
+                left.boundsMin = glm::min(left.boundsMin, bins[b].boundsMin);
+                left.boundsMax = glm::max(left.boundsMax, bins[b].boundsMax);
+                if(left.count == 0 || left.count == count)
+                    continue;
+                float cost = 1.0f + (left.count * surfaceArea(left.boundsMin, left.boundsMax) + rightCost[b]) / parentArea;
+                if(cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = b;
+                }
+            }
+        }
+        if(bestAxis < 0 && count <= BVH_MAX_LEAF_TRIANGLES)
+            return index;
+
+        int middle;
+        if(bestAxis >= 0)
+        {
+            float scale = BVH_BIN_COUNT / extent[bestAxis];
+            float minimum = centroidMin[bestAxis];
+            int *split = partition(&build.order[first], &build.order[first] + count, [&](int t) {
+                return min((int)((build.centroids[t][bestAxis] - minimum) * scale), BVH_BIN_COUNT - 1) <= bestBin;
+            });
+            middle = (int)(split - &build.order[0]);
+        }
+        else
+        {
+            // no split pays off but the leaf would be too big: halves along the widest axis
+            int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+            middle = first + count / 2;
+            nth_element(&build.order[first], &build.order[middle], &build.order[first] + count, [&](int a, int b) {
+                return build.centroids[a][axis] < build.centroids[b][axis];
+            });
+        }
+        buildNode(build, first, middle - first, depth + 1);
+        int second = buildNode(build, middle, first + count - middle, depth + 1);
+        nodes[index].offset = second;
+        nodes[index].count = 0;
+        return index;
+    }
+
+    // ---- traversal
+
+    static bool intersectBounds(const BvhNode &node, const glm::vec3 &origin, const glm::vec3 &inverseDirection, float tMax, float &entry)
+    {
+        glm::vec3 t0 = (node.boundsMin - origin) * inverseDirection;
+        glm::vec3 t1 = (node.boundsMax - origin) * inverseDirection;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+        entry = fmaxf(fmaxf(tNear.x, tNear.y), fmaxf(tNear.z, 0.0f));
+        return entry <= fminf(fminf(tFar.x, tFar.y), fminf(tFar.z, tMax));
+    }
+
+    // whether any lane enters the node before its closest hit so far; entry is the nearest.
+    // All four lanes are tested at once with SSE or NEON, one at a time elsewhere.
+    static bool intersectBounds(const BvhNode &node, const RayPacket &packet, float &entry)
+    {
+#if defined(PATH_TRACER_SSE)
+        __m128 originX = _mm_loadu_ps(packet.originX);
+        __m128 originY = _mm_loadu_ps(packet.originY);
+        __m128 originZ = _mm_loadu_ps(packet.originZ);
+        __m128 x0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin.x), originX), _mm_loadu_ps(packet.inverseX));
+        __m128 x1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax.x), originX), _mm_loadu_ps(packet.inverseX));
+        __m128 y0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin.y), originY), _mm_loadu_ps(packet.inverseY));
+        __m128 y1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax.y), originY), _mm_loadu_ps(packet.inverseY));
+        __m128 z0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin.z), originZ), _mm_loadu_ps(packet.inverseZ));
+        __m128 z1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax.z), originZ), _mm_loadu_ps(packet.inverseZ));
+        __m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)), _mm_max_ps(_mm_min_ps(z0, z1), _mm_setzero_ps()));
+        __m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)), _mm_min_ps(_mm_max_ps(z0, z1), _mm_loadu_ps(packet.hitT)));
+        __m128 hit = _mm_cmple_ps(tNear, tFar);
+        if(!_mm_movemask_ps(hit))
+            return false;
+        // lanes that miss enter at RAY_FAR, then the minimum of the four
+        __m128 entries = _mm_or_ps(_mm_and_ps(hit, tNear), _mm_andnot_ps(hit, _mm_set1_ps(RAY_FAR)));
+        entries = _mm_min_ps(entries, _mm_shuffle_ps(entries, entries, _MM_SHUFFLE(2, 3, 0, 1)));
+        entries = _mm_min_ps(entries, _mm_shuffle_ps(entries, entries, _MM_SHUFFLE(1, 0, 3, 2)));
+        entry = _mm_cvtss_f32(entries);
+        return true;
+#elif defined(PATH_TRACER_NEON)
+        float32x4_t originX = vld1q_f32(packet.originX);
+        float32x4_t originY = vld1q_f32(packet.originY);
+        float32x4_t originZ = vld1q_f32(packet.originZ);
+        float32x4_t x0 = vmulq_f32(vsubq_f32(vdupq_n_f32(node.boundsMin.x), originX), vld1q_f32(packet.inverseX));
+        float32x4_t x1 = vmulq_f32(vsubq_f32(vdupq_n_f32(node.boundsMax.x), originX), vld1q_f32(packet.inverseX));
+        float32x4_t y0 = vmulq_f32(vsubq_f32(vdupq_n_f32(node.boundsMin.y), originY), vld1q_f32(packet.inverseY));
+        float32x4_t y1 = vmulq_f32(vsubq_f32(vdupq_n_f32(node.boundsMax.y), originY), vld1q_f32(packet.inverseY));
+        float32x4_t z0 = vmulq_f32(vsubq_f32(vdupq_n_f32(node.boundsMin.z), originZ), vld1q_f32(packet.inverseZ));
+        float32x4_t z1 = vmulq_f32(vsubq_f32(vdupq_n_f32(node.boundsMax.z), originZ), vld1q_f32(packet.inverseZ));
+        float32x4_t tNear = vmaxq_f32(vmaxq_f32(vminq_f32(x0, x1), vminq_f32(y0, y1)), vmaxq_f32(vminq_f32(z0, z1), vdupq_n_f32(0.0f)));
+        float32x4_t tFar = vminq_f32(vminq_f32(vmaxq_f32(x0, x1), vmaxq_f32(y0, y1)), vminq_f32(vmaxq_f32(z0, z1), vld1q_f32(packet.hitT)));
+        uint32x4_t hit = vcleq_f32(tNear, tFar);
+        if(!vmaxvq_u32(hit))
+            return false;
+        entry = vminvq_f32(vbslq_f32(hit, tNear, vdupq_n_f32(RAY_FAR)));
+        return true;
+#else
+        bool any = false;
+        entry = RAY_FAR;
+        for(int i = 0; i < RAY_PACKET_SIZE; i++)
+        {
+            float x0 = (node.boundsMin.x - packet.originX[i]) * packet.inverseX[i];
+            float x1 = (node.boundsMax.x - packet.originX[i]) * packet.inverseX[i];
+            float y0 = (node.boundsMin.y - packet.originY[i]) * packet.inverseY[i];
+            float y1 = (node.boundsMax.y - packet.originY[i]) * packet.inverseY[i];
+            float z0 = (node.boundsMin.z - packet.originZ[i]) * packet.inverseZ[i];
+            float z1 = (node.boundsMax.z - packet.originZ[i]) * packet.inverseZ[i];
+            float tNear = fmaxf(fmaxf(fminf(x0, x1), fminf(y0, y1)), fmaxf(fminf(z0, z1), 0.0f));
+            float tFar = fminf(fminf(fmaxf(x0, x1), fmaxf(y0, y1)), fminf(fmaxf(z0, z1), packet.hitT[i]));
+            bool hit = tNear <= tFar;
+            any |= hit;
+            entry = hit ? fminf(entry, tNear) : entry;
+        }
+        return any;
+#endif
+    }
+
+    // Moller-Trumbore; updates hit if the triangle is closer
+    static void intersectTriangle(const TraceTriangle &triangle, int index, const glm::vec3 &origin, const glm::vec3 &direction, TraceHit &hit)
+    {
+        glm::vec3 p = glm::cross(direction, triangle.edge2);
+        float determinant = glm::dot(triangle.edge1, p);
+        if(fabsf(determinant) < 1e-12f)
+            return;
+        float inverseDeterminant = 1.0f / determinant;
+        glm::vec3 s = origin - triangle.v0;
+        float u = glm::dot(s, p) * inverseDeterminant;
+        if(u < 0.0f || u > 1.0f)
+            return;
+        glm::vec3 q = glm::cross(s, triangle.edge1);
+        float v = glm::dot(direction, q) * inverseDeterminant;
+        if(v < 0.0f || u + v > 1.0f)
+            return;
+        float t = glm::dot(triangle.edge2, q) * inverseDeterminant;
+        if(t <= RAY_EPSILON || t >= hit.t)
+            return;
+        hit.t = t;
+        hit.triangle = index;
+        hit.u = u;
+        hit.v = v;
+    }
+
+    // the same test for every lane of the packet, four at once with SSE or NEON
+    static void intersectTriangle(const TraceTriangle &triangle, int index, RayPacket &packet)
+    {
+#if defined(PATH_TRACER_SSE)
+        __m128 dx = _mm_loadu_ps(packet.directionX);
+        __m128 dy = _mm_loadu_ps(packet.directionY);
+        __m128 dz = _mm_loadu_ps(packet.directionZ);
+        __m128 e1x = _mm_set1_ps(triangle.edge1.x), e1y = _mm_set1_ps(triangle.edge1.y), e1z = _mm_set1_ps(triangle.edge1.z);
+        __m128 e2x = _mm_set1_ps(triangle.edge2.x), e2y = _mm_set1_ps(triangle.edge2.y), e2z = _mm_set1_ps(triangle.edge2.z);
+        // p = direction x edge2
+        __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        __m128 inverseDeterminant = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+        __m128 sx = _mm_sub_ps(_mm_loadu_ps(packet.originX), _mm_set1_ps(triangle.v0.x));
+        __m128 sy = _mm_sub_ps(_mm_loadu_ps(packet.originY), _mm_set1_ps(triangle.v0.y));
+        __m128 sz = _mm_sub_ps(_mm_loadu_ps(packet.originZ), _mm_set1_ps(triangle.v0.z));
+        __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverseDeterminant);
+        // q = s x edge1
+        __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverseDeterminant);
+        __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDeterminant);
+        __m128 zero = _mm_setzero_ps();
+        __m128 hit = _mm_cmpge_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), determinant), _mm_set1_ps(1e-12f));
+        hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero)));
+        hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+        hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpgt_ps(t, _mm_set1_ps(RAY_EPSILON)), _mm_cmplt_ps(t, _mm_loadu_ps(packet.hitT))));
+        int mask = _mm_movemask_ps(hit);
+        if(!mask)
+            return;
+        float hitT[RAY_PACKET_SIZE], hitU[RAY_PACKET_SIZE], hitV[RAY_PACKET_SIZE];
+        _mm_storeu_ps(hitT, t);
+        _mm_storeu_ps(hitU, u);
+        _mm_storeu_ps(hitV, v);
+        packet.takeHits(mask, index, hitT, hitU, hitV);
+#elif defined(PATH_TRACER_NEON)
+        float32x4_t dx = vld1q_f32(packet.directionX);
+        float32x4_t dy = vld1q_f32(packet.directionY);
+        float32x4_t dz = vld1q_f32(packet.directionZ);
+        float32x4_t e1x = vdupq_n_f32(triangle.edge1.x), e1y = vdupq_n_f32(triangle.edge1.y), e1z = vdupq_n_f32(triangle.edge1.z);
+        float32x4_t e2x = vdupq_n_f32(triangle.edge2.x), e2y = vdupq_n_f32(triangle.edge2.y), e2z = vdupq_n_f32(triangle.edge2.z);
+        // p = direction x edge2
+        float32x4_t px = vsubq_f32(vmulq_f32(dy, e2z), vmulq_f32(dz, e2y));
+        float32x4_t py = vsubq_f32(vmulq_f32(dz, e2x), vmulq_f32(dx, e2z));
+        float32x4_t pz = vsubq_f32(vmulq_f32(dx, e2y), vmulq_f32(dy, e2x));
+        float32x4_t determinant = vaddq_f32(vaddq_f32(vmulq_f32(e1x, px), vmulq_f32(e1y, py)), vmulq_f32(e1z, pz));
+        float32x4_t inverseDeterminant = vdivq_f32(vdupq_n_f32(1.0f), determinant);
+        float32x4_t sx = vsubq_f32(vld1q_f32(packet.originX), vdupq_n_f32(triangle.v0.x));
+        float32x4_t sy = vsubq_f32(vld1q_f32(packet.originY), vdupq_n_f32(triangle.v0.y));
+        float32x4_t sz = vsubq_f32(vld1q_f32(packet.originZ), vdupq_n_f32(triangle.v0.z));
+        float32x4_t u = vmulq_f32(vaddq_f32(vaddq_f32(vmulq_f32(sx, px), vmulq_f32(sy, py)), vmulq_f32(sz, pz)), inverseDeterminant);
+        // q = s x edge1
+        float32x4_t qx = vsubq_f32(vmulq_f32(sy, e1z), vmulq_f32(sz, e1y));
+        float32x4_t qy = vsubq_f32(vmulq_f32(sz, e1x), vmulq_f32(sx, e1z));
+        float32x4_t qz = vsubq_f32(vmulq_f32(sx, e1y), vmulq_f32(sy, e1x));
+        float32x4_t v = vmulq_f32(vaddq_f32(vaddq_f32(vmulq_f32(dx, qx), vmulq_f32(dy, qy)), vmulq_f32(dz, qz)), inverseDeterminant);
+        float32x4_t t = vmulq_f32(vaddq_f32(vaddq_f32(vmulq_f32(e2x, qx), vmulq_f32(e2y, qy)), vmulq_f32(e2z, qz)), inverseDeterminant);
+        float32x4_t zero = vdupq_n_f32(0.0f);
+        uint32x4_t hit = vcgeq_f32(vabsq_f32(determinant), vdupq_n_f32(1e-12f));
+        hit = vandq_u32(hit, vandq_u32(vcgeq_f32(u, zero), vcgeq_f32(v, zero)));
+        hit = vandq_u32(hit, vcleq_f32(vaddq_f32(u, v), vdupq_n_f32(1.0f)));
+        hit = vandq_u32(hit, vandq_u32(vcgtq_f32(t, vdupq_n_f32(RAY_EPSILON)), vcltq_f32(t, vld1q_f32(packet.hitT))));
+        if(!vmaxvq_u32(hit))
+            return;
+        uint32_t lanes[RAY_PACKET_SIZE];
+        vst1q_u32(lanes, hit);
+        int mask = 0;
+        for(int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+            mask |= (lanes[lane] & 1) << lane;
+        float hitT[RAY_PACKET_SIZE], hitU[RAY_PACKET_SIZE], hitV[RAY_PACKET_SIZE];
+        vst1q_f32(hitT, t);
+        vst1q_f32(hitU, u);
+        vst1q_f32(hitV, v);
+        packet.takeHits(mask, index, hitT, hitU, hitV);
+#else
+        for(int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+        {
+            TraceHit hit = packet.getHit(lane);
+            intersectTriangle(triangle, index, packet.getOrigin(lane), packet.getDirection(lane), hit);
+            packet.setHit(lane, hit);
+        }
+#endif
+    }
+
+    // closest hit before hit.t, or with anyHit the first one found, for shadow rays
+    bool intersect(const glm::vec3 &origin, const glm::vec3 &direction, TraceHit &hit, bool anyHit = false) const
+    {
+        glm::vec3 inverseDirection = 1.0f / direction;
+        float entry;
+        if(nodes.empty() || !intersectBounds(nodes[0], origin, inverseDirection, hit.t, entry))
+            return false;
+        int stack[BVH_STACK_SIZE];
+        float stackEntry[BVH_STACK_SIZE];
+        int top = 0;
+        int node = 0;
+        while(true)
+        {
+            const BvhNode &n = nodes[node];
+            if(n.count > 0)
+            {
+                for(int i = n.offset; i < n.offset + n.count; i++)
+                    intersectTriangle(triangles[i], i, origin, direction, hit);
+                if(anyHit && hit.triangle >= 0)
+                    return true;
+            }
+            else
+            {
+                // nearer child first, the other one waits on the stack
+                int near = node + 1;
+                int far = n.offset;
+                float nearEntry, farEntry;
+                bool hitNear = intersectBounds(nodes[near], origin, inverseDirection, hit.t, nearEntry);
+                bool hitFar = intersectBounds(nodes[far], origin, inverseDirection, hit.t, farEntry);
+                if(hitNear && hitFar)
+                {
+                    if(farEntry < nearEntry)
+                    {
+                        swap(near, far);
+                        swap(nearEntry, farEntry);
+                    }
+                    stack[top] = far;
+                    stackEntry[top++] = farEntry;
+                    node = near;
+                    continue;
+                }
+                if(hitNear || hitFar)
+                {
+                    node = hitNear ? near : far;
+                    continue;
+                }
+            }
+            // nodes that were pushed before a closer hit was found are skipped
+            while(top > 0 && stackEntry[top - 1] > hit.t)
+                top--;
+            if(top == 0)
+                break;
+            node = stack[--top];
+        }
+        return hit.triangle >= 0;
+    }
+
+    // the packet walks the tree once, into every node any lane enters
+    void intersect(RayPacket &packet) const
+    {
+        float entry;
+        if(nodes.empty() || !intersectBounds(nodes[0], packet, entry))
+            return;
+        int stack[BVH_STACK_SIZE];
+        int top = 0;
+        int node = 0;
+        while(true)
+        {
+            const BvhNode &n = nodes[node];
+            if(n.count > 0)
+            {
+                for(int i = n.offset; i < n.offset + n.count; i++)
+                    intersectTriangle(triangles[i], i, packet);
+            }
+            else
+            {
+                int near = node + 1;
+                int far = n.offset;
+                float nearEntry, farEntry;
+                bool hitNear = intersectBounds(nodes[near], packet, nearEntry);
+                bool hitFar = intersectBounds(nodes[far], packet, farEntry);
+                if(hitNear && hitFar)
+                {
+                    if(farEntry < nearEntry)
+                        swap(near, far);
+                    stack[top++] = far;
+                    node = near;
+                    continue;
+                }
+                if(hitNear || hitFar)
+                {
+                    node = hitNear ? near : far;
+                    continue;
+                }
+            }
+            // popped nodes are tested again, the lanes may have found closer hits since
+            bool found = false;
+            while(top > 0 && !found)
+            {
+                node = stack[--top];
+                found = intersectBounds(nodes[node], packet, entry);
+            }
+            if(!found)
+                break;
+        }
+    }
+
+    // ---- shading
+
+    void getSurface(const glm::vec3 &origin, const glm::vec3 &direction, const TraceHit &hit, TraceSurface &surface) const
+    {
+        const TraceTriangle &triangle = triangles[hit.triangle];
+        const TraceTriangleShading &s = shading[hit.triangle];
+        float w = 1.0f - hit.u - hit.v;
+        surface.position = origin + direction * hit.t;
+        surface.geometricNormal = glm::normalize(glm::cross(triangle.edge1, triangle.edge2));
+        if(glm::dot(surface.geometricNormal, direction) > 0.0f)
+            surface.geometricNormal = -surface.geometricNormal;
+        surface.normal = glm::normalize(s.normals[0] * w + s.normals[1] * hit.u + s.normals[2] * hit.v);
+        if(glm::dot(surface.normal, surface.geometricNormal) < 0.0f)
+            surface.normal = -surface.normal;
+
+        const SceneMaterial &material = s.material >= 0 ? materials[s.material] : defaultMaterial;
+        if(s.textured)
+        {
+            // as the textured lighting shader: the diffuse map is the ambient color too
+            glm::vec2 uv = s.texCoords[0] * w + s.texCoords[1] * hit.u + s.texCoords[2] * hit.v;
+            surface.diffuse = textures[material.diffuseMap].sample(uv);
+            surface.ambient = surface.diffuse;
+            surface.specular = textures[material.specularMap].sample(uv);
+        }
+        else
+        {
+            surface.ambient = material.ambient;
+            surface.diffuse = material.diffuse;
+            surface.specular = material.specular;
+        }
+        surface.shininess = material.shininess;
+    }
+
+    // diffuse and specular of one light arriving from L, unless something nearer than distance blocks it
+    glm::vec3 shadeLight(const TraceSurface &surface, const glm::vec3 &V, const glm::vec3 &L, float distance, const glm::vec3 &diffuse, const glm::vec3 &specular, uint64_t &rays) const
+    {
+        float NdotL = glm::dot(surface.normal, L);
+        if(NdotL <= 0.0f || glm::dot(surface.geometricNormal, L) <= 0.0f)
+            return glm::vec3(0.0f);
+        TraceHit shadow;
+        shadow.t = distance;
+        rays++;
+        if(intersect(surface.position + surface.geometricNormal * RAY_EPSILON, L, shadow, true))
+            return glm::vec3(0.0f);
+        glm::vec3 R = glm::reflect(-L, surface.normal);
+        return surface.diffuse * NdotL * diffuse + surface.specular * powf(fmaxf(glm::dot(V, R), 0.0f), surface.shininess) * specular;
+    }
+
+    // every light of the scene, with the attenuation and spot cone of the lighting shaders
+    glm::vec3 shadeDirect(const TraceSurface &surface, const glm::vec3 &V, bool ambientTerms, uint64_t &rays) const
+    {
+        glm::vec3 ambient = dirLight.ambient;
+        glm::vec3 result = shadeLight(surface, V, glm::normalize(-dirLight.direction), RAY_FAR, dirLight.diffuse, dirLight.specular, rays);
+        for(size_t i = 0; i < pointLights.size(); i++)
+        {
+            const PointLight &light = pointLights[i];
+            glm::vec3 toLight = light.position - surface.position;
+            float d = glm::length(toLight);
+            float attenuation = 1.0f / (light.k_c + light.k_l * d + light.k_q * (d * d));
+            ambient += light.ambient * attenuation;
+            result += shadeLight(surface, V, toLight / d, d, light.diffuse * attenuation, light.specular * attenuation, rays);
+        }
+        glm::vec3 toSpot = spotLight.position - surface.position;
+        float d = glm::length(toSpot);
+        glm::vec3 L = toSpot / d;
+        float attenuation = 1.0f / (spotLight.k_c + spotLight.k_l * d + spotLight.k_q * (d * d));
+        float theta = glm::dot(L, glm::normalize(-spotLight.direction));
+        float intensity = glm::clamp((theta - spotOuterCutOff) / (spotCutOff - spotOuterCutOff), 0.0f, 1.0f);
+        ambient += spotLight.ambient * attenuation * intensity;
+        if(intensity > 0.0f)
+            result += shadeLight(surface, V, L, d, spotLight.diffuse * attenuation * intensity, spotLight.specular * attenuation * intensity, rays);
+        if(ambientTerms)
+            result += surface.ambient * ambient;
+        return result;
+    }
+
+    static glm::vec3 sampleCosine(const glm::vec3 &N, TraceRandom &random)
+    {
+        float r = sqrtf(random.next());
+        float phi = 2.0f * PI * random.next();
+        glm::vec3 tangent = glm::normalize(glm::cross(fabsf(N.x) > 0.9f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f), N));
+        glm::vec3 bitangent = glm::cross(N, tangent);
+        return glm::normalize(tangent * (r * cosf(phi)) + bitangent * (r * sinf(phi)) + N * sqrtf(fmaxf(0.0f, 1.0f - r * r)));
+    }
+
+    // radiance along a ray whose first hit is already known
+    glm::vec3 tracePath(glm::vec3 origin, glm::vec3 direction, TraceHit hit, TraceRandom &random, uint64_t &rays) const
+    {
+        glm::vec3 radiance(0.0f);
+        glm::vec3 throughput(1.0f);
+        for(int bounce = 0; ; bounce++)
+        {
+            if(hit.triangle < 0)
+            {
+                // the background is a backdrop, not a light
+                if(bounce == 0)
+                    radiance += background;
+                break;
+            }
+            TraceSurface surface;
+            getSurface(origin, direction, hit, surface);
+            radiance += throughput * shadeDirect(surface, -direction, maxBounces == 0, rays);
+            if(bounce >= maxBounces)
+                break;
+
+            // diffuse bounce, cosine weighted: the cosine and the pdf cancel, the albedo is left
+            throughput *= surface.diffuse;
+            if(bounce >= 2)
+            {
+                float survival = glm::clamp(fmaxf(throughput.x, fmaxf(throughput.y, throughput.z)), 0.05f, 0.95f);
+                if(random.next() >= survival)
+                    break;
+                throughput /= survival;
+            }
+            origin = surface.position + surface.geometricNormal * RAY_EPSILON;
+            direction = sampleCosine(surface.normal, random);
+            if(glm::dot(direction, surface.geometricNormal) <= 0.0f)
+                break;
+            hit = TraceHit();
+            rays++;
+            intersect(origin, direction, hit);
+        }
+        return radiance;
+    }
+
+    glm::vec3 getPrimaryDirection(float x, float y) const
+    {
+        float ndcX = x / width * 2.0f - 1.0f;
+        float ndcY = 1.0f - y / height * 2.0f;
+        float aspect = (float)width / (float)height;
+        return glm::normalize(cameraFront + cameraRight * (ndcX * tanHalfFovy * aspect) + cameraUp * (ndcY * tanHalfFovy));
+    }
+
+    // one jittered sample per pixel, primary rays a pixel quad at a time
+    void renderTile(int tileX, int tileY, int sample, uint64_t &rays)
+    {
+        int x0 = tileX * PATH_TRACER_TILE_SIZE;
+        int y0 = tileY * PATH_TRACER_TILE_SIZE;
+        int x1 = min(x0 + PATH_TRACER_TILE_SIZE, width);
+        int y1 = min(y0 + PATH_TRACER_TILE_SIZE, height);
+        for(int y = y0; y < y1; y += 2)
+            for(int x = x0; x < x1; x += 2)
+            {
+                RayPacket packet;
+                int pixels[RAY_PACKET_SIZE];
+                TraceRandom randoms[RAY_PACKET_SIZE];
+                for(int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+                {
+                    // lanes past the image edge trace their pixel again and are dropped
+                    int px = min(x + lane % 2, x1 - 1);
+                    int py = min(y + lane / 2, y1 - 1);
+                    bool inside = px == x + lane % 2 && py == y + lane / 2;
+                    pixels[lane] = inside ? py * width + px : -1;
+                    randoms[lane].seed((uint32_t)(py * width + px), (uint32_t)sample);
+                    float jitterX = randoms[lane].next();
+                    float jitterY = randoms[lane].next();
+                    packet.setRay(lane, cameraPosition, getPrimaryDirection(px + jitterX, py + jitterY));
+                }
+                intersect(packet);
+                for(int lane = 0; lane < RAY_PACKET_SIZE; lane++)
+                {
+                    if(pixels[lane] < 0)
+                        continue;
+                    rays++;
+                    accumulation[pixels[lane]] += tracePath(packet.getOrigin(lane), packet.getDirection(lane), packet.getHit(lane), randoms[lane], rays);
+                }
+            }
+    }
+};
+
+#endif /* pathTracer_h */
@@ -11,6 +11,7 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include "shader.h"
+#include "lightAttenuation.h"
 
 class PointLight{
 public:
@@ -79,6 +80,11 @@ public:
             lightingShader.setFloat("pointLights[3].k_q", k_q);
         }
     }
+    // where the light fades out (lightAttenuation.h), used to size the light volume of the deferred renderer
+    float getAttenuationRadius() const
+    {
+        return ::getAttenuationRadius(k_c, k_l, k_q, diffuse, specular);
+    }
     void turnOff()
     {
         ambientOn = 0.0;
@@ -0,0 +1,303 @@
+//
+//  pointShadowMap.h
+//  test
+//
+
+#ifndef pointShadowMap_h
+#define pointShadowMap_h
+
+#include <glad/glad.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "shader.h"
+#include "pointLight.h"
+#include "frustum.h"
+
+using namespace std;
+
+const int MAX_POINT_SHADOWS = 4;
+// point light i samples its cube map from texture unit POINT_SHADOW_TEXTURE_UNIT + i
+const int POINT_SHADOW_TEXTURE_UNIT = 9;
+const int ALL_CUBE_FACES = 0x3F;
+
+// Omnidirectional shadows for the point lights. Each light owns a depth cube map
+// holding distance / farPlane, rendered in a single pass: the geometry shader
+// sends every caster triangle to the cube faces selected by faceMask (gl_Layer).
+// The maps are cached between frames. Casters are registered every frame under
+// a stable id; one that moved, appeared or disappeared marks its old and new
+// bounds dirty, and only faces whose frustum touches a dirty bound are cleared
+// and re-rendered. A light that moved re-renders all six faces.
+class PointShadowRenderer{
+public:
+    PointShadowRenderer(int resolution = 512)
+    {
+        this->resolution = resolution;
+        glGenFramebuffers(1, &shadowFBO);
+        createShadowMaps();
+    }
+
+    ~PointShadowRenderer()
+    {
+        deleteShadowMaps();
+        glDeleteFramebuffers(1, &shadowFBO);
+    }
+
+    void setResolution(int resolution)
+    {
+        if(resolution == this->resolution || resolution <= 0)
+            return;
+        this->resolution = resolution;
+        deleteShadowMaps();
+        createShadowMaps();
+    }
+
+    int getResolution() const
+    {
+        return resolution;
+    }
+
+    // forces a full re-render, e.g. after frames in which casters were not tracked
+    void invalidate()
+    {
+        for(int i = 0; i < MAX_POINT_SHADOWS; i++)
+            lights[i].valid = false;
+    }
+
+    // caster registration, once per frame before any light is updated
+    void beginCasters()
+    {
+        dirtyBounds.clear();
+        facesRendered = 0;
+        for(size_t i = 0; i < casters.size(); i++)
+            casters[i].seen = false;
+    }
+
+    void addCaster(int id, const glm::mat4 &model, const glm::vec4 &bounds)
+    {
+        for(size_t i = 0; i < casters.size(); i++)
+        {
+            Caster &c = casters[i];
+            if(c.id != id)
+                continue;
+            if(c.model != model)
+            {
+                // the shadow has to disappear from where the caster was, and appear where it is now
+                dirtyBounds.push_back(c.bounds);
+                dirtyBounds.push_back(bounds);
+                c.model = model;
+                c.bounds = bounds;
+            }
+            c.seen = true;
+            return;
+        }
+        Caster c;
+        c.id = id;
+        c.model = model;
+        c.bounds = bounds;
+        c.seen = true;
+        casters.push_back(c);
+        dirtyBounds.push_back(bounds);
+    }
+
+    void endCasters()
+    {
+        for(size_t i = 0; i < casters.size(); )
+        {
+            if(casters[i].seen)
+            {
+                i++;
+                continue;
+            }
+            dirtyBounds.push_back(casters[i].bounds);
+            casters[i] = casters.back();
+            casters.pop_back();
+        }
+    }
+
+    // faces of this light that must be re-rendered this frame, 0 when its cached map is still valid
+    int getDirtyFaces(int light, const PointLight &pointLight)
+    {
+        LightCache &cache = lights[light];
+        float farPlane = pointLight.getAttenuationRadius();
+        // a light that fades out before the near plane gets no shadow pass and shades unshadowed
+        if(farPlane <= LIGHT_MIN_RADIUS)
+        {
+            cache.valid = false;
+            return 0;
+        }
+        int faceMask = 0;
+        if(!cache.valid || cache.position != pointLight.position || cache.farPlane != farPlane)
+        {
+            cache.position = pointLight.position;
+            cache.farPlane = farPlane;
+            setUpFaces(cache);
+            cache.valid = true;
+            faceMask = ALL_CUBE_FACES;
+        }
+        else
+        {
+            for(int face = 0; face < 6; face++)
+                for(size_t i = 0; i < dirtyBounds.size(); i++)
+                    if(cache.faceFrustums[face].intersectsSphere(dirtyBounds[i]))
+                    {
+                        faceMask |= 1 << face;
+                        break;
+                    }
+        }
+        for(int face = 0; face < 6; face++)
+            if(faceMask & (1 << face))
+                facesRendered++;
+        return faceMask;
+    }
+
+    // clears the faces in faceMask and binds the whole cube map as a layered depth target
+    void beginLight(int light, int faceMask, Shader &cubeDepthShader)
+    {
+        LightCache &cache = lights[light];
+        glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
+        glViewport(0, 0, resolution, resolution);
+        if(faceMask != ALL_CUBE_FACES)
+        {
+            for(int face = 0; face < 6; face++)
+            {
+                if(!(faceMask & (1 << face)))
+                    continue;
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, cache.cubeMap, 0);
+                glClear(GL_DEPTH_BUFFER_BIT);
+            }
+        }
+        // clearing a layered attachment clears all six faces at once
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cache.cubeMap, 0);
+        if(faceMask == ALL_CUBE_FACES)
+            glClear(GL_DEPTH_BUFFER_BIT);
+
+        cubeDepthShader.use();
+        for(int face = 0; face < 6; face++)
+            cubeDepthShader.setMat4("shadowMatrices[" + to_string(face) + "]", cache.faceMatrices[face]);
+        cubeDepthShader.setInt("faceMask", faceMask);
+        cubeDepthShader.setVec3("lightPos", cache.position);
+        cubeDepthShader.setFloat("farPlane", cache.farPlane);
+    }
+
+    // caster culling against the faces being re-rendered; bounds: xyz = world center, w = radius
+    bool isCasterInFaces(int light, int faceMask, const glm::vec4 &bounds) const
+    {
+        for(int face = 0; face < 6; face++)
+            if((faceMask & (1 << face)) && lights[light].faceFrustums[face].intersectsSphere(bounds))
+                return true;
+        return false;
+    }
+
+    // number of cube faces re-rendered this frame, over all lights
+    int getFacesRendered() const
+    {
+        return facesRendered;
+    }
+
+    // for shaders that shade all point lights at once (pointShadowMaps[i])
+    void setUpShadows(Shader &shader, bool enabled)
+    {
+        shader.use();
+        for(int i = 0; i < MAX_POINT_SHADOWS; i++)
+        {
+            shader.setInt("pointShadowMaps[" + to_string(i) + "]", POINT_SHADOW_TEXTURE_UNIT + i);
+            shader.setFloat("pointShadowFarPlanes[" + to_string(i) + "]", (enabled && lights[i].valid) ? lights[i].farPlane : 0.0f);
+            glActiveTexture(GL_TEXTURE0 + POINT_SHADOW_TEXTURE_UNIT + i);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, lights[i].cubeMap);
+        }
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // for shaders that shade one point light at a time (pointShadowMap), e.g. deferred light volumes
+    void setUpLightShadow(Shader &shader, int light, bool enabled)
+    {
+        shader.use();
+        shader.setBool("shadowsOn", enabled);
+        shader.setInt("pointShadowMap", POINT_SHADOW_TEXTURE_UNIT + light);
+        shader.setFloat("pointShadowFarPlane", (enabled && lights[light].valid) ? lights[light].farPlane : 0.0f);
+        glActiveTexture(GL_TEXTURE0 + POINT_SHADOW_TEXTURE_UNIT + light);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, lights[light].cubeMap);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    struct Caster{
+        int id;
+        glm::mat4 model;
+        glm::vec4 bounds;
+        bool seen;
+    };
+    struct LightCache{
+        unsigned int cubeMap = 0;
+        bool valid = false;
+        glm::vec3 position = glm::vec3(0.0f);
+        float farPlane = 0.0f;
+        glm::mat4 faceMatrices[6];
+        Frustum faceFrustums[6];
+    };
+
+    int resolution;
+    unsigned int shadowFBO;
+    LightCache lights[MAX_POINT_SHADOWS];
+    vector<Caster> casters;
+    vector<glm::vec4> dirtyBounds;
+    int facesRendered = 0;
+
+    // one 90 degree frustum per cube face, in GL_TEXTURE_CUBE_MAP_POSITIVE_X + face order
+    void setUpFaces(LightCache &cache)
+    {
+        const glm::vec3 directions[6] = {
+            glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(-1.0f,  0.0f,  0.0f),
+            glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3( 0.0f, -1.0f,  0.0f),
+            glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3( 0.0f,  0.0f, -1.0f)
+        };
+        const glm::vec3 ups[6] = {
+            glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f),
+            glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f,  0.0f, -1.0f),
+            glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)
+        };
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.05f, cache.farPlane);
+        for(int face = 0; face < 6; face++)
+        {
+            cache.faceMatrices[face] = projection * glm::lookAt(cache.position, cache.position + directions[face], ups[face]);
+            cache.faceFrustums[face].set(cache.faceMatrices[face]);
+        }
+    }
+
+    void createShadowMaps()
+    {
+        for(int i = 0; i < MAX_POINT_SHADOWS; i++)
+        {
+            glGenTextures(1, &lights[i].cubeMap);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, lights[i].cubeMap);
+            for(int face = 0; face < 6; face++)
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT24, resolution, resolution, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+            lights[i].valid = false;
+        }
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, lights[0].cubeMap, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "point shadow framebuffer is not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void deleteShadowMaps()
+    {
+        for(int i = 0; i < MAX_POINT_SHADOWS; i++)
+            glDeleteTextures(1, &lights[i].cubeMap);
+    }
+};
+
+#endif /* pointShadowMap_h */
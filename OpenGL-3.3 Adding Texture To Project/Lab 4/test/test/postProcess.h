@@ -0,0 +1,404 @@
+//
+//  postProcess.h
+//  test
+//
+
+#ifndef postProcess_h
+#define postProcess_h
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include "shader.h"
+#include "profiler.h"
+#include "renderTargetPool.h"
+
+using namespace std;
+
+// how the HDR scene is brought into the display's range
+enum ToneMapper{
+    TONE_MAP_CLAMP,         // what an 8-bit framebuffer does: everything above 1 clips
+    TONE_MAP_REINHARD,      // c / (1 + c) per channel
+    TONE_MAP_ACES,          // filmic curve, Narkowicz's fit of ACES
+    TONE_MAP_COUNT
+};
+
+const char* getToneMapperName(ToneMapper toneMapper)
+{
+    const char *names[TONE_MAP_COUNT] = { "clamp", "Reinhard", "ACES" };
+    return names[toneMapper];
+}
+
+// how the glow around pixels brighter than the bloom threshold is blurred
+enum BloomMode{
+    BLOOM_OFF,
+    BLOOM_MIP_CHAIN,        // 13-tap downsamples from half resolution down, tent upsamples back
+    BLOOM_GAUSSIAN,         // separable 9-tap Gaussian at full resolution, the reference
+    BLOOM_MODE_COUNT
+};
+
+const char* getBloomModeName(BloomMode mode)
+{
+    const char *names[BLOOM_MODE_COUNT] = { "off", "mip chain", "gaussian" };
+    return names[mode];
+}
+
+// levels of the bloom mip chain, or horizontal + vertical pairs of the Gaussian
+const int MAX_BLOOM_LEVELS = 8;
+
+// how edges are smoothed: multisampling the scene target, or FXAA after tone mapping
+enum AntiAliasing{
+    AA_OFF,
+    AA_FXAA,
+    AA_MSAA_2X,
+    AA_MSAA_4X,
+    AA_MSAA_8X,
+    AA_MODE_COUNT
+};
+
+const char* getAntiAliasingName(AntiAliasing mode)
+{
+    const char *names[AA_MODE_COUNT] = { "off", "FXAA", "2x MSAA", "4x MSAA", "8x MSAA" };
+    return names[mode];
+}
+
+// scene target samples of a mode, 1 for the ones that are not MSAA
+int getAntiAliasingSamples(AntiAliasing mode)
+{
+    const int samples[AA_MODE_COUNT] = { 1, 1, 2, 4, 8 };
+    return samples[mode];
+}
+
+// The scene is drawn into an RGBA16F target instead of the 8-bit default framebuffer,
+// so lights can be brighter than 1, and run() turns it into the final image through a
+// chain of fullscreen passes. Each pass draws one triangle with no vertex buffer
+// (vertexShaderForFullscreen.vs) from the previous pass's output into a target from a
+// RenderTargetPool, releasing its input as soon as it has drawn: passes that want the
+// same kind of target ping-pong between two, however long the chain gets. The last
+// pass, tone mapping with exposure, writes the window. Every pass is a profiler scope
+// "post <name>", read back per pass with getPassGpuTime().
+//
+// Bloom runs beside the chain on the scene target. The mip chain, after Jimenez's
+// Call of Duty bloom, downsamples with a 13-tap filter into a half, quarter, ... size
+// R11F_G11F_B10F target per level (the first also applying the threshold), then walks
+// back up adding a 3x3 tent upsample of each level onto the next larger one, so the
+// widest blur costs a pass over a few texels; bloomLevels trades width for passes.
+// The Gaussian reference blurs the thresholded scene at full resolution bloomLevels
+// times in each direction. Either result is added before tone mapping.
+//
+// With MSAA the scene target is multisampled (beginScene()'s samples) and the first pass,
+// "msaa resolve", blits it into a plain RGBA16F target. With fxaa, tone mapping writes an
+// RGBA8 target with the luma in alpha and an "fxaa" pass writes the window instead.
+// A scene smaller than run()'s output size, from dynamic resolution, ends in an
+// "upscale" pass, a 9-tap Catmull-Rom filter, into the window.
+class PostProcessChain{
+public:
+    float exposure = 1.0f;
+    bool fxaa = false;
+    ToneMapper toneMapper = TONE_MAP_ACES;
+    BloomMode bloomMode = BLOOM_MIP_CHAIN;
+    int bloomLevels = 5;
+    float bloomThreshold = 1.0f;    // scene brightness where bloom starts
+    float bloomKnee = 0.5f;         // width of the soft transition below the threshold
+    float bloomStrength = 0.5f;
+
+    PostProcessChain(const string &shaderDirectory, Profiler &profiler) :
+        toneMapShader((shaderDirectory + "vertexShaderForFullscreen.vs").c_str(), (shaderDirectory + "fragmentShaderForToneMapping.fs").c_str()),
+        downsampleShader((shaderDirectory + "vertexShaderForFullscreen.vs").c_str(), (shaderDirectory + "fragmentShaderForBloomDownsample.fs").c_str()),
+        upsampleShader((shaderDirectory + "vertexShaderForFullscreen.vs").c_str(), (shaderDirectory + "fragmentShaderForBloomUpsample.fs").c_str()),
+        gaussianShader((shaderDirectory + "vertexShaderForFullscreen.vs").c_str(), (shaderDirectory + "fragmentShaderForGaussianBlur.fs").c_str()),
+        fxaaShader((shaderDirectory + "vertexShaderForFullscreen.vs").c_str(), (shaderDirectory + "fragmentShaderForFXAA.fs").c_str()),
+        upscaleShader((shaderDirectory + "vertexShaderForFullscreen.vs").c_str(), (shaderDirectory + "fragmentShaderForUpscale.fs").c_str()),
+        profiler(profiler)
+    {
+        toneMapShader.use();
+        toneMapShader.setInt("hdrBuffer", 0);
+        toneMapShader.setInt("bloomBuffer", 1);
+        fxaaShader.use();
+        fxaaShader.setInt("source", 0);
+        upscaleShader.use();
+        upscaleShader.setInt("source", 0);
+        // renderbuffer samples, float formats included
+        glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+        Shader* bloomShaders[] = { &downsampleShader, &upsampleShader, &gaussianShader };
+        for(int i = 0; i < 3; i++)
+        {
+            bloomShaders[i]->use();
+            bloomShaders[i]->setInt("source", 0);
+        }
+        // the fullscreen triangle has no attributes, but core profile still needs a VAO bound
+        glGenVertexArrays(1, &emptyVAO);
+    }
+
+    ~PostProcessChain()
+    {
+        glDeleteVertexArrays(1, &emptyVAO);
+    }
+
+    // binds a cleared RGBA16F target with depth at this size for the scene, multisampled
+    // for samples > 1 up to what the context allows
+    void beginScene(int width, int height, int samples = 1)
+    {
+        this->width = width;
+        this->height = height;
+        RenderTargetDesc desc = { width, height, GL_RGBA16F, true, min(samples, maxSamples) };
+        scene = pool.acquire(desc);
+        glBindFramebuffer(GL_FRAMEBUFFER, scene->FBO);
+        glViewport(0, 0, width, height);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    // where the scene goes between beginScene() and run()
+    unsigned int getSceneFBO() const
+    {
+        return scene ? scene->FBO : 0;
+    }
+
+    int getSceneSamples() const
+    {
+        return scene ? max(scene->desc.samples, 1) : 1;
+    }
+
+    // every pass in order, the last one into targetFBO at the output size, the scene's by default
+    void run(unsigned int targetFBO = 0, int outputWidth = 0, int outputHeight = 0)
+    {
+        if(!scene)
+            return;
+        this->outputWidth = outputWidth > 0 ? outputWidth : width;
+        this->outputHeight = outputHeight > 0 ? outputHeight : height;
+        bool upscale = this->outputWidth != width || this->outputHeight != height;
+        passNames.clear();
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glBindVertexArray(emptyVAO);
+        current = scene;
+        scene = NULL;
+
+        // explicit resolve, every pass after this one samples a plain texture
+        resolvedSamples = max(current->desc.samples, 1);
+        if(resolvedSamples > 1)
+        {
+            RenderTarget *resolved = beginPass("msaa resolve", GL_RGBA16F);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, current->FBO);
+            glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            endPass();
+            pool.release(current);
+            current = resolved;
+        }
+
+        // the mip chain sums one blurred copy per level, divided back so the knob keeps the brightness
+        RenderTarget *bloom = NULL;
+        float bloomScale = bloomStrength;
+        if(bloomMode == BLOOM_MIP_CHAIN)
+        {
+            int levels;
+            bloom = bloomMipChain(current, levels);
+            bloomScale /= levels;
+        }
+        else if(bloomMode == BLOOM_GAUSSIAN)
+            bloom = bloomGaussian(current);
+
+        // tone mapping, FXAA and the upscale to the output size; the last of them writes targetFBO
+        RenderTarget *ldr = beginLdrPass("tone map", !fxaa && !upscale, targetFBO);
+        toneMapShader.use();
+        toneMapShader.setFloat("exposure", exposure);
+        toneMapShader.setInt("toneMapper", toneMapper);
+        toneMapShader.setBool("lumaInAlpha", fxaa);
+        toneMapShader.setBool("bloomOn", bloom != NULL);
+        toneMapShader.setFloat("bloomStrength", bloomScale);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, bloom ? bloom->texture : 0);
+        drawFullscreen(current);
+        endPass();
+        pool.release(bloom);
+        pool.release(current);
+        current = NULL;
+
+        if(fxaa)
+        {
+            RenderTarget *antiAliased = beginLdrPass("fxaa", !upscale, targetFBO);
+            fxaaShader.use();
+            fxaaShader.setVec2("texelSize", 1.0f / width, 1.0f / height);
+            drawFullscreen(ldr);
+            endPass();
+            pool.release(ldr);
+            ldr = antiAliased;
+        }
+        if(upscale)
+        {
+            beginPass("upscale", targetFBO, this->outputWidth, this->outputHeight);
+            upscaleShader.use();
+            drawFullscreen(ldr);
+            endPass();
+            pool.release(ldr);
+        }
+
+        glBindVertexArray(0);
+        glEnable(GL_DEPTH_TEST);
+        pool.endFrame();
+    }
+
+    // the passes of the last run(), in order
+    const vector<string>& getPassNames() const
+    {
+        return passNames;
+    }
+
+    // smoothed GPU time of a pass, in ms
+    double getPassGpuTime(const string &name) const
+    {
+        return profiler.getSmoothedGpuTime("post " + name);
+    }
+
+    RenderTargetPool& getPool()
+    {
+        return pool;
+    }
+
+    void report(ostream &out = cout) const
+    {
+        out << "post-processing: " << getToneMapperName(toneMapper) << " tone mapping, exposure " << exposure << ", "
+            << getBloomModeName(bloomMode) << " bloom (" << bloomLevels << " levels), "
+            << (resolvedSamples > 1 ? to_string(resolvedSamples) + "x MSAA" : fxaa ? string("FXAA") : string("no anti-aliasing")) << ", "
+            << width << "x" << height << (outputWidth != width || outputHeight != height ? " upscaled to " + to_string(outputWidth) + "x" + to_string(outputHeight) : string()) << ", "
+            << pool.getTargetCount() << " render targets, " << fixed << setprecision(1) << pool.getAllocatedBytes() / (1024.0 * 1024.0) << " MB" << endl;
+        for(size_t i = 0; i < passNames.size(); i++)
+            out << "  " << left << setw(26) << passNames[i] << right << fixed << setprecision(3) << setw(10) << getPassGpuTime(passNames[i]) << " ms" << endl;
+    }
+
+private:
+    Shader toneMapShader;
+    Shader downsampleShader;
+    Shader upsampleShader;
+    Shader gaussianShader;
+    Shader fxaaShader;
+    Shader upscaleShader;
+    Profiler &profiler;
+    RenderTargetPool pool;
+    RenderTarget *scene = NULL;
+    RenderTarget *current = NULL;       // the previous pass's output
+    vector<RenderTarget*> bloomChain;
+    vector<string> passNames;
+    unsigned int emptyVAO = 0;
+    int width = 0;
+    int height = 0;
+    int outputWidth = 0;
+    int outputHeight = 0;
+    int maxSamples = 1;
+    int resolvedSamples = 1;        // of the last run()'s scene
+
+    PostProcessChain(const PostProcessChain&);
+    PostProcessChain& operator=(const PostProcessChain&);
+
+    // binds a pooled target of this format at 1/divisor of the scene size for a pass
+    RenderTarget* beginPass(const string &name, GLenum internalFormat, int divisor = 1)
+    {
+        RenderTargetDesc desc = { max(width / divisor, 1), max(height / divisor, 1), internalFormat, false, 1 };
+        RenderTarget *output = pool.acquire(desc);
+        beginPass(name, output->FBO, desc.width, desc.height);
+        return output;
+    }
+
+    // an LDR pass into a pooled RGBA8 target, or into targetFBO if it is the last pass
+    RenderTarget* beginLdrPass(const string &name, bool last, unsigned int targetFBO)
+    {
+        if(!last)
+            return beginPass(name, GL_RGBA8);
+        beginPass(name, targetFBO, width, height);
+        return NULL;
+    }
+
+    void beginPass(const string &name, unsigned int FBO, int width, int height)
+    {
+        passNames.push_back(name);
+        profiler.begin("post " + name);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, width, height);
+    }
+
+    void endPass()
+    {
+        profiler.end();
+    }
+
+    static void setSourceTexelSize(Shader &shader, const RenderTarget *source)
+    {
+        shader.setVec2("sourceTexelSize", 1.0f / source->desc.width, 1.0f / source->desc.height);
+    }
+
+    // the bloom of input at half its size; levels is how many the chain went down
+    RenderTarget* bloomMipChain(RenderTarget *input, int &levels)
+    {
+        // no level smaller than a couple of texels
+        levels = glm::clamp(bloomLevels, 1, MAX_BLOOM_LEVELS);
+        while(levels > 1 && min(width, height) >> levels < 2)
+            levels--;
+
+        bloomChain.clear();
+        RenderTarget *source = input;
+        downsampleShader.use();
+        downsampleShader.setFloat("threshold", bloomThreshold);
+        downsampleShader.setFloat("knee", bloomKnee);
+        for(int i = 0; i < levels; i++)
+        {
+            RenderTarget *level = beginPass("bloom down " + to_string(i), GL_R11F_G11F_B10F, 2 << i);
+            downsampleShader.setBool("prefilter", i == 0);
+            setSourceTexelSize(downsampleShader, source);
+            drawFullscreen(source);
+            endPass();
+            bloomChain.push_back(level);
+            source = level;
+        }
+
+        upsampleShader.use();
+        upsampleShader.setFloat("filterRadius", 1.0f);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        for(int i = levels - 1; i > 0; i--)
+        {
+            RenderTarget *target = bloomChain[i - 1];
+            beginPass("bloom up " + to_string(i - 1), target->FBO, target->desc.width, target->desc.height);
+            setSourceTexelSize(upsampleShader, bloomChain[i]);
+            drawFullscreen(bloomChain[i]);
+            endPass();
+            pool.release(bloomChain[i]);
+        }
+        glDisable(GL_BLEND);
+        return bloomChain[0];
+    }
+
+    // the full resolution reference: bloomLevels horizontal and vertical blurs, ping-ponged
+    RenderTarget* bloomGaussian(RenderTarget *input)
+    {
+        int passes = glm::clamp(bloomLevels, 1, MAX_BLOOM_LEVELS);
+        RenderTarget *source = input;
+        gaussianShader.use();
+        gaussianShader.setFloat("threshold", bloomThreshold);
+        gaussianShader.setFloat("knee", bloomKnee);
+        for(int i = 0; i < passes; i++)
+            for(int d = 0; d < 2; d++)
+            {
+                RenderTarget *output = beginPass(string("bloom blur ") + (d == 0 ? "h " : "v ") + to_string(i), GL_R11F_G11F_B10F);
+                gaussianShader.setBool("prefilter", i == 0 && d == 0);
+                gaussianShader.setVec2("direction", d == 0 ? glm::vec2(1.0f / width, 0.0f) : glm::vec2(0.0f, 1.0f / height));
+                drawFullscreen(source);
+                endPass();
+                if(source != input)
+                    pool.release(source);
+                source = output;
+            }
+        return source;
+    }
+
+    void drawFullscreen(RenderTarget *input)
+    {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, input->texture);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+};
+
+#endif /* postProcess_h */
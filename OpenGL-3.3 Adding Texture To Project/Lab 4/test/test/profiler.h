@@ -0,0 +1,230 @@
+//
+//  profiler.h
+//  test
+//
+
+#ifndef profiler_h
+#define profiler_h
+
+#include <glad/glad.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+// results are read back this many frames late so the CPU never waits on the GPU
+const int PROFILER_FRAME_LATENCY = 3;
+
+class Profiler{
+public:
+    struct Scope{
+        string name;
+        double gpuTotal = 0.0;      // ms, summed since last reset
+        double cpuTotal = 0.0;      // ms, summed since last reset
+        int samples = 0;
+        double gpuSmoothed = 0.0;   // ms, exponential moving average
+        double cpuSmoothed = 0.0;
+        double gpuLast = 0.0;       // ms, most recent resolved sample
+    };
+
+    bool enabled = true;
+
+    Profiler() {}
+
+    ~Profiler()
+    {
+        for(int i = 0; i < PROFILER_FRAME_LATENCY; i++)
+            if(!frames[i].queries.empty())
+                glDeleteQueries((GLsizei)frames[i].queries.size(), frames[i].queries.data());
+    }
+
+    // call once per frame before any begin()/end(); resolves the oldest frame in flight
+    void beginFrame()
+    {
+        currentFrame = (currentFrame + 1) % PROFILER_FRAME_LATENCY;
+        resolve(frames[currentFrame]);
+        frames[currentFrame].used = 0;
+        frames[currentFrame].samples.clear();
+    }
+
+    void endFrame()
+    {
+        // unbalanced begin() calls are closed here so a frame can never leak an open scope
+        while(!stack.empty())
+            end();
+    }
+
+    // timestamp queries nest freely, unlike GL_TIME_ELAPSED
+    void begin(const string &name)
+    {
+        if(!enabled)
+            return;
+        Sample s;
+        s.scope = findScope(name);
+        s.startQuery = nextQuery();
+        s.cpuStart = chrono::high_resolution_clock::now();
+        glQueryCounter(frames[currentFrame].queries[s.startQuery], GL_TIMESTAMP);
+        stack.push_back((int)frames[currentFrame].samples.size());
+        frames[currentFrame].samples.push_back(s);
+    }
+
+    void end()
+    {
+        if(!enabled || stack.empty())
+            return;
+        Sample &s = frames[currentFrame].samples[stack.back()];
+        stack.pop_back();
+        s.endQuery = nextQuery();
+        glQueryCounter(frames[currentFrame].queries[s.endQuery], GL_TIMESTAMP);
+        s.cpuMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - s.cpuStart).count();
+    }
+
+    const Scope* getScope(const string &name) const
+    {
+        for(size_t i = 0; i < scopes.size(); i++)
+            if(scopes[i].name == name)
+                return &scopes[i];
+        return nullptr;
+    }
+
+    // average GPU time of a scope since the last reset, in ms
+    double getGpuTime(const string &name) const
+    {
+        const Scope *s = getScope(name);
+        return (s && s->samples) ? s->gpuTotal / s->samples : 0.0;
+    }
+
+    double getCpuTime(const string &name) const
+    {
+        const Scope *s = getScope(name);
+        return (s && s->samples) ? s->cpuTotal / s->samples : 0.0;
+    }
+
+    double getSmoothedGpuTime(const string &name) const
+    {
+        const Scope *s = getScope(name);
+        return s ? s->gpuSmoothed : 0.0;
+    }
+
+    // the newest resolved GPU time of a scope, PROFILER_FRAME_LATENCY frames old, 0 before the first
+    double getLastGpuTime(const string &name) const
+    {
+        const Scope *s = getScope(name);
+        return s ? s->gpuLast : 0.0;
+    }
+
+    // drops the averages and every sample still in flight, e.g. after benchmark warm-up
+    void reset()
+    {
+        for(int i = 0; i < PROFILER_FRAME_LATENCY; i++)
+            if(i != currentFrame)
+                frames[i].samples.clear();
+        for(size_t i = 0; i < scopes.size(); i++)
+        {
+            scopes[i].gpuTotal = 0.0;
+            scopes[i].cpuTotal = 0.0;
+            scopes[i].samples = 0;
+        }
+    }
+
+    // resolves every frame still in flight, e.g. at the end of a benchmark run
+    void finish()
+    {
+        for(int i = 1; i <= PROFILER_FRAME_LATENCY; i++)
+        {
+            Frame &f = frames[(currentFrame + i) % PROFILER_FRAME_LATENCY];
+            resolve(f);
+            f.samples.clear();
+            f.used = 0;
+        }
+    }
+
+    void report(ostream &out = cout) const
+    {
+        out << left << setw(28) << "scope" << right << setw(12) << "gpu ms" << setw(12) << "cpu ms" << setw(10) << "samples" << endl;
+        for(size_t i = 0; i < scopes.size(); i++)
+        {
+            const Scope &s = scopes[i];
+            double gpu = s.samples ? s.gpuTotal / s.samples : 0.0;
+            double cpu = s.samples ? s.cpuTotal / s.samples : 0.0;
+            out << left << setw(28) << s.name << right << fixed << setprecision(3) << setw(12) << gpu << setw(12) << cpu << setw(10) << s.samples << endl;
+        }
+    }
+
+private:
+    struct Sample{
+        int scope;
+        int startQuery;
+        int endQuery = -1;
+        chrono::high_resolution_clock::time_point cpuStart;
+        double cpuMs = 0.0;
+    };
+    struct Frame{
+        vector<unsigned int> queries;
+        vector<Sample> samples;
+        int used = 0;
+    };
+
+    vector<Scope> scopes;
+    Frame frames[PROFILER_FRAME_LATENCY];
+    vector<int> stack;
+    int currentFrame = 0;
+
+    int findScope(const string &name)
+    {
+        for(size_t i = 0; i < scopes.size(); i++)
+            if(scopes[i].name == name)
+                return (int)i;
+        Scope s;
+        s.name = name;
+        scopes.push_back(s);
+        return (int)scopes.size() - 1;
+    }
+
+    int nextQuery()
+    {
+        Frame &f = frames[currentFrame];
+        if(f.used == (int)f.queries.size())
+        {
+            unsigned int q;
+            glGenQueries(1, &q);
+            f.queries.push_back(q);
+        }
+        return f.used++;
+    }
+
+    void resolve(Frame &f)
+    {
+        for(size_t i = 0; i < f.samples.size(); i++)
+        {
+            Sample &s = f.samples[i];
+            if(s.endQuery < 0)
+                continue;
+            GLuint64 t0, t1;
+            glGetQueryObjectui64v(f.queries[s.startQuery], GL_QUERY_RESULT, &t0);
+            glGetQueryObjectui64v(f.queries[s.endQuery], GL_QUERY_RESULT, &t1);
+            double gpuMs = (double)(t1 - t0) / 1000000.0;
+
+            Scope &scope = scopes[s.scope];
+            scope.gpuTotal += gpuMs;
+            scope.cpuTotal += s.cpuMs;
+            scope.gpuLast = gpuMs;
+            if(scope.samples == 0 && scope.gpuSmoothed == 0.0)
+            {
+                scope.gpuSmoothed = gpuMs;
+                scope.cpuSmoothed = s.cpuMs;
+            }
+            else
+            {
+                scope.gpuSmoothed = 0.9 * scope.gpuSmoothed + 0.1 * gpuMs;
+                scope.cpuSmoothed = 0.9 * scope.cpuSmoothed + 0.1 * s.cpuMs;
+            }
+            scope.samples++;
+        }
+    }
+};
+
+#endif /* profiler_h */
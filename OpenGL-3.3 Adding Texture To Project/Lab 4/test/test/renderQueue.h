@@ -0,0 +1,75 @@
+//
+//  renderQueue.h
+//  test
+//
+
+#ifndef renderQueue_h
+#define renderQueue_h
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+
+using namespace std;
+
+// One queued draw: the object's slot in the TransformBuffer plus an index the
+// caller uses to find what to draw (e.g. which container cube).
+struct RenderItem{
+    uint64_t key;
+    int objectIndex;
+    int drawable;
+    glm::vec4 bounds;       // world bounding sphere, for culling
+};
+
+// Opaque draws sorted by a 64-bit key, most significant bits first:
+//   [63..56] program, so draws sharing a shader stay together
+//   [55..24] view depth as float bits, nearest first (front to back)
+//   [23..0]  submission order, keeps the sort stable
+// Positive IEEE floats compare the same as their bit patterns, so the depth
+// can be used in the key without any conversion.
+class RenderQueue{
+public:
+    void clear()
+    {
+        items.clear();
+    }
+    
+    void add(int program, float viewDepth, int objectIndex, int drawable, glm::vec4 bounds = glm::vec4(0.0f))
+    {
+        if(viewDepth < 0.0f)
+            viewDepth = 0.0f;
+        uint32_t depthBits;
+        memcpy(&depthBits, &viewDepth, sizeof(float));
+        
+        RenderItem item;
+        item.key = ((uint64_t)(program & 0xff) << 56) | ((uint64_t)depthBits << 24) | (uint64_t)(items.size() & 0xffffff);
+        item.objectIndex = objectIndex;
+        item.drawable = drawable;
+        item.bounds = bounds;
+        items.push_back(item);
+    }
+    
+    // view depth of a model's local point, for add()
+    static float viewDepth(const glm::mat4 &view, const glm::mat4 &model, glm::vec3 localCenter)
+    {
+        glm::vec4 p = view * (model * glm::vec4(localCenter, 1.0f));
+        return -p.z;
+    }
+    
+    void sort()
+    {
+        std::sort(items.begin(), items.end(), [](const RenderItem &a, const RenderItem &b) { return a.key < b.key; });
+    }
+    
+    const vector<RenderItem>& getItems() const
+    {
+        return items;
+    }
+    
+private:
+    vector<RenderItem> items;
+};
+
+#endif /* renderQueue_h */
@@ -0,0 +1,196 @@
+//
+//  renderTargetPool.h
+//  test
+//
+
+#ifndef renderTargetPool_h
+#define renderTargetPool_h
+
+#include <glad/glad.h>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+// a pooled target nobody acquired for this many frames is deleted, e.g. after a resize
+const int RENDER_TARGET_IDLE_FRAMES = 3;
+
+// what a pass needs to render into
+struct RenderTargetDesc{
+    int width;
+    int height;
+    GLenum internalFormat;      // GL_RGBA16F, GL_R11F_G11F_B10F, GL_RGBA8, GL_R8, ...
+    bool depth;                 // with a GL_DEPTH24_STENCIL8 renderbuffer, the default framebuffer's format
+    int samples;                // MSAA samples, 0 or 1 for a plain texture
+
+    bool operator==(const RenderTargetDesc &other) const
+    {
+        return width == other.width && height == other.height && internalFormat == other.internalFormat && depth == other.depth
+            && max(samples, 1) == max(other.samples, 1);
+    }
+};
+
+// one color texture, linear filtered and clamped, in its own framebuffer; a multisampled
+// target has a renderbuffer instead, which cannot be sampled and is resolved with a blit
+struct RenderTarget{
+    RenderTargetDesc desc;
+    unsigned int FBO = 0;
+    unsigned int texture = 0;
+    unsigned int colorRBO = 0;
+    unsigned int depthRBO = 0;
+    bool inUse = false;
+    int lastUsedFrame = 0;
+};
+
+// Transient render targets shared by the passes of a frame. A pass acquires a target
+// of the size and format it needs and releases the ones it has read, so the next pass
+// asking for the same kind gets that memory back: a chain of any length ping-pongs
+// between as many targets as are alive at once, never one per pass. Targets outlive
+// the frame, so a steady frame allocates nothing.
+class RenderTargetPool{
+public:
+    RenderTargetPool() {}
+
+    ~RenderTargetPool()
+    {
+        for(size_t i = 0; i < targets.size(); i++)
+            destroy(targets[i]);
+    }
+
+    RenderTarget* acquire(const RenderTargetDesc &desc)
+    {
+        for(size_t i = 0; i < targets.size(); i++)
+            if(!targets[i]->inUse && targets[i]->desc == desc)
+            {
+                targets[i]->inUse = true;
+                targets[i]->lastUsedFrame = frame;
+                return targets[i];
+            }
+        RenderTarget *target = create(desc);
+        target->inUse = true;
+        target->lastUsedFrame = frame;
+        targets.push_back(target);
+        return target;
+    }
+
+    void release(RenderTarget *target)
+    {
+        if(target)
+            target->inUse = false;
+    }
+
+    // deletes what has been idle for RENDER_TARGET_IDLE_FRAMES frames
+    void endFrame()
+    {
+        frame++;
+        size_t kept = 0;
+        for(size_t i = 0; i < targets.size(); i++)
+        {
+            if(!targets[i]->inUse && frame - targets[i]->lastUsedFrame > RENDER_TARGET_IDLE_FRAMES)
+                destroy(targets[i]);
+            else
+                targets[kept++] = targets[i];
+        }
+        targets.resize(kept);
+    }
+
+    int getTargetCount() const
+    {
+        return (int)targets.size();
+    }
+
+    size_t getAllocatedBytes() const
+    {
+        size_t bytes = 0;
+        for(size_t i = 0; i < targets.size(); i++)
+            bytes += getTargetBytes(targets[i]->desc);
+        return bytes;
+    }
+
+    static size_t getTargetBytes(const RenderTargetDesc &desc)
+    {
+        size_t texel = 4;
+        switch(desc.internalFormat)
+        {
+        case GL_R8: texel = 1; break;
+        case GL_R16F: case GL_RG8: texel = 2; break;
+        case GL_R11F_G11F_B10F: case GL_R32F: texel = 4; break;
+        case GL_RGBA16F: texel = 8; break;
+        case GL_RGBA32F: texel = 16; break;
+        }
+        return (size_t)desc.width * desc.height * (texel + (desc.depth ? 4 : 0)) * max(desc.samples, 1);
+    }
+
+private:
+    vector<RenderTarget*> targets;
+    int frame = 0;
+
+    RenderTargetPool(const RenderTargetPool&);
+    RenderTargetPool& operator=(const RenderTargetPool&);
+
+    static RenderTarget* create(const RenderTargetDesc &desc)
+    {
+        RenderTarget *target = new RenderTarget();
+        target->desc = desc;
+
+        // a sized internal format still needs a matching client format, even with no data
+        GLenum format = GL_RGBA;
+        if(desc.internalFormat == GL_R8 || desc.internalFormat == GL_R16F || desc.internalFormat == GL_R32F)
+            format = GL_RED;
+        else if(desc.internalFormat == GL_RG8)
+            format = GL_RG;
+        else if(desc.internalFormat == GL_R11F_G11F_B10F)
+            format = GL_RGB;
+        GLenum type = (desc.internalFormat == GL_RGBA16F || desc.internalFormat == GL_RGBA32F || desc.internalFormat == GL_R16F || desc.internalFormat == GL_R32F || desc.internalFormat == GL_R11F_G11F_B10F) ? GL_FLOAT : GL_UNSIGNED_BYTE;
+        int samples = max(desc.samples, 1);
+
+        glGenFramebuffers(1, &target->FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, target->FBO);
+        if(samples > 1)
+        {
+            glGenRenderbuffers(1, &target->colorRBO);
+            glBindRenderbuffer(GL_RENDERBUFFER, target->colorRBO);
+            glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, desc.internalFormat, desc.width, desc.height);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target->colorRBO);
+        }
+        else
+        {
+            glGenTextures(1, &target->texture);
+            glBindTexture(GL_TEXTURE_2D, target->texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, desc.internalFormat, desc.width, desc.height, 0, format, type, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->texture, 0);
+        }
+        if(desc.depth)
+        {
+            // every attachment of a framebuffer has the same sample count
+            glGenRenderbuffers(1, &target->depthRBO);
+            glBindRenderbuffer(GL_RENDERBUFFER, target->depthRBO);
+            glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples > 1 ? samples : 0, GL_DEPTH24_STENCIL8, desc.width, desc.height);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target->depthRBO);
+        }
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "render target framebuffer is not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return target;
+    }
+
+    static void destroy(RenderTarget *target)
+    {
+        glDeleteFramebuffers(1, &target->FBO);
+        if(target->texture)
+            glDeleteTextures(1, &target->texture);
+        if(target->colorRBO)
+            glDeleteRenderbuffers(1, &target->colorRBO);
+        if(target->depthRBO)
+            glDeleteRenderbuffers(1, &target->depthRBO);
+        delete target;
+    }
+};
+
+#endif /* renderTargetPool_h */
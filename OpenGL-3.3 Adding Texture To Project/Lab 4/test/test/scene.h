@@ -0,0 +1,1234 @@
+//
+//  scene.h
+//  test
+//
+
+#ifndef scene_h
+#define scene_h
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "shader.h"
+#include "cube.h"
+#include "sphere.h"
+#include "meshFile.h"
+#include "meshImporter.h"
+#include "mappedFile.h"
+#include "texture.h"
+#include "materialBuffer.h"
+#include "meshPool.h"
+#include "json.h"
+#include "pointLight.h"
+#include "directionLight.h"
+#include "spotLight.h"
+
+using namespace std;
+
+// the lighting shaders have four point light slots
+const int MAX_SCENE_POINT_LIGHTS = 4;
+// nodes a compiled scene streams in per Scene::update()
+const int SCENE_STREAM_BATCH = 4096;
+// sphere sectors and stacks beyond this are rejected, which keeps vertex and index counts far inside int
+const int SCENE_MAX_SPHERE_SEGMENTS = 1024;
+
+enum SceneMeshType{ SCENE_MESH_CUBE, SCENE_MESH_SPHERE, SCENE_MESH_FILE };
+
+// lit program a node is drawn with; textured materials need texture coordinates
+enum SceneProgram{ SCENE_PROGRAM_TEXTURED, SCENE_PROGRAM_MATERIAL };
+
+struct SceneTexture{
+    string name;
+    string path;                        // relative to the scene file
+    GLenum wrapS = GL_REPEAT;
+    GLenum wrapT = GL_REPEAT;
+    GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR;
+    GLenum magFilter = GL_LINEAR;
+};
+
+struct SceneMaterial{
+    string name;
+    glm::vec3 ambient = glm::vec3(1.0f);
+    glm::vec3 diffuse = glm::vec3(1.0f);
+    glm::vec3 specular = glm::vec3(0.5f);
+    float shininess = 32.0f;
+    int diffuseMap = -1;                // texture index, -1 for an untextured material
+    int specularMap = -1;
+};
+
+struct SceneMesh{
+    string name;
+    SceneMeshType type = SCENE_MESH_CUBE;
+    string path;                        // SCENE_MESH_FILE: a .mesh, .obj or .ply file
+    glm::vec4 textureRange = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);    // cube texture coordinates: xmin, ymin, xmax, ymax
+    int sectors = 36;                   // sphere tessellation
+    int stacks = 18;
+    SphereType sphereType = UV_SPHERE;
+};
+
+// Nodes are stored parents first, so world matrices are one forward pass.
+struct SceneNode{
+    string name;
+    int parent = -1;
+    int mesh = -1;                      // -1 for a group
+    int material = -1;                  // -1 for the default material
+    glm::mat4 local = glm::mat4(1.0f);
+};
+
+// Everything a scene file describes, in flat arrays the nodes index into.
+struct SceneData{
+    string directory;                   // of the scene file, relative paths start here
+    string shaderDirectory;             // relative to directory
+    glm::vec3 cameraPosition = glm::vec3(0.0f, 1.1f, 5.2f);
+    vector<SceneTexture> textures;
+    vector<SceneMaterial> materials;
+    vector<SceneMesh> meshes;
+    vector<SceneNode> nodes;
+    DirectionLight dirLight = DirectionLight(0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+    vector<PointLight> pointLights;
+    SpotLight spotLight = SpotLight(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 12.5f, 15.0f);
+    bool spotLightFollowsCamera = false;
+
+    string resolvePath(const string &path) const
+    {
+        return (!path.empty() && path[0] == '/') ? path : directory + path;
+    }
+};
+
+// ---- names of GL enums in scene files
+
+struct SceneEnumName{
+    const char *name;
+    GLenum value;
+};
+
+const SceneEnumName SCENE_WRAP_MODES[] = {
+    { "repeat", GL_REPEAT }, { "mirrored_repeat", GL_MIRRORED_REPEAT }, { "clamp_to_edge", GL_CLAMP_TO_EDGE }
+};
+const SceneEnumName SCENE_FILTERS[] = {
+    { "nearest", GL_NEAREST }, { "linear", GL_LINEAR },
+    { "nearest_mipmap_nearest", GL_NEAREST_MIPMAP_NEAREST }, { "linear_mipmap_nearest", GL_LINEAR_MIPMAP_NEAREST },
+    { "nearest_mipmap_linear", GL_NEAREST_MIPMAP_LINEAR }, { "linear_mipmap_linear", GL_LINEAR_MIPMAP_LINEAR }
+};
+const char* SCENE_MESH_TYPES[] = { "cube", "sphere", "file" };
+const char* SCENE_SPHERE_TYPES[] = { "uv", "icosphere", "cube_sphere" };
+
+template <int N>
+bool findSceneEnum(const SceneEnumName (&names)[N], const string &name, GLenum &value)
+{
+    for(int i = 0; i < N; i++)
+        if(name == names[i].name)
+        {
+            value = names[i].value;
+            return true;
+        }
+    return false;
+}
+
+template <int N>
+const char* getSceneEnumName(const SceneEnumName (&names)[N], GLenum value)
+{
+    for(int i = 0; i < N; i++)
+        if(names[i].value == value)
+            return names[i].name;
+    return names[0].name;
+}
+
+template <int N>
+int findSceneName(const char* (&names)[N], const string &name)
+{
+    for(int i = 0; i < N; i++)
+        if(name == names[i])
+            return i;
+    return -1;
+}
+
+// ---- JSON authoring form
+//
+// {
+//   "shaderDirectory": "",                         relative to the scene file
+//   "camera": { "position": [0, 1.1, 5.2] },
+//   "textures": [ { "name", "path", "wrap": "repeat", "minFilter", "magFilter" } ],
+//   "materials": [ { "name", "diffuseMap", "specularMap", "shininess" }                 textured
+//                  { "name", "ambient", "diffuse", "specular", "shininess" } ],         untextured
+//   "meshes": [ { "name", "type": "cube", "textureRange": [0, 0, 1, 1] },
+//               { "name", "type": "sphere", "sectors", "stacks", "sphereType": "uv" },
+//               { "name", "type": "file", "path": "model.obj" } ],
+//   "lights": { "directional": { "direction", "ambient", "diffuse", "specular" },
+//               "point": [ { "position", "ambient", "diffuse", "specular", "attenuation": [k_c, k_l, k_q] } ],
+//               "spot": { ..., "direction", "cutOff", "outerCutOff", "followCamera": true } },
+//   "nodes": [ { "name", "mesh", "material", "translation", "rotation" (degrees, x then y then z),
+//                "scale" (number or [x, y, z]) or "matrix" (16 numbers, column major), "children": [...] } ]
+// }
+//
+// Textures, materials and meshes are referred to by name or by index.
+
+// whether a sphere's sectors or stacks are a sane tessellation
+bool isSceneSphereSegments(double count, int minimum)
+{
+    return count >= minimum && count <= SCENE_MAX_SPHERE_SEGMENTS && count == floor(count);
+}
+
+// index of a reference by name or number into items, -1 for none, -2 if it does not resolve
+template <typename Item>
+int readSceneReference(const JsonValue &reference, const vector<Item> &items)
+{
+    if(reference.isNull())
+        return -1;
+    if(reference.isNumber())
+    {
+        // range checked as a double first, NaN and out of range numbers do not convert to int
+        double index = reference.getNumber();
+        if(!(index >= 0.0 && index < (double)items.size()) || index != floor(index))
+            return -2;
+        return (int)index;
+    }
+    if(!reference.isString())
+        return -2;
+    for(size_t i = 0; i < items.size(); i++)
+        if(items[i].name == reference.getString())
+            return (int)i;
+    return -2;
+}
+
+glm::mat4 readSceneTransform(const JsonValue &node)
+{
+    const JsonValue &matrix = node["matrix"];
+    if(matrix.isArray() && matrix.size() == 16)
+    {
+        glm::mat4 local;
+        for(int i = 0; i < 16; i++)
+            local[i / 4][i % 4] = (float)matrix[i].getNumber();
+        return local;
+    }
+    glm::vec3 rotation = node["rotation"].getVec3(glm::vec3(0.0f));
+    glm::vec3 scale = node["scale"].isNumber() ? glm::vec3((float)node["scale"].getNumber()) : node["scale"].getVec3(glm::vec3(1.0f));
+    glm::mat4 local = glm::translate(glm::mat4(1.0f), node["translation"].getVec3(glm::vec3(0.0f)));
+    local = glm::rotate(local, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+    local = glm::rotate(local, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+    local = glm::rotate(local, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+    return glm::scale(local, scale);
+}
+
+// appends nodes and their children depth first, so every parent comes before its children
+bool readSceneNodes(const JsonValue &nodes, int parent, SceneData &scene, const string &path)
+{
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        const JsonValue &json = nodes[i];
+        SceneNode node;
+        node.name = json["name"].getString("");
+        node.parent = parent;
+        node.mesh = readSceneReference(json["mesh"], scene.meshes);
+        node.material = readSceneReference(json["material"], scene.materials);
+        if(node.mesh == -2 || node.material == -2)
+        {
+            cout << path << ": node " << node.name << " refers to an unknown mesh or material" << endl;
+            return false;
+        }
+        node.local = readSceneTransform(json);
+        scene.nodes.push_back(node);
+        if(!readSceneNodes(json["children"], (int)scene.nodes.size() - 1, scene, path))
+            return false;
+    }
+    return true;
+}
+
+PointLight readScenePointLight(const JsonValue &json, int number)
+{
+    glm::vec3 p = json["position"].getVec3(glm::vec3(0.0f));
+    glm::vec3 a = json["ambient"].getVec3(glm::vec3(0.05f));
+    glm::vec3 d = json["diffuse"].getVec3(glm::vec3(0.8f));
+    glm::vec3 s = json["specular"].getVec3(glm::vec3(1.0f));
+    glm::vec3 k = json["attenuation"].getVec3(glm::vec3(1.0f, 0.09f, 0.032f));
+    return PointLight(p.x, p.y, p.z, a.x, a.y, a.z, d.x, d.y, d.z, s.x, s.y, s.z, k.x, k.y, k.z, number);
+}
+
+bool loadSceneJson(const string &path, SceneData &scene)
+{
+    ifstream file(path.c_str());
+    if(!file)
+    {
+        cout << "scene " << path << " could not be opened" << endl;
+        return false;
+    }
+    stringstream text;
+    text << file.rdbuf();
+    JsonValue root;
+    if(!JsonValue::parse(text.str(), root, path))
+        return false;
+    if(!root.isObject())
+    {
+        cout << "scene " << path << " is not a JSON object" << endl;
+        return false;
+    }
+
+    scene = SceneData();
+    size_t slash = path.rfind('/');
+    scene.directory = slash == string::npos ? string() : path.substr(0, slash + 1);
+    scene.shaderDirectory = root["shaderDirectory"].getString("");
+    scene.cameraPosition = root["camera"]["position"].getVec3(scene.cameraPosition);
+
+    const JsonValue &textures = root["textures"];
+    for(size_t i = 0; i < textures.size(); i++)
+    {
+        SceneTexture texture;
+        texture.name = textures[i]["name"].getString("");
+        texture.path = textures[i]["path"].getString("");
+        string wrap = textures[i]["wrap"].getString("repeat");
+        if(!findSceneEnum(SCENE_WRAP_MODES, textures[i]["wrapS"].getString(wrap), texture.wrapS)
+           || !findSceneEnum(SCENE_WRAP_MODES, textures[i]["wrapT"].getString(wrap), texture.wrapT)
+           || !findSceneEnum(SCENE_FILTERS, textures[i]["minFilter"].getString("linear_mipmap_linear"), texture.minFilter)
+           || !findSceneEnum(SCENE_FILTERS, textures[i]["magFilter"].getString("linear"), texture.magFilter))
+        {
+            cout << path << ": texture " << texture.name << " has an unknown wrap mode or filter" << endl;
+            return false;
+        }
+        scene.textures.push_back(texture);
+    }
+
+    const JsonValue &materials = root["materials"];
+    for(size_t i = 0; i < materials.size(); i++)
+    {
+        SceneMaterial material;
+        material.name = materials[i]["name"].getString("");
+        material.ambient = materials[i]["ambient"].getVec3(material.ambient);
+        material.diffuse = materials[i]["diffuse"].getVec3(material.diffuse);
+        material.specular = materials[i]["specular"].getVec3(material.specular);
+        material.shininess = (float)materials[i]["shininess"].getNumber(material.shininess);
+        material.diffuseMap = readSceneReference(materials[i]["diffuseMap"], scene.textures);
+        material.specularMap = readSceneReference(materials[i]["specularMap"], scene.textures);
+        if(material.diffuseMap == -2 || material.specularMap == -2 || (material.diffuseMap < 0) != (material.specularMap < 0))
+        {
+            cout << path << ": material " << material.name << " needs both a known diffuseMap and specularMap, or neither" << endl;
+            return false;
+        }
+        scene.materials.push_back(material);
+    }
+
+    const JsonValue &meshes = root["meshes"];
+    for(size_t i = 0; i < meshes.size(); i++)
+    {
+        SceneMesh mesh;
+        mesh.name = meshes[i]["name"].getString("");
+        int type = findSceneName(SCENE_MESH_TYPES, meshes[i]["type"].getString("cube"));
+        int sphereType = findSceneName(SCENE_SPHERE_TYPES, meshes[i]["sphereType"].getString("uv"));
+        if(type < 0 || sphereType < 0)
+        {
+            cout << path << ": mesh " << mesh.name << " has an unknown type" << endl;
+            return false;
+        }
+        mesh.type = (SceneMeshType)type;
+        mesh.sphereType = (SphereType)sphereType;
+        mesh.path = meshes[i]["path"].getString("");
+        const JsonValue &range = meshes[i]["textureRange"];
+        for(int c = 0; c < 4 && range.size() == 4; c++)
+            mesh.textureRange[c] = (float)range[c].getNumber();
+        // range checked as doubles first, like readSceneReference()
+        double sectors = meshes[i]["sectors"].getNumber(mesh.sectors);
+        double stacks = meshes[i]["stacks"].getNumber(mesh.stacks);
+        if(!isSceneSphereSegments(sectors, MIN_SECTOR_COUNT) || !isSceneSphereSegments(stacks, MIN_STACK_COUNT))
+        {
+            cout << path << ": mesh " << mesh.name << " needs whole sectors and stacks up to " << SCENE_MAX_SPHERE_SEGMENTS << endl;
+            return false;
+        }
+        mesh.sectors = (int)sectors;
+        mesh.stacks = (int)stacks;
+        scene.meshes.push_back(mesh);
+    }
+
+    const JsonValue &lights = root["lights"];
+    const JsonValue &directional = lights["directional"];
+    if(directional.isObject())
+    {
+        glm::vec3 d = directional["direction"].getVec3(glm::vec3(-0.2f, -1.0f, -0.3f));
+        glm::vec3 a = directional["ambient"].getVec3(glm::vec3(0.05f));
+        glm::vec3 f = directional["diffuse"].getVec3(glm::vec3(0.4f));
+        glm::vec3 s = directional["specular"].getVec3(glm::vec3(0.5f));
+        scene.dirLight = DirectionLight(d.x, d.y, d.z, a.x, a.y, a.z, f.x, f.y, f.z, s.x, s.y, s.z);
+    }
+    const JsonValue &points = lights["point"];
+    if(points.size() > (size_t)MAX_SCENE_POINT_LIGHTS)
+        cout << path << ": only the first " << MAX_SCENE_POINT_LIGHTS << " point lights are used" << endl;
+    for(size_t i = 0; i < points.size() && i < (size_t)MAX_SCENE_POINT_LIGHTS; i++)
+        scene.pointLights.push_back(readScenePointLight(points[i], (int)i + 1));
+    const JsonValue &spot = lights["spot"];
+    if(spot.isObject())
+    {
+        glm::vec3 p = spot["position"].getVec3(scene.cameraPosition);
+        glm::vec3 d = spot["direction"].getVec3(glm::vec3(0.0f, 0.0f, -1.0f));
+        glm::vec3 a = spot["ambient"].getVec3(glm::vec3(0.0f));
+        glm::vec3 f = spot["diffuse"].getVec3(glm::vec3(1.0f));
+        glm::vec3 s = spot["specular"].getVec3(glm::vec3(1.0f));
+        glm::vec3 k = spot["attenuation"].getVec3(glm::vec3(1.0f, 0.09f, 0.032f));
+        scene.spotLight = SpotLight(p.x, p.y, p.z, d.x, d.y, d.z, a.x, a.y, a.z, f.x, f.y, f.z, s.x, s.y, s.z, k.x, k.y, k.z,
+                                    (float)spot["cutOff"].getNumber(12.5), (float)spot["outerCutOff"].getNumber(15.0));
+        scene.spotLightFollowsCamera = spot["followCamera"].getBool(false);
+    }
+
+    return readSceneNodes(root["nodes"], -1, scene, path);
+}
+
+string toJsonVec3(const glm::vec3 &v)
+{
+    return toJsonArray(&v[0], 3);
+}
+
+void writeSceneNodeJson(ofstream &out, const SceneData &scene, const vector<vector<int> > &children, int node, const string &indent)
+{
+    const SceneNode &n = scene.nodes[node];
+    out << indent << "{ \"name\": " << toJsonString(n.name);
+    if(n.mesh >= 0)
+        out << ", \"mesh\": " << toJsonString(scene.meshes[n.mesh].name);
+    if(n.material >= 0)
+        out << ", \"material\": " << toJsonString(scene.materials[n.material].name);
+    // a plain translation is written as one, everything else as the whole matrix
+    glm::mat4 translation = glm::translate(glm::mat4(1.0f), glm::vec3(n.local[3]));
+    if(n.local == translation)
+        out << ", \"translation\": " << toJsonVec3(glm::vec3(n.local[3]));
+    else
+        out << ", \"matrix\": " << toJsonArray(&n.local[0][0], 16);
+    if(!children[node].empty())
+    {
+        out << ", \"children\": [\n";
+        for(size_t i = 0; i < children[node].size(); i++)
+        {
+            writeSceneNodeJson(out, scene, children, children[node][i], indent + "    ");
+            out << (i + 1 < children[node].size() ? ",\n" : "\n");
+        }
+        out << indent << "]";
+    }
+    out << " }";
+}
+
+// writes the authoring form; references are by name, so names should be unique
+bool writeSceneJson(const string &path, const SceneData &scene)
+{
+    ofstream out(path.c_str());
+    if(!out)
+    {
+        cout << "scene " << path << " could not be opened for writing" << endl;
+        return false;
+    }
+    out << "{\n    \"shaderDirectory\": " << toJsonString(scene.shaderDirectory) << ",\n";
+    out << "    \"camera\": { \"position\": " << toJsonVec3(scene.cameraPosition) << " },\n";
+    out << "    \"textures\": [\n";
+    for(size_t i = 0; i < scene.textures.size(); i++)
+    {
+        const SceneTexture &t = scene.textures[i];
+        out << "        { \"name\": " << toJsonString(t.name) << ", \"path\": " << toJsonString(t.path)
+            << ", \"wrapS\": \"" << getSceneEnumName(SCENE_WRAP_MODES, t.wrapS) << "\", \"wrapT\": \"" << getSceneEnumName(SCENE_WRAP_MODES, t.wrapT)
+            << "\", \"minFilter\": \"" << getSceneEnumName(SCENE_FILTERS, t.minFilter) << "\", \"magFilter\": \"" << getSceneEnumName(SCENE_FILTERS, t.magFilter)
+            << "\" }" << (i + 1 < scene.textures.size() ? ",\n" : "\n");
+    }
+    out << "    ],\n    \"materials\": [\n";
+    for(size_t i = 0; i < scene.materials.size(); i++)
+    {
+        const SceneMaterial &m = scene.materials[i];
+        out << "        { \"name\": " << toJsonString(m.name);
+        if(m.diffuseMap >= 0)
+            out << ", \"diffuseMap\": " << toJsonString(scene.textures[m.diffuseMap].name) << ", \"specularMap\": " << toJsonString(scene.textures[m.specularMap].name);
+        else
+            out << ", \"ambient\": " << toJsonVec3(m.ambient) << ", \"diffuse\": " << toJsonVec3(m.diffuse) << ", \"specular\": " << toJsonVec3(m.specular);
+        out << ", \"shininess\": " << toJsonNumber(m.shininess) << " }" << (i + 1 < scene.materials.size() ? ",\n" : "\n");
+    }
+    out << "    ],\n    \"meshes\": [\n";
+    for(size_t i = 0; i < scene.meshes.size(); i++)
+    {
+        const SceneMesh &m = scene.meshes[i];
+        out << "        { \"name\": " << toJsonString(m.name) << ", \"type\": \"" << SCENE_MESH_TYPES[m.type] << "\"";
+        if(m.type == SCENE_MESH_CUBE)
+            out << ", \"textureRange\": " << toJsonArray(&m.textureRange[0], 4);
+        else if(m.type == SCENE_MESH_SPHERE)
+            out << ", \"sectors\": " << m.sectors << ", \"stacks\": " << m.stacks << ", \"sphereType\": \"" << SCENE_SPHERE_TYPES[m.sphereType] << "\"";
+        else
+            out << ", \"path\": " << toJsonString(m.path);
+        out << " }" << (i + 1 < scene.meshes.size() ? ",\n" : "\n");
+    }
+    const DirectionLight &d = scene.dirLight;
+    out << "    ],\n    \"lights\": {\n";
+    out << "        \"directional\": { \"direction\": " << toJsonVec3(d.direction) << ", \"ambient\": " << toJsonVec3(d.ambient)
+        << ", \"diffuse\": " << toJsonVec3(d.diffuse) << ", \"specular\": " << toJsonVec3(d.specular) << " },\n";
+    out << "        \"point\": [\n";
+    for(size_t i = 0; i < scene.pointLights.size(); i++)
+    {
+        const PointLight &p = scene.pointLights[i];
+        out << "            { \"position\": " << toJsonVec3(p.position) << ", \"ambient\": " << toJsonVec3(p.ambient) << ", \"diffuse\": " << toJsonVec3(p.diffuse)
+            << ", \"specular\": " << toJsonVec3(p.specular) << ", \"attenuation\": " << toJsonVec3(glm::vec3(p.k_c, p.k_l, p.k_q))
+            << " }" << (i + 1 < scene.pointLights.size() ? ",\n" : "\n");
+    }
+    const SpotLight &s = scene.spotLight;
+    out << "        ],\n        \"spot\": { \"position\": " << toJsonVec3(s.position) << ", \"direction\": " << toJsonVec3(s.direction)
+        << ", \"ambient\": " << toJsonVec3(s.ambient) << ", \"diffuse\": " << toJsonVec3(s.diffuse) << ", \"specular\": " << toJsonVec3(s.specular)
+        << ", \"attenuation\": " << toJsonVec3(glm::vec3(s.k_c, s.k_l, s.k_q)) << ", \"cutOff\": " << toJsonNumber(s.cutOff) << ", \"outerCutOff\": " << toJsonNumber(s.outerCuttOff)
+        << ", \"followCamera\": " << (scene.spotLightFollowsCamera ? "true" : "false") << " }\n    },\n";
+
+    vector<vector<int> > children(scene.nodes.size());
+    vector<int> roots;
+    for(size_t i = 0; i < scene.nodes.size(); i++)
+    {
+        if(scene.nodes[i].parent < 0)
+            roots.push_back((int)i);
+        else
+            children[scene.nodes[i].parent].push_back((int)i);
+    }
+    out << "    \"nodes\": [\n";
+    for(size_t i = 0; i < roots.size(); i++)
+    {
+        writeSceneNodeJson(out, scene, children, roots[i], "        ");
+        out << (i + 1 < roots.size() ? ",\n" : "\n");
+    }
+    out << "    ]\n}\n";
+    if(!out)
+    {
+        cout << "scene " << path << " could not be written" << endl;
+        return false;
+    }
+    return true;
+}
+
+// ---- compiled binary form, little-endian, version 1:
+//   SceneFileHeader
+//   SceneFileTexture[textureCount], SceneFileMaterial[materialCount], SceneFileMesh[meshCount]
+//   SceneFileLight[2 + pointLightCount]     directional, spot, then the point lights
+//   string blob at stringsOffset            NUL terminated, records hold offsets into it
+//   SceneFileNode[nodeCount] at nodesOffset parents first, read in batches while streaming
+// Everything up to the nodes is read when the file is opened.
+const char SCENE_FILE_MAGIC[4] = { 'S', 'C', 'N', 'E' };
+const uint32_t SCENE_FILE_VERSION = 1;
+const uint32_t SCENE_FILE_SPOT_FOLLOWS_CAMERA = 1;
+
+struct SceneFileHeader{
+    char magic[4];
+    uint32_t version;
+    uint32_t textureCount;
+    uint32_t materialCount;
+    uint32_t meshCount;
+    uint32_t pointLightCount;
+    uint32_t nodeCount;
+    uint32_t flags;
+    uint32_t shaderDirectory;           // string offset
+    float cameraPosition[3];
+    uint64_t stringsOffset;
+    uint64_t stringBytes;
+    uint64_t nodesOffset;
+};
+
+struct SceneFileTexture{
+    uint32_t name, path;
+    uint32_t wrapS, wrapT, minFilter, magFilter;
+};
+
+struct SceneFileMaterial{
+    uint32_t name;
+    float ambient[3], diffuse[3], specular[3];
+    float shininess;
+    int32_t diffuseMap, specularMap;
+};
+
+struct SceneFileMesh{
+    uint32_t name, type, path;
+    float textureRange[4];
+    int32_t sectors, stacks, sphereType;
+};
+
+struct SceneFileLight{
+    float position[3], direction[3];
+    float ambient[3], diffuse[3], specular[3];
+    float attenuation[3];               // k_c, k_l, k_q
+    float cutOff, outerCutOff;
+};
+
+struct SceneFileNode{
+    uint32_t name;
+    int32_t parent, mesh, material;
+    float local[16];                    // column major
+};
+
+// appends a string to the blob, returns its offset
+uint32_t addSceneString(string &blob, const string &text)
+{
+    uint32_t offset = (uint32_t)blob.size();
+    blob += text;
+    blob += '\0';
+    return offset;
+}
+
+SceneFileLight makeSceneFileLight(const glm::vec3 &position, const glm::vec3 &direction, const glm::vec3 &ambient, const glm::vec3 &diffuse,
+                                  const glm::vec3 &specular, const glm::vec3 &attenuation, float cutOff, float outerCutOff)
+{
+    SceneFileLight light;
+    memcpy(light.position, &position[0], sizeof(light.position));
+    memcpy(light.direction, &direction[0], sizeof(light.direction));
+    memcpy(light.ambient, &ambient[0], sizeof(light.ambient));
+    memcpy(light.diffuse, &diffuse[0], sizeof(light.diffuse));
+    memcpy(light.specular, &specular[0], sizeof(light.specular));
+    memcpy(light.attenuation, &attenuation[0], sizeof(light.attenuation));
+    light.cutOff = cutOff;
+    light.outerCutOff = outerCutOff;
+    return light;
+}
+
+// compiles a scene; the file keeps relative paths, so it belongs next to its JSON source
+bool writeSceneFile(const string &path, const SceneData &scene)
+{
+    string strings;
+    SceneFileHeader header;
+    memcpy(header.magic, SCENE_FILE_MAGIC, 4);
+    header.version = SCENE_FILE_VERSION;
+    header.textureCount = (uint32_t)scene.textures.size();
+    header.materialCount = (uint32_t)scene.materials.size();
+    header.meshCount = (uint32_t)scene.meshes.size();
+    header.pointLightCount = (uint32_t)scene.pointLights.size();
+    header.nodeCount = (uint32_t)scene.nodes.size();
+    header.flags = scene.spotLightFollowsCamera ? SCENE_FILE_SPOT_FOLLOWS_CAMERA : 0;
+    header.shaderDirectory = addSceneString(strings, scene.shaderDirectory);
+    memcpy(header.cameraPosition, &scene.cameraPosition[0], sizeof(header.cameraPosition));
+
+    vector<SceneFileTexture> textures(scene.textures.size());
+    for(size_t i = 0; i < textures.size(); i++)
+    {
+        const SceneTexture &t = scene.textures[i];
+        textures[i].name = addSceneString(strings, t.name);
+        textures[i].path = addSceneString(strings, t.path);
+        textures[i].wrapS = t.wrapS;
+        textures[i].wrapT = t.wrapT;
+        textures[i].minFilter = t.minFilter;
+        textures[i].magFilter = t.magFilter;
+    }
+    vector<SceneFileMaterial> materials(scene.materials.size());
+    for(size_t i = 0; i < materials.size(); i++)
+    {
+        const SceneMaterial &m = scene.materials[i];
+        materials[i].name = addSceneString(strings, m.name);
+        memcpy(materials[i].ambient, &m.ambient[0], sizeof(materials[i].ambient));
+        memcpy(materials[i].diffuse, &m.diffuse[0], sizeof(materials[i].diffuse));
+        memcpy(materials[i].specular, &m.specular[0], sizeof(materials[i].specular));
+        materials[i].shininess = m.shininess;
+        materials[i].diffuseMap = m.diffuseMap;
+        materials[i].specularMap = m.specularMap;
+    }
+    vector<SceneFileMesh> meshes(scene.meshes.size());
+    for(size_t i = 0; i < meshes.size(); i++)
+    {
+        const SceneMesh &m = scene.meshes[i];
+        meshes[i].name = addSceneString(strings, m.name);
+        meshes[i].type = m.type;
+        meshes[i].path = addSceneString(strings, m.path);
+        memcpy(meshes[i].textureRange, &m.textureRange[0], sizeof(meshes[i].textureRange));
+        meshes[i].sectors = m.sectors;
+        meshes[i].stacks = m.stacks;
+        meshes[i].sphereType = m.sphereType;
+    }
+    vector<SceneFileLight> lights;
+    const DirectionLight &d = scene.dirLight;
+    lights.push_back(makeSceneFileLight(glm::vec3(0.0f), d.direction, d.ambient, d.diffuse, d.specular, glm::vec3(0.0f), 0.0f, 0.0f));
+    const SpotLight &s = scene.spotLight;
+    lights.push_back(makeSceneFileLight(s.position, s.direction, s.ambient, s.diffuse, s.specular, glm::vec3(s.k_c, s.k_l, s.k_q), s.cutOff, s.outerCuttOff));
+    for(size_t i = 0; i < scene.pointLights.size(); i++)
+    {
+        const PointLight &p = scene.pointLights[i];
+        lights.push_back(makeSceneFileLight(p.position, glm::vec3(0.0f), p.ambient, p.diffuse, p.specular, glm::vec3(p.k_c, p.k_l, p.k_q), 0.0f, 0.0f));
+    }
+    vector<SceneFileNode> nodes(scene.nodes.size());
+    for(size_t i = 0; i < nodes.size(); i++)
+    {
+        const SceneNode &n = scene.nodes[i];
+        nodes[i].name = addSceneString(strings, n.name);
+        nodes[i].parent = n.parent;
+        nodes[i].mesh = n.mesh;
+        nodes[i].material = n.material;
+        memcpy(nodes[i].local, &n.local[0][0], sizeof(nodes[i].local));
+    }
+
+    header.stringsOffset = sizeof(header) + textures.size() * sizeof(SceneFileTexture) + materials.size() * sizeof(SceneFileMaterial)
+                         + meshes.size() * sizeof(SceneFileMesh) + lights.size() * sizeof(SceneFileLight);
+    header.stringBytes = strings.size();
+    header.nodesOffset = (header.stringsOffset + header.stringBytes + 15) / 16 * 16;
+
+    ofstream out(path.c_str(), ios::binary | ios::trunc);
+    if(!out)
+    {
+        cout << "scene " << path << " could not be opened for writing" << endl;
+        return false;
+    }
+    out.write((const char*)&header, sizeof(header));
+    if(!textures.empty())
+        out.write((const char*)textures.data(), textures.size() * sizeof(SceneFileTexture));
+    if(!materials.empty())
+        out.write((const char*)materials.data(), materials.size() * sizeof(SceneFileMaterial));
+    if(!meshes.empty())
+        out.write((const char*)meshes.data(), meshes.size() * sizeof(SceneFileMesh));
+    out.write((const char*)lights.data(), lights.size() * sizeof(SceneFileLight));
+    out.write(strings.data(), strings.size());
+    const char padding[16] = { 0 };
+    out.write(padding, header.nodesOffset - header.stringsOffset - header.stringBytes);
+    if(!nodes.empty())
+        out.write((const char*)nodes.data(), nodes.size() * sizeof(SceneFileNode));
+    if(!out)
+    {
+        cout << "scene " << path << " could not be written" << endl;
+        return false;
+    }
+    return true;
+}
+
+// Reads a compiled scene from a mapping. open() fills in everything but the nodes,
+// which streamNodes() then appends in batches, so a large scene can be brought in
+// over several frames while the pages behind it are read ahead.
+class SceneStream{
+public:
+    ~SceneStream()
+    {
+        close();
+    }
+
+    bool open(const string &path, SceneData &scene)
+    {
+        close();
+        file = new MappedFile(path);
+        if(!file->isOpen() || !readHeader(scene))
+        {
+            cout << "scene " << path << " is not a valid version " << SCENE_FILE_VERSION << " scene file" << endl;
+            close();
+            return false;
+        }
+        size_t slash = path.rfind('/');
+        scene.directory = slash == string::npos ? string() : path.substr(0, slash + 1);
+        return true;
+    }
+
+    // appends up to maxNodes nodes to scene, returns how many; false from isValid() on a bad node
+    int streamNodes(SceneData &scene, int maxNodes)
+    {
+        if(!file)
+            return 0;
+        uint32_t last = header.nodeCount - nextNode < (uint32_t)maxNodes ? header.nodeCount : nextNode + maxNodes;
+        const unsigned char *records = file->getData() + header.nodesOffset;
+        int added = 0;
+        for(; nextNode < last; nextNode++, added++)
+        {
+            SceneFileNode record;
+            memcpy(&record, records + (size_t)nextNode * sizeof(SceneFileNode), sizeof(record));
+            if(record.parent >= (int32_t)nextNode || record.parent < -1 || record.mesh >= (int32_t)header.meshCount || record.mesh < -1
+               || record.material >= (int32_t)header.materialCount || record.material < -1 || record.name >= header.stringBytes)
+            {
+                cout << "scene node " << nextNode << " is not valid" << endl;
+                valid = false;
+                close();
+                return added;
+            }
+            SceneNode node;
+            node.name = getString(record.name);
+            node.parent = record.parent;
+            node.mesh = record.mesh;
+            node.material = record.material;
+            memcpy(&node.local[0][0], record.local, sizeof(record.local));
+            scene.nodes.push_back(node);
+        }
+        if(nextNode == header.nodeCount)
+            close();
+        return added;
+    }
+
+    bool isDone() const
+    {
+        return file == NULL;
+    }
+
+    bool isValid() const
+    {
+        return valid;
+    }
+
+    size_t getNodeCount() const
+    {
+        return header.nodeCount;
+    }
+
+private:
+    MappedFile *file = NULL;
+    SceneFileHeader header;
+    uint32_t nextNode = 0;
+    bool valid = true;
+
+    void close()
+    {
+        delete file;
+        file = NULL;
+    }
+
+    const char* getString(uint32_t offset) const
+    {
+        return (const char*)file->getData() + header.stringsOffset + offset;
+    }
+
+    bool readHeader(SceneData &scene)
+    {
+        const unsigned char *data = file->getData();
+        uint64_t size = file->getSize();
+        if(size < sizeof(header))
+            return false;
+        memcpy(&header, data, sizeof(header));
+        if(memcmp(header.magic, SCENE_FILE_MAGIC, 4) != 0 || header.version != SCENE_FILE_VERSION || header.pointLightCount > (uint32_t)MAX_SCENE_POINT_LIGHTS)
+            return false;
+        uint64_t tables = sizeof(header) + (uint64_t)header.textureCount * sizeof(SceneFileTexture) + (uint64_t)header.materialCount * sizeof(SceneFileMaterial)
+                        + (uint64_t)header.meshCount * sizeof(SceneFileMesh) + (2 + (uint64_t)header.pointLightCount) * sizeof(SceneFileLight);
+        // the blob has to end in a NUL, so every string in it is terminated
+        if(header.stringsOffset != tables || header.stringBytes == 0 || header.stringsOffset + header.stringBytes > size
+           || data[header.stringsOffset + header.stringBytes - 1] != 0 || header.nodesOffset < header.stringsOffset + header.stringBytes
+           || header.nodesOffset + (uint64_t)header.nodeCount * sizeof(SceneFileNode) > size || header.shaderDirectory >= header.stringBytes)
+            return false;
+
+        scene = SceneData();
+        scene.shaderDirectory = getString(header.shaderDirectory);
+        scene.cameraPosition = glm::vec3(header.cameraPosition[0], header.cameraPosition[1], header.cameraPosition[2]);
+        scene.spotLightFollowsCamera = (header.flags & SCENE_FILE_SPOT_FOLLOWS_CAMERA) != 0;
+        const unsigned char *p = data + sizeof(header);
+        for(uint32_t i = 0; i < header.textureCount; i++, p += sizeof(SceneFileTexture))
+        {
+            SceneFileTexture record;
+            memcpy(&record, p, sizeof(record));
+            if(record.name >= header.stringBytes || record.path >= header.stringBytes)
+                return false;
+            SceneTexture texture;
+            texture.name = getString(record.name);
+            texture.path = getString(record.path);
+            texture.wrapS = record.wrapS;
+            texture.wrapT = record.wrapT;
+            texture.minFilter = record.minFilter;
+            texture.magFilter = record.magFilter;
+            scene.textures.push_back(texture);
+        }
+        for(uint32_t i = 0; i < header.materialCount; i++, p += sizeof(SceneFileMaterial))
+        {
+            SceneFileMaterial record;
+            memcpy(&record, p, sizeof(record));
+            if(record.name >= header.stringBytes || record.diffuseMap >= (int32_t)header.textureCount || record.specularMap >= (int32_t)header.textureCount
+               || (record.diffuseMap < 0) != (record.specularMap < 0))
+                return false;
+            SceneMaterial material;
+            material.name = getString(record.name);
+            material.ambient = glm::vec3(record.ambient[0], record.ambient[1], record.ambient[2]);
+            material.diffuse = glm::vec3(record.diffuse[0], record.diffuse[1], record.diffuse[2]);
+            material.specular = glm::vec3(record.specular[0], record.specular[1], record.specular[2]);
+            material.shininess = record.shininess;
+            material.diffuseMap = record.diffuseMap < 0 ? -1 : record.diffuseMap;
+            material.specularMap = record.specularMap < 0 ? -1 : record.specularMap;
+            scene.materials.push_back(material);
+        }
+        for(uint32_t i = 0; i < header.meshCount; i++, p += sizeof(SceneFileMesh))
+        {
+            SceneFileMesh record;
+            memcpy(&record, p, sizeof(record));
+            if(record.name >= header.stringBytes || record.path >= header.stringBytes || record.type > SCENE_MESH_FILE
+               || record.sphereType < UV_SPHERE || record.sphereType > CUBE_SPHERE
+               || !isSceneSphereSegments(record.sectors, MIN_SECTOR_COUNT) || !isSceneSphereSegments(record.stacks, MIN_STACK_COUNT))
+                return false;
+            SceneMesh mesh;
+            mesh.name = getString(record.name);
+            mesh.type = (SceneMeshType)record.type;
+            mesh.path = getString(record.path);
+            mesh.textureRange = glm::vec4(record.textureRange[0], record.textureRange[1], record.textureRange[2], record.textureRange[3]);
+            mesh.sectors = record.sectors;
+            mesh.stacks = record.stacks;
+            mesh.sphereType = (SphereType)record.sphereType;
+            scene.meshes.push_back(mesh);
+        }
+        SceneFileLight lights[2 + MAX_SCENE_POINT_LIGHTS];
+        memcpy(lights, p, (2 + header.pointLightCount) * sizeof(SceneFileLight));
+        const SceneFileLight &d = lights[0], &s = lights[1];
+        scene.dirLight = DirectionLight(d.direction[0], d.direction[1], d.direction[2], d.ambient[0], d.ambient[1], d.ambient[2],
+                                        d.diffuse[0], d.diffuse[1], d.diffuse[2], d.specular[0], d.specular[1], d.specular[2]);
+        scene.spotLight = SpotLight(s.position[0], s.position[1], s.position[2], s.direction[0], s.direction[1], s.direction[2],
+                                    s.ambient[0], s.ambient[1], s.ambient[2], s.diffuse[0], s.diffuse[1], s.diffuse[2], s.specular[0], s.specular[1], s.specular[2],
+                                    s.attenuation[0], s.attenuation[1], s.attenuation[2], s.cutOff, s.outerCutOff);
+        for(uint32_t i = 0; i < header.pointLightCount; i++)
+        {
+            const SceneFileLight &l = lights[2 + i];
+            scene.pointLights.push_back(PointLight(l.position[0], l.position[1], l.position[2], l.ambient[0], l.ambient[1], l.ambient[2],
+                                                   l.diffuse[0], l.diffuse[1], l.diffuse[2], l.specular[0], l.specular[1], l.specular[2],
+                                                   l.attenuation[0], l.attenuation[1], l.attenuation[2], (int)i + 1));
+        }
+        nextNode = 0;
+        valid = true;
+        return true;
+    }
+};
+
+// loads either form completely, without creating any GL objects
+bool loadSceneData(const string &path, SceneData &scene)
+{
+    if(path.size() < 6 || path.compare(path.size() - 6, 6, ".scene") != 0)
+        return loadSceneJson(path, scene);
+    SceneStream stream;
+    if(!stream.open(path, scene))
+        return false;
+    while(!stream.isDone())
+        stream.streamNodes(scene, SCENE_STREAM_BATCH);
+    return stream.isValid();
+}
+
+// ---- the scene on the GPU
+
+// The renderer's view of a scene: world matrices of the loaded nodes plus the textures
+// and meshes they use, created when the first node needing them comes in. JSON scenes
+// load whole; compiled (.scene) scenes stream in SCENE_STREAM_BATCH nodes per update().
+class Scene{
+public:
+    SceneData data;
+    vector<glm::mat4> worldMatrices;    // one per loaded node, parent * local
+
+    Scene() {}
+
+    ~Scene()
+    {
+        release();
+    }
+
+    bool load(const string &path)
+    {
+        release();
+        bool compiled = path.size() >= 6 && path.compare(path.size() - 6, 6, ".scene") == 0;
+        if(compiled ? !stream.open(path, data) : !loadSceneJson(path, data))
+            return false;
+        textures.assign(data.textures.size(), 0);
+        cubes.assign(data.meshes.size(), NULL);
+        spheres.assign(data.meshes.size(), NULL);
+        assets.assign(data.meshes.size(), NULL);
+        meshFailed.assign(data.meshes.size(), false);
+        addNodes(0);
+        return true;
+    }
+
+    // streams in the next nodes of a compiled scene; false once all of them are in
+    bool update(int maxNodes = SCENE_STREAM_BATCH)
+    {
+        if(stream.isDone())
+            return false;
+        int first = (int)data.nodes.size();
+        stream.streamNodes(data, maxNodes);
+        addNodes(first);
+        return !stream.isDone();
+    }
+
+    bool isStreaming() const
+    {
+        return !stream.isDone();
+    }
+
+    int getNodeCount() const
+    {
+        return (int)worldMatrices.size();
+    }
+
+    string getShaderDirectory() const
+    {
+        string directory = data.resolvePath(data.shaderDirectory);
+        if(!directory.empty() && directory[directory.size() - 1] != '/')
+            directory += '/';
+        return directory;
+    }
+
+    // sets up every light of the scene on a lighting shader
+    void setUpLights(Shader &lightingShader)
+    {
+        data.dirLight.setUpDirectionLight(lightingShader);
+        for(size_t i = 0; i < data.pointLights.size(); i++)
+            data.pointLights[i].setUpPointLight(lightingShader);
+        data.spotLight.setUpSpotLight(lightingShader);
+    }
+
+    bool isDrawable(int node) const
+    {
+        int mesh = data.nodes[node].mesh;
+        return mesh >= 0 && !(data.meshes[mesh].type == SCENE_MESH_FILE && !assets[mesh]);
+    }
+
+    SceneProgram getProgram(int node) const
+    {
+        const SceneNode &n = data.nodes[node];
+        bool textured = n.material >= 0 && data.materials[n.material].diffuseMap >= 0;
+        // spheres have no texture coordinates
+        return (textured && data.meshes[n.mesh].type != SCENE_MESH_SPHERE) ? SCENE_PROGRAM_TEXTURED : SCENE_PROGRAM_MATERIAL;
+    }
+
+    // adds the scene's materials to registry; nodes drawn with SCENE_PROGRAM_MATERIAL then
+    // take theirs from it by getMaterialIndex() instead of through material.* uniforms
+    void registerMaterials(MaterialRegistry &registry)
+    {
+        materialIndices.resize(data.materials.size());
+        for(size_t i = 0; i < data.materials.size(); i++)
+        {
+            const SceneMaterial &m = data.materials[i];
+            materialIndices[i] = registry.add(m.ambient, m.diffuse, m.specular, m.shininess);
+        }
+        defaultMaterialIndex = registry.add(defaultMaterial.ambient, defaultMaterial.diffuse, defaultMaterial.specular, defaultMaterial.shininess);
+    }
+
+    // registry index for TransformBuffer::add(), -1 for textured nodes or before registerMaterials()
+    int getMaterialIndex(int node) const
+    {
+        if(materialIndices.empty() || getProgram(node) != SCENE_PROGRAM_MATERIAL)
+            return -1;
+        int material = data.nodes[node].material;
+        return material >= 0 ? materialIndices[material] : defaultMaterialIndex;
+    }
+
+    // adds the scene's cube and sphere meshes to pool; nodes with a registry material can
+    // then be drawn from it in a MultiDrawList by getPoolMesh()
+    void registerMeshes(MeshPool &pool)
+    {
+        poolMeshes.assign(data.meshes.size(), -1);
+        for(size_t i = 0; i < data.meshes.size(); i++)
+        {
+            const SceneMesh &m = data.meshes[i];
+            if(m.type == SCENE_MESH_CUBE)
+                poolMeshes[i] = pool.addCube();
+            else if(m.type == SCENE_MESH_SPHERE)
+                poolMeshes[i] = pool.addSphereLevels(m.sectors, m.stacks, m.sphereType);
+        }
+    }
+
+    // pool mesh of a node drawn with the material buffer, -1 when it has to be drawn with drawNode()
+    int getPoolMesh(int node) const
+    {
+        if(poolMeshes.empty() || getMaterialIndex(node) < 0)
+            return -1;
+        return poolMeshes[data.nodes[node].mesh] + getLod(node);
+    }
+
+    // Picks this frame's level of a sphere node from its world bounding sphere as seen from
+    // eye, with the sphere's hysteresis against the node's level of the last frame. Every
+    // pass of the frame draws that level, so the GL_EQUAL pass after the depth pre-pass and
+    // the pooled draws see exactly the same triangles.
+    void selectLod(int node, const glm::vec4 &bounds, const glm::vec3 &eye, float fovyDegrees, int viewportHeight)
+    {
+        int mesh = data.nodes[node].mesh;
+        if(mesh < 0 || data.meshes[mesh].type != SCENE_MESH_SPHERE)
+            return;
+        nodeLods[node] = spheres[mesh]->selectLod(Sphere::projectedRadius(bounds, eye, fovyDegrees, viewportHeight), nodeLods[node]);
+    }
+
+    // level the node is drawn with, 0 until selectLod() picked one
+    int getLod(int node) const
+    {
+        return nodeLods[node] < 0 ? 0 : nodeLods[node];
+    }
+
+    // nodeMatrix is the node's world matrix under the caller's root transform; draws use
+    // this matrix, which adds what the mesh itself needs (e.g. quantized positions)
+    glm::mat4 getDrawMatrix(int node, const glm::mat4 &nodeMatrix) const
+    {
+        int mesh = data.nodes[node].mesh;
+        if(data.meshes[mesh].type == SCENE_MESH_SPHERE)
+            return spheres[mesh]->getModelMatrix(nodeMatrix);
+        if(data.meshes[mesh].type == SCENE_MESH_FILE)
+            return assets[mesh]->getModelMatrix(nodeMatrix);
+        return nodeMatrix;
+    }
+
+    // world bounding sphere under nodeMatrix: xyz = center, w = radius
+    glm::vec4 getBoundingSphere(int node, const glm::mat4 &nodeMatrix) const
+    {
+        int mesh = data.nodes[node].mesh;
+        if(data.meshes[mesh].type == SCENE_MESH_SPHERE)
+            return spheres[mesh]->getBoundingSphere(nodeMatrix);
+        if(data.meshes[mesh].type == SCENE_MESH_FILE)
+            return assets[mesh]->getBoundingSphere(nodeMatrix);
+        return cubes[mesh]->getBoundingSphere(nodeMatrix);
+    }
+
+    // lit draw with the node's material, on the shader of getProgram()
+    void drawNode(int node, Shader &shader, int objectIndex)
+    {
+        const SceneNode &n = data.nodes[node];
+        const SceneMaterial &material = n.material >= 0 ? data.materials[n.material] : defaultMaterial;
+        bool textured = getProgram(node) == SCENE_PROGRAM_TEXTURED;
+        if(getMaterialIndex(node) >= 0)
+        {
+            // the material comes with the transform, only the geometry is left to draw
+            if(data.meshes[n.mesh].type == SCENE_MESH_CUBE)
+                cubes[n.mesh]->drawCubeWithMaterialBuffer(shader, objectIndex);
+            else
+                drawNodeDepthOnly(node, shader, objectIndex);
+            return;
+        }
+        if(data.meshes[n.mesh].type == SCENE_MESH_CUBE)
+        {
+            Cube &cube = *cubes[n.mesh];
+            if(textured)
+            {
+                cube.setTextureProperty(textures[material.diffuseMap], textures[material.specularMap], material.shininess);
+                cube.drawCubeWithTexture(shader, objectIndex);
+            }
+            else
+            {
+                cube.setMaterialisticProperty(material.ambient, material.diffuse, material.specular, material.shininess);
+                cube.drawCubeWithMaterialisticProperty(shader, objectIndex);
+            }
+        }
+        else if(data.meshes[n.mesh].type == SCENE_MESH_SPHERE)
+        {
+            Sphere &sphere = *spheres[n.mesh];
+            sphere.ambient = material.ambient;
+            sphere.diffuse = material.diffuse;
+            sphere.specular = material.specular;
+            sphere.shininess = material.shininess;
+            sphere.drawSphere(shader, objectIndex, getLod(node));
+        }
+        else
+        {
+            shader.use();
+            if(textured)
+            {
+                shader.setInt("material.diffuse", 0);
+                shader.setInt("material.specular", 1);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, textures[material.diffuseMap]);
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, textures[material.specularMap]);
+            }
+            else
+            {
+                shader.setVec3("material.ambient", material.ambient);
+                shader.setVec3("material.diffuse", material.diffuse);
+                shader.setVec3("material.specular", material.specular);
+            }
+            shader.setFloat("material.shininess", material.shininess);
+            assets[n.mesh]->drawMesh(shader, objectIndex);
+        }
+    }
+
+    // geometry-only draw: position-only for the depth pre-pass and shadow maps, and the
+    // sphere and file meshes of nodes whose material comes from the registry
+    void drawNodeDepthOnly(int node, Shader &depthShader, int objectIndex)
+    {
+        int mesh = data.nodes[node].mesh;
+        if(data.meshes[mesh].type == SCENE_MESH_CUBE)
+            cubes[mesh]->drawCubeDepthOnly(depthShader, objectIndex);
+        else if(data.meshes[mesh].type == SCENE_MESH_SPHERE)
+        {
+            depthShader.use();
+            depthShader.setInt("objectIndex", objectIndex);
+            spheres[mesh]->drawSphereGeometry(getLod(node));
+        }
+        else
+            assets[mesh]->drawMesh(depthShader, objectIndex);
+    }
+
+private:
+    SceneStream stream;
+    SceneMaterial defaultMaterial;
+    vector<int> materialIndices;        // registry index of each material, see registerMaterials()
+    int defaultMaterialIndex = -1;
+    vector<int> poolMeshes;             // MeshPool id of each mesh (of level 0 for spheres), see registerMeshes()
+    vector<int> nodeLods;               // sphere level of each loaded node, -1 before the first selectLod()
+    vector<unsigned int> textures;      // 0 until a node needs the texture
+    vector<Cube*> cubes;                // per mesh, only the one of the mesh's type is created
+    vector<Sphere*> spheres;
+    vector<MeshAsset*> assets;
+    vector<bool> meshFailed;            // file meshes that could not be loaded, tried once
+
+    Scene(const Scene&);
+    Scene& operator=(const Scene&);
+
+    // world matrices of the nodes from first on, and whatever they draw with
+    void addNodes(int first)
+    {
+        for(int i = first; i < (int)data.nodes.size(); i++)
+        {
+            const SceneNode &node = data.nodes[i];
+            worldMatrices.push_back(node.parent < 0 ? node.local : worldMatrices[node.parent] * node.local);
+            nodeLods.push_back(-1);
+            if(node.mesh < 0)
+                continue;
+            createMesh(node.mesh);
+            if(node.material >= 0 && data.materials[node.material].diffuseMap >= 0)
+            {
+                loadSceneTexture(data.materials[node.material].diffuseMap);
+                loadSceneTexture(data.materials[node.material].specularMap);
+            }
+        }
+    }
+
+    void loadSceneTexture(int texture)
+    {
+        if(textures[texture])
+            return;
+        const SceneTexture &t = data.textures[texture];
+        textures[texture] = loadTexture(data.resolvePath(t.path).c_str(), t.wrapS, t.wrapT, t.minFilter, t.magFilter);
+    }
+
+    void createMesh(int mesh)
+    {
+        const SceneMesh &m = data.meshes[mesh];
+        if(m.type == SCENE_MESH_CUBE && !cubes[mesh])
+            cubes[mesh] = new Cube(0, 0, 32.0f, m.textureRange.x, m.textureRange.y, m.textureRange.z, m.textureRange.w);
+        else if(m.type == SCENE_MESH_SPHERE && !spheres[mesh])
+            spheres[mesh] = new Sphere(1.0f, m.sectors, m.stacks, glm::vec3(1.0f), glm::vec3(1.0f), glm::vec3(0.5f), 32.0f, false, m.sphereType);
+        else if(m.type == SCENE_MESH_FILE && !assets[mesh] && !meshFailed[mesh])
+        {
+            // a mesh that fails to load stays NULL and its nodes are not drawn
+            meshFailed[mesh] = true;
+            string path = data.resolvePath(m.path);
+            string extension = getMeshExtension(path);
+            if(extension == ".obj" || extension == ".ply")
+            {
+                ImportedMesh imported;
+                if(!importMesh(path, imported))
+                {
+                    cout << "scene mesh " << m.name << " is left out" << endl;
+                    return;
+                }
+                assets[mesh] = createMeshAsset(imported);
+            }
+            else
+            {
+                MeshAsset *asset = new MeshAsset(path);
+                if(!asset->isLoaded())
+                {
+                    cout << "scene mesh " << m.name << " is left out" << endl;
+                    delete asset;
+                    return;
+                }
+                assets[mesh] = asset;
+            }
+            meshFailed[mesh] = false;
+        }
+    }
+
+    void release()
+    {
+        for(size_t i = 0; i < textures.size(); i++)
+            if(textures[i])
+                glDeleteTextures(1, &textures[i]);
+        for(size_t i = 0; i < cubes.size(); i++)
+        {
+            delete cubes[i];
+            delete spheres[i];
+            delete assets[i];
+        }
+        textures.clear();
+        cubes.clear();
+        spheres.clear();
+        assets.clear();
+        meshFailed.clear();
+        worldMatrices.clear();
+        materialIndices.clear();
+        defaultMaterialIndex = -1;
+        poolMeshes.clear();
+        nodeLods.clear();
+        data = SceneData();
+    }
+};
+
+#endif /* scene_h */
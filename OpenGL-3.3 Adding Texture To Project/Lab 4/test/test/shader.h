@@ -5,6 +5,7 @@
 #include <glm/glm.hpp>
 
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -95,6 +96,38 @@ public:
         if(geometryPath != nullptr)
             glDeleteShader(geometry);
 
+    }
+    // transform feedback program: vertex and geometry stages only, the outputs named in
+    // varyings are captured interleaved into GL_TRANSFORM_FEEDBACK_BUFFER binding 0
+    // ------------------------------------------------------------------------
+    Shader(const char* vertexPath, const char* geometryPath, const std::vector<const char*> &varyings)
+    {
+        unsigned int vertex = compileFile(GL_VERTEX_SHADER, vertexPath, "VERTEX");
+        unsigned int geometry = compileFile(GL_GEOMETRY_SHADER, geometryPath, "GEOMETRY");
+        ID = glCreateProgram();
+        glAttachShader(ID, vertex);
+        glAttachShader(ID, geometry);
+        glTransformFeedbackVaryings(ID, (GLsizei)varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        glDeleteShader(vertex);
+        glDeleteShader(geometry);
+    }
+    // compute program, needs a GL 4.3 context
+    // ------------------------------------------------------------------------
+    explicit Shader(const char* computePath)
+    {
+#ifdef GL_COMPUTE_SHADER
+        unsigned int compute = compileFile(GL_COMPUTE_SHADER, computePath, "COMPUTE");
+        ID = glCreateProgram();
+        glAttachShader(ID, compute);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        glDeleteShader(compute);
+#else
+        ID = 0;
+        std::cout << "ERROR::SHADER::COMPUTE_SHADERS_NOT_AVAILABLE: " << computePath << std::endl;
+#endif
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -162,6 +195,32 @@ public:
     }
 
 private:
+    // reads and compiles one stage
+    // ------------------------------------------------------------------------
+    unsigned int compileFile(GLenum type, const char* path, const std::string &name)
+    {
+        std::string code;
+        std::ifstream file;
+        file.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            file.open(path);
+            std::stringstream stream;
+            stream << file.rdbuf();
+            file.close();
+            code = stream.str();
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+        }
+        const char* source = code.c_str();
+        unsigned int shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+        checkCompileErrors(shader, name);
+        return shader;
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
@@ -0,0 +1,284 @@
+//
+//  shadowMap.h
+//  test
+//
+
+#ifndef shadowMap_h
+#define shadowMap_h
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "shader.h"
+#include "spotLight.h"
+#include "frustum.h"
+#include "pointShadowMap.h"
+
+using namespace std;
+
+const int MAX_CASCADES = 4;
+// texture units of the shadow maps; kept clear of the material maps, the G-buffer and the transforms
+const int DIR_SHADOW_TEXTURE_UNIT = 13;
+const int SPOT_SHADOW_TEXTURE_UNIT = 14;
+
+// Shadow maps for the directional light and the spot light.
+// The directional light uses cascaded shadow maps: the camera frustum up to
+// shadowDistance is split into cascadeCount slices, each rendered into one layer
+// of a depth texture array with an orthographic matrix fitted around the slice.
+// The spot light uses a single perspective depth map along its cone.
+// Both are sampled with depth comparison (sampler2DArrayShadow / sampler2DShadow)
+// and a 3x3 PCF kernel in the lit shaders. Point light cube maps live in
+// pointShadows and are bound together with these.
+class ShadowRenderer{
+public:
+    bool enabled = true;
+    float shadowDistance = 30.0f;   // directional shadows end this far from the camera
+    float splitLambda = 0.75f;      // 0 = uniform splits, 1 = logarithmic splits
+    float casterExtrusion = 20.0f;  // casters this far behind a cascade, towards the light, still cast into it
+    PointShadowRenderer pointShadows;
+
+    ShadowRenderer(int resolution = 2048, int cascadeCount = 4)
+    {
+        this->resolution = resolution;
+        this->cascadeCount = glm::clamp(cascadeCount, 1, MAX_CASCADES);
+        glGenFramebuffers(1, &shadowFBO);
+        createShadowMaps();
+    }
+
+    ~ShadowRenderer()
+    {
+        deleteShadowMaps();
+        glDeleteFramebuffers(1, &shadowFBO);
+    }
+
+    // recreates the depth textures only when the resolution actually changes
+    void setResolution(int resolution)
+    {
+        if(resolution == this->resolution || resolution <= 0)
+            return;
+        this->resolution = resolution;
+        deleteShadowMaps();
+        createShadowMaps();
+    }
+
+    void setCascadeCount(int cascadeCount)
+    {
+        cascadeCount = glm::clamp(cascadeCount, 1, MAX_CASCADES);
+        if(cascadeCount == this->cascadeCount)
+            return;
+        this->cascadeCount = cascadeCount;
+        deleteShadowMaps();
+        createShadowMaps();
+    }
+
+    int getResolution() const
+    {
+        return resolution;
+    }
+
+    int getCascadeCount() const
+    {
+        return cascadeCount;
+    }
+
+    // splits the camera frustum and fits one light matrix around each slice
+    void updateCascades(const glm::mat4 &view, float fovy, float aspect, float nearPlane, glm::vec3 lightDirection)
+    {
+        lightDirection = glm::normalize(lightDirection);
+        glm::vec3 up = fabsf(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+        float splitNear = nearPlane;
+        for(int i = 0; i < cascadeCount; i++)
+        {
+            // practical split scheme: blend of logarithmic and uniform split distances
+            float p = (float)(i + 1) / cascadeCount;
+            float logSplit = nearPlane * powf(shadowDistance / nearPlane, p);
+            float uniformSplit = nearPlane + (shadowDistance - nearPlane) * p;
+            float splitFar = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+            cascadeSplits[i] = splitFar;
+
+            // corners of the slice in world space
+            glm::mat4 invSlice = glm::inverse(glm::perspective(fovy, aspect, splitNear, splitFar) * view);
+            glm::vec3 corners[8];
+            glm::vec3 center = glm::vec3(0.0f);
+            for(int c = 0; c < 8; c++)
+            {
+                glm::vec4 corner = invSlice * glm::vec4((c & 1) ? 1.0f : -1.0f, (c & 2) ? 1.0f : -1.0f, (c & 4) ? 1.0f : -1.0f, 1.0f);
+                corners[c] = glm::vec3(corner) / corner.w;
+                center += corners[c];
+            }
+            center /= 8.0f;
+
+            // a bounding sphere keeps the cascade size constant while the camera turns, so shadows don't swim
+            float radius = 0.0f;
+            for(int c = 0; c < 8; c++)
+                radius = fmaxf(radius, glm::length(corners[c] - center));
+            radius = ceilf(radius * 16.0f) / 16.0f;
+
+            glm::mat4 lightView = glm::lookAt(center - lightDirection * (radius + casterExtrusion), center, up);
+            glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius + casterExtrusion);
+
+            // snap the cascade origin to whole texels, so shadow edges don't shimmer when the camera moves
+            glm::vec4 origin = lightProjection * lightView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            origin *= resolution * 0.5f;
+            glm::vec2 offset = (glm::vec2(roundf(origin.x), roundf(origin.y)) - glm::vec2(origin.x, origin.y)) * (2.0f / resolution);
+            lightProjection[3][0] += offset.x;
+            lightProjection[3][1] += offset.y;
+
+            cascadeMatrices[i] = lightProjection * lightView;
+            cascadeFrustums[i].set(cascadeMatrices[i]);
+            splitNear = splitFar;
+        }
+    }
+
+    void updateSpotLight(const SpotLight &spotLight)
+    {
+        glm::vec3 direction = glm::normalize(spotLight.direction);
+        glm::vec3 up = fabsf(direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        glm::mat4 lightView = glm::lookAt(spotLight.position, spotLight.position + direction, up);
+        // the cone fits inside a square frustum of twice the outer cutoff angle, with a little margin for PCF
+        // a light that fades out before the near plane casts nothing, see LIGHT_MIN_RADIUS
+        float farPlane = spotLight.getAttenuationRadius();
+        spotActive = farPlane > LIGHT_MIN_RADIUS;
+        if(!spotActive)
+            return;
+        glm::mat4 lightProjection = glm::perspective(glm::radians(2.0f * spotLight.outerCuttOff + 2.0f), 1.0f, 0.1f, farPlane);
+        spotMatrix = lightProjection * lightView;
+        spotFrustum.set(spotMatrix);
+    }
+
+    // caster culling against one cascade; bounds: xyz = world center, w = radius
+    bool isCasterInCascade(int cascade, const glm::vec4 &bounds) const
+    {
+        return cascadeFrustums[cascade].intersectsSphere(bounds);
+    }
+
+    // false when the spot light reaches no further than its near plane; skip its pass then
+    bool hasSpotShadow() const
+    {
+        return spotActive;
+    }
+
+    bool isCasterInSpotLight(const glm::vec4 &bounds) const
+    {
+        return spotActive && spotFrustum.intersectsSphere(bounds);
+    }
+
+    // binds one cascade layer as the depth target; draw the casters with depthShader afterwards
+    void beginCascade(int cascade, Shader &depthShader)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, dirShadowMap, 0, cascade);
+        beginShadowPass(depthShader, cascadeMatrices[cascade]);
+    }
+
+    void beginSpotLight(Shader &depthShader)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, spotShadowMap, 0);
+        beginShadowPass(depthShader, spotMatrix);
+    }
+
+    // back to the default framebuffer with the given viewport
+    void end(int viewportWidth, int viewportHeight)
+    {
+        glDisable(GL_POLYGON_OFFSET_FILL);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, viewportWidth, viewportHeight);
+    }
+
+    // every shader that declares the shadow uniforms needs this each frame, even with shadows off,
+    // since its shadow samplers must never share a texture unit with a different sampler type
+    void setUpShadows(Shader &shader, const glm::mat4 &view)
+    {
+        shader.use();
+        shader.setBool("shadowsOn", enabled);
+        shader.setMat4("view", view);
+        shader.setInt("cascadeCount", cascadeCount);
+        for(int i = 0; i < cascadeCount; i++)
+        {
+            shader.setFloat("cascadeSplits[" + to_string(i) + "]", cascadeSplits[i]);
+            shader.setMat4("dirLightSpaceMatrices[" + to_string(i) + "]", cascadeMatrices[i]);
+        }
+        shader.setMat4("spotLightSpaceMatrix", spotMatrix);
+        pointShadows.setUpShadows(shader, enabled);
+
+        shader.setInt("dirShadowMap", DIR_SHADOW_TEXTURE_UNIT);
+        glActiveTexture(GL_TEXTURE0 + DIR_SHADOW_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, dirShadowMap);
+        shader.setInt("spotShadowMap", SPOT_SHADOW_TEXTURE_UNIT);
+        glActiveTexture(GL_TEXTURE0 + SPOT_SHADOW_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D, spotShadowMap);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    int resolution;
+    int cascadeCount;
+    unsigned int shadowFBO;
+    unsigned int dirShadowMap = 0;
+    unsigned int spotShadowMap = 0;
+    float cascadeSplits[MAX_CASCADES] = { 0.0f };
+    glm::mat4 cascadeMatrices[MAX_CASCADES];
+    Frustum cascadeFrustums[MAX_CASCADES];
+    glm::mat4 spotMatrix = glm::mat4(1.0f);
+    bool spotActive = false;
+    Frustum spotFrustum;
+
+    void beginShadowPass(Shader &depthShader, const glm::mat4 &lightSpaceMatrix)
+    {
+        glViewport(0, 0, resolution, resolution);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        // slope scaled bias against shadow acne, the shaders add a small normal offset on top
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(2.0f, 4.0f);
+        depthShader.use();
+        depthShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
+    }
+
+    void setUpShadowSampling(GLenum target)
+    {
+        // outside the map everything is lit
+        float border[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameterfv(target, GL_TEXTURE_BORDER_COLOR, border);
+        // hardware depth comparison, with GL_LINEAR every tap is already a 2x2 PCF
+        glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    }
+
+    void createShadowMaps()
+    {
+        glGenTextures(1, &dirShadowMap);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, dirShadowMap);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, cascadeCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        setUpShadowSampling(GL_TEXTURE_2D_ARRAY);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        glGenTextures(1, &spotShadowMap);
+        glBindTexture(GL_TEXTURE_2D, spotShadowMap);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, resolution, resolution, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        setUpShadowSampling(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // depth only
+        glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, spotShadowMap, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "shadow map framebuffer is not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void deleteShadowMaps()
+    {
+        glDeleteTextures(1, &dirShadowMap);
+        glDeleteTextures(1, &spotShadowMap);
+    }
+};
+
+#endif /* shadowMap_h */
@@ -10,10 +10,16 @@
 
 #include <glad/glad.h>
 #include <vector>
+#include <unordered_map>
+#include <cstring>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/constants.hpp>
 #include "shader.h"
+#include "meshOptimizer.h"
+#include "vertexFormat.h"
+#include "meshFile.h"
 
 # define PI 3.1416
 
@@ -21,7 +27,72 @@ using namespace std;
 
 const int MIN_SECTOR_COUNT = 3;
 const int MIN_STACK_COUNT  = 2;
+// coarsest level of the LOD chain
+const int MIN_LOD_SECTOR_COUNT = 8;
+const int MIN_LOD_STACK_COUNT  = 4;
+const int MAX_LOD_COUNT = 12;
+const int MAX_ICOSPHERE_SUBDIVISIONS = 7;
+
+// UV_SPHERE: sectorCount x stackCount grid of longitude/latitude, dense at the poles.
+// ICOSPHERE: subdivided icosahedron, the subdivision count is picked so the equator
+// has about sectorCount edges. CUBE_SPHERE: a cube with an n x n grid per face
+// projected onto the sphere, n = sectorCount / 4. Both have uniform triangle density.
+enum SphereType { UV_SPHERE, ICOSPHERE, CUBE_SPHERE };
+
+// Unit sphere geometry with its whole LOD chain: level 0 is the requested
+// tessellation, every following level halves it, down to about 8 edges around the
+// equator. One mesh exists per (type, sectors, stacks) and is shared, refcounted, by
+// every Sphere with that tessellation.
+struct SphereMesh{
+    struct LodLevel{
+        int sectorCount;                // edges around the equator
+        int stackCount;                 // edges from pole to pole
+        int detail;                     // icosphere subdivisions / cube-sphere grid per face edge
+        int baseVertex;
+        int vertexCount;
+        int firstIndex;
+        int indexCount;
+    };
+    
+    SphereType type;
+    int sectorCount;
+    int stackCount;
+    bool keepCpuData;
+    bool compact;
+    VertexFormat format;                // GL buffer layout, see VertexFormat::positionNormal()
+    GLenum indexType;                   // GL_UNSIGNED_SHORT when every level has at most 64k vertices
+    int refCount = 0;
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+    unsigned int EBO = 0;
+    vector<float> vertices;             // CPU copies as 6 floats / 32-bit indices, only filled with keepCpuData
+    vector<unsigned int> indices;
+    LodLevel lods[MAX_LOD_COUNT];
+    int lodCount = 0;
+    int vertexTotal = 0;                // over all levels
+    int indexTotal = 0;
+    
+    unsigned int getVertexSize() const
+    {
+        return (unsigned int)vertexTotal * format.getStride();
+    }
+    
+    unsigned int getIndexSize() const
+    {
+        return (unsigned int)indexTotal * getIndexTypeSize(indexType);
+    }
+};
 
+// A sphere is a material, a radius and a reference to the shared unit mesh of its
+// tessellation. The radius is not baked into the vertices: draws pass the model
+// matrix through getModelMatrix(), which applies it as a scale. Meshes are written
+// straight into the mapped GL buffers with exact sizes, so no CPU copy exists unless
+// keepCpuData asks for one (getVertices()/getIndices()). Draws pick a LOD level with
+// selectLod() from the projected radius. Every level's index buffer is reordered
+// for the post-transform vertex cache and its vertices for fetch locality
+// (meshOptimizer.h) in a level-sized scratch buffer before it is copied out. By
+// default vertices are packed to 12 bytes (snorm16 position, 2_10_10_10 normal) with
+// 16-bit indices; compactVertices = false keeps 24-byte float vertices.
 class Sphere
 {
 public:
@@ -29,49 +100,41 @@ public:
     glm::vec3 diffuse;
     glm::vec3 specular;
     float shininess;
+    float lodEdgePixels = 8.0f;     // longest acceptable triangle edge on screen, in pixels
+    float lodHysteresis = 0.25f;    // a level coarsens only once it is this much too fine
     // ctor/dtor
-    Sphere(float radius=1.0f, int sectorCount=36, int stackCount=18, glm::vec3 amb = glm::vec3(1.0f,0.0f,0.0f), glm::vec3 diff = glm::vec3(1.0f,0.0f,0.0f), glm::vec3 spec = glm::vec3(0.5f,0.5f,0.5f), float shiny = 32.0f) : verticesStride(24)
+    Sphere(float radius=1.0f, int sectorCount=36, int stackCount=18, glm::vec3 amb = glm::vec3(1.0f,0.0f,0.0f), glm::vec3 diff = glm::vec3(1.0f,0.0f,0.0f), glm::vec3 spec = glm::vec3(0.5f,0.5f,0.5f), float shiny = 32.0f, bool keepCpuData = false, SphereType type = UV_SPHERE, bool compactVertices = true)
     {
         set(radius, sectorCount, stackCount, amb, diff, spec, shiny);
-        buildCoordinatesAndIndices();
-        buildVertices();
-        
-        glGenVertexArrays(1, &sphereVAO);
-        glBindVertexArray(sphereVAO);
-
-        // create VBO to copy vertex data to VBO
-        unsigned int sphereVBO;
-        glGenBuffers(1, &sphereVBO);
-        glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);           // for vertex data
-        glBufferData(GL_ARRAY_BUFFER,                   // target
-                     this->getVertexSize(), // data size, # of bytes
-                     this->getVertices(),   // ptr to vertex data
-                     GL_STATIC_DRAW);                   // usage
-
-        // create EBO to copy index data
-        unsigned int sphereEBO;
-        glGenBuffers(1, &sphereEBO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);   // for index data
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER,           // target
-                     this->getIndexSize(),             // data size, # of bytes
-                     this->getIndices(),               // ptr to index data
-                     GL_STATIC_DRAW);                   // usage
-
-        // activate attrib arrays
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-
-        // set attrib arrays with stride and offset
-        int stride = this->getVerticesStride();     // should be 24 bytes
-        glVertexAttribPointer(0, 3, GL_FLOAT, false, stride, (void*)0);
-        glVertexAttribPointer(1, 3, GL_FLOAT, false, stride, (void*)(sizeof(float)*3));
-
-        // unbind VAO and VBOs
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        mesh = acquireMesh(type, this->sectorCount, this->stackCount, keepCpuData, compactVertices);
+    }
+    Sphere(const Sphere &other)
+    {
+        *this = other;
+    }
+    Sphere& operator=(const Sphere &other)
+    {
+        if(this == &other)
+            return *this;
+        if(mesh)
+            releaseMesh(mesh);
+        ambient = other.ambient;
+        diffuse = other.diffuse;
+        specular = other.specular;
+        shininess = other.shininess;
+        lodEdgePixels = other.lodEdgePixels;
+        lodHysteresis = other.lodHysteresis;
+        radius = other.radius;
+        sectorCount = other.sectorCount;
+        stackCount = other.stackCount;
+        mesh = other.mesh;
+        mesh->refCount++;
+        return *this;
+    }
+    ~Sphere()
+    {
+        releaseMesh(mesh);
     }
-    ~Sphere() {}
 
     // getters/setters
     
@@ -100,52 +163,194 @@ public:
     void setSectorCount(int sectors)
     {
         if(sectors != this->sectorCount)
+        {
             set(radius, sectors, stackCount, ambient, diffuse, specular, shininess);
+            swapMesh();
+        }
     }
 
     void setStackCount(int stacks)
     {
         if(stacks != this->stackCount)
+        {
             set(radius, sectorCount, stacks, ambient, diffuse, specular, shininess);
+            swapMesh();
+        }
     }
     
     // for interleaved vertices
-    unsigned int getVertexCount() const
+    unsigned int getVertexCount(int lod = 0) const
     { 
-        return (unsigned int)coordinates.size() / 3;     // # of vertices
+        return (unsigned int)mesh->lods[lod].vertexCount;   // # of vertices
     }
     
     unsigned int getVertexSize() const
     { 
-        return (unsigned int) vertices.size() * sizeof(float);  // # of bytes
+        return mesh->getVertexSize();       // # of bytes, all levels
     }
     
     int getVerticesStride() const
     {
-        return verticesStride;   // should be 24 bytes
+        return mesh->format.getStride();    // 12 bytes compact, 24 bytes float
     }
+    // interleaved position/normal data of all levels, NULL unless constructed with keepCpuData
     const float* getVertices() const
     { 
-        return vertices.data();
+        return mesh->vertices.empty() ? NULL : mesh->vertices.data();
+    }
+    
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    GLenum getIndexType() const
+    {
+        return mesh->indexType;
     }
     
     unsigned int getIndexSize() const       
     {
-        return (unsigned int)indices.size() * sizeof(unsigned int);
+        return mesh->getIndexSize();
     }
     
     const unsigned int* getIndices() const
     { 
-        return indices.data();
+        return mesh->indices.empty() ? NULL : mesh->indices.data();
+    }
+    
+    // bytes this sphere's mesh keeps on the CPU / in GL buffers, shared with every
+    // sphere of the same tessellation (see getMeshCacheMemory() for the totals)
+    size_t getCpuMemory() const
+    {
+        return sizeof(Sphere) + sizeof(SphereMesh) + mesh->vertices.capacity() * sizeof(float) + mesh->indices.capacity() * sizeof(unsigned int);
+    }
+    
+    size_t getGpuMemory() const
+    {
+        return (size_t)getVertexSize() + getIndexSize();
+    }
+    
+    // scale by the radius, the shared mesh is a unit sphere
+    glm::mat4 getModelMatrix(const glm::mat4 &model) const
+    {
+        return glm::scale(model, glm::vec3(radius));
+    }
+    
+    // writes the unit mesh with its LOD chain as a mesh file (meshFile.h), packed to
+    // the sphere's vertex format; needs the CPU copy kept with keepCpuData
+    bool writeMeshFile(const string &path) const
+    {
+        if(mesh->vertices.empty())
+        {
+            cout << "sphere mesh needs keepCpuData to be written to " << path << endl;
+            return false;
+        }
+        vector<unsigned char> vertexData(mesh->getVertexSize());
+        vector<unsigned char> indexData(mesh->getIndexSize());
+        mesh->format.pack(mesh->vertices.data(), 6, mesh->vertexTotal, vertexData.data());
+        packIndices(mesh->indices.data(), mesh->indexTotal, mesh->indexType, indexData.data());
+        vector<MeshFileLod> lods(mesh->lodCount);
+        for(int l = 0; l < mesh->lodCount; l++)
+        {
+            lods[l].baseVertex = mesh->lods[l].baseVertex;
+            lods[l].vertexCount = mesh->lods[l].vertexCount;
+            lods[l].firstIndex = mesh->lods[l].firstIndex;
+            lods[l].indexCount = mesh->lods[l].indexCount;
+            lods[l].detail = (float)mesh->lods[l].sectorCount;
+        }
+        return ::writeMeshFile(path, mesh->format, vertexData.data(), mesh->vertexTotal, indexData.data(), mesh->indexTotal,
+                               mesh->indexType, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), lods);
+    }
+    
+    // mesh cache statistics, over every live Sphere
+    static int getMeshCacheSize()
+    {
+        return (int)meshCache().size();
+    }
+    
+    // GL buffer bytes held by the cache, and the bytes one mesh per sphere would add on top
+    static size_t getMeshCacheMemory()
+    {
+        size_t bytes = 0;
+        for(size_t i = 0; i < meshCache().size(); i++)
+            bytes += (size_t)meshCache()[i]->getVertexSize() + meshCache()[i]->getIndexSize();
+        return bytes;
+    }
+    
+    static size_t getMeshCacheMemorySaved()
+    {
+        size_t bytes = 0;
+        for(size_t i = 0; i < meshCache().size(); i++)
+        {
+            const SphereMesh *m = meshCache()[i];
+            bytes += (size_t)(m->refCount - 1) * (m->getVertexSize() + m->getIndexSize());
+        }
+        return bytes;
     }
     
-    unsigned int getIndexCount() const
+    unsigned int getIndexCount(int lod = 0) const
     { 
-        return (unsigned int)indices.size();
+        return (unsigned int)mesh->lods[lod].indexCount;
+    }
+    
+    int getLodCount() const
+    {
+        return mesh->lodCount;
+    }
+    
+    // where a level starts in getVertices() (in vertices) and getIndices()
+    int getBaseVertex(int lod = 0) const
+    {
+        return mesh->lods[lod].baseVertex;
+    }
+    
+    unsigned int getFirstIndex(int lod = 0) const
+    {
+        return (unsigned int)mesh->lods[lod].firstIndex;
+    }
+    
+    SphereType getType() const
+    {
+        return mesh->type;
+    }
+    
+    const SphereMesh::LodLevel& getLod(int lod) const
+    {
+        return mesh->lods[lod];
+    }
+    
+    // edges around the equator at this level
+    int getLodSectorCount(int lod) const
+    {
+        return mesh->lods[lod].sectorCount;
+    }
+    
+    int getLodStackCount(int lod) const
+    {
+        return mesh->lods[lod].stackCount;
+    }
+    
+    // radius in pixels of a bounding sphere (see getBoundingSphere) seen from eye
+    static float projectedRadius(const glm::vec4 &bounds, const glm::vec3 &eye, float fovyDegrees, int viewportHeight)
+    {
+        float d = glm::length(glm::vec3(bounds) - eye);
+        if(d <= bounds.w)
+            return (float)viewportHeight;
+        return bounds.w / (d * tanf(glm::radians(fovyDegrees) * 0.5f)) * (viewportHeight * 0.5f);
+    }
+    
+    // LOD level for a sphere covering projectedRadius pixels. previousLod is the level the
+    // same instance used last frame (-1 if none): finer levels are taken at once, coarser
+    // ones only once the sphere is lodHysteresis smaller than needed, so levels don't pop
+    // back and forth at a threshold.
+    int selectLod(float projectedRadius, int previousLod = -1) const
+    {
+        int fine = levelFor(projectedRadius);
+        if(previousLod < 0 || fine < previousLod)
+            return fine;
+        int coarse = levelFor(projectedRadius * (1.0f + lodHysteresis));
+        return coarse > previousLod ? coarse : previousLod;
     }
 
     // draw in VertexArray mode
-    void drawSphere(Shader & lightingShader, glm::mat4 model) const      // draw surface
+    void drawSphere(Shader & lightingShader, int objectIndex, int lod = 0) const      // draw surface
     {
         lightingShader.use();
         
@@ -154,56 +359,288 @@ public:
         lightingShader.setVec3("material.specular", this->specular);
         lightingShader.setFloat("material.shininess", this->shininess);
         
-        lightingShader.setMat4("model", model);
+        lightingShader.setInt("objectIndex", objectIndex);
         
         // draw a sphere with VAO
-        glBindVertexArray(sphereVAO);
-        glDrawElements(GL_TRIANGLES,                    // primitive type
-                       this->getIndexCount(),          // # of indices
-                       GL_UNSIGNED_INT,                 // data type
-                       (void*)0);                       // offset to indices
+        const SphereMesh::LodLevel &level = mesh->lods[lod];
+        glBindVertexArray(mesh->VAO);
+        glDrawElementsBaseVertex(GL_TRIANGLES,          // primitive type
+                       level.indexCount,                // # of indices
+                       mesh->indexType,                 // data type
+                       (void*)(size_t)(level.firstIndex * getIndexTypeSize(mesh->indexType)),  // offset to the level's indices
+                       level.baseVertex);               // indices of every level start at 0
 
         // unbind VAO
         glBindVertexArray(0);
     }
+    
+    // world bounding sphere under model (without the radius scale): xyz = center, w = radius
+    glm::vec4 getBoundingSphere(const glm::mat4 &model) const
+    {
+        glm::vec3 center = glm::vec3(model * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        float scale = fmaxf(glm::length(glm::vec3(model[0])), fmaxf(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        return glm::vec4(center, radius * scale);
+    }
+    
+    // draw the mesh only, for passes that set up their own shader (light volumes, depth)
+    void drawSphereGeometry(int lod = 0) const
+    {
+        const SphereMesh::LodLevel &level = mesh->lods[lod];
+        glBindVertexArray(mesh->VAO);
+        glDrawElementsBaseVertex(GL_TRIANGLES, level.indexCount, mesh->indexType, (void*)(size_t)(level.firstIndex * getIndexTypeSize(mesh->indexType)), level.baseVertex);
+        glBindVertexArray(0);
+    }
 
 private:
-    // member functions
-    void buildCoordinatesAndIndices()
+    // coarsest level whose edges stay under lodEdgePixels at this size
+    int levelFor(float projectedRadius) const
     {
-        float x, y, z, xz;                              // vertex position
-        float nx, ny, nz, lengthInv = 1.0f / radius;    // vertex normal
+        float neededSectors = 2.0f * PI * projectedRadius / lodEdgePixels;
+        int lod = 0;
+        while(lod + 1 < mesh->lodCount && mesh->lods[lod + 1].sectorCount >= neededSectors)
+            lod++;
+        return lod;
+    }
+    
+    // every live mesh, one per (type, sectors, stacks, keepCpuData, compact)
+    static vector<SphereMesh*>& meshCache()
+    {
+        static vector<SphereMesh*> cache;
+        return cache;
+    }
+    
+    static SphereMesh* acquireMesh(SphereType type, int sectors, int stacks, bool keepCpuData, bool compact)
+    {
+        // stacks only shape UV spheres
+        if(type != UV_SPHERE)
+            stacks = 0;
+        vector<SphereMesh*> &cache = meshCache();
+        for(size_t i = 0; i < cache.size(); i++)
+            if(cache[i]->type == type && cache[i]->sectorCount == sectors && cache[i]->stackCount == stacks && cache[i]->keepCpuData == keepCpuData && cache[i]->compact == compact)
+            {
+                cache[i]->refCount++;
+                return cache[i];
+            }
+        SphereMesh *mesh = new SphereMesh();
+        mesh->type = type;
+        mesh->sectorCount = sectors;
+        mesh->stackCount = stacks;
+        mesh->keepCpuData = keepCpuData;
+        mesh->compact = compact;
+        mesh->refCount = 1;
+        createMesh(*mesh);
+        cache.push_back(mesh);
+        return mesh;
+    }
+    
+    // moves to the mesh of the current tessellation
+    void swapMesh()
+    {
+        SphereMesh *previous = mesh;
+        mesh = acquireMesh(previous->type, sectorCount, stackCount, previous->keepCpuData, previous->compact);
+        releaseMesh(previous);
+    }
+    
+    static void releaseMesh(SphereMesh *mesh)
+    {
+        if(--mesh->refCount > 0)
+            return;
+        vector<SphereMesh*> &cache = meshCache();
+        for(size_t i = 0; i < cache.size(); i++)
+            if(cache[i] == mesh)
+            {
+                cache[i] = cache.back();
+                cache.pop_back();
+                break;
+            }
+        glDeleteVertexArrays(1, &mesh->VAO);
+        glDeleteBuffers(1, &mesh->VBO);
+        glDeleteBuffers(1, &mesh->EBO);
+        delete mesh;
+    }
+    
+    static void createMesh(SphereMesh &mesh)
+    {
+        // exact vertex and index counts of the whole chain, before anything is written
+        if(mesh.type == ICOSPHERE)
+        {
+            // the equator of subdivision s has 5 * 2^s edges
+            int subdivisions = (int)roundf(log2f(mesh.sectorCount / 5.0f));
+            subdivisions = glm::clamp(subdivisions, 1, MAX_ICOSPHERE_SUBDIVISIONS);
+            while(mesh.lodCount < MAX_LOD_COUNT)
+            {
+                int faces = 20 << (2 * subdivisions);
+                addLevel(mesh, 5 << subdivisions, 3 << subdivisions, subdivisions, faces / 2 + 2, faces * 3);
+                if(subdivisions == 1 || (5 << (subdivisions - 1)) < MIN_LOD_SECTOR_COUNT)
+                    break;
+                subdivisions--;
+            }
+        }
+        else if(mesh.type == CUBE_SPHERE)
+        {
+            // four faces span the equator; face seams keep separate vertices
+            int n = glm::max(2, (mesh.sectorCount + 2) / 4);
+            while(mesh.lodCount < MAX_LOD_COUNT)
+            {
+                addLevel(mesh, 4 * n, 2 * n, n, 6 * (n + 1) * (n + 1), 36 * n * n);
+                if(4 * (n / 2) < MIN_LOD_SECTOR_COUNT)
+                    break;
+                n /= 2;
+            }
+        }
+        else
+        {
+            int sectors = mesh.sectorCount;
+            int stacks = mesh.stackCount;
+            while(mesh.lodCount < MAX_LOD_COUNT)
+            {
+                // one triangle per sector at the poles, two elsewhere
+                addLevel(mesh, sectors, stacks, 0, (stacks + 1) * (sectors + 1), sectors * (stacks - 1) * 6);
+                if(sectors / 2 < MIN_LOD_SECTOR_COUNT || stacks / 2 < MIN_LOD_STACK_COUNT)
+                    break;
+                sectors /= 2;
+                stacks /= 2;
+            }
+        }
+        
+        // indices are level-local (drawn with a base vertex), so only the largest level has to fit
+        int maxLevelVertices = 0;
+        for(int l = 0; l < mesh.lodCount; l++)
+            maxLevelVertices = glm::max(maxLevelVertices, mesh.lods[l].vertexCount);
+        mesh.format = VertexFormat::positionNormal(mesh.compact);
+        mesh.indexType = mesh.compact ? getIndexTypeFor(maxLevelVertices) : GL_UNSIGNED_INT;
+        
+        glGenVertexArrays(1, &mesh.VAO);
+        glBindVertexArray(mesh.VAO);
+
+        // allocate VBO and EBO storage, the data is written below
+        glGenBuffers(1, &mesh.VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);            // for vertex data
+        glBufferData(GL_ARRAY_BUFFER, mesh.getVertexSize(), NULL, GL_STATIC_DRAW);
+        glGenBuffers(1, &mesh.EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);    // for index data
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.getIndexSize(), NULL, GL_STATIC_DRAW);
+        
+        if(mesh.keepCpuData)
+        {
+            mesh.vertices.resize(mesh.vertexTotal * 6);
+            mesh.indices.resize(mesh.indexTotal);
+        }
+        buildIntoMappedBuffers(mesh);
+
+        // attrib arrays from the format
+        mesh.format.setUpAttributes();
 
+        // unbind VAO and VBOs
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+    
+    static void addLevel(SphereMesh &mesh, int sectors, int stacks, int detail, int vertexCount, int indexCount)
+    {
+        SphereMesh::LodLevel &level = mesh.lods[mesh.lodCount++];
+        level.sectorCount = sectors;
+        level.stackCount = stacks;
+        level.detail = detail;
+        level.baseVertex = mesh.vertexTotal;
+        level.vertexCount = vertexCount;
+        level.firstIndex = mesh.indexTotal;
+        level.indexCount = indexCount;
+        mesh.vertexTotal += vertexCount;
+        mesh.indexTotal += indexCount;
+    }
+    
+    // writes every level into vertexOut and indexOut, packed to the mesh's format and index
+    // type, and into the CPU copies if kept; each level is generated and optimized in
+    // scratch memory first, since mapped buffers are write-only
+    static void buildVerticesAndIndices(SphereMesh &mesh, unsigned char *vertexOut, unsigned char *indexOut)
+    {
+        vector<float> vertexData;
+        vector<unsigned int> indexData;
+        for(int l = 0; l < mesh.lodCount; l++)
+        {
+            const SphereMesh::LodLevel &level = mesh.lods[l];
+            vertexData.resize(level.vertexCount * 6);
+            indexData.resize(level.indexCount);
+            generateLevel(mesh.type, level, vertexData.data(), indexData.data());
+            optimizeVertexCache(indexData.data(), level.indexCount, level.vertexCount);
+            optimizeVertexFetch(vertexData.data(), indexData.data(), level.indexCount, level.vertexCount, 6);
+            mesh.format.pack(vertexData.data(), 6, level.vertexCount, vertexOut + level.baseVertex * mesh.format.getStride());
+            packIndices(indexData.data(), level.indexCount, mesh.indexType, indexOut + level.firstIndex * getIndexTypeSize(mesh.indexType));
+            if(mesh.keepCpuData)
+            {
+                memcpy(&mesh.vertices[level.baseVertex * 6], vertexData.data(), vertexData.size() * sizeof(float));
+                memcpy(&mesh.indices[level.firstIndex], indexData.data(), indexData.size() * sizeof(unsigned int));
+            }
+        }
+    }
+    
+    // generates the mesh directly into the GL buffers bound to the VAO
+    static void buildIntoMappedBuffers(SphereMesh &mesh)
+    {
+        unsigned char *vertexOut = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, mesh.getVertexSize(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        unsigned char *indexOut = (unsigned char*)glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, mesh.getIndexSize(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if(vertexOut && indexOut)
+            buildVerticesAndIndices(mesh, vertexOut, indexOut);
+        bool written = vertexOut && indexOut;
+        if(vertexOut && !glUnmapBuffer(GL_ARRAY_BUFFER))
+            written = false;
+        if(indexOut && !glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER))
+            written = false;
+        
+        // mapping failed or the driver lost the data store while mapped, upload through a temporary copy instead
+        if(!written)
+        {
+            vector<unsigned char> vertexData(mesh.getVertexSize());
+            vector<unsigned char> indexData(mesh.getIndexSize());
+            buildVerticesAndIndices(mesh, vertexData.data(), indexData.data());
+            glBufferSubData(GL_ARRAY_BUFFER, 0, mesh.getVertexSize(), vertexData.data());
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, mesh.getIndexSize(), indexData.data());
+        }
+    }
+    
+public:
+    // writes one level of a unit sphere as generated, before any optimization
+    // (vertex indices start at 0); the radius is applied by getModelMatrix()
+    static void generateLevel(SphereType type, const SphereMesh::LodLevel &level, float *v, unsigned int *index)
+    {
+        if(type == ICOSPHERE)
+            generateIcosphere(level, v, index);
+        else if(type == CUBE_SPHERE)
+            generateCubeSphere(level, v, index);
+        else
+            generateUvSphere(level, v, index);
+    }
+
+private:
+    static void generateUvSphere(const SphereMesh::LodLevel &level, float *v, unsigned int *index)
+    {
+        int sectorCount = level.sectorCount;
+        int stackCount = level.stackCount;
         float sectorStep = 2 * PI / sectorCount;
         float stackStep = PI / stackCount;
-        float sectorAngle = -sectorStep;
-        float stackAngle = PI/2 + stackStep;
 
         for(int i = 0; i <= stackCount; ++i)
         {
-            stackAngle -= stackStep;        // starting from pi/2 to -pi/2
-            xz = radius * cosf(stackAngle);
-            y = radius * sinf(stackAngle);
+            float stackAngle = PI / 2 - i * stackStep;      // starting from pi/2 to -pi/2
+            float xz = cosf(stackAngle);
+            float ny = sinf(stackAngle);
             // add (sectorCount+1) vertices per stack
             // first and last vertices have same position and normal, but different tex coords
             for(int j = 0; j <= sectorCount; ++j)
             {
-                sectorAngle += sectorStep;           // starting from 0 to 2pi
-
-                // vertex position (x, y, z)
-                z = xz * cosf(sectorAngle);
-                x = xz * sinf(sectorAngle);
-                coordinates.push_back(x);
-                coordinates.push_back(y);
-                coordinates.push_back(z);
-
-                // normalized vertex normal (nx, ny, nz)
-                nx = x * lengthInv;
-                ny = y * lengthInv;
-                nz = z * lengthInv;
-                normals.push_back(nx);
-                normals.push_back(ny);
-                normals.push_back(nz);
+                float sectorAngle = j * sectorStep;         // starting from 0 to 2pi
+                float nx = xz * sinf(sectorAngle);
+                float nz = xz * cosf(sectorAngle);
+
+                // vertex position (x, y, z), then normalized vertex normal (nx, ny, nz)
+                *v++ = nx;
+                *v++ = ny;
+                *v++ = nz;
+                *v++ = nx;
+                *v++ = ny;
+                *v++ = nz;
             }
         }
         
@@ -213,7 +650,7 @@ private:
         // | /  |
         // k2--k2+1
         
-        int k1, k2;
+        unsigned int k1, k2;
         for(int i = 0; i < stackCount; ++i)
         {
             k1 = i * (sectorCount + 1);     // beginning of current stack
@@ -222,50 +659,144 @@ private:
             for(int j = 0; j < sectorCount; ++j, ++k1, ++k2)
             {
                 // 2 triangles per sector excluding first and last stacks
-                if(i!=0 && i!=(stackCount-1))
+                if(i != 0)
                 {
                     // k1 => k2 => k1+1
-                    indices.push_back(k1);
-                    indices.push_back(k2);
-                    indices.push_back(k1 + 1);
-                    
-                    // k1+1 => k2 => k2+1
-                    indices.push_back(k1 + 1);
-                    indices.push_back(k2);
-                    indices.push_back(k2 + 1);
+                    *index++ = k1;
+                    *index++ = k2;
+                    *index++ = k1 + 1;
                 }
-                // 2 triangles per sector excluding first and last stacks
-                else if(i == 0)
-                {
-                    indices.push_back(k1 + 1);
-                    indices.push_back(k2);
-                    indices.push_back(k2 + 1);
-                    
-                }
-
-                else if(i == (stackCount-1))
+                if(i != (stackCount-1))
                 {
-                    indices.push_back(k1);
-                    indices.push_back(k2);
-                    indices.push_back(k1 + 1);
+                    // k1+1 => k2 => k2+1
+                    *index++ = k1 + 1;
+                    *index++ = k2;
+                    *index++ = k2 + 1;
                 }
             }
         }
     }
     
-    void buildVertices()
+    static void generateIcosphere(const SphereMesh::LodLevel &level, float *v, unsigned int *index)
     {
-        size_t i, j;
-        size_t count = coordinates.size();
-        for(i = 0, j = 0; i < count; i += 3, j += 2)
+        const float t = (1.0f + sqrtf(5.0f)) / 2.0f;
+        const float corners[12][3] = {
+            { -1,  t,  0 }, {  1,  t,  0 }, { -1, -t,  0 }, {  1, -t,  0 },
+            {  0, -1,  t }, {  0,  1,  t }, {  0, -1, -t }, {  0,  1, -t },
+            {  t,  0, -1 }, {  t,  0,  1 }, { -t,  0, -1 }, { -t,  0,  1 }
+        };
+        const unsigned int faces[60] = {
+            0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+            1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+            3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+            4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1
+        };
+        
+        // positions are written straight to v, normals follow once all exist
+        unsigned int vertexCount = 0;
+        for(int i = 0; i < 12; i++)
         {
-            vertices.push_back(coordinates[i]);
-            vertices.push_back(coordinates[i+1]);
-            vertices.push_back(coordinates[i+2]);
-
-            vertices.push_back(normals[i]);
-            vertices.push_back(normals[i+1]);
-            vertices.push_back(normals[i+2]);
+            glm::vec3 p = glm::normalize(glm::vec3(corners[i][0], corners[i][1], corners[i][2]));
+            v[vertexCount * 6] = p.x;
+            v[vertexCount * 6 + 1] = p.y;
+            v[vertexCount * 6 + 2] = p.z;
+            vertexCount++;
+        }
+        vector<unsigned int> triangles(faces, faces + 60);
+        vector<unsigned int> subdivided;
+        for(int s = 0; s < level.detail; s++)
+        {
+            // every edge is split once, shared by the two triangles on either side
+            unordered_map<unsigned long long, unsigned int> midpoints;
+            subdivided.clear();
+            subdivided.reserve(triangles.size() * 4);
+            for(size_t i = 0; i < triangles.size(); i += 3)
+            {
+                unsigned int a = triangles[i], b = triangles[i + 1], c = triangles[i + 2];
+                unsigned int ab = midpoint(a, b, v, vertexCount, midpoints);
+                unsigned int bc = midpoint(b, c, v, vertexCount, midpoints);
+                unsigned int ca = midpoint(c, a, v, vertexCount, midpoints);
+                unsigned int split[12] = { a, ab, ca,   b, bc, ab,   c, ca, bc,   ab, bc, ca };
+                subdivided.insert(subdivided.end(), split, split + 12);
+            }
+            triangles.swap(subdivided);
+        }
+        
+        for(unsigned int i = 0; i < vertexCount; i++)
+        {
+            v[i * 6 + 3] = v[i * 6];
+            v[i * 6 + 4] = v[i * 6 + 1];
+            v[i * 6 + 5] = v[i * 6 + 2];
+        }
+        memcpy(index, triangles.data(), triangles.size() * sizeof(unsigned int));
+    }
+    
+    // index of the unit-sphere point halfway along edge a-b, added to v on first use
+    static unsigned int midpoint(unsigned int a, unsigned int b, float *v, unsigned int &vertexCount, unordered_map<unsigned long long, unsigned int> &midpoints)
+    {
+        unsigned long long key = a < b ? ((unsigned long long)a << 32) | b : ((unsigned long long)b << 32) | a;
+        unordered_map<unsigned long long, unsigned int>::iterator found = midpoints.find(key);
+        if(found != midpoints.end())
+            return found->second;
+        glm::vec3 p = glm::normalize(glm::vec3(v[a * 6] + v[b * 6], v[a * 6 + 1] + v[b * 6 + 1], v[a * 6 + 2] + v[b * 6 + 2]));
+        v[vertexCount * 6] = p.x;
+        v[vertexCount * 6 + 1] = p.y;
+        v[vertexCount * 6 + 2] = p.z;
+        midpoints[key] = vertexCount;
+        return vertexCount++;
+    }
+    
+    static void generateCubeSphere(const SphereMesh::LodLevel &level, float *v, unsigned int *index)
+    {
+        // face normal, then the two in-face axes with u x v = normal so triangles wind outward
+        const glm::vec3 faceAxes[6][3] = {
+            { glm::vec3( 1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, 0, 1) },
+            { glm::vec3(-1, 0, 0), glm::vec3(0, 0, 1), glm::vec3(0, 1, 0) },
+            { glm::vec3(0,  1, 0), glm::vec3(0, 0, 1), glm::vec3(1, 0, 0) },
+            { glm::vec3(0, -1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, 1) },
+            { glm::vec3(0, 0,  1), glm::vec3(1, 0, 0), glm::vec3(0, 1, 0) },
+            { glm::vec3(0, 0, -1), glm::vec3(0, 1, 0), glm::vec3(1, 0, 0) }
+        };
+        int n = level.detail;
+        unsigned int row = n + 1;
+        // equal-angle grid: tan spreads the points so cells keep about the same area. It is
+        // mirrored around 0 with the borders exactly -1 and 1, so a vertex on the edge of
+        // two faces comes out bit-identical on both
+        vector<float> grid(row);
+        for(int k = 0; 2 * k <= n; k++)
+        {
+            float g = k == 0 ? 1.0f : (2 * k == n ? 0.0f : tanf((1.0f - 2.0f * k / n) * (glm::pi<float>() / 4)));
+            grid[k] = -g;
+            grid[n - k] = g;
+        }
+        for(int face = 0; face < 6; face++)
+        {
+            unsigned int first = face * row * row;
+            for(int i = 0; i <= n; i++)
+                for(int j = 0; j <= n; j++)
+                {
+                    float s = grid[i];
+                    float t = grid[j];
+                    glm::vec3 p = glm::normalize(faceAxes[face][0] + s * faceAxes[face][1] + t * faceAxes[face][2]);
+                    *v++ = p.x;
+                    *v++ = p.y;
+                    *v++ = p.z;
+                    *v++ = p.x;
+                    *v++ = p.y;
+                    *v++ = p.z;
+                }
+            for(int i = 0; i < n; i++)
+                for(int j = 0; j < n; j++)
+                {
+                    unsigned int k = first + i * row + j;
+                    // k => k+row => k+row+1, k => k+row+1 => k+1
+                    *index++ = k;
+                    *index++ = k + row;
+                    *index++ = k + row + 1;
+                    *index++ = k;
+                    *index++ = k + row + 1;
+                    *index++ = k + 1;
+                }
         }
     }
     
@@ -304,15 +835,10 @@ private:
     }
 
     // memeber vars
-    unsigned int sphereVAO;
+    SphereMesh *mesh = nullptr;         // shared, refcounted
     float radius;
     int sectorCount;                        // longitude, # of slices
     int stackCount;                         // latitude, # of stacks
-    vector<float> vertices;
-    vector<float> normals;
-    vector<unsigned int> indices;
-    vector<float> coordinates;
-    int verticesStride;                 // # of bytes to hop to the next vertex (should be 24 bytes)
 
 };
 
@@ -11,6 +11,7 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include "shader.h"
+#include "lightAttenuation.h"
 
 class SpotLight{
 public:
@@ -52,6 +53,11 @@ public:
         lightingShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(cutOff)));
         lightingShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(outerCuttOff)));
     }
+    // where the light fades out (lightAttenuation.h), used as the length of the deferred renderer's light cone
+    float getAttenuationRadius() const
+    {
+        return ::getAttenuationRadius(k_c, k_l, k_q, diffuse, specular);
+    }
     void turnOff()
     {
         ambientOn = 0.0;
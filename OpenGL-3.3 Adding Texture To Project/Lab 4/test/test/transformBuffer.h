@@ -0,0 +1,139 @@
+//
+//  transformBuffer.h
+//  test
+//
+
+#ifndef transformBuffer_h
+#define transformBuffer_h
+
+#include <glad/glad.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "shader.h"
+
+using namespace std;
+
+// texture unit the transform buffer is bound to; kept clear of the material maps
+const int TRANSFORM_TEXTURE_UNIT = 15;
+// vec4 texels per object: model (4), normal matrix (3), model-view-projection (4);
+// the w of the first normal matrix texel holds the object's material index (materialBuffer.h)
+const int TRANSFORM_TEXELS = 11;
+
+// Per-object transform block, computed once per object on the CPU and uploaded
+// for all objects of a frame into one texture buffer. Vertex shaders fetch it
+// with texelFetch(transforms, (objectIndex + gl_InstanceID) * 11 + i), so the
+// normal matrix is no longer inverted per vertex.
+class TransformBuffer{
+public:
+    TransformBuffer(int capacity = 1024)
+    {
+        this->capacity = capacity;
+        data.reserve(capacity * TRANSFORM_TEXELS);
+
+        glGenBuffers(1, &transformTBO);
+        glBindBuffer(GL_TEXTURE_BUFFER, transformTBO);
+        glBufferData(GL_TEXTURE_BUFFER, capacity * TRANSFORM_TEXELS * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+
+        glGenTextures(1, &transformTexture);
+        glBindTexture(GL_TEXTURE_BUFFER, transformTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, transformTBO);
+
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    ~TransformBuffer()
+    {
+        glDeleteTextures(1, &transformTexture);
+        glDeleteBuffers(1, &transformTBO);
+    }
+
+    // start a new frame of objects
+    void begin(const glm::mat4 &view, const glm::mat4 &projection)
+    {
+        this->viewProjection = projection * view;
+        data.clear();
+        uploaded = 0;
+    }
+
+    // returns the object index to pass to the draw call; materialIndex -1 keeps the material.* uniforms
+    int add(const glm::mat4 &model, int materialIndex = -1)
+    {
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+        glm::mat4 mvp = viewProjection * model;
+
+        data.push_back(model[0]);
+        data.push_back(model[1]);
+        data.push_back(model[2]);
+        data.push_back(model[3]);
+        data.push_back(glm::vec4(normalMatrix[0], (float)materialIndex));
+        data.push_back(glm::vec4(normalMatrix[1], 0.0f));
+        data.push_back(glm::vec4(normalMatrix[2], 0.0f));
+        data.push_back(mvp[0]);
+        data.push_back(mvp[1]);
+        data.push_back(mvp[2]);
+        data.push_back(mvp[3]);
+
+        return getCount() - 1;
+    }
+
+    // uploads every object added since the last flush; called once per frame after all add()s
+    void flush()
+    {
+        int count = getCount();
+        if(count == uploaded)
+            return;
+
+        glBindBuffer(GL_TEXTURE_BUFFER, transformTBO);
+        if(count > capacity)
+        {
+            while(capacity < count)
+                capacity *= 2;
+            glBufferData(GL_TEXTURE_BUFFER, capacity * TRANSFORM_TEXELS * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+            uploaded = 0;
+        }
+        else if(uploaded == 0)
+        {
+            // orphan the previous frame's storage instead of waiting for the GPU to finish with it
+            glBufferData(GL_TEXTURE_BUFFER, capacity * TRANSFORM_TEXELS * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+        }
+        glBufferSubData(GL_TEXTURE_BUFFER,
+                        uploaded * TRANSFORM_TEXELS * sizeof(glm::vec4),
+                        (count - uploaded) * TRANSFORM_TEXELS * sizeof(glm::vec4),
+                        &data[uploaded * TRANSFORM_TEXELS]);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        uploaded = count;
+    }
+
+    // bind the buffer for a shader that reads "transforms"
+    void bind(Shader &shader)
+    {
+        flush();
+        shader.use();
+        shader.setInt("transforms", TRANSFORM_TEXTURE_UNIT);
+        glActiveTexture(GL_TEXTURE0 + TRANSFORM_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, transformTexture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    int getCount() const
+    {
+        return (int)data.size() / TRANSFORM_TEXELS;
+    }
+
+    const glm::mat4& getViewProjection() const
+    {
+        return viewProjection;
+    }
+
+private:
+    unsigned int transformTBO;
+    unsigned int transformTexture;
+    int capacity;
+    int uploaded = 0;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    vector<glm::vec4> data;
+};
+
+#endif /* transformBuffer_h */
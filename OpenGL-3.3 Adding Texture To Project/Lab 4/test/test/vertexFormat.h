@@ -0,0 +1,229 @@
+//
+//  vertexFormat.h
+//  test
+//
+
+#ifndef vertexFormat_h
+#define vertexFormat_h
+
+#include <glad/glad.h>
+#include <vector>
+#include <cstring>
+#include <glm/glm.hpp>
+
+using namespace std;
+
+// how one attribute is stored in the vertex buffer
+enum AttribEncoding{
+    ATTRIB_FLOAT,               // GL_FLOAT, 4 bytes per component
+    ATTRIB_HALF,                // GL_HALF_FLOAT, 2 bytes per component, e.g. texture coordinates
+    ATTRIB_SNORM16,             // normalized GL_SHORT, quantized positions in [-1, 1]
+    ATTRIB_SNORM_2_10_10_10     // normalized GL_INT_2_10_10_10_REV, xyz in 4 bytes, unit normals
+};
+
+struct VertexAttrib{
+    int location;
+    int components;             // as read from the source data
+    AttribEncoding encoding;
+    int sourceOffset;           // in floats, into a source vertex
+    int offset;                 // in bytes, into a packed vertex
+};
+
+unsigned short floatToHalf(float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    unsigned int sign = (bits >> 16) & 0x8000;
+    int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+    unsigned int mantissa = bits & 0x7FFFFF;
+    if(exponent >= 31)
+    {
+        // too large for half: infinity, NaN stays NaN
+        bool nan = (bits & 0x7FFFFFFF) > 0x7F800000;
+        return (unsigned short)(sign | 0x7C00 | (nan ? 0x200 : 0));
+    }
+    if(exponent <= 0)
+    {
+        // subnormal half, or zero once even the implicit bit is shifted out
+        if(exponent < -10)
+            return (unsigned short)sign;
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        unsigned int half = mantissa >> shift;
+        if((mantissa >> (shift - 1)) & 1)
+            half++;
+        return (unsigned short)(sign | half);
+    }
+    unsigned int half = sign | (exponent << 10) | (mantissa >> 13);
+    // round to nearest, a carry into the exponent is still the right result
+    if(mantissa & 0x1000)
+        half++;
+    return (unsigned short)half;
+}
+
+short packSnorm16(float value)
+{
+    return (short)roundf(glm::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+unsigned int packSnorm2_10_10_10(float x, float y, float z)
+{
+    unsigned int px = (unsigned int)(int)roundf(glm::clamp(x, -1.0f, 1.0f) * 511.0f) & 0x3FF;
+    unsigned int py = (unsigned int)(int)roundf(glm::clamp(y, -1.0f, 1.0f) * 511.0f) & 0x3FF;
+    unsigned int pz = (unsigned int)(int)roundf(glm::clamp(z, -1.0f, 1.0f) * 511.0f) & 0x3FF;
+    return px | (py << 10) | (pz << 20);
+}
+
+// Describes the layout of a vertex in a GL buffer. The attrib pointers of a VAO are
+// set up from it, and vertices generated as plain floats are packed into it, so
+// mesh code only ever writes floats and picks a format.
+class VertexFormat{
+public:
+    VertexFormat() {}
+
+    // components: 2 or 3 (ATTRIB_SNORM_2_10_10_10 takes 3)
+    VertexFormat& add(int location, int components, AttribEncoding encoding, int sourceOffset)
+    {
+        VertexAttrib attrib;
+        attrib.location = location;
+        attrib.components = components;
+        attrib.encoding = encoding;
+        attrib.sourceOffset = sourceOffset;
+        attrib.offset = stride;
+        attribs.push_back(attrib);
+        stride += getAttribSize(attrib);
+        return *this;
+    }
+
+    // bytes per vertex
+    int getStride() const
+    {
+        return stride;
+    }
+
+    const vector<VertexAttrib>& getAttribs() const
+    {
+        return attribs;
+    }
+
+    // attrib pointers of the bound VAO into the bound GL_ARRAY_BUFFER; locationMask picks
+    // the attributes to enable, e.g. position only for depth passes
+    void setUpAttributes(unsigned int locationMask = ~0u) const
+    {
+        for(size_t i = 0; i < attribs.size(); i++)
+        {
+            const VertexAttrib &a = attribs[i];
+            if(!(locationMask & (1u << a.location)))
+                continue;
+            void *offset = (void*)(size_t)a.offset;
+            if(a.encoding == ATTRIB_FLOAT)
+                glVertexAttribPointer(a.location, a.components, GL_FLOAT, GL_FALSE, stride, offset);
+            else if(a.encoding == ATTRIB_HALF)
+                glVertexAttribPointer(a.location, getPaddedComponents(a), GL_HALF_FLOAT, GL_FALSE, stride, offset);
+            else if(a.encoding == ATTRIB_SNORM16)
+                glVertexAttribPointer(a.location, getPaddedComponents(a), GL_SHORT, GL_TRUE, stride, offset);
+            else
+                glVertexAttribPointer(a.location, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, offset);
+            glEnableVertexAttribArray(a.location);
+        }
+    }
+
+    // packs vertexCount vertices of sourceStride floats each into destination
+    void pack(const float *source, int sourceStride, size_t vertexCount, void *destination) const
+    {
+        unsigned char *out = (unsigned char*)destination;
+        for(size_t v = 0; v < vertexCount; v++, source += sourceStride, out += stride)
+        {
+            for(size_t i = 0; i < attribs.size(); i++)
+            {
+                const VertexAttrib &a = attribs[i];
+                const float *in = source + a.sourceOffset;
+                unsigned char *dst = out + a.offset;
+                if(a.encoding == ATTRIB_FLOAT)
+                    memcpy(dst, in, a.components * sizeof(float));
+                else if(a.encoding == ATTRIB_HALF)
+                {
+                    unsigned short h[4] = { 0, 0, 0, 0 };
+                    for(int c = 0; c < a.components; c++)
+                        h[c] = floatToHalf(in[c]);
+                    memcpy(dst, h, getPaddedComponents(a) * sizeof(unsigned short));
+                }
+                else if(a.encoding == ATTRIB_SNORM16)
+                {
+                    short q[4] = { 0, 0, 0, 0 };
+                    for(int c = 0; c < a.components; c++)
+                        q[c] = packSnorm16(in[c]);
+                    memcpy(dst, q, getPaddedComponents(a) * sizeof(short));
+                }
+                else
+                {
+                    unsigned int n = packSnorm2_10_10_10(in[0], in[1], in[2]);
+                    memcpy(dst, &n, sizeof(n));
+                }
+            }
+        }
+    }
+
+    // position + normal, from 6 floats per vertex
+    static VertexFormat positionNormal(bool compact)
+    {
+        VertexFormat format;
+        if(compact)
+            format.add(0, 3, ATTRIB_SNORM16, 0).add(1, 3, ATTRIB_SNORM_2_10_10_10, 3);
+        else
+            format.add(0, 3, ATTRIB_FLOAT, 0).add(1, 3, ATTRIB_FLOAT, 3);
+        return format;
+    }
+
+    // position + normal + texture coordinates, from 8 floats per vertex
+    static VertexFormat positionNormalTexture(bool compact)
+    {
+        VertexFormat format = positionNormal(compact);
+        format.add(2, 2, compact ? ATTRIB_HALF : ATTRIB_FLOAT, 6);
+        return format;
+    }
+
+private:
+    vector<VertexAttrib> attribs;
+    int stride = 0;
+
+    // three component attributes are padded to four to keep every attribute 4-byte aligned
+    static int getPaddedComponents(const VertexAttrib &a)
+    {
+        return a.components == 3 ? 4 : a.components;
+    }
+
+    static int getAttribSize(const VertexAttrib &a)
+    {
+        if(a.encoding == ATTRIB_FLOAT)
+            return a.components * 4;
+        if(a.encoding == ATTRIB_SNORM_2_10_10_10)
+            return 4;
+        return getPaddedComponents(a) * 2;
+    }
+};
+
+// GL_UNSIGNED_SHORT when every index fits in 16 bits
+GLenum getIndexTypeFor(size_t vertexCount)
+{
+    return vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+int getIndexTypeSize(GLenum indexType)
+{
+    return indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+}
+
+void packIndices(const unsigned int *source, size_t indexCount, GLenum indexType, void *destination)
+{
+    if(indexType == GL_UNSIGNED_INT)
+    {
+        memcpy(destination, source, indexCount * sizeof(unsigned int));
+        return;
+    }
+    unsigned short *out = (unsigned short*)destination;
+    for(size_t i = 0; i < indexCount; i++)
+        out[i] = (unsigned short)source[i];
+}
+
+#endif /* vertexFormat_h */
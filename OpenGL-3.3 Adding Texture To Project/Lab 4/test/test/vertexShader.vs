@@ -1,11 +1,16 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// same gl_Position in every program, needed for the GL_EQUAL color pass after the depth pre-pass
+invariant gl_Position;
+
+// per-object transforms, 11 texels per object; only the MVP is needed here
+uniform samplerBuffer transforms;
+uniform int objectIndex;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    int base = (objectIndex + gl_InstanceID) * 11;
+    mat4 mvp = mat4(texelFetch(transforms, base + 7), texelFetch(transforms, base + 8), texelFetch(transforms, base + 9), texelFetch(transforms, base + 10));
+    gl_Position = mvp * vec4(aPos, 1.0);
 }
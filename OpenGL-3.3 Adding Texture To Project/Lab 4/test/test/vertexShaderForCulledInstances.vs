@@ -0,0 +1,27 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+// object index of the instance, from the culling pass's compacted survivors (see gpuCulling.h)
+layout (location = 3) in int aObjectIndex;
+
+out vec3 FragPos;
+out vec3 Normal;
+flat out int MaterialIndex;
+
+// model and normal matrix per object (see transformBuffer.h); the instances' transforms are
+// uploaded once, so the stored MVP is stale and the view-projection comes as a uniform
+uniform samplerBuffer transforms;
+uniform mat4 viewProjection;
+
+void main()
+{
+    int base = aObjectIndex * 11;
+    mat4 model = mat4(texelFetch(transforms, base + 0), texelFetch(transforms, base + 1), texelFetch(transforms, base + 2), texelFetch(transforms, base + 3));
+    vec4 normalColumn = texelFetch(transforms, base + 4);
+    mat3 normalMatrix = mat3(normalColumn.xyz, texelFetch(transforms, base + 5).xyz, texelFetch(transforms, base + 6).xyz);
+    
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
+    Normal = normalMatrix * aNormal;
+    MaterialIndex = int(normalColumn.w);
+}
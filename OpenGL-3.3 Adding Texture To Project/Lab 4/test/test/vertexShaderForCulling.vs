@@ -0,0 +1,19 @@
+#version 330 core
+// one point per instance: world bounding sphere and the object index its draw reads
+layout (location = 0) in vec4 aBounds;
+layout (location = 1) in int aObjectIndex;
+
+flat out int Visible;
+flat out int ObjectIndex;
+
+// frustum planes in world space, xyz points inside (see frustum.h)
+uniform vec4 frustumPlanes[6];
+
+void main()
+{
+    Visible = 1;
+    for(int i = 0; i < 6; i++)
+        if(dot(frustumPlanes[i].xyz, aBounds.xyz) + frustumPlanes[i].w < -aBounds.w)
+            Visible = 0;
+    ObjectIndex = aObjectIndex;
+}
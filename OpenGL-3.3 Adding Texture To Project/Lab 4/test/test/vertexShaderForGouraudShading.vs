@@ -4,9 +4,12 @@ layout (location = 1) in vec3 aNormal;
 
 out vec4 LightingColor;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// same gl_Position in every program, needed for the GL_EQUAL color pass after the depth pre-pass
+invariant gl_Position;
+
+// per-object model, normal matrix and MVP, 11 texels per object (see transformBuffer.h)
+uniform samplerBuffer transforms;
+uniform int objectIndex;
 
 struct Material {
     vec3 ambient;
@@ -65,10 +68,15 @@ vec3 CalcSpotLight(Material material, SpotLight light, vec3 N, vec3 Pos, vec3 V)
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    int base = (objectIndex + gl_InstanceID) * 11;
+    mat4 model = mat4(texelFetch(transforms, base + 0), texelFetch(transforms, base + 1), texelFetch(transforms, base + 2), texelFetch(transforms, base + 3));
+    mat3 normalMatrix = mat3(texelFetch(transforms, base + 4).xyz, texelFetch(transforms, base + 5).xyz, texelFetch(transforms, base + 6).xyz);
+    mat4 mvp = mat4(texelFetch(transforms, base + 7), texelFetch(transforms, base + 8), texelFetch(transforms, base + 9), texelFetch(transforms, base + 10));
+    
+    gl_Position = mvp * vec4(aPos, 1.0);
     
      vec3 Pos = vec3(model * vec4(aPos, 1.0));
-    vec3 Normal = mat3(transpose(inverse(model))) * aNormal;
+    vec3 Normal = normalMatrix * aNormal;
     
     // properties
     vec3 N = normalize(Normal);
@@ -4,16 +4,27 @@ layout (location = 1) in vec3 aNormal;
 
 out vec3 FragPos;
 out vec3 Normal;
+flat out int MaterialIndex;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// same gl_Position in every program, needed for the GL_EQUAL color pass after the depth pre-pass
+invariant gl_Position;
+
+// per-object model, normal matrix and MVP, 11 texels per object (see transformBuffer.h)
+uniform samplerBuffer transforms;
+uniform int objectIndex;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    int base = (objectIndex + gl_InstanceID) * 11;
+    mat4 model = mat4(texelFetch(transforms, base + 0), texelFetch(transforms, base + 1), texelFetch(transforms, base + 2), texelFetch(transforms, base + 3));
+    vec4 normalColumn = texelFetch(transforms, base + 4);
+    mat3 normalMatrix = mat3(normalColumn.xyz, texelFetch(transforms, base + 5).xyz, texelFetch(transforms, base + 6).xyz);
+    mat4 mvp = mat4(texelFetch(transforms, base + 7), texelFetch(transforms, base + 8), texelFetch(transforms, base + 9), texelFetch(transforms, base + 10));
+    
+    gl_Position = mvp * vec4(aPos, 1.0);
     
     FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = normalMatrix * aNormal;
+    MaterialIndex = int(normalColumn.w);
     
 }
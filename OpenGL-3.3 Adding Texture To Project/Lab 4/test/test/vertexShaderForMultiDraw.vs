@@ -0,0 +1,32 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+// object index of the draw: read per instance through the command's baseInstance with
+// multi-draw indirect, a constant attribute when drawn one at a time (see meshPool.h)
+layout (location = 3) in int aObjectIndex;
+
+out vec3 FragPos;
+out vec3 Normal;
+flat out int MaterialIndex;
+
+// same gl_Position in every program, needed for the GL_EQUAL color pass after the depth pre-pass
+invariant gl_Position;
+
+// per-object model, normal matrix and MVP, 11 texels per object (see transformBuffer.h)
+uniform samplerBuffer transforms;
+
+void main()
+{
+    int base = aObjectIndex * 11;
+    mat4 model = mat4(texelFetch(transforms, base + 0), texelFetch(transforms, base + 1), texelFetch(transforms, base + 2), texelFetch(transforms, base + 3));
+    vec4 normalColumn = texelFetch(transforms, base + 4);
+    mat3 normalMatrix = mat3(normalColumn.xyz, texelFetch(transforms, base + 5).xyz, texelFetch(transforms, base + 6).xyz);
+    mat4 mvp = mat4(texelFetch(transforms, base + 7), texelFetch(transforms, base + 8), texelFetch(transforms, base + 9), texelFetch(transforms, base + 10));
+    
+    gl_Position = mvp * vec4(aPos, 1.0);
+    
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = normalMatrix * aNormal;
+    MaterialIndex = int(normalColumn.w);
+    
+}
@@ -0,0 +1,14 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+// per-object transforms, 11 texels per object; only the model matrix is needed here
+uniform samplerBuffer transforms;
+uniform int objectIndex;
+
+void main()
+{
+    int base = (objectIndex + gl_InstanceID) * 11;
+    mat4 model = mat4(texelFetch(transforms, base + 0), texelFetch(transforms, base + 1), texelFetch(transforms, base + 2), texelFetch(transforms, base + 3));
+    // world position, the geometry shader projects it once per cube face
+    gl_Position = model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+// per-object transforms, 11 texels per object; only the model matrix is needed here
+uniform samplerBuffer transforms;
+uniform int objectIndex;
+
+// projection * view of the cascade or spot light being rendered
+uniform mat4 lightSpaceMatrix;
+
+void main()
+{
+    int base = (objectIndex + gl_InstanceID) * 11;
+    mat4 model = mat4(texelFetch(transforms, base + 0), texelFetch(transforms, base + 1), texelFetch(transforms, base + 2), texelFetch(transforms, base + 3));
+    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+}
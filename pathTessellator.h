@@ -0,0 +1,433 @@
+//
+//  pathTessellator.h
+//  triangle
+//
+
+#ifndef pathTessellator_h
+#define pathTessellator_h
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+// which points a path's fill covers, from the winding number of its contours around them
+enum FillRule{
+    FILL_NONZERO,       // any nonzero winding, SVG's default
+    FILL_EVEN_ODD       // odd windings only, so overlaps and same-direction holes are left out
+};
+
+// most segments a curve is flattened into, whatever the tolerance
+const int PATH_MAX_CURVE_SEGMENTS = 1024;
+
+// the triangles of a path's fill, in path space
+struct PathFill{
+    vector<glm::vec2> vertices;
+    vector<unsigned int> indices;
+    int edgeCount = 0;          // flattened edges the fill was built from
+};
+
+class FillTessellator;
+
+// A 2D vector path as in SVG or canvas: contours of lines and quadratic and cubic
+// Beziers. Every contour is closed when filled. getFill() keeps the last tessellation
+// and hands it back while the path, fill rule and tolerance are unchanged, so a path
+// that only moves, turns or scales costs nothing after its first frame.
+class Path{
+public:
+    void moveTo(const glm::vec2 &p)
+    {
+        verbs.push_back(VERB_MOVE);
+        points.push_back(p);
+        start = p;
+        version++;
+    }
+
+    void lineTo(const glm::vec2 &p)
+    {
+        beginContourIfNeeded();
+        verbs.push_back(VERB_LINE);
+        points.push_back(p);
+        version++;
+    }
+
+    void quadTo(const glm::vec2 &control, const glm::vec2 &p)
+    {
+        beginContourIfNeeded();
+        verbs.push_back(VERB_QUAD);
+        points.push_back(control);
+        points.push_back(p);
+        version++;
+    }
+
+    void cubicTo(const glm::vec2 &control1, const glm::vec2 &control2, const glm::vec2 &p)
+    {
+        beginContourIfNeeded();
+        verbs.push_back(VERB_CUBIC);
+        points.push_back(control1);
+        points.push_back(control2);
+        points.push_back(p);
+        version++;
+    }
+
+    // the next segment starts a new contour at the start of this one
+    void close()
+    {
+        if(verbs.empty() || verbs.back() == VERB_CLOSE)
+            return;
+        verbs.push_back(VERB_CLOSE);
+        version++;
+    }
+
+    void clear()
+    {
+        verbs.clear();
+        points.clear();
+        version++;
+    }
+
+    bool isEmpty() const
+    {
+        return verbs.empty();
+    }
+
+    // contours as polygons whose points are at most tolerance from the curves, appended
+    // to polygonPoints with each contour's end in contourEnds
+    void flatten(float tolerance, vector<glm::vec2> &polygonPoints, vector<int> &contourEnds) const
+    {
+        size_t p = 0;
+        glm::vec2 current(0.0f);
+        for(size_t i = 0; i < verbs.size(); i++)
+        {
+            switch(verbs[i])
+            {
+            case VERB_MOVE:
+                endContour(polygonPoints, contourEnds);
+                current = points[p++];
+                polygonPoints.push_back(current);
+                break;
+            case VERB_LINE:
+                current = points[p++];
+                polygonPoints.push_back(current);
+                break;
+            case VERB_QUAD:
+                flattenQuad(current, points[p], points[p + 1], tolerance, polygonPoints);
+                current = points[p + 1];
+                p += 2;
+                break;
+            case VERB_CUBIC:
+                flattenCubic(current, points[p], points[p + 1], points[p + 2], tolerance, polygonPoints);
+                current = points[p + 2];
+                p += 3;
+                break;
+            case VERB_CLOSE:
+                endContour(polygonPoints, contourEnds);
+                break;
+            }
+        }
+        endContour(polygonPoints, contourEnds);
+    }
+
+    // the fill's triangles, tessellated again only if the path, rule or tolerance changed
+    const PathFill& getFill(FillTessellator &tessellator, FillRule rule, float tolerance);
+
+private:
+    enum Verb{ VERB_MOVE, VERB_LINE, VERB_QUAD, VERB_CUBIC, VERB_CLOSE };
+
+    vector<unsigned char> verbs;
+    vector<glm::vec2> points;       // the points each verb takes, one after another
+    glm::vec2 start = glm::vec2(0.0f);
+    unsigned int version = 0;
+
+    PathFill fill;
+    unsigned int fillVersion = ~0u;
+    FillRule fillRule = FILL_NONZERO;
+    float fillTolerance = 0.0f;
+
+    // segments after close() or before any moveTo() start at the last contour's start
+    void beginContourIfNeeded()
+    {
+        if(verbs.empty() || verbs.back() == VERB_CLOSE)
+        {
+            verbs.push_back(VERB_MOVE);
+            points.push_back(start);
+        }
+    }
+
+    static void endContour(vector<glm::vec2> &polygonPoints, vector<int> &contourEnds)
+    {
+        int begin = contourEnds.empty() ? 0 : contourEnds.back();
+        if((int)polygonPoints.size() > begin)
+            contourEnds.push_back((int)polygonPoints.size());
+    }
+
+    // Wang's formula: segments of an evenly split Bezier of this degree that keep every
+    // point within tolerance, from the largest second difference of its control points
+    static int curveSegments(float degreeFactor, float secondDifference, float tolerance)
+    {
+        float n = ceilf(sqrtf(degreeFactor * secondDifference / tolerance));
+        return (int)glm::clamp(n, 1.0f, (float)PATH_MAX_CURVE_SEGMENTS);
+    }
+
+    static void flattenQuad(const glm::vec2 &p0, const glm::vec2 &p1, const glm::vec2 &p2, float tolerance, vector<glm::vec2> &out)
+    {
+        int n = curveSegments(0.25f, glm::length(p0 - 2.0f * p1 + p2), tolerance);
+        for(int i = 1; i < n; i++)
+        {
+            float t = (float)i / n, u = 1.0f - t;
+            out.push_back(u * u * p0 + 2.0f * u * t * p1 + t * t * p2);
+        }
+        out.push_back(p2);
+    }
+
+    static void flattenCubic(const glm::vec2 &p0, const glm::vec2 &p1, const glm::vec2 &p2, const glm::vec2 &p3, float tolerance, vector<glm::vec2> &out)
+    {
+        float dd = glm::max(glm::length(p0 - 2.0f * p1 + p2), glm::length(p1 - 2.0f * p2 + p3));
+        int n = curveSegments(0.75f, dd, tolerance);
+        for(int i = 1; i < n; i++)
+        {
+            float t = (float)i / n, u = 1.0f - t;
+            out.push_back(u * u * u * p0 + 3.0f * u * u * t * p1 + 3.0f * u * t * t * p2 + t * t * t * p3);
+        }
+        out.push_back(p3);
+    }
+};
+
+// Fills flattened paths with a horizontal sweep. The plane is cut at the y of every
+// vertex and every crossing of two edges, so inside one slab no edges cross and their
+// left-to-right order fixes the winding number of every span between them; the spans
+// inside the fill become trapezoids, and a trapezoid grows through the next slabs for
+// as long as the same two edges bound it. Self-intersections, holes and overlapping
+// contours need no special cases under either fill rule. Keeps its work buffers
+// between paths, so tessellating a whole set reuses one allocation.
+class FillTessellator{
+public:
+    void tessellate(const Path &path, FillRule rule, float tolerance, PathFill &out)
+    {
+        polygonPoints.clear();
+        contourEnds.clear();
+        path.flatten(tolerance, polygonPoints, contourEnds);
+        out.vertices.clear();
+        out.indices.clear();
+        buildEdges();
+        out.edgeCount = (int)edges.size();
+        sweep(rule, out);
+    }
+
+private:
+    // an edge ordered top to bottom, winding +1 if the contour runs down it
+    struct Edge{
+        float yTop, yBottom;
+        float xTop, slope;      // x = xTop + slope * (y - yTop)
+        int winding;
+
+        float xAt(float y) const
+        {
+            return xTop + slope * (y - yTop);
+        }
+    };
+
+    // a trapezoid between two edges, open from yStart
+    struct Span{
+        int left, right;
+        float yStart;
+    };
+
+    vector<glm::vec2> polygonPoints;
+    vector<int> contourEnds;
+    vector<Edge> edges;
+    vector<float> stops;
+    vector<int> active;
+    vector<Span> open;
+    vector<Span> spans;
+
+    void buildEdges()
+    {
+        edges.clear();
+        stops.clear();
+        int begin = 0;
+        for(size_t c = 0; c < contourEnds.size(); c++)
+        {
+            int end = contourEnds[c];
+            for(int i = begin; i < end; i++)
+            {
+                glm::vec2 a = polygonPoints[i];
+                glm::vec2 b = polygonPoints[i + 1 < end ? i + 1 : begin];
+                // horizontal edges bound no slab
+                if(a.y == b.y)
+                    continue;
+                Edge e;
+                e.winding = a.y < b.y ? 1 : -1;
+                if(a.y > b.y)
+                    swap(a, b);
+                e.yTop = a.y;
+                e.yBottom = b.y;
+                e.xTop = a.x;
+                e.slope = (b.x - a.x) / (b.y - a.y);
+                edges.push_back(e);
+                stops.push_back(a.y);
+                stops.push_back(b.y);
+            }
+            begin = end;
+        }
+        sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) { return a.yTop < b.yTop; });
+        sort(stops.begin(), stops.end());
+        stops.erase(unique(stops.begin(), stops.end()), stops.end());
+    }
+
+    bool isInside(int winding, FillRule rule) const
+    {
+        return rule == FILL_NONZERO ? winding != 0 : (winding & 1) != 0;
+    }
+
+    void sweep(FillRule rule, PathFill &out)
+    {
+        active.clear();
+        open.clear();
+        if(stops.size() < 2)
+            return;
+        size_t nextEdge = 0;
+        size_t stop = 1;
+        float y0 = stops[0];
+        while(stop < stops.size())
+        {
+            float y1 = stops[stop];
+            while(nextEdge < edges.size() && edges[nextEdge].yTop <= y0)
+                active.push_back((int)nextEdge++);
+            size_t kept = 0;
+            for(size_t i = 0; i < active.size(); i++)
+                if(edges[active[i]].yBottom > y0)
+                    active[kept++] = active[i];
+            active.resize(kept);
+            sortActive(y0);
+
+            // the slab ends early at the first crossing of two neighbours
+            float minimumHeight = 1e-6f * (1.0f + fabsf(y0));
+            for(size_t i = 0; i + 1 < active.size(); i++)
+            {
+                const Edge &a = edges[active[i]];
+                const Edge &b = edges[active[i + 1]];
+                if(a.xAt(y1) > b.xAt(y1) && a.slope != b.slope)
+                {
+                    float y = y0 + (b.xAt(y0) - a.xAt(y0)) / (a.slope - b.slope);
+                    if(y > y0 + minimumHeight && y < y1)
+                        y1 = y;
+                }
+            }
+
+            collectSpans(rule, y0);
+            closeSpans(y0, out);
+            if(y1 >= stops[stop])
+                stop++;
+            y0 = y1;
+        }
+        spans.clear();
+        closeSpans(y0, out);
+    }
+
+    // left to right at y, ties broken by where the edges go next; x within rounding of
+    // each other counts as a tie, as two edges leaving the crossing the slab ended at
+    // do. The order barely changes from one slab to the next, so an insertion sort is
+    // close to linear
+    void sortActive(float y)
+    {
+        for(size_t i = 1; i < active.size(); i++)
+        {
+            int e = active[i];
+            float x = edges[e].xAt(y);
+            float slope = edges[e].slope;
+            size_t j = i;
+            while(j > 0)
+            {
+                const Edge &previous = edges[active[j - 1]];
+                float px = previous.xAt(y);
+                float tie = 1e-5f * (1.0f + fabsf(x) + fabsf(px));
+                if(px < x - tie || (px <= x + tie && previous.slope <= slope))
+                    break;
+                active[j] = active[j - 1];
+                j--;
+            }
+            active[j] = e;
+        }
+    }
+
+    // the maximal spans of the slab from y0 inside the fill
+    void collectSpans(FillRule rule, float y0)
+    {
+        spans.clear();
+        int winding = 0;
+        int left = -1;
+        for(size_t i = 0; i < active.size(); i++)
+        {
+            bool wasInside = isInside(winding, rule);
+            winding += edges[active[i]].winding;
+            bool inside = isInside(winding, rule);
+            if(!wasInside && inside)
+                left = active[i];
+            else if(wasInside && !inside)
+            {
+                Span span = { left, active[i], y0 };
+                spans.push_back(span);
+            }
+        }
+    }
+
+    // spans still bounded by the same two edges stay open, the others become trapezoids
+    // ending at y; open then holds this slab's spans
+    void closeSpans(float y, PathFill &out)
+    {
+        for(size_t i = 0; i < spans.size(); i++)
+            for(size_t j = 0; j < open.size(); j++)
+                if(open[j].left == spans[i].left && open[j].right == spans[i].right)
+                {
+                    spans[i].yStart = open[j].yStart;
+                    open[j].left = -1;
+                    break;
+                }
+        for(size_t j = 0; j < open.size(); j++)
+            if(open[j].left >= 0)
+                addTrapezoid(edges[open[j].left], edges[open[j].right], open[j].yStart, y, out);
+        open.swap(spans);
+    }
+
+    void addTrapezoid(const Edge &left, const Edge &right, float yTop, float yBottom, PathFill &out)
+    {
+        if(yBottom <= yTop)
+            return;
+        unsigned int base = (unsigned int)out.vertices.size();
+        out.vertices.push_back(glm::vec2(left.xAt(yTop), yTop));
+        out.vertices.push_back(glm::vec2(right.xAt(yTop), yTop));
+        out.vertices.push_back(glm::vec2(right.xAt(yBottom), yBottom));
+        out.vertices.push_back(glm::vec2(left.xAt(yBottom), yBottom));
+        unsigned int quad[6] = { 0, 1, 2, 0, 2, 3 };
+        for(int i = 0; i < 6; i++)
+            out.indices.push_back(base + quad[i]);
+    }
+};
+
+const PathFill& Path::getFill(FillTessellator &tessellator, FillRule rule, float tolerance)
+{
+    if(fillVersion != version || fillRule != rule || fillTolerance != tolerance)
+    {
+        tessellator.tessellate(*this, rule, tolerance, fill);
+        fillVersion = version;
+        fillRule = rule;
+        fillTolerance = tolerance;
+    }
+    return fill;
+}
+
+// Flattening tolerance in path units for drawing under transform onto a viewport
+// viewportHeight pixels high, rounded down to a power of two so a path that zooms a
+// little keeps its cached fill; halving the size can only make the curves finer.
+float pathTolerance(const glm::mat4 &transform, int viewportHeight, float pixelTolerance = 0.25f)
+{
+    float scale = sqrtf(fabsf(transform[0][0] * transform[1][1] - transform[0][1] * transform[1][0])) * viewportHeight * 0.5f;
+    if(scale <= 0.0f)
+        return 1.0f;
+    return exp2f(floorf(log2f(pixelTolerance / scale)));
+}
+
+#endif /* pathTessellator_h */
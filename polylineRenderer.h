@@ -0,0 +1,286 @@
+//
+//  polylineRenderer.h
+//  triangle
+//
+
+#ifndef polylineRenderer_h
+#define polylineRenderer_h
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <iostream>
+#include "primitiveBatch.h"
+
+using namespace std;
+
+// how two segments of a polyline meet
+enum LineJoin{
+    JOIN_MITER,     // outer edges extended to a point, bevelled past the miter limit
+    JOIN_BEVEL      // outer corners cut off by a triangle
+};
+
+// one point of the renderer's stream; 16 bytes
+struct PolylinePoint{
+    glm::vec2 position;
+    float width;            // in pixels, negated on the last point of each polyline
+    unsigned int color;     // packColor()
+};
+
+// vertices the vertex shader expands each segment into: a quad and the bevel triangle at its end
+const int POLYLINE_SEGMENT_VERTICES = 9;
+
+const char *polylineVertexShaderSource = "#version 330 core\n"
+    "layout (location = 0) in vec3 aPrevious;\n"
+    "layout (location = 1) in vec3 aStart;\n"
+    "layout (location = 2) in vec4 aStartColor;\n"
+    "layout (location = 3) in vec3 aEnd;\n"
+    "layout (location = 4) in vec4 aEndColor;\n"
+    "layout (location = 5) in vec3 aNext;\n"
+    "uniform mat4 projection;\n"
+    "uniform vec2 viewport;\n"
+    "uniform float miterLimit;\n"
+    "out vec4 color;\n"
+    "vec2 toScreen(vec2 p)\n"
+    "{\n"
+    "   vec4 clip = projection * vec4(p, 0.0, 1.0);\n"
+    "   return (clip.xy / clip.w * 0.5 + 0.5) * viewport;\n"
+    "}\n"
+    "vec2 direction(vec2 from, vec2 to)\n"
+    "{\n"
+    "   vec2 d = to - from;\n"
+    "   float len = length(d);\n"
+    "   return len > 0.0 ? d / len : vec2(1.0, 0.0);\n"
+    "}\n"
+    "vec2 normalOf(vec2 d)\n"
+    "{\n"
+    "   return vec2(-d.y, d.x);\n"
+    "}\n"
+    // offset of the joint's left corner from the joint point; the plain normal when bevelled
+    "vec2 joinOffset(vec2 n0, vec2 n1, vec2 n, float halfWidth, out bool bevel)\n"
+    "{\n"
+    "   vec2 m = n0 + n1;\n"
+    "   float mLength = length(m);\n"
+    "   float c = mLength > 1e-4 ? dot(m / mLength, n1) : 0.0;\n"
+    "   bevel = c * miterLimit < 1.0;\n"
+    "   return bevel ? n * halfWidth : m / mLength * (halfWidth / c);\n"
+    "}\n"
+    "void main()\n"
+    "{\n"
+    "   int corner = gl_VertexID;\n"
+    // the segment from a polyline's last point to the next polyline's first is not drawn
+    "   if (aStart.z < 0.0)\n"
+    "   {\n"
+    "       color = vec4(0.0);\n"
+    "       gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
+    "       return;\n"
+    "   }\n"
+    "   vec2 a = toScreen(aStart.xy);\n"
+    "   vec2 b = toScreen(aEnd.xy);\n"
+    "   vec2 d = direction(a, b);\n"
+    "   vec2 n = normalOf(d);\n"
+    "   float halfA = aStart.z * 0.5;\n"
+    "   float halfB = abs(aEnd.z) * 0.5;\n"
+    "   bool bevelA = true;\n"
+    "   bool bevelB = true;\n"
+    "   vec2 offsetA = n * halfA;\n"
+    "   vec2 offsetB = n * halfB;\n"
+    "   vec2 nNext = n;\n"
+    "   if (aPrevious.z >= 0.0)\n"
+    "       offsetA = joinOffset(normalOf(direction(toScreen(aPrevious.xy), a)), n, n, halfA, bevelA);\n"
+    "   if (aEnd.z >= 0.0)\n"
+    "   {\n"
+    "       nNext = normalOf(direction(b, toScreen(aNext.xy)));\n"
+    "       offsetB = joinOffset(n, nNext, n, halfB, bevelB);\n"
+    "   }\n"
+    "   vec2 p;\n"
+    "   if (corner < 6)\n"
+    "   {\n"
+    // two triangles: A-, A+, B+ and A-, B+, B-
+    "       bool atEnd = corner == 2 || corner == 4 || corner == 5;\n"
+    "       float side = (corner == 1 || corner == 2 || corner == 4) ? 1.0 : -1.0;\n"
+    "       p = atEnd ? b + side * offsetB : a + side * offsetA;\n"
+    "       color = atEnd ? aEndColor : aStartColor;\n"
+    "   }\n"
+    "   else\n"
+    "   {\n"
+    // the bevel fills the outer side of a turn; collapsed to b when the end is mitered or capped
+    "       float outer = dot(nNext, d) < 0.0 ? -1.0 : 1.0;\n"
+    "       p = b;\n"
+    "       if (bevelB && aEnd.z >= 0.0 && corner > 6)\n"
+    "           p = b + outer * (corner == 7 ? n : nNext) * halfB;\n"
+    "       color = aEndColor;\n"
+    "   }\n"
+    "   gl_Position = vec4(p / viewport * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\0";
+const char *polylineFragmentShaderSource = "#version 330 core\n"
+    "in vec4 color;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "   FragColor = color;\n"
+    "}\n\0";
+
+// Polylines of any pixel width, with per-point width and color, for plots and overlays
+// that GL_LINE_STRIP cannot draw in a core profile. Points of every polyline added in a
+// frame go one after another into a stream buffer, and flush() draws all of them with a
+// single glDrawArraysInstanced: one instance per segment, its previous, start, end and
+// next points read as per-instance attributes at consecutive offsets of the same buffer,
+// expanded by the vertex shader into a quad plus the bevel triangle of its end joint.
+// Polylines are separated by the negated width of their last point; the instance that
+// would bridge two polylines is collapsed. The CPU does nothing but copy 16 bytes per point.
+class PolylineRenderer{
+public:
+    PolylineRenderer()
+    {
+        join = JOIN_MITER;
+        miterLimit = 4.0f;
+        shaderProgram = buildShaderProgram(polylineVertexShaderSource, polylineFragmentShaderSource);
+        projectionLocation = glGetUniformLocation(shaderProgram, "projection");
+        viewportLocation = glGetUniformLocation(shaderProgram, "viewport");
+        miterLimitLocation = glGetUniformLocation(shaderProgram, "miterLimit");
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        for(int i = 0; i < 6; i++)
+        {
+            glEnableVertexAttribArray(i);
+            glVertexAttribDivisor(i, 1);
+        }
+        glBindVertexArray(0);
+        clear();
+    }
+
+    ~PolylineRenderer()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteProgram(shaderProgram);
+    }
+
+    // miterLimit is the longest miter drawn, in widths, as in SVG; longer ones are bevelled
+    void setJoin(LineJoin join, float miterLimit = 4.0f)
+    {
+        this->join = join;
+        this->miterLimit = miterLimit;
+    }
+
+    // a polyline of one width and color
+    void add(const glm::vec2 *points, int count, float width, const glm::vec4 &color)
+    {
+        unsigned int packed = packColor(color);
+        size_t base = reserve(count);
+        for(int i = 0; i < count; i++)
+        {
+            PolylinePoint &p = this->points[base + i];
+            p.position = points[i];
+            p.width = storedWidth(width);
+            p.color = packed;
+        }
+        endPolyline(count);
+    }
+
+    // a polyline with a width and color per point
+    void add(const glm::vec2 *points, const float *widths, const glm::vec4 *colors, int count)
+    {
+        size_t base = reserve(count);
+        for(int i = 0; i < count; i++)
+        {
+            PolylinePoint &p = this->points[base + i];
+            p.position = points[i];
+            p.width = storedWidth(widths[i]);
+            p.color = packColor(colors[i]);
+        }
+        endPolyline(count);
+    }
+
+    int getSegmentCount() const
+    {
+        return segmentCount;
+    }
+
+    bool isPersistent() const
+    {
+        return stream.isPersistent();
+    }
+
+    // draws everything added since the last flush, positions through projection onto a
+    // viewport of this size in pixels, then starts over
+    void flush(const glm::mat4 &projection, int viewportWidth, int viewportHeight)
+    {
+        // the trailing point is only ever read as the next point of a polyline's last segment
+        points.push_back(points[0]);
+        int instances = (int)points.size() - 3;
+        if(segmentCount > 0)
+        {
+            size_t bytes = points.size() * sizeof(PolylinePoint);
+            stream.begin(StreamBuffer::alignSize(bytes));
+            size_t offset = stream.write(points.data(), bytes);
+
+            glUseProgram(shaderProgram);
+            glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, &projection[0][0]);
+            glUniform2f(viewportLocation, (float)viewportWidth, (float)viewportHeight);
+            glUniform1f(miterLimitLocation, join == JOIN_MITER ? miterLimit : 0.0f);
+            glBindVertexArray(VAO);
+            glBindBuffer(GL_ARRAY_BUFFER, stream.getBuffer());
+            // instance i: points i, i + 1, i + 2 and i + 3 as previous, start, end and next
+            const GLsizei stride = sizeof(PolylinePoint);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offset + stride));
+            glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)(offset + stride + 12));
+            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offset + 2 * stride));
+            glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)(offset + 2 * stride + 12));
+            glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offset + 3 * stride));
+            glDrawArraysInstanced(GL_TRIANGLES, 0, POLYLINE_SEGMENT_VERTICES, instances);
+            glBindVertexArray(0);
+            stream.end();
+        }
+        clear();
+    }
+
+private:
+    LineJoin join;
+    float miterLimit;
+    vector<PolylinePoint> points;
+    int segmentCount = 0;
+    StreamBuffer stream;
+    unsigned int VAO = 0;
+    unsigned int shaderProgram = 0;
+    int projectionLocation = -1;
+    int viewportLocation = -1;
+    int miterLimitLocation = -1;
+
+    PolylineRenderer(const PolylineRenderer&);
+    PolylineRenderer& operator=(const PolylineRenderer&);
+
+    // the stream starts with a point marked as an end, the missing previous point of the
+    // first polyline
+    void clear()
+    {
+        points.clear();
+        PolylinePoint start = { glm::vec2(0.0f), -1.0f, 0 };
+        points.push_back(start);
+        segmentCount = 0;
+    }
+
+    size_t reserve(int count)
+    {
+        size_t base = points.size();
+        points.resize(base + count);
+        return base;
+    }
+
+    // a zero width could not carry the end mark, so widths stay above a thousandth of a pixel
+    static float storedWidth(float width)
+    {
+        return glm::max(width, 0.001f);
+    }
+
+    void endPolyline(int count)
+    {
+        if(count <= 0)
+            return;
+        points.back().width = -points.back().width;
+        segmentCount += count - 1;
+    }
+};
+
+#endif /* polylineRenderer_h */
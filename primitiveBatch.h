@@ -0,0 +1,497 @@
+//
+//  primitiveBatch.h
+//  triangle
+//
+
+#ifndef primitiveBatch_h
+#define primitiveBatch_h
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstring>
+#include <iostream>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PRIMITIVE_BATCH_SSE
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define PRIMITIVE_BATCH_NEON
+#endif
+
+// glad headers generated for GL 3.3 alone have no glBufferStorage
+#if defined(GL_VERSION_4_4) || defined(GL_ARB_buffer_storage)
+#define HAS_BUFFER_STORAGE
+#endif
+
+using namespace std;
+
+// frames a persistently mapped stream buffer is split into, so the CPU writes one
+// while the GPU still reads the others
+const int STREAM_BUFFER_FRAMES = 3;
+
+bool isBufferStorageSupported()
+{
+#if defined(GL_VERSION_4_4)
+    if(GLAD_GL_VERSION_4_4)
+        return true;
+#endif
+#if defined(GL_ARB_buffer_storage)
+    if(GLAD_GL_ARB_buffer_storage)
+        return true;
+#endif
+    return false;
+}
+
+// Vertex and index data written anew every frame. With GL 4.4 / ARB_buffer_storage the
+// buffer is mapped once, persistently, and split into STREAM_BUFFER_FRAMES regions; a
+// frame writes the next region after waiting on the fence of its last use, which is
+// three frames old and normally signalled long ago. Without it the buffer is orphaned
+// every frame, so the driver hands out fresh storage instead of stalling on the old one.
+class StreamBuffer{
+public:
+    StreamBuffer()
+    {
+        persistent = isBufferStorageSupported();
+        for(int i = 0; i < STREAM_BUFFER_FRAMES; i++)
+            fences[i] = 0;
+    }
+
+    ~StreamBuffer()
+    {
+        release();
+    }
+
+    bool isPersistent() const
+    {
+        return persistent;
+    }
+
+    unsigned int getBuffer() const
+    {
+        return buffer;
+    }
+
+    // starts a frame that writes at most frameSize bytes (16-byte aligned pieces included)
+    void begin(size_t frameSize)
+    {
+        if(frameSize > regionSize || !buffer)
+        {
+            size_t size = regionSize ? regionSize : 1 << 20;
+            while(size < frameSize)
+                size *= 2;
+            allocate(size);
+        }
+        if(persistent)
+        {
+            region = (region + 1) % STREAM_BUFFER_FRAMES;
+            waitForRegion(region);
+            cursor = region * regionSize;
+        }
+        else
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glBufferData(GL_ARRAY_BUFFER, regionSize, NULL, GL_STREAM_DRAW);
+            cursor = 0;
+        }
+    }
+
+    // copies size bytes into the frame, returns their offset in the buffer
+    size_t write(const void *data, size_t size)
+    {
+        size_t offset = cursor;
+        if(size == 0)
+            return offset;
+        if(persistent)
+            memcpy(mapped + offset, data, size);
+        else
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+        }
+        cursor += alignSize(size);
+        return offset;
+    }
+
+    // call once the frame's draws are issued
+    void end()
+    {
+        if(persistent)
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    static size_t alignSize(size_t size)
+    {
+        return (size + 15) & ~(size_t)15;
+    }
+
+private:
+    bool persistent;
+    unsigned int buffer = 0;
+    unsigned char *mapped = NULL;
+    size_t regionSize = 0;
+    size_t cursor = 0;
+    int region = 0;
+    GLsync fences[STREAM_BUFFER_FRAMES];
+
+    StreamBuffer(const StreamBuffer&);
+    StreamBuffer& operator=(const StreamBuffer&);
+
+    void waitForRegion(int r)
+    {
+        if(!fences[r])
+            return;
+        while(glClientWaitSync(fences[r], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+            ;
+        glDeleteSync(fences[r]);
+        fences[r] = 0;
+    }
+
+    void allocate(size_t size)
+    {
+        release();
+        regionSize = size;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+#ifdef HAS_BUFFER_STORAGE
+        if(persistent)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, regionSize * STREAM_BUFFER_FRAMES, NULL, flags);
+            mapped = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, regionSize * STREAM_BUFFER_FRAMES, flags);
+            if(mapped)
+                return;
+            cout << "persistent mapping failed, orphaning the stream buffer instead" << endl;
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        }
+#endif
+        persistent = false;
+        glBufferData(GL_ARRAY_BUFFER, regionSize, NULL, GL_STREAM_DRAW);
+    }
+
+    void release()
+    {
+        for(int i = 0; i < STREAM_BUFFER_FRAMES; i++)
+            waitForRegion(i);
+        if(!buffer)
+            return;
+        if(mapped)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            mapped = NULL;
+        }
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+};
+
+// a 2D affine transform: x' = a x + c y + e, y' = b x + d y + f
+struct Transform2D{
+    float a, b, c, d, e, f;
+};
+
+// the 2D part of a transform built with glm::translate/rotate/scale around the z axis
+Transform2D toTransform2D(const glm::mat4 &m)
+{
+    Transform2D t = { m[0][0], m[0][1], m[1][0], m[1][1], m[3][0], m[3][1] };
+    return t;
+}
+
+// transforms count points from in to out, two per SIMD operation where available
+void transformPoints2D(const Transform2D &t, const glm::vec2 *in, glm::vec2 *out, size_t count)
+{
+    size_t i = 0;
+#if defined(PRIMITIVE_BATCH_SSE)
+    __m128 ab = _mm_setr_ps(t.a, t.b, t.a, t.b);
+    __m128 cd = _mm_setr_ps(t.c, t.d, t.c, t.d);
+    __m128 ef = _mm_setr_ps(t.e, t.f, t.e, t.f);
+    for(; i + 2 <= count; i += 2)
+    {
+        __m128 p = _mm_loadu_ps(&in[i].x);                         // x0 y0 x1 y1
+        __m128 xs = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 0, 0)); // x0 x0 x1 x1
+        __m128 ys = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 1, 1)); // y0 y0 y1 y1
+        _mm_storeu_ps(&out[i].x, _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, ab), _mm_mul_ps(ys, cd)), ef));
+    }
+#elif defined(PRIMITIVE_BATCH_NEON)
+    float abValues[4] = { t.a, t.b, t.a, t.b };
+    float cdValues[4] = { t.c, t.d, t.c, t.d };
+    float efValues[4] = { t.e, t.f, t.e, t.f };
+    float32x4_t ab = vld1q_f32(abValues);
+    float32x4_t cd = vld1q_f32(cdValues);
+    float32x4_t ef = vld1q_f32(efValues);
+    for(; i + 2 <= count; i += 2)
+    {
+        float32x4_t p = vld1q_f32(&in[i].x);
+        float32x4_t xs = vtrn1q_f32(p, p);
+        float32x4_t ys = vtrn2q_f32(p, p);
+        vst1q_f32(&out[i].x, vmlaq_f32(vmlaq_f32(ef, xs, ab), ys, cd));
+    }
+#endif
+    for(; i < count; i++)
+    {
+        glm::vec2 p = in[i];
+        out[i] = glm::vec2(t.a * p.x + t.c * p.y + t.e, t.b * p.x + t.d * p.y + t.f);
+    }
+}
+
+unsigned char packUnorm8(float value)
+{
+    return (unsigned char)(glm::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+// RGBA8, the byte order GL_UNSIGNED_BYTE attributes read
+unsigned int packColor(const glm::vec4 &color)
+{
+    unsigned char bytes[4] = { packUnorm8(color.x), packUnorm8(color.y), packUnorm8(color.z), packUnorm8(color.w) };
+    unsigned int packed;
+    memcpy(&packed, bytes, sizeof(packed));
+    return packed;
+}
+
+unsigned int compileShader(GLenum type, const char *source, const char *name)
+{
+    unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    int success;
+    char infoLog[512];
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::" << name << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+    return shader;
+}
+
+// a program from inline vertex and fragment sources, errors printed like main()'s
+unsigned int buildShaderProgram(const char *vertexSource, const char *fragmentSource)
+{
+    unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource, "VERTEX");
+    unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource, "FRAGMENT");
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    int success;
+    char infoLog[512];
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    }
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    return program;
+}
+
+const char *primitiveBatchVertexShaderSource = "#version 330 core\n"
+    "layout (location = 0) in vec2 aPos;\n"
+    "layout (location = 1) in vec4 aColor;\n"
+    "uniform mat4 projection;\n"
+    "out vec4 color;\n"
+    "void main()\n"
+    "{\n"
+    "   color = aColor;\n"
+    "   gl_Position = projection * vec4(aPos, 0.0, 1.0);\n"
+    "}\0";
+const char *primitiveBatchFragmentShaderSource = "#version 330 core\n"
+    "in vec4 color;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "   FragColor = color;\n"
+    "}\n\0";
+
+// Immediate-mode 2D drawing: shapes are pushed every frame with the glDrawArrays mode they
+// would have been drawn with, transformed on the CPU by the current transform, and turned
+// into indexed triangle and line lists (strips, fans and loops included). flush() streams
+// the frame's vertices and indices and draws everything in at most two calls, one
+// GL_TRIANGLES and one GL_LINES. Positions and colors are kept in separate arrays so the
+// SIMD transform writes straight into the position array.
+class PrimitiveBatch{
+public:
+    PrimitiveBatch()
+    {
+        transform = toTransform2D(glm::mat4(1.0f));
+        shaderProgram = buildShaderProgram(primitiveBatchVertexShaderSource, primitiveBatchFragmentShaderSource);
+        projectionLocation = glGetUniformLocation(shaderProgram, "projection");
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+    }
+
+    ~PrimitiveBatch()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteProgram(shaderProgram);
+    }
+
+    // applies to the shapes added from now on
+    void setTransform(const glm::mat4 &model)
+    {
+        transform = toTransform2D(model);
+    }
+
+    // mode: GL_TRIANGLES, GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN, GL_LINES, GL_LINE_STRIP or GL_LINE_LOOP
+    void add(GLenum mode, const glm::vec2 *points, int count, const glm::vec4 &color)
+    {
+        unsigned int base = addVertices(points, count, color);
+        if(mode == GL_TRIANGLES)
+        {
+            for(int i = 0; i + 3 <= count; i += 3)
+                addTriangle(base + i, base + i + 1, base + i + 2);
+        }
+        else if(mode == GL_TRIANGLE_STRIP)
+        {
+            // every other triangle swaps its first two vertices to keep the winding
+            for(int i = 0; i + 3 <= count; i++)
+                if(i % 2 == 0)
+                    addTriangle(base + i, base + i + 1, base + i + 2);
+                else
+                    addTriangle(base + i + 1, base + i, base + i + 2);
+        }
+        else if(mode == GL_TRIANGLE_FAN)
+        {
+            for(int i = 1; i + 2 <= count; i++)
+                addTriangle(base, base + i, base + i + 1);
+        }
+        else if(mode == GL_LINES)
+        {
+            for(int i = 0; i + 2 <= count; i += 2)
+                addLine(base + i, base + i + 1);
+        }
+        else if(mode == GL_LINE_STRIP || mode == GL_LINE_LOOP)
+        {
+            for(int i = 0; i + 2 <= count; i++)
+                addLine(base + i, base + i + 1);
+            if(mode == GL_LINE_LOOP && count > 2)
+                addLine(base + count - 1, base);
+        }
+        else
+            cout << "primitive batch: unsupported mode " << mode << endl;
+    }
+
+    // the points of a vertex array of 3 floats per vertex, as the demo's vertices[]
+    void add(GLenum mode, const float *vertices, int count, const glm::vec4 &color)
+    {
+        scratch.resize(count);
+        for(int i = 0; i < count; i++)
+            scratch[i] = glm::vec2(vertices[i * 3], vertices[i * 3 + 1]);
+        add(mode, scratch.data(), count, color);
+    }
+
+    // a triangle list of count points and indexCount indices into them, as a PathFill
+    void addTriangles(const glm::vec2 *points, int count, const unsigned int *indices, int indexCount, const glm::vec4 &color)
+    {
+        unsigned int base = addVertices(points, count, color);
+        size_t first = triangleIndices.size();
+        triangleIndices.resize(first + indexCount);
+        for(int i = 0; i < indexCount; i++)
+            triangleIndices[first + i] = base + indices[i];
+    }
+
+    int getVertexCount() const
+    {
+        return (int)positions.size();
+    }
+
+    int getDrawCallCount() const
+    {
+        return drawCalls;
+    }
+
+    bool isPersistent() const
+    {
+        return stream.isPersistent();
+    }
+
+    // draws everything added since the last flush, then starts over
+    void flush(const glm::mat4 &projection = glm::mat4(1.0f))
+    {
+        drawCalls = 0;
+        if(positions.empty())
+            return;
+        size_t positionBytes = positions.size() * sizeof(glm::vec2);
+        size_t colorBytes = colors.size() * sizeof(unsigned int);
+        size_t triangleBytes = triangleIndices.size() * sizeof(unsigned int);
+        size_t lineBytes = lineIndices.size() * sizeof(unsigned int);
+        stream.begin(StreamBuffer::alignSize(positionBytes) + StreamBuffer::alignSize(colorBytes)
+                     + StreamBuffer::alignSize(triangleBytes) + StreamBuffer::alignSize(lineBytes));
+        size_t positionOffset = stream.write(positions.data(), positionBytes);
+        size_t colorOffset = stream.write(colors.data(), colorBytes);
+        size_t triangleOffset = stream.write(triangleIndices.data(), triangleBytes);
+        size_t lineOffset = stream.write(lineIndices.data(), lineBytes);
+
+        glUseProgram(shaderProgram);
+        glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, &projection[0][0]);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, stream.getBuffer());
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)positionOffset);
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(unsigned int), (void*)colorOffset);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, stream.getBuffer());
+        if(!triangleIndices.empty())
+        {
+            glDrawElements(GL_TRIANGLES, (GLsizei)triangleIndices.size(), GL_UNSIGNED_INT, (void*)triangleOffset);
+            drawCalls++;
+        }
+        if(!lineIndices.empty())
+        {
+            glDrawElements(GL_LINES, (GLsizei)lineIndices.size(), GL_UNSIGNED_INT, (void*)lineOffset);
+            drawCalls++;
+        }
+        glBindVertexArray(0);
+        stream.end();
+
+        positions.clear();
+        colors.clear();
+        triangleIndices.clear();
+        lineIndices.clear();
+    }
+
+private:
+    Transform2D transform;
+    vector<glm::vec2> positions;
+    vector<unsigned int> colors;
+    vector<unsigned int> triangleIndices;
+    vector<unsigned int> lineIndices;
+    vector<glm::vec2> scratch;
+    StreamBuffer stream;
+    unsigned int VAO = 0;
+    unsigned int shaderProgram = 0;
+    int projectionLocation = -1;
+    int drawCalls = 0;
+
+    PrimitiveBatch(const PrimitiveBatch&);
+    PrimitiveBatch& operator=(const PrimitiveBatch&);
+
+    unsigned int addVertices(const glm::vec2 *points, int count, const glm::vec4 &color)
+    {
+        unsigned int base = (unsigned int)positions.size();
+        positions.resize(base + count);
+        transformPoints2D(transform, points, &positions[base], count);
+        colors.resize(base + count, packColor(color));
+        return base;
+    }
+
+    void addTriangle(unsigned int i0, unsigned int i1, unsigned int i2)
+    {
+        triangleIndices.push_back(i0);
+        triangleIndices.push_back(i1);
+        triangleIndices.push_back(i2);
+    }
+
+    void addLine(unsigned int i0, unsigned int i1)
+    {
+        lineIndices.push_back(i0);
+        lineIndices.push_back(i1);
+    }
+};
+
+#endif /* primitiveBatch_h */